@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AudioSink"
+
+#include <string.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Log.h>
+
+#include "AudioSink.h"
+
+namespace android {
+
+AudioSink::AudioSink()
+    : mSampleRate(0),
+      mFormat(AUDIO_FORMAT_PCM_16_BIT),
+      mFrameSize(0),
+      mStarted(false),
+      mData(NULL),
+      mCapacity(0),
+      mWritePos(0),
+      mReadPos(0),
+      mDiscardPos(0),
+      mNumUnderruns(0ll),
+      mPlaying(false),
+      mReachedEOS(false) {
+}
+
+AudioSink::~AudioSink() {
+    close();
+
+    // close() does not join the callback thread, stop() only pauses it and
+    // PlaybackClock may keep the AudioTrack alive. The track promotes its
+    // weak reference to this sink for every callback though, so no callback
+    // is running once the last strong reference is gone.
+    delete[] mData;
+    mData = NULL;
+}
+
+status_t AudioSink::open(
+        uint32_t sampleRate,
+        int32_t channelCount,
+        audio_format_t format,
+        int64_t bufferDurationUs,
+        bool lowLatency) {
+    // The ring is allocated once, a callback of an earlier track could
+    // still be reading it.
+    CHECK(mData == NULL);
+
+    mSampleRate = sampleRate;
+    mFormat = format;
+    mFrameSize = channelCount * audio_bytes_per_sample(format);
+
+    mCapacity = (size_t)(bufferDurationUs * sampleRate / 1000000ll) * mFrameSize;
+    mData = new uint8_t[mCapacity];
+    mWritePos.store(0);
+    mReadPos.store(0);
+    mDiscardPos.store(0);
+    mNumUnderruns.store(0ll);
+    mPlaying.store(false);
+    mReachedEOS.store(false);
+
+    mAudioTrack = new AudioTrack(
+            AUDIO_STREAM_MUSIC,
+            sampleRate,
+            format,
+            audio_channel_out_mask_from_count(channelCount),
+            0 /* frameCount */,
+            lowLatency ? AUDIO_OUTPUT_FLAG_FAST : AUDIO_OUTPUT_FLAG_NONE,
+            this,
+            0 /* notificationFrames */,
+            AUDIO_SESSION_ALLOCATE,
+            AudioTrack::TRANSFER_CALLBACK);
+
+    status_t err = mAudioTrack->initCheck();
+    if (err != OK) {
+        ALOGE("failed to create AudioTrack (%d)", err);
+        close();
+    }
+
+    return err;
+}
+
+void AudioSink::close() {
+    if (mAudioTrack != NULL) {
+        mAudioTrack->stop();
+        mAudioTrack.clear();
+    }
+
+    mStarted = false;
+}
+
+void AudioSink::flush() {
+    if (mAudioTrack == NULL) {
+        return;
+    }
+
+    mDiscardPos.store(mWritePos.load(std::memory_order_relaxed), std::memory_order_release);
+    mPlaying.store(false);
+    mReachedEOS.store(false);
+
+    mAudioTrack->stop();
+    mAudioTrack->flush();
+    mStarted = false;
+}
+
+status_t AudioSink::start() {
+    CHECK(mAudioTrack != NULL);
+
+    status_t err = mAudioTrack->start();
+    if (err == OK) {
+        mStarted = true;
+    }
+
+    return err;
+}
+
+size_t AudioSink::fillBytes() const {
+    size_t readPos = mReadPos.load(std::memory_order_acquire);
+    size_t discardPos = mDiscardPos.load(std::memory_order_acquire);
+
+    return mWritePos.load(std::memory_order_relaxed)
+        - (readPos > discardPos ? readPos : discardPos);
+}
+
+int64_t AudioSink::bytesToDurationUs(size_t bytes) const {
+    if (mFrameSize == 0 || mSampleRate == 0) {
+        return 0ll;
+    }
+
+    return (int64_t)(bytes / mFrameSize) * 1000000ll / mSampleRate;
+}
+
+uint32_t AudioSink::numTrackUnderruns() const {
+    return mAudioTrack != NULL ? mAudioTrack->getUnderrunCount() : 0;
+}
+
+bool AudioSink::discardPending() const {
+    return mReadPos.load(std::memory_order_acquire)
+            < mDiscardPos.load(std::memory_order_relaxed);
+}
+
+size_t AudioSink::write(const void *data, size_t size) {
+    size_t writePos = mWritePos.load(std::memory_order_relaxed);
+    size_t available = mCapacity - (writePos - mReadPos.load(std::memory_order_acquire));
+
+    if (discardPending()) {
+        // Flushed data the callback has not skipped yet still occupies the
+        // ring, write nothing rather than overwrite what it may be reading.
+        return 0;
+    }
+
+    size_t copy = size < available ? size : available;
+    copy -= copy % mFrameSize;
+
+    size_t offset = writePos % mCapacity;
+    size_t first = copy < mCapacity - offset ? copy : mCapacity - offset;
+    memcpy(mData + offset, data, first);
+    memcpy(mData, (const uint8_t *)data + first, copy - first);
+
+    mWritePos.store(writePos + copy, std::memory_order_release);
+
+    if (copy > 0) {
+        // More data after the end of stream, e.g. the next playlist item.
+        mReachedEOS.store(false);
+    }
+
+    return copy;
+}
+
+size_t AudioSink::onMoreData(const AudioTrack::Buffer &buffer) {
+    size_t readPos = mReadPos.load(std::memory_order_relaxed);
+    size_t discardPos = mDiscardPos.load(std::memory_order_acquire);
+    if (readPos < discardPos) {
+        readPos = discardPos;
+        mReadPos.store(readPos, std::memory_order_release);
+    }
+
+    size_t fill = mWritePos.load(std::memory_order_acquire) - readPos;
+
+    size_t copy = buffer.size() < fill ? buffer.size() : fill;
+    copy -= copy % mFrameSize;
+
+    if (copy == 0) {
+        if (mPlaying.load() && !mReachedEOS.load()) {
+            mNumUnderruns.fetch_add(1);
+        }
+        return 0;
+    }
+
+    size_t offset = readPos % mCapacity;
+    size_t first = copy < mCapacity - offset ? copy : mCapacity - offset;
+    memcpy(buffer.data(), mData + offset, first);
+    memcpy(buffer.data() + first, mData, copy - first);
+
+    mReadPos.store(readPos + copy, std::memory_order_release);
+    mPlaying.store(true);
+
+    return copy;
+}
+
+void AudioSink::onUnderrun() {
+    ALOGV("AudioTrack underrun");
+}
+
+}  // namespace android
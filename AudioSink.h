@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUDIO_SINK_H
+#define AUDIO_SINK_H
+
+#include <atomic>
+
+#include <media/AudioTrack.h>
+#include <media/stagefright/foundation/ABase.h>
+
+namespace android {
+
+// Plays PCM 16 or 24 bit through an AudioTrack in callback mode. The player looper
+// copies decoded audio into a lock-free ring and returns right away, the
+// AudioTrack callback thread drains the ring as the device needs data.
+struct AudioSink : public AudioTrack::IAudioTrackCallback {
+    AudioSink();
+
+    // lowLatency asks for a fast track, which AudioFlinger keeps only a
+    // couple of mixer periods of data for. A sink is opened once, another
+    // format takes a new sink.
+    status_t open(
+            uint32_t sampleRate,
+            int32_t channelCount,
+            audio_format_t format,
+            int64_t bufferDurationUs,
+            bool lowLatency);
+    void close();
+
+    // Starts the AudioTrack, typically once the ring holds some data.
+    status_t start();
+    bool started() const { return mStarted; }
+
+    // Copies as many whole frames as fit and returns the number of bytes
+    // taken, never blocks. Looper thread only. Takes nothing while flushed
+    // data is pending, see discardPending().
+    size_t write(const void *data, size_t size);
+
+    // flush() left data in the ring that the callback has not skipped yet.
+    // It only does so while the track runs, the caller has to start it.
+    bool discardPending() const;
+
+    // Drops everything buffered, playback resumes with the next write.
+    void flush();
+
+    // No more data will follow, running dry is no longer an underrun until
+    // the next write.
+    void signalEndOfStream() { mReachedEOS.store(true); }
+
+    sp<AudioTrack> getAudioTrack() const { return mAudioTrack; }
+    size_t frameSize() const { return mFrameSize; }
+    uint32_t sampleRate() const { return mSampleRate; }
+    audio_format_t format() const { return mFormat; }
+
+    size_t capacityBytes() const { return mCapacity; }
+    size_t fillBytes() const;
+    size_t availableBytes() const { return mCapacity - fillBytes(); }
+    int64_t bytesToDurationUs(size_t bytes) const;
+
+    // Times the callback found the ring empty after playback got going, and times the AudioTrack
+    // itself ran out of data.
+    int64_t numUnderruns() const { return mNumUnderruns.load(); }
+    uint32_t numTrackUnderruns() const;
+
+    // AudioTrack::IAudioTrackCallback
+    virtual size_t onMoreData(const AudioTrack::Buffer &buffer);
+    virtual void onUnderrun();
+
+protected:
+    virtual ~AudioSink();
+
+private:
+    sp<AudioTrack> mAudioTrack;
+    uint32_t mSampleRate;
+    audio_format_t mFormat;
+    size_t mFrameSize;
+    bool mStarted;
+
+    uint8_t *mData;
+    size_t mCapacity;
+
+    // Free running byte counters, only ever advanced by their owning side.
+    alignas(64) std::atomic<size_t> mWritePos;
+    alignas(64) std::atomic<size_t> mReadPos;
+
+    // Set by flush(), the consumer skips ahead to it. The ring is never
+    // rewound from the producer side.
+    std::atomic<size_t> mDiscardPos;
+
+    std::atomic<int64_t> mNumUnderruns;
+    // Data has been played since open() or flush(), an empty ring from
+    // here on is an underrun.
+    std::atomic<bool> mPlaying;
+    std::atomic<bool> mReachedEOS;
+
+    DISALLOW_EVIL_CONSTRUCTORS(AudioSink);
+};
+
+}  // namespace android
+
+#endif // AUDIO_SINK_H
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "CodecPool"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaCodec.h>
+#include <utils/Log.h>
+
+#include "CodecPool.h"
+
+namespace android {
+
+// Guess at the buffers a video decoder allocates for a given size, 4:2:0
+// frames for the reference set plus what is queued for display.
+static const int64_t kVideoFramesPerCodec = 16;
+
+static const int64_t kAudioBytesPerCodec = 256ll * 1024;
+
+CodecPool::CodecPool(int64_t maxBytes, int64_t maxIdleUs)
+    : mMaxBytes(maxBytes),
+      mMaxIdleUs(maxIdleUs),
+      mTotalBytes(0ll),
+      mNumHits(0ll),
+      mNumMisses(0ll),
+      mNumEvictions(0ll) {
+}
+
+CodecPool::~CodecPool() {
+    clear();
+}
+
+// static
+int64_t CodecPool::EstimateBytes(const AString &mime, int32_t width, int32_t height) {
+    if (!strncasecmp(mime.c_str(), "video/", 6)) {
+        return (int64_t)width * height * 3 / 2 * kVideoFramesPerCodec;
+    }
+
+    return kAudioBytesPerCodec;
+}
+
+sp<MediaCodec> CodecPool::acquire(
+        const AString &mime, const sp<AMessage> &format, bool softwareOnly) {
+    int32_t width = 0;
+    int32_t height = 0;
+    format->findInt32("width", &width);
+    format->findInt32("height", &height);
+
+    Vector<sp<MediaCodec> > evicted;
+    sp<MediaCodec> codec;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        trim_l(ALooper::GetNowUs(), &evicted);
+
+        ssize_t match = -1;
+        for (size_t i = mEntries.size(); i-- > 0;) {
+            const Entry &entry = mEntries.itemAt(i);
+
+            if (strcasecmp(entry.mMime.c_str(), mime.c_str())) {
+                continue;
+            }
+
+            if (softwareOnly
+                    && !entry.mName.startsWithIgnoreCase("c2.android.")
+                    && !entry.mName.startsWithIgnoreCase("OMX.google.")) {
+                continue;
+            }
+
+            if (match < 0) {
+                match = i;
+            }
+
+            if (entry.mWidth == width && entry.mHeight == height) {
+                match = i;
+                break;
+            }
+        }
+
+        if (match < 0) {
+            ++mNumMisses;
+        } else {
+            const Entry &entry = mEntries.itemAt(match);
+            codec = entry.mCodec;
+
+            ALOGV("reusing %s for %s", entry.mName.c_str(), mime.c_str());
+
+            mTotalBytes -= entry.mBytes;
+            mEntries.removeAt(match);
+            ++mNumHits;
+        }
+    }
+
+    ReleaseAll(evicted);
+
+    return codec;
+}
+
+void CodecPool::release(
+        const sp<MediaCodec> &codec, const AString &mime, const sp<AMessage> &format) {
+    // Messages still in flight for the old owner are dropped by it, nothing
+    // new is posted once the callbacks are gone.
+    status_t err = codec->stop();
+    if (err == OK) {
+        err = codec->setCallback(NULL);
+    }
+    if (err == OK) {
+        err = codec->setOnFrameRenderedNotification(NULL);
+    }
+
+    if (err != OK) {
+        ALOGW("failed to stop %s decoder (%d), not keeping it", mime.c_str(), err);
+        codec->release();
+        return;
+    }
+
+    Entry entry;
+    entry.mCodec = codec;
+    entry.mMime = mime;
+    entry.mWidth = 0;
+    entry.mHeight = 0;
+    format->findInt32("width", &entry.mWidth);
+    format->findInt32("height", &entry.mHeight);
+    entry.mBytes = EstimateBytes(mime, entry.mWidth, entry.mHeight);
+    entry.mIdleSinceUs = ALooper::GetNowUs();
+    codec->getName(&entry.mName);
+
+    Vector<sp<MediaCodec> > evicted;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        mEntries.push_back(entry);
+        mTotalBytes += entry.mBytes;
+
+        while (mTotalBytes > mMaxBytes && !mEntries.empty()) {
+            evictAt_l(0, &evicted);
+        }
+
+        trim_l(entry.mIdleSinceUs, &evicted);
+    }
+
+    ReleaseAll(evicted);
+}
+
+void CodecPool::trim() {
+    Vector<sp<MediaCodec> > evicted;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        trim_l(ALooper::GetNowUs(), &evicted);
+    }
+
+    ReleaseAll(evicted);
+}
+
+void CodecPool::clear() {
+    Vector<sp<MediaCodec> > evicted;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        while (!mEntries.empty()) {
+            evictAt_l(0, &evicted);
+        }
+    }
+
+    ReleaseAll(evicted);
+}
+
+size_t CodecPool::size() const {
+    Mutex::Autolock autoLock(mLock);
+    return mEntries.size();
+}
+
+int64_t CodecPool::numHits() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumHits;
+}
+
+int64_t CodecPool::numMisses() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumMisses;
+}
+
+int64_t CodecPool::numEvictions() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumEvictions;
+}
+
+// static
+void CodecPool::ReleaseAll(const Vector<sp<MediaCodec> > &codecs) {
+    for (size_t i = 0; i < codecs.size(); ++i) {
+        codecs.itemAt(i)->release();
+    }
+}
+
+void CodecPool::evictAt_l(size_t index, Vector<sp<MediaCodec> > *evicted) {
+    const Entry &entry = mEntries.itemAt(index);
+
+    ALOGV("releasing %s", entry.mName.c_str());
+
+    evicted->push_back(entry.mCodec);
+    mTotalBytes -= entry.mBytes;
+    mEntries.removeAt(index);
+    ++mNumEvictions;
+}
+
+void CodecPool::trim_l(int64_t nowUs, Vector<sp<MediaCodec> > *evicted) {
+    while (!mEntries.empty()
+            && nowUs - mEntries.itemAt(0).mIdleSinceUs > mMaxIdleUs) {
+        evictAt_l(0, evicted);
+    }
+}
+
+}  // namespace android
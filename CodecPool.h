@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CODEC_POOL_H
+#define CODEC_POOL_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct AMessage;
+struct MediaCodec;
+
+// Keeps decoders that a player is done with in the stopped (unconfigured)
+// state, so the next player or the next source can configure one right
+// away instead of allocating a new component. Shared between players, all
+// methods are thread safe.
+//
+// What a stopped codec still holds is unknown, it is estimated from the
+// format it last ran with. Codecs are released oldest first to stay within
+// maxBytes, and once they have not been used for maxIdleUs. Idle codecs are
+// only looked at when the pool is used, or on trim().
+struct CodecPool : public RefBase {
+    CodecPool(int64_t maxBytes, int64_t maxIdleUs);
+
+    // A stopped decoder for mime, preferring one that last ran with the
+    // dimensions of format, or NULL. With softwareOnly set only c2.android.*
+    // and OMX.google.* components qualify.
+    sp<MediaCodec> acquire(const AString &mime, const sp<AMessage> &format, bool softwareOnly);
+
+    // Stops the codec and keeps it, it is released instead if stopping fails.
+    // Callbacks set on it are cleared.
+    void release(const sp<MediaCodec> &codec, const AString &mime, const sp<AMessage> &format);
+
+    // Releases codecs that have been idle for too long.
+    void trim();
+
+    // Releases every codec kept.
+    void clear();
+
+    size_t size() const;
+    int64_t numHits() const;
+    int64_t numMisses() const;
+    int64_t numEvictions() const;
+
+protected:
+    virtual ~CodecPool();
+
+private:
+    struct Entry {
+        sp<MediaCodec> mCodec;
+        AString mMime;
+        AString mName;
+        int32_t mWidth;
+        int32_t mHeight;
+        int64_t mBytes;
+        int64_t mIdleSinceUs;
+    };
+
+    const int64_t mMaxBytes;
+    const int64_t mMaxIdleUs;
+
+    mutable Mutex mLock;
+    // Oldest first.
+    Vector<Entry> mEntries;
+    int64_t mTotalBytes;
+    int64_t mNumHits;
+    int64_t mNumMisses;
+    int64_t mNumEvictions;
+
+    static int64_t EstimateBytes(const AString &mime, int32_t width, int32_t height);
+
+    // Releasing a codec can block on the component, evicted codecs are
+    // collected under mLock and released by ReleaseAll() after dropping it.
+    static void ReleaseAll(const Vector<sp<MediaCodec> > &codecs);
+
+    void evictAt_l(size_t index, Vector<sp<MediaCodec> > *evicted);
+    void trim_l(int64_t nowUs, Vector<sp<MediaCodec> > *evicted);
+
+    DISALLOW_EVIL_CONSTRUCTORS(CodecPool);
+};
+
+}  // namespace android
+
+#endif // CODEC_POOL_H
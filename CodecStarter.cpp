@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "CodecStarter"
+
+#include <gui/Surface.h>
+#include <media/MediaCodecBuffer.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaCodecList.h>
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Log.h>
+
+#include "CodecPool.h"
+#include "CodecStarter.h"
+
+namespace android {
+
+CodecStarter::CodecStarter(
+        const sp<ALooper> &codecLooper,
+        const sp<AMessage> &format,
+        const sp<CodecPool> &pool,
+        bool preferSoftwareCodecs)
+    : Thread(false /* canCallJava */),
+      mCodecLooper(codecLooper),
+      mFormat(format),
+      mPool(pool),
+      mPreferSoftwareCodecs(preferSoftwareCodecs),
+      mFromPool(false),
+      mDoneTimeUs(-1ll),
+      mResult(OK),
+      mDone(false) {
+    for (size_t i = 0; i < NUM_PHASES; ++i) {
+        mPhaseUs[i] = 0ll;
+    }
+}
+
+CodecStarter::~CodecStarter() {
+}
+
+void CodecStarter::setSurface(const sp<Surface> &surface) {
+    mSurface = surface;
+}
+
+void CodecStarter::setCallback(const sp<AMessage> &callback) {
+    mCallback = callback;
+}
+
+void CodecStarter::setOnFrameRenderedNotification(const sp<AMessage> &notify) {
+    mFrameRenderedNotify = notify;
+}
+
+void CodecStarter::setCodecSpecificData(const Vector<sp<ABuffer> > &csd) {
+    mCSD = csd;
+}
+
+status_t CodecStarter::start() {
+    return run("SimplePlayerCodecStart", PRIORITY_FOREGROUND);
+}
+
+status_t CodecStarter::wait() {
+    join();
+    return mResult;
+}
+
+// static
+const char *CodecStarter::PhaseName(Phase phase) {
+    static const char *kPhaseNames[NUM_PHASES] = {
+        "create", "configure", "start", "csd",
+    };
+
+    CHECK_LT(phase, NUM_PHASES);
+    return kPhaseNames[phase];
+}
+
+// static
+sp<MediaCodec> CodecStarter::CreateCodec(
+        const sp<ALooper> &looper,
+        const AString &mime,
+        bool encoder,
+        bool preferSoftwareCodecs) {
+    if (!preferSoftwareCodecs) {
+        return MediaCodec::CreateByType(looper, mime, encoder);
+    }
+
+    Vector<AString> matchingCodecs;
+    MediaCodecList::findMatchingCodecs(
+            mime.c_str(),
+            encoder,
+            MediaCodecList::kPreferSoftwareCodecs,
+            &matchingCodecs);
+
+    for (size_t i = 0; i < matchingCodecs.size(); ++i) {
+        sp<MediaCodec> codec =
+            MediaCodec::CreateByComponentName(looper, matchingCodecs[i]);
+
+        if (codec != NULL) {
+            ALOGI("using %s for %s", matchingCodecs[i].c_str(), mime.c_str());
+            return codec;
+        }
+    }
+
+    return NULL;
+}
+
+status_t CodecStarter::startCodec() {
+    AString mime;
+    CHECK(mFormat->findString("mime", &mime));
+
+    int64_t phaseStartTimeUs = ALooper::GetNowUs();
+
+    if (mPool != NULL) {
+        mCodec = mPool->acquire(mime, mFormat, mPreferSoftwareCodecs);
+        mFromPool = mCodec != NULL;
+    }
+
+    if (mCodec == NULL) {
+        mCodec = CreateCodec(mCodecLooper, mime, false /* encoder */, mPreferSoftwareCodecs);
+    }
+
+    if (mCodec == NULL) {
+        ALOGE("no decoder for %s", mime.c_str());
+        return ERROR_UNSUPPORTED;
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    mPhaseUs[CREATE] = nowUs - phaseStartTimeUs;
+    phaseStartTimeUs = nowUs;
+
+    status_t err;
+    if (mCallback != NULL) {
+        err = mCodec->setCallback(mCallback);
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    err = mCodec->configure(mFormat, mSurface, NULL /* crypto */, 0 /* flags */);
+    if (err != OK) {
+        return err;
+    }
+
+    if (mFrameRenderedNotify != NULL) {
+        err = mCodec->setOnFrameRenderedNotification(mFrameRenderedNotify);
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    nowUs = ALooper::GetNowUs();
+    mPhaseUs[CONFIGURE] = nowUs - phaseStartTimeUs;
+    phaseStartTimeUs = nowUs;
+
+    err = mCodec->start();
+    if (err != OK) {
+        return err;
+    }
+
+    nowUs = ALooper::GetNowUs();
+    mPhaseUs[START] = nowUs - phaseStartTimeUs;
+    phaseStartTimeUs = nowUs;
+
+    if (mCallback != NULL) {
+        // Input buffers only show up through CB_INPUT_AVAILABLE, the caller
+        // queues the codec specific data ahead of the first sample.
+        return OK;
+    }
+
+    err = queueCodecSpecificData();
+
+    mPhaseUs[QUEUE_CSD] = ALooper::GetNowUs() - phaseStartTimeUs;
+
+    return err;
+}
+
+status_t CodecStarter::queueCodecSpecificData() {
+    status_t err = mCodec->getInputBuffers(&mInputBuffers);
+    if (err != OK) {
+        return err;
+    }
+
+    err = mCodec->getOutputBuffers(&mOutputBuffers);
+    if (err != OK) {
+        return err;
+    }
+
+    for (size_t i = 0; i < mCSD.size(); ++i) {
+        const sp<ABuffer> &srcBuffer = mCSD.itemAt(i);
+
+        size_t index;
+        err = mCodec->dequeueInputBuffer(&index, -1ll);
+        if (err != OK) {
+            return err;
+        }
+
+        const sp<MediaCodecBuffer> &dstBuffer = mInputBuffers.itemAt(index);
+
+        CHECK_LE(srcBuffer->size(), dstBuffer->capacity());
+        dstBuffer->setRange(0, srcBuffer->size());
+        memcpy(dstBuffer->data(), srcBuffer->data(), srcBuffer->size());
+
+        err = mCodec->queueInputBuffer(
+                index,
+                0,
+                dstBuffer->size(),
+                0ll,
+                MediaCodec::BUFFER_FLAG_CODECCONFIG);
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    return OK;
+}
+
+bool CodecStarter::threadLoop() {
+    mResult = startCodec();
+    mDoneTimeUs = ALooper::GetNowUs();
+
+    if (mResult != OK) {
+        ALOGE("failed to start decoder (%d)", mResult);
+
+        if (mCodec != NULL) {
+            mCodec->release();
+            mCodec.clear();
+        }
+    }
+
+    mDone.store(true);
+
+    return false;
+}
+
+}  // namespace android
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CODEC_STARTER_H
+#define CODEC_STARTER_H
+
+#include <atomic>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Thread.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct ABuffer;
+struct ALooper;
+struct AMessage;
+struct CodecPool;
+struct MediaCodec;
+class MediaCodecBuffer;
+class Surface;
+
+// Brings up one decoder on a thread of its own: takes it from the pool or
+// creates it, configures and starts it. Without a callback the codec runs
+// in the synchronous mode, its buffers are fetched and the codec specific
+// data is queued as well. Nothing is shared with the caller until wait()
+// returns, so any number of these can run next to each other and next to
+// the extractor.
+struct CodecStarter : public Thread {
+    enum Phase {
+        // Creating or taking the codec from the pool.
+        CREATE,
+        CONFIGURE,
+        START,
+        // Synchronous mode only.
+        QUEUE_CSD,
+        NUM_PHASES
+    };
+
+    CodecStarter(
+            const sp<ALooper> &codecLooper,
+            const sp<AMessage> &format,
+            const sp<CodecPool> &pool,
+            bool preferSoftwareCodecs);
+
+    // All of these must be called before start().
+    void setSurface(const sp<Surface> &surface);
+    void setCallback(const sp<AMessage> &callback);
+    void setOnFrameRenderedNotification(const sp<AMessage> &notify);
+    void setCodecSpecificData(const Vector<sp<ABuffer> > &csd);
+
+    status_t start();
+
+    // Blocks until the codec is up.
+    status_t wait();
+    bool done() const { return mDone.load(); }
+
+    // Valid once wait() returned OK.
+    const sp<MediaCodec> &codec() const { return mCodec; }
+    bool fromPool() const { return mFromPool; }
+    const Vector<sp<MediaCodecBuffer> > &inputBuffers() const { return mInputBuffers; }
+    const Vector<sp<MediaCodecBuffer> > &outputBuffers() const { return mOutputBuffers; }
+    int64_t phaseUs(Phase phase) const { return mPhaseUs[phase]; }
+    // When the codec was up, in ALooper::GetNowUs() time.
+    int64_t doneTimeUs() const { return mDoneTimeUs; }
+
+    static const char *PhaseName(Phase phase);
+
+    // With preferSoftwareCodecs c2.android.* codecs are tried first.
+    static sp<MediaCodec> CreateCodec(
+            const sp<ALooper> &looper,
+            const AString &mime,
+            bool encoder,
+            bool preferSoftwareCodecs);
+
+protected:
+    virtual ~CodecStarter();
+
+private:
+    sp<ALooper> mCodecLooper;
+    sp<AMessage> mFormat;
+    sp<CodecPool> mPool;
+    bool mPreferSoftwareCodecs;
+    sp<Surface> mSurface;
+    sp<AMessage> mCallback;
+    sp<AMessage> mFrameRenderedNotify;
+    Vector<sp<ABuffer> > mCSD;
+
+    sp<MediaCodec> mCodec;
+    bool mFromPool;
+    Vector<sp<MediaCodecBuffer> > mInputBuffers;
+    Vector<sp<MediaCodecBuffer> > mOutputBuffers;
+    int64_t mPhaseUs[NUM_PHASES];
+    int64_t mDoneTimeUs;
+    status_t mResult;
+    std::atomic<bool> mDone;
+
+    status_t startCodec();
+    status_t queueCodecSpecificData();
+
+    virtual bool threadLoop();
+
+    DISALLOW_EVIL_CONSTRUCTORS(CodecStarter);
+};
+
+}  // namespace android
+
+#endif // CODEC_STARTER_H
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "Demuxer"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <utils/Log.h>
+
+#include "Demuxer.h"
+#include "PrefetchPolicy.h"
+#include "SampleBufferPool.h"
+#include "SampleQueue.h"
+#include "SampleSource.h"
+#include "SyncSampleIndex.h"
+
+namespace android {
+
+// Upper bound on how long a full queue is waited on without a signal.
+static const nsecs_t kWaitTimeoutNs = 20000000ll;
+
+Demuxer::Demuxer(const sp<SampleSource> &extractor, const sp<AMessage> &notify)
+    : Thread(false /* canCallJava */),
+      mExtractor(extractor),
+      mNotify(notify),
+      mWaiting(false),
+      mReachedEOS(false) {
+}
+
+Demuxer::~Demuxer() {
+}
+
+void Demuxer::addTrack(
+        size_t trackIndex,
+        const sp<SampleQueue> &queue,
+        const sp<SampleBufferPool> &pool,
+        const sp<PrefetchPolicy> &policy,
+        const sp<SyncSampleIndex> &syncIndex) {
+    Track track;
+    track.mQueue = queue;
+    track.mPool = pool;
+    track.mPolicy = policy;
+    track.mSyncIndex = syncIndex;
+    mTracks.add(trackIndex, track);
+}
+
+status_t Demuxer::start() {
+    return run("SimplePlayerDemux", PRIORITY_AUDIO);
+}
+
+void Demuxer::stop() {
+    requestExit();
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mCondition.signal();
+    }
+
+    requestExitAndWait();
+}
+
+void Demuxer::signalSpaceAvailable() {
+    if (mWaiting.load()) {
+        Mutex::Autolock autoLock(mLock);
+        mCondition.signal();
+    }
+}
+
+// static
+bool Demuxer::canQueue(const Track &track) {
+    return !track.mQueue->full() && track.mPolicy->canPrefetch();
+}
+
+bool Demuxer::threadLoop() {
+    size_t trackIndex;
+    if (mExtractor->getSampleTrackIndex(&trackIndex) != OK) {
+        ALOGV("reached end of stream");
+        mReachedEOS.store(true);
+        mNotify->dup()->post();
+        return false;
+    }
+
+    const Track &track = mTracks.valueFor(trackIndex);
+
+    if (!canQueue(track)) {
+        Mutex::Autolock autoLock(mLock);
+        mWaiting.store(true);
+
+        // Re-check now that the consumer is guaranteed to see mWaiting.
+        if (!canQueue(track) && !exitPending()) {
+            mCondition.waitRelative(mLock, kWaitTimeoutNs);
+        }
+
+        mWaiting.store(false);
+        return true;
+    }
+
+    bool isSync = track.mSyncIndex->addCurrentSample(mExtractor);
+
+    size_t sampleSize = 0;
+    CHECK_EQ(mExtractor->getSampleSize(&sampleSize), (status_t)OK);
+
+    sp<ABuffer> buffer = track.mPool->acquire(sampleSize);
+    CHECK_EQ(mExtractor->readSampleData(buffer), (status_t)OK);
+    buffer->meta()->setInt64("demuxTimeUs", ALooper::GetNowUs());
+
+    int64_t timeUs = 0;
+    CHECK_EQ(mExtractor->getSampleTime(&timeUs), (status_t)OK);
+    buffer->meta()->setInt64("timeUs", timeUs);
+    buffer->meta()->setInt32("sync", isSync);
+
+    track.mPolicy->onSampleQueued(buffer->size(), timeUs);
+    CHECK(track.mQueue->push(buffer));
+    mExtractor->advance();
+
+    // Decided after the push, the consumer may have drained the queue
+    // since it was last looked at. A queue that is empty again has been
+    // consumed already.
+    if (track.mQueue->size() == 1) {
+        mNotify->dup()->post();
+    }
+
+    return true;
+}
+
+}  // namespace android
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DEMUXER_H
+#define DEMUXER_H
+
+#include <atomic>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Condition.h>
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
+#include <utils/Thread.h>
+
+namespace android {
+
+struct AMessage;
+struct PrefetchPolicy;
+struct SampleBufferPool;
+struct SampleQueue;
+struct SampleSource;
+struct SyncSampleIndex;
+
+// Reads the SampleSource on its own thread, ahead of playback, and pushes
+// every sample into the SampleQueue of its track. Once started the
+// source belongs to this thread until stop() returns.
+struct Demuxer : public Thread {
+    // notify is posted whenever a queue goes from empty to non-empty and
+    // once more when the end of the stream has been reached.
+    Demuxer(const sp<SampleSource> &extractor, const sp<AMessage> &notify);
+
+    void addTrack(
+            size_t trackIndex,
+            const sp<SampleQueue> &queue,
+            const sp<SampleBufferPool> &pool,
+            const sp<PrefetchPolicy> &policy,
+            const sp<SyncSampleIndex> &syncIndex);
+
+    status_t start();
+    void stop();
+
+    // Called by the consumer after popping from a queue or growing a budget.
+    void signalSpaceAvailable();
+
+    bool reachedEOS() const { return mReachedEOS.load(); }
+
+protected:
+    virtual ~Demuxer();
+
+private:
+    struct Track {
+        sp<SampleQueue> mQueue;
+        sp<SampleBufferPool> mPool;
+        sp<PrefetchPolicy> mPolicy;
+        sp<SyncSampleIndex> mSyncIndex;
+    };
+
+    sp<SampleSource> mExtractor;
+    sp<AMessage> mNotify;
+    KeyedVector<size_t, Track> mTracks;
+
+    Mutex mLock;
+    Condition mCondition;
+    std::atomic<bool> mWaiting;
+    std::atomic<bool> mReachedEOS;
+
+    static bool canQueue(const Track &track);
+
+    virtual bool threadLoop();
+
+    DISALLOW_EVIL_CONSTRUCTORS(Demuxer);
+};
+
+}  // namespace android
+
+#endif // DEMUXER_H
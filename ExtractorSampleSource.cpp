@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ExtractorSampleSource"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <utils/Log.h>
+
+#include "ExtractorSampleSource.h"
+#include "SampleIndexFile.h"
+
+namespace android {
+
+ExtractorSampleSource::ExtractorSampleSource(const sp<NuMediaExtractor> &extractor)
+    : mExtractor(extractor) {
+}
+
+ExtractorSampleSource::~ExtractorSampleSource() {
+}
+
+void ExtractorSampleSource::setIndexWriter(const sp<SampleIndexWriter> &writer) {
+    mIndexWriter = writer;
+}
+
+size_t ExtractorSampleSource::countTracks() const {
+    return mExtractor->countTracks();
+}
+
+status_t ExtractorSampleSource::getTrackFormat(size_t index, sp<AMessage> *format) const {
+    return mExtractor->getTrackFormat(index, format);
+}
+
+status_t ExtractorSampleSource::selectTrack(size_t index) {
+    status_t err = mExtractor->selectTrack(index);
+
+    if (err == OK && mIndexWriter != NULL) {
+        sp<AMessage> format;
+        if (mExtractor->getTrackFormat(index, &format) == OK) {
+            mIndexWriter->addTrack(index, format);
+        } else {
+            mIndexWriter->abandon("no track format");
+        }
+    }
+
+    return err;
+}
+
+status_t ExtractorSampleSource::seekTo(
+        int64_t timeUs, MediaSource::ReadOptions::SeekMode mode) {
+    if (mIndexWriter != NULL) {
+        mIndexWriter->abandon("seeked");
+    }
+
+    return mExtractor->seekTo(timeUs, mode);
+}
+
+status_t ExtractorSampleSource::advance() {
+    return mExtractor->advance();
+}
+
+status_t ExtractorSampleSource::readSampleData(const sp<ABuffer> &buffer) {
+    status_t err = mExtractor->readSampleData(buffer);
+
+    if (mIndexWriter != NULL) {
+        size_t trackIndex;
+        sp<MetaData> meta;
+        if (err != OK || mExtractor->getSampleTrackIndex(&trackIndex) != OK
+                || mExtractor->getSampleMeta(&meta) != OK) {
+            mIndexWriter->abandon("failed to read a sample");
+        } else {
+            mIndexWriter->addSample(trackIndex, meta, buffer);
+        }
+    }
+
+    return err;
+}
+
+status_t ExtractorSampleSource::getSampleSize(size_t *sampleSize) {
+    return mExtractor->getSampleSize(sampleSize);
+}
+
+status_t ExtractorSampleSource::getSampleTrackIndex(size_t *trackIndex) {
+    status_t err = mExtractor->getSampleTrackIndex(trackIndex);
+
+    if (err == ERROR_END_OF_STREAM && mIndexWriter != NULL) {
+        mIndexWriter->finish();
+        mIndexWriter.clear();
+    }
+
+    return err;
+}
+
+status_t ExtractorSampleSource::getSampleTime(int64_t *sampleTimeUs) {
+    return mExtractor->getSampleTime(sampleTimeUs);
+}
+
+status_t ExtractorSampleSource::getSampleMeta(sp<MetaData> *sampleMeta) {
+    return mExtractor->getSampleMeta(sampleMeta);
+}
+
+}  // namespace android
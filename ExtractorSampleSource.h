@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXTRACTOR_SAMPLE_SOURCE_H
+#define EXTRACTOR_SAMPLE_SOURCE_H
+
+#include "SampleSource.h"
+
+namespace android {
+
+struct NuMediaExtractor;
+struct SampleIndexWriter;
+
+// Reads samples by parsing the container. With an index writer set, every
+// sample read on a pass from start to end is recorded for the sidecar.
+struct ExtractorSampleSource : public SampleSource {
+    explicit ExtractorSampleSource(const sp<NuMediaExtractor> &extractor);
+
+    void setIndexWriter(const sp<SampleIndexWriter> &writer);
+
+    virtual size_t countTracks() const;
+    virtual status_t getTrackFormat(size_t index, sp<AMessage> *format) const;
+    virtual status_t selectTrack(size_t index);
+
+    virtual status_t seekTo(
+            int64_t timeUs, MediaSource::ReadOptions::SeekMode mode);
+
+    virtual status_t advance();
+    virtual status_t readSampleData(const sp<ABuffer> &buffer);
+    virtual status_t getSampleSize(size_t *sampleSize);
+    virtual status_t getSampleTrackIndex(size_t *trackIndex);
+    virtual status_t getSampleTime(int64_t *sampleTimeUs);
+    virtual status_t getSampleMeta(sp<MetaData> *sampleMeta);
+
+protected:
+    virtual ~ExtractorSampleSource();
+
+private:
+    sp<NuMediaExtractor> mExtractor;
+    sp<SampleIndexWriter> mIndexWriter;
+
+    DISALLOW_EVIL_CONSTRUCTORS(ExtractorSampleSource);
+};
+
+}  // namespace android
+
+#endif // EXTRACTOR_SAMPLE_SOURCE_H
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FrameDropPolicy"
+
+#include <utils/Log.h>
+
+#include "FrameDropPolicy.h"
+
+namespace android {
+
+// Roughly how many frames a hardware decoder holds on to, the lag of the
+// frames behind them is extrapolated this far.
+static const int64_t kLookaheadFrames = 6ll;
+
+// Dropping non-reference frames has this long to bring the lag down before
+// the policy moves on to the next sync sample.
+static const int64_t kMaxCatchUpUs = 1000000ll;
+
+static const double kSmoothing = 0.125;
+
+FrameDropPolicy::FrameDropPolicy()
+    : mNonReferenceLagUs(-1ll),
+      mSyncLagUs(-1ll),
+      mMaxLagUs(0ll),
+      mNumSyncSkips(0ll) {
+    reset();
+}
+
+void FrameDropPolicy::setThresholds(int64_t nonReferenceLagUs, int64_t syncLagUs) {
+    mNonReferenceLagUs = nonReferenceLagUs;
+    mSyncLagUs = syncLagUs;
+}
+
+void FrameDropPolicy::reset() {
+    mLevel = DROP_NONE;
+    mLevelTimeUs = -1ll;
+    mLevelLagUs = 0ll;
+    mResumeTimeUs = -1ll;
+    mNumFrames = 0ll;
+    mLastLateByUs = 0ll;
+    mLagUs = 0.0;
+    mTrendUs = 0.0;
+}
+
+int64_t FrameDropPolicy::predictedLagUs() const {
+    double trendUs = mTrendUs > 0.0 ? mTrendUs : 0.0;
+    return (int64_t)(mLagUs + trendUs * kLookaheadFrames);
+}
+
+void FrameDropPolicy::onFrameReleased(int64_t timeUs, int64_t lateByUs, int64_t nowUs) {
+    if (timeUs < mResumeTimeUs) {
+        return;
+    }
+
+    if (mNumFrames++ == 0) {
+        mLagUs = lateByUs;
+        mTrendUs = 0.0;
+    } else {
+        mLagUs += (lateByUs - mLagUs) * kSmoothing;
+        mTrendUs += ((lateByUs - mLastLateByUs) - mTrendUs) * kSmoothing;
+    }
+    mLastLateByUs = lateByUs;
+
+    if (lateByUs > mMaxLagUs) {
+        mMaxLagUs = lateByUs;
+    }
+
+    int64_t predictedUs = predictedLagUs();
+
+    switch (mLevel) {
+        case DROP_NONE:
+        case DROP_NON_REFERENCE:
+        {
+            if (mSyncLagUs >= 0ll && predictedUs > mSyncLagUs) {
+                setLevel(DROP_TO_SYNC, nowUs);
+            } else if (mLevel == DROP_NONE) {
+                if (mNonReferenceLagUs >= 0ll && predictedUs > mNonReferenceLagUs) {
+                    setLevel(DROP_NON_REFERENCE, nowUs);
+                }
+            } else if (mLagUs < 0.0) {
+                // Caught up, frames are coming out early again.
+                setLevel(DROP_NONE, nowUs);
+            } else if (mSyncLagUs >= 0ll
+                    && nowUs - mLevelTimeUs > kMaxCatchUpUs && mLagUs >= mLevelLagUs) {
+                setLevel(DROP_TO_SYNC, nowUs);
+            }
+            break;
+        }
+
+        default:
+            // Left by onSyncSampleQueued().
+            break;
+    }
+}
+
+void FrameDropPolicy::onSyncSampleQueued(int64_t timeUs, int64_t nowUs) {
+    if (mLevel != DROP_TO_SYNC) {
+        return;
+    }
+
+    ++mNumSyncSkips;
+
+    // Frames still in the decoder come out as late as ever, the lag is
+    // measured afresh from the sync sample on.
+    mResumeTimeUs = timeUs;
+    mNumFrames = 0ll;
+    mLagUs = 0.0;
+    mTrendUs = 0.0;
+
+    setLevel(DROP_NON_REFERENCE, nowUs);
+}
+
+void FrameDropPolicy::setLevel(Level level, int64_t nowUs) {
+    ALOGV("%s -> %s, lag %lld us, predicted %lld us",
+          LevelName(mLevel), LevelName(level), (long long)mLagUs, (long long)predictedLagUs());
+
+    mLevel = level;
+    mLevelTimeUs = nowUs;
+    mLevelLagUs = (int64_t)mLagUs;
+}
+
+// static
+const char *FrameDropPolicy::LevelName(Level level) {
+    static const char *kNames[NUM_LEVELS] = {
+        "none", "non-reference", "to-sync",
+    };
+
+    return level < NUM_LEVELS ? kNames[level] : "unknown";
+}
+
+}  // namespace android
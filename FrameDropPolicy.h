@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAME_DROP_POLICY_H
+#define FRAME_DROP_POLICY_H
+
+#include <stdint.h>
+
+namespace android {
+
+// Decides from how late decoded video frames come out whether access units
+// should be dropped before they reach the decoder at all. The lateness is
+// smoothed and extrapolated over the frames still inside the decoder, so
+// input is thinned before frames have to be thrown away after decoding.
+// Non-reference frames go first. If that does not stop the lag from
+// growing, everything up to the next sync sample is skipped.
+struct FrameDropPolicy {
+    enum Level {
+        DROP_NONE,
+        DROP_NON_REFERENCE,
+        DROP_TO_SYNC,
+        NUM_LEVELS
+    };
+
+    FrameDropPolicy();
+
+    // Predicted lag above which each level is entered, a negative value
+    // never enters it. Nothing is dropped until this is called.
+    void setThresholds(int64_t nonReferenceLagUs, int64_t syncLagUs);
+
+    // The decoded frame due at timeUs was released lateByUs after its due
+    // time, negative when early.
+    void onFrameReleased(int64_t timeUs, int64_t lateByUs, int64_t nowUs);
+
+    // Input was skipped up to the sync sample at timeUs, which was queued.
+    void onSyncSampleQueued(int64_t timeUs, int64_t nowUs);
+
+    // The decoder was flushed, nothing before says anything about the lag.
+    void reset();
+
+    Level level() const { return mLevel; }
+    int64_t lagUs() const { return (int64_t)mLagUs; }
+    int64_t predictedLagUs() const;
+    int64_t maxLagUs() const { return mMaxLagUs; }
+    int64_t numSyncSkips() const { return mNumSyncSkips; }
+
+    static const char *LevelName(Level level);
+
+private:
+    int64_t mNonReferenceLagUs;
+    int64_t mSyncLagUs;
+
+    Level mLevel;
+    int64_t mLevelTimeUs;
+    int64_t mLevelLagUs;
+
+    // Frames due before this were in the decoder before the skip.
+    int64_t mResumeTimeUs;
+
+    // Exponentially smoothed lateness and its change from frame to frame.
+    int64_t mNumFrames;
+    int64_t mLastLateByUs;
+    double mLagUs;
+    double mTrendUs;
+
+    int64_t mMaxLagUs;
+    int64_t mNumSyncSkips;
+
+    void setLevel(Level level, int64_t nowUs);
+};
+
+}  // namespace android
+
+#endif // FRAME_DROP_POLICY_H
@@ -0,0 +1,369 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FrameExportRing"
+
+#include <atomic>
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cutils/ashmem.h>
+#include <media/hardware/VideoAPI.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Log.h>
+
+#include "FrameExportRing.h"
+
+namespace android {
+
+static const char kMagic[4] = { 'S', 'P', 'F', 'R' };
+static const uint32_t kVersion = 1;
+
+// Readers in other processes go through the same memory.
+static_assert(std::atomic<uint32_t>::is_always_lock_free
+        && std::atomic<uint64_t>::is_always_lock_free, "ring atomics need to be lock free");
+
+struct FrameExportRing::RingHeader {
+    char mMagic[4];
+    uint32_t mVersion;
+    uint32_t mNumSlots;
+    uint32_t mSlotSize;
+    uint64_t mSlotStride;
+    uint64_t mSlotsOffset;
+    std::atomic<uint64_t> mNumPublished;
+    std::atomic<uint32_t> mClosed;
+};
+
+struct FrameExportRing::SlotHeader {
+    std::atomic<uint32_t> mSequence;
+    uint32_t mSize;
+    uint64_t mIndex;
+    int64_t mTimeUs;
+    FrameInfo mInfo;
+};
+
+static size_t align64(size_t size) {
+    return (size + 63) & ~(size_t)63;
+}
+
+// static
+sp<FrameExportRing> FrameExportRing::Create(size_t numSlots, size_t slotSize) {
+    if (numSlots == 0 || numSlots > UINT32_MAX || slotSize == 0 || slotSize > UINT32_MAX) {
+        return NULL;
+    }
+
+    size_t slotsOffset = align64(sizeof(RingHeader));
+    size_t slotStride = align64(sizeof(SlotHeader)) + align64(slotSize);
+    size_t size = slotsOffset + numSlots * slotStride;
+
+    int fd = ashmem_create_region("SimplePlayerFrameExport", size);
+    if (fd < 0) {
+        ALOGE("failed to create a %zu byte region: %s", size, strerror(errno));
+        return NULL;
+    }
+
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ALOGE("failed to map %zu bytes: %s", size, strerror(errno));
+        ::close(fd);
+        return NULL;
+    }
+
+    sp<FrameExportRing> ring = new FrameExportRing;
+    ring->mFd = fd;
+    ring->mWriter = true;
+    ring->mData = static_cast<uint8_t *>(data);
+    ring->mSize = size;
+    ring->mNumSlots = numSlots;
+    ring->mSlotSize = slotSize;
+    ring->mSlotStride = slotStride;
+    ring->mSlotsOffset = slotsOffset;
+
+    // The region starts out zeroed, every slot sequence included.
+    RingHeader *header = static_cast<RingHeader *>(data);
+    memcpy(header->mMagic, kMagic, sizeof(kMagic));
+    header->mVersion = kVersion;
+    header->mNumSlots = numSlots;
+    header->mSlotSize = slotSize;
+    header->mSlotStride = slotStride;
+    header->mSlotsOffset = slotsOffset;
+    header->mNumPublished.store(0, std::memory_order_release);
+    ring->mHeader = header;
+
+    return ring;
+}
+
+// static
+sp<FrameExportRing> FrameExportRing::Map(int fd) {
+    int size = ashmem_get_size_region(fd);
+    if (size < (int)sizeof(RingHeader)) {
+        return NULL;
+    }
+
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ALOGW("failed to map ring: %s", strerror(errno));
+        return NULL;
+    }
+
+    sp<FrameExportRing> ring = new FrameExportRing;
+    ring->mData = static_cast<uint8_t *>(data);
+    ring->mSize = size;
+
+    const RingHeader *header = static_cast<const RingHeader *>(data);
+    if (memcmp(header->mMagic, kMagic, sizeof(kMagic)) || header->mVersion != kVersion) {
+        ALOGW("not a frame export ring");
+        return NULL;
+    }
+
+    if (header->mNumSlots == 0
+            || header->mSlotStride < align64(sizeof(SlotHeader)) + header->mSlotSize
+            || header->mSlotsOffset < sizeof(RingHeader)
+            || header->mSlotsOffset > (uint64_t)size
+            || ((uint64_t)size - header->mSlotsOffset) / header->mSlotStride
+                    < header->mNumSlots) {
+        ALOGW("ring header is malformed");
+        return NULL;
+    }
+
+    ring->mHeader = const_cast<RingHeader *>(header);
+    ring->mNumSlots = header->mNumSlots;
+    ring->mSlotSize = header->mSlotSize;
+    ring->mSlotStride = header->mSlotStride;
+    ring->mSlotsOffset = header->mSlotsOffset;
+
+    return ring;
+}
+
+// static
+status_t FrameExportRing::GetFrameInfo(const sp<AMessage> &format, FrameInfo *info) {
+    memset(info, 0, sizeof(*info));
+
+    int32_t colorFormat;
+    if (!format->findInt32(KEY_COLOR_FORMAT, &colorFormat)) {
+        return BAD_VALUE;
+    }
+    info->mColorFormat = colorFormat;
+
+    sp<ABuffer> imageData;
+    if (format->findBuffer("image-data", &imageData)
+            && imageData->size() >= sizeof(MediaImage2)) {
+        const MediaImage2 *image = reinterpret_cast<const MediaImage2 *>(imageData->data());
+        if (image->mType != MediaImage2::MEDIA_IMAGE_TYPE_UNKNOWN
+                && image->mNumPlanes <= MAX_NUM_PLANES) {
+            info->mWidth = image->mWidth;
+            info->mHeight = image->mHeight;
+            info->mBitDepth = image->mBitDepth;
+            info->mNumPlanes = image->mNumPlanes;
+
+            for (size_t i = 0; i < image->mNumPlanes; ++i) {
+                const MediaImage2::PlaneInfo &plane = image->mPlane[i];
+                info->mPlanes[i].mOffset = plane.mOffset;
+                info->mPlanes[i].mColInc = plane.mColInc;
+                info->mPlanes[i].mRowInc = plane.mRowInc;
+                info->mPlanes[i].mHorizSubsampling = plane.mHorizSubsampling;
+                info->mPlanes[i].mVertSubsampling = plane.mVertSubsampling;
+            }
+            return OK;
+        }
+    }
+
+    int32_t width, height, stride, sliceHeight;
+    if (!format->findInt32(KEY_WIDTH, &width) || !format->findInt32(KEY_HEIGHT, &height)) {
+        return BAD_VALUE;
+    }
+    if (!format->findInt32(KEY_STRIDE, &stride)) {
+        stride = width;
+    }
+    if (!format->findInt32(KEY_SLICE_HEIGHT, &sliceHeight)) {
+        sliceHeight = height;
+    }
+
+    info->mWidth = width;
+    info->mHeight = height;
+    info->mBitDepth = 8;
+    info->mNumPlanes = 3;
+
+    Plane *planes = info->mPlanes;
+    planes[0].mOffset = 0;
+    planes[0].mColInc = 1;
+    planes[0].mRowInc = stride;
+    planes[0].mHorizSubsampling = 1;
+    planes[0].mVertSubsampling = 1;
+
+    uint32_t chromaOffset = stride * sliceHeight;
+    for (size_t i = 1; i < 3; ++i) {
+        planes[i].mHorizSubsampling = 2;
+        planes[i].mVertSubsampling = 2;
+    }
+
+    switch (colorFormat) {
+        case COLOR_FormatYUV420Planar:
+            planes[1].mOffset = chromaOffset;
+            planes[1].mColInc = 1;
+            planes[1].mRowInc = stride / 2;
+            planes[2].mOffset = chromaOffset + (stride / 2) * (sliceHeight / 2);
+            planes[2].mColInc = 1;
+            planes[2].mRowInc = stride / 2;
+            break;
+
+        case COLOR_FormatYUV420SemiPlanar:
+            planes[1].mOffset = chromaOffset;
+            planes[1].mColInc = 2;
+            planes[1].mRowInc = stride;
+            planes[2].mOffset = chromaOffset + 1;
+            planes[2].mColInc = 2;
+            planes[2].mRowInc = stride;
+            break;
+
+        default:
+            return ERROR_UNSUPPORTED;
+    }
+
+    return OK;
+}
+
+FrameExportRing::FrameExportRing()
+    : mFd(-1),
+      mWriter(false),
+      mData(NULL),
+      mSize(0),
+      mHeader(NULL),
+      mNumSlots(0),
+      mSlotSize(0),
+      mSlotStride(0),
+      mSlotsOffset(0),
+      mNumBytesCopied(0ll) {
+}
+
+FrameExportRing::~FrameExportRing() {
+    if (mData != NULL) {
+        munmap(mData, mSize);
+        mData = NULL;
+    }
+
+    if (mWriter && mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+FrameExportRing::SlotHeader *FrameExportRing::slotAt(uint64_t index) const {
+    return reinterpret_cast<SlotHeader *>(
+            mData + mSlotsOffset + (index % mNumSlots) * mSlotStride);
+}
+
+uint8_t *FrameExportRing::slotDataAt(uint64_t index) const {
+    return reinterpret_cast<uint8_t *>(slotAt(index)) + align64(sizeof(SlotHeader));
+}
+
+status_t FrameExportRing::publish(
+        const uint8_t *data,
+        size_t size,
+        int64_t timeUs,
+        const FrameInfo &info,
+        uint64_t *index) {
+    CHECK(mWriter);
+
+    if (size > mSlotSize) {
+        return BAD_VALUE;
+    }
+
+    uint64_t frameIndex = mHeader->mNumPublished.load(std::memory_order_relaxed);
+    SlotHeader *slot = slotAt(frameIndex);
+
+    // Odd until the frame is complete, readers of the frame that was in
+    // this slot see the change and drop it.
+    uint32_t sequence = slot->mSequence.load(std::memory_order_relaxed);
+    slot->mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(slotDataAt(frameIndex), data, size);
+    slot->mSize = size;
+    slot->mIndex = frameIndex;
+    slot->mTimeUs = timeUs;
+    slot->mInfo = info;
+
+    slot->mSequence.store(sequence + 2, std::memory_order_release);
+    mHeader->mNumPublished.store(frameIndex + 1, std::memory_order_release);
+
+    mNumBytesCopied += size;
+    *index = frameIndex;
+
+    return OK;
+}
+
+void FrameExportRing::close() {
+    CHECK(mWriter);
+    mHeader->mClosed.store(1, std::memory_order_release);
+}
+
+uint64_t FrameExportRing::numPublished() const {
+    return mHeader->mNumPublished.load(std::memory_order_acquire);
+}
+
+uint64_t FrameExportRing::oldestIndex() const {
+    uint64_t numPublished = this->numPublished();
+    return numPublished > mNumSlots ? numPublished - mNumSlots : 0;
+}
+
+bool FrameExportRing::closed() const {
+    return mHeader->mClosed.load(std::memory_order_acquire) != 0;
+}
+
+status_t FrameExportRing::acquireFrame(uint64_t index, Frame *frame) const {
+    uint64_t numPublished = this->numPublished();
+    if (index >= numPublished) {
+        return NOT_ENOUGH_DATA;
+    }
+    if (numPublished - index > mNumSlots) {
+        return BAD_INDEX;
+    }
+
+    const SlotHeader *slot = slotAt(index);
+    uint32_t sequence = slot->mSequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+        // Frame index + numSlots is on its way in.
+        return BAD_INDEX;
+    }
+
+    frame->mIndex = slot->mIndex;
+    frame->mTimeUs = slot->mTimeUs;
+    frame->mInfo = slot->mInfo;
+    frame->mData = slotDataAt(index);
+    frame->mSize = slot->mSize;
+    frame->mSequence = sequence;
+
+    if (frame->mIndex != index || frame->mSize > mSlotSize || !validateFrame(*frame)) {
+        return BAD_INDEX;
+    }
+
+    return OK;
+}
+
+bool FrameExportRing::validateFrame(const Frame &frame) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slotAt(frame.mIndex)->mSequence.load(std::memory_order_relaxed) == frame.mSequence;
+}
+
+}  // namespace android
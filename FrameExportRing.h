@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAME_EXPORT_RING_H
+#define FRAME_EXPORT_RING_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+struct AMessage;
+
+// Decoded video frames published into shared memory for consumers in other
+// processes. The memory holds a header and a ring of fixed size slots, each
+// a frame as the decoder laid it out with its planes described like a
+// MediaImage2. Consumers map it from fd() and read frames in place.
+//
+// There is one writer and any number of readers and nobody ever waits. The
+// writer overwrites the oldest slot. Every slot is a sequence lock, odd
+// while it is being written, and readers check it before and after using a
+// frame to find out whether it was overwritten underneath them.
+//
+// Layout, native byte order, every part 64 byte aligned:
+//   RingHeader
+//   numSlots times: SlotHeader, slotSize bytes of frame data
+struct FrameExportRing : public RefBase {
+    enum {
+        MAX_NUM_PLANES = 4,
+    };
+
+    struct Plane {
+        uint32_t mOffset;
+        int32_t mColInc;
+        int32_t mRowInc;
+        uint32_t mHorizSubsampling;
+        uint32_t mVertSubsampling;
+    };
+
+    struct FrameInfo {
+        uint32_t mWidth;
+        uint32_t mHeight;
+        // MediaCodec color format the decoder output.
+        int32_t mColorFormat;
+        uint32_t mBitDepth;
+        uint32_t mNumPlanes;
+        Plane mPlanes[MAX_NUM_PLANES];
+    };
+
+    struct Frame {
+        uint64_t mIndex;
+        int64_t mTimeUs;
+        FrameInfo mInfo;
+        // Inside the mapping, only valid while validateFrame() says so.
+        const uint8_t *mData;
+        size_t mSize;
+
+        uint32_t mSequence;
+    };
+
+    // Writer side, backed by an ashmem region of its own.
+    static sp<FrameExportRing> Create(size_t numSlots, size_t slotSize);
+
+    // Reader side, maps the ring behind fd read-only. fd stays with the
+    // caller. NULL unless it is a ring this build can read.
+    static sp<FrameExportRing> Map(int fd);
+
+    // The plane layout of the frames a decoder outputs in format, from its
+    // "image-data" or else from the stride and slice height of a planar or
+    // semi-planar YUV 420 color format.
+    static status_t GetFrameInfo(const sp<AMessage> &format, FrameInfo *info);
+
+    int fd() const { return mFd; }
+    size_t numSlots() const { return mNumSlots; }
+    size_t slotSize() const { return mSlotSize; }
+
+    // Writer only. Copies the frame into the oldest slot, BAD_VALUE if it
+    // does not fit into one.
+    status_t publish(
+            const uint8_t *data,
+            size_t size,
+            int64_t timeUs,
+            const FrameInfo &info,
+            uint64_t *index);
+
+    // Writer only, tells readers no more frames are coming.
+    void close();
+
+    // Frames published so far, frame n goes into slot n % numSlots().
+    uint64_t numPublished() const;
+    uint64_t oldestIndex() const;
+    bool closed() const;
+
+    // Writer side counter.
+    int64_t numBytesCopied() const { return mNumBytesCopied; }
+
+    // Reader only. Points frame at frame number index inside the mapping,
+    // nothing is copied. NOT_ENOUGH_DATA if it has not been published yet,
+    // BAD_INDEX if it has been overwritten already, a reader that far behind
+    // carries on from oldestIndex().
+    status_t acquireFrame(uint64_t index, Frame *frame) const;
+
+    // Whether frame was left alone since acquireFrame(), its data is garbage
+    // otherwise. Call once done with it.
+    bool validateFrame(const Frame &frame) const;
+
+protected:
+    virtual ~FrameExportRing();
+
+private:
+    struct RingHeader;
+    struct SlotHeader;
+
+    int mFd;
+    bool mWriter;
+    uint8_t *mData;
+    size_t mSize;
+    RingHeader *mHeader;
+    // Copied out of the header once it has been checked.
+    size_t mNumSlots;
+    size_t mSlotSize;
+    size_t mSlotStride;
+    size_t mSlotsOffset;
+    int64_t mNumBytesCopied;
+
+    FrameExportRing();
+
+    SlotHeader *slotAt(uint64_t index) const;
+    uint8_t *slotDataAt(uint64_t index) const;
+
+    DISALLOW_EVIL_CONSTRUCTORS(FrameExportRing);
+};
+
+}  // namespace android
+
+#endif // FRAME_EXPORT_RING_H
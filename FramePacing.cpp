@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FramePacing"
+
+#include <math.h>
+
+#include <utils/Log.h>
+
+#include "FramePacing.h"
+
+namespace android {
+
+FramePacing::FramePacing() {
+    reset();
+}
+
+void FramePacing::reset() {
+    mNumFrames = 0ll;
+    mLastMediaTimeUs = -1ll;
+    mLastSystemNs = -1ll;
+    mNumIntervals = 0ll;
+    mIntervalMeanUs = 0.0;
+    mIntervalM2 = 0.0;
+    mErrorMeanUs = 0.0;
+    mErrorM2 = 0.0;
+}
+
+void FramePacing::onFrameRendered(int64_t mediaTimeUs, int64_t systemNs) {
+    ++mNumFrames;
+
+    if (mLastSystemNs >= 0ll && mediaTimeUs > mLastMediaTimeUs) {
+        double intervalUs = (systemNs - mLastSystemNs) / 1E3;
+        double errorUs = intervalUs - (mediaTimeUs - mLastMediaTimeUs);
+
+        ++mNumIntervals;
+
+        double delta = intervalUs - mIntervalMeanUs;
+        mIntervalMeanUs += delta / mNumIntervals;
+        mIntervalM2 += delta * (intervalUs - mIntervalMeanUs);
+
+        delta = errorUs - mErrorMeanUs;
+        mErrorMeanUs += delta / mNumIntervals;
+        mErrorM2 += delta * (errorUs - mErrorMeanUs);
+    }
+
+    mLastMediaTimeUs = mediaTimeUs;
+    mLastSystemNs = systemNs;
+}
+
+int64_t FramePacing::intervalStdDevUs() const {
+    return mNumIntervals > 1 ? (int64_t)sqrt(mIntervalM2 / (mNumIntervals - 1)) : 0ll;
+}
+
+int64_t FramePacing::judderUs() const {
+    return mNumIntervals > 1 ? (int64_t)sqrt(mErrorM2 / (mNumIntervals - 1)) : 0ll;
+}
+
+}  // namespace android
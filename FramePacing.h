@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <stdint.h>
+
+namespace android {
+
+// Frame pacing of what actually reached the display, fed from the codec's
+// frame rendered notifications. Judder is the standard deviation of the
+// difference between each present interval and the media time interval of
+// the same two frames, it is zero for perfectly paced playback whatever the
+// frame rate.
+struct FramePacing {
+    FramePacing();
+
+    void onFrameRendered(int64_t mediaTimeUs, int64_t systemNs);
+    void reset();
+
+    // The next frame does not follow the previous one, e.g. after a seek.
+    void onDiscontinuity() { mLastSystemNs = -1ll; }
+
+    int64_t numFrames() const { return mNumFrames; }
+    int64_t intervalMeanUs() const { return (int64_t)mIntervalMeanUs; }
+    int64_t intervalStdDevUs() const;
+    int64_t judderUs() const;
+
+private:
+    int64_t mNumFrames;
+    int64_t mLastMediaTimeUs;
+    int64_t mLastSystemNs;
+
+    // Running mean and sum of squared deviations (Welford).
+    int64_t mNumIntervals;
+    double mIntervalMeanUs;
+    double mIntervalM2;
+    double mErrorMeanUs;
+    double mErrorM2;
+};
+
+}  // namespace android
+
+#endif // FRAME_PACING_H
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FrameTimeline"
+
+#include <inttypes.h>
+
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Log.h>
+
+#include "FrameTimeline.h"
+
+namespace android {
+
+// Frames whose output never showed up (e.g. decoder-dropped) are forgotten
+// once this many are in flight.
+static const size_t kMaxFramesInFlight = 64;
+
+FrameTimeline::FrameTimeline()
+    : mNumFramesDropped(0ll) {
+}
+
+void FrameTimeline::reset() {
+    clearPending();
+
+    for (size_t i = 0; i < NUM_STAGES; ++i) {
+        mHistograms[i].reset();
+    }
+    mNumFramesDropped = 0ll;
+}
+
+void FrameTimeline::clearPending() {
+    mPending.clear();
+}
+
+void FrameTimeline::onQueued(int64_t timeUs, int64_t demuxTimeUs, int64_t nowUs) {
+    if (mPending.size() >= kMaxFramesInFlight) {
+        mPending.removeItemsAt(0);
+    }
+
+    Timestamps timestamps;
+    timestamps.mDemuxTimeUs = demuxTimeUs;
+    timestamps.mQueueTimeUs = nowUs;
+    timestamps.mOutputTimeUs = -1ll;
+    mPending.add(timeUs, timestamps);
+
+    mHistograms[DEMUX_TO_QUEUE].record(nowUs - demuxTimeUs);
+}
+
+void FrameTimeline::onOutput(int64_t timeUs, int64_t nowUs) {
+    ssize_t index = mPending.indexOfKey(timeUs);
+    if (index < 0) {
+        return;
+    }
+
+    Timestamps &timestamps = mPending.editValueAt(index);
+    timestamps.mOutputTimeUs = nowUs;
+
+    mHistograms[QUEUE_TO_OUTPUT].record(nowUs - timestamps.mQueueTimeUs);
+}
+
+int64_t FrameTimeline::onRendered(int64_t timeUs, int64_t nowUs, bool dropped) {
+    if (dropped) {
+        ++mNumFramesDropped;
+    }
+
+    ssize_t index = mPending.indexOfKey(timeUs);
+    if (index < 0) {
+        return -1ll;
+    }
+
+    const Timestamps &timestamps = mPending.valueAt(index);
+    int64_t queueToRenderUs = -1ll;
+    if (timestamps.mOutputTimeUs >= 0ll) {
+        queueToRenderUs = nowUs - timestamps.mQueueTimeUs;
+        mHistograms[OUTPUT_TO_RENDER].record(nowUs - timestamps.mOutputTimeUs);
+        mHistograms[QUEUE_TO_RENDER].record(queueToRenderUs);
+        mHistograms[DEMUX_TO_RENDER].record(nowUs - timestamps.mDemuxTimeUs);
+    }
+
+    mPending.removeItemsAt(index);
+    return queueToRenderUs;
+}
+
+void FrameTimeline::writeToMessage(const sp<AMessage> &msg) const {
+    for (size_t i = 0; i < NUM_STAGES; ++i) {
+        const LatencyHistogram &histogram = mHistograms[i];
+        const char *name = StageName((Stage)i);
+
+        msg->setInt64(AStringPrintf("%s-count", name).c_str(), histogram.count());
+
+        if (histogram.count() > 0) {
+            msg->setInt64(AStringPrintf("%s-p50-us", name).c_str(),
+                          histogram.percentileUs(50));
+            msg->setInt64(AStringPrintf("%s-p90-us", name).c_str(),
+                          histogram.percentileUs(90));
+            msg->setInt64(AStringPrintf("%s-p99-us", name).c_str(),
+                          histogram.percentileUs(99));
+            msg->setInt64(AStringPrintf("%s-max-us", name).c_str(),
+                          histogram.maxUs());
+        }
+    }
+}
+
+void FrameTimeline::dump(AString *out) const {
+    for (size_t i = 0; i < NUM_STAGES; ++i) {
+        const LatencyHistogram &histogram = mHistograms[i];
+
+        out->append(AStringPrintf(
+                "%s: n=%" PRId64 " p50=%" PRId64 " p90=%" PRId64
+                " p99=%" PRId64 " max=%" PRId64 " us\n",
+                StageName((Stage)i),
+                histogram.count(),
+                histogram.percentileUs(50),
+                histogram.percentileUs(90),
+                histogram.percentileUs(99),
+                histogram.maxUs()));
+    }
+}
+
+// static
+const char *FrameTimeline::StageName(Stage stage) {
+    switch (stage) {
+        case DEMUX_TO_QUEUE:   return "demux-to-queue";
+        case QUEUE_TO_OUTPUT:  return "queue-to-output";
+        case OUTPUT_TO_RENDER: return "output-to-render";
+        case QUEUE_TO_RENDER:  return "queue-to-render";
+        case DEMUX_TO_RENDER:  return "demux-to-render";
+        default:               return "unknown";
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAME_TIMELINE_H
+#define FRAME_TIMELINE_H
+
+#include <utils/KeyedVector.h>
+
+#include "LatencyHistogram.h"
+
+namespace android {
+
+struct AMessage;
+class AString;
+
+// Follows access units of one track from the extractor to the display or
+// AudioTrack, keyed by presentation time, and keeps a histogram per stage.
+// Only a few integer updates per frame so it can stay enabled.
+struct FrameTimeline {
+    enum Stage {
+        DEMUX_TO_QUEUE,     // readSampleData to queueInputBuffer
+        QUEUE_TO_OUTPUT,    // queueInputBuffer to output buffer available
+        OUTPUT_TO_RENDER,   // output buffer available to render or drop
+        QUEUE_TO_RENDER,    // queueInputBuffer to render, decoder included
+        DEMUX_TO_RENDER,    // end to end
+        NUM_STAGES
+    };
+
+    FrameTimeline();
+
+    void onQueued(int64_t timeUs, int64_t demuxTimeUs, int64_t nowUs);
+    void onOutput(int64_t timeUs, int64_t nowUs);
+    // The frame's QUEUE_TO_RENDER latency, -1 if it was not followed.
+    int64_t onRendered(int64_t timeUs, int64_t nowUs, bool dropped);
+
+    // Forgets frames in flight, e.g. after the codec has been flushed.
+    void clearPending();
+    void reset();
+
+    const LatencyHistogram &histogram(Stage stage) const { return mHistograms[stage]; }
+    int64_t numFramesDropped() const { return mNumFramesDropped; }
+
+    // "<stage>-count" and "<stage>-p50-us", "-p90-us", "-p99-us", "-max-us".
+    void writeToMessage(const sp<AMessage> &msg) const;
+    void dump(AString *out) const;
+
+    static const char *StageName(Stage stage);
+
+private:
+    struct Timestamps {
+        int64_t mDemuxTimeUs;
+        int64_t mQueueTimeUs;
+        int64_t mOutputTimeUs;
+    };
+
+    KeyedVector<int64_t, Timestamps> mPending;
+    LatencyHistogram mHistograms[NUM_STAGES];
+    int64_t mNumFramesDropped;
+};
+
+}  // namespace android
+
+#endif // FRAME_TIMELINE_H
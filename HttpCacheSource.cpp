@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "HttpCacheSource"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <utils/Log.h>
+#include <utils/Thread.h>
+
+#include "HttpCacheSource.h"
+#include "HttpConnection.h"
+
+namespace android {
+
+// Unit of fetching and of caching. Large enough for a range request to be
+// mostly payload, small enough that a stall waits for little more than
+// what was asked for.
+static const size_t kBlockSize = 256 * 1024;
+
+// Failed requests are retried after kRetryDelayNs, the source fails after
+// this many in a row.
+static const size_t kMaxConsecutiveErrors = 5;
+static const nsecs_t kRetryDelayNs = 200000000ll;
+
+struct HttpCacheSource::Fetcher : public Thread {
+    explicit Fetcher(HttpCacheSource *source)
+        : Thread(false /* canCallJava */),
+          mSource(source) {
+    }
+
+    HttpConnection mConnection;
+
+private:
+    // close() joins the thread, so the source outlives it.
+    HttpCacheSource *mSource;
+
+    virtual bool threadLoop() {
+        return mSource->fetchNextBlock(&mConnection);
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(Fetcher);
+};
+
+HttpCacheSource::HttpCacheSource(
+        const char *url,
+        size_t cacheBytes,
+        size_t readAheadBytes,
+        size_t numConnections,
+        const char *cacheFilePath)
+    : mUrl(url),
+      mNumConnections(numConnections > 0 ? numConnections : 1),
+      mCacheFilePath(cacheFilePath != NULL ? cacheFilePath : ""),
+      mCacheFd(-1),
+      mInitCheck(NO_INIT),
+      mFinalStatus(OK),
+      mClosing(false),
+      mSize(0),
+      mNumBlocks(0),
+      mBlocks(NULL),
+      mNumSlots(cacheBytes / kBlockSize),
+      mOnDisk(NULL),
+      mReadBlock(0),
+      mReadAheadBlocks(readAheadBytes / kBlockSize),
+      mUseCount(0ll),
+      mNumConsecutiveErrors(0),
+      mConnectTimeUs(-1ll),
+      mNumRequests(0ll),
+      mNumBytesFetched(0ll),
+      mNumDiskReads(0ll),
+      mNumEvictions(0ll),
+      mNumStalls(0ll),
+      mStallTimeUs(0ll) {
+    // Every fetcher needs a block to fetch into while the reader holds on
+    // to one outside of the read-ahead.
+    if (mNumSlots < mNumConnections + 2) {
+        mNumSlots = mNumConnections + 2;
+    }
+
+    int64_t maxReadAheadBlocks = mNumSlots - mNumConnections - 1;
+    if (mReadAheadBlocks > maxReadAheadBlocks) {
+        mReadAheadBlocks = maxReadAheadBlocks;
+    } else if (mReadAheadBlocks < 1) {
+        mReadAheadBlocks = 1;
+    }
+
+    mBlocks = new Block[mNumSlots];
+    for (size_t i = 0; i < mNumSlots; ++i) {
+        Block *block = &mBlocks[i];
+        block->mIndex = -1;
+        block->mState = EMPTY;
+        block->mData = NULL;
+        block->mSize = 0;
+        block->mLastUsed = 0ll;
+    }
+}
+
+HttpCacheSource::~HttpCacheSource() {
+    close();
+
+    for (size_t i = 0; i < mNumSlots; ++i) {
+        delete[] mBlocks[i].mData;
+    }
+    delete[] mBlocks;
+    mBlocks = NULL;
+
+    delete[] mOnDisk;
+    mOnDisk = NULL;
+
+    if (mCacheFd >= 0) {
+        ::close(mCacheFd);
+        mCacheFd = -1;
+    }
+}
+
+status_t HttpCacheSource::connect() {
+    CHECK_EQ(mInitCheck, (status_t)NO_INIT);
+
+    int64_t startUs = ALooper::GetNowUs();
+
+    for (size_t i = 0; i < mNumConnections; ++i) {
+        sp<Fetcher> fetcher = new Fetcher(this);
+        status_t err = fetcher->mConnection.setUrl(mUrl.c_str());
+        if (err != OK) {
+            return err;
+        }
+        mFetchers.push_back(fetcher);
+    }
+
+    // Nothing runs yet, no need to lock.
+    Block *block = &mBlocks[0];
+    block->mData = new uint8_t[kBlockSize];
+
+    size_t numRead;
+    off64_t size;
+    status_t err = mFetchers[0]->mConnection.getRange(
+            0, kBlockSize, block->mData, &numRead, &size);
+    if (err != OK) {
+        ALOGE("failed to fetch %s: %d", mUrl.c_str(), err);
+        return err;
+    }
+
+    if (size <= 0) {
+        ALOGE("%s is empty", mUrl.c_str());
+        return ERROR_MALFORMED;
+    }
+
+    mSize = size;
+    mNumBlocks = (mSize + kBlockSize - 1) / kBlockSize;
+    ++mNumRequests;
+    mNumBytesFetched += numRead;
+
+    block->mIndex = 0;
+    block->mState = READY;
+    block->mSize = numRead;
+    block->mLastUsed = ++mUseCount;
+    mSlotByBlock.add(0, 0);
+
+    if (!mCacheFilePath.empty()) {
+        mCacheFd = open(mCacheFilePath.c_str(),
+                O_RDWR | O_CREAT | O_TRUNC | O_LARGEFILE | O_CLOEXEC, 0600);
+
+        if (mCacheFd < 0 || ftruncate64(mCacheFd, mSize) != 0) {
+            ALOGW("not caching to %s: %s", mCacheFilePath.c_str(), strerror(errno));
+            if (mCacheFd >= 0) {
+                ::close(mCacheFd);
+                mCacheFd = -1;
+            }
+        } else {
+            mOnDisk = new uint8_t[mNumBlocks];
+            memset(mOnDisk, 0, mNumBlocks);
+            if (pwrite64(mCacheFd, block->mData, numRead, 0) == (ssize_t)numRead) {
+                mOnDisk[0] = 1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < mFetchers.size(); ++i) {
+        err = mFetchers[i]->run("HttpCacheFetch");
+        if (err != OK) {
+            close();
+            return err;
+        }
+    }
+
+    mConnectTimeUs = ALooper::GetNowUs() - startUs;
+    ALOGV("connected to %s in %lld us, %lld bytes",
+            mUrl.c_str(), (long long)mConnectTimeUs, (long long)mSize);
+
+    Mutex::Autolock autoLock(mLock);
+    mInitCheck = OK;
+
+    return OK;
+}
+
+void HttpCacheSource::close() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mClosing) {
+            return;
+        }
+
+        mClosing = true;
+        mCondition.broadcast();
+    }
+
+    for (size_t i = 0; i < mFetchers.size(); ++i) {
+        mFetchers[i]->requestExit();
+        mFetchers[i]->mConnection.cancel();
+    }
+
+    for (size_t i = 0; i < mFetchers.size(); ++i) {
+        mFetchers[i]->requestExitAndWait();
+    }
+    mFetchers.clear();
+}
+
+status_t HttpCacheSource::initCheck() const {
+    Mutex::Autolock autoLock(mLock);
+    return mInitCheck;
+}
+
+status_t HttpCacheSource::getSize(off64_t *size) {
+    Mutex::Autolock autoLock(mLock);
+    if (mInitCheck != OK) {
+        return mInitCheck;
+    }
+
+    *size = mSize;
+    return OK;
+}
+
+bool HttpCacheSource::isReadAhead_l(int64_t blockIndex) const {
+    return blockIndex >= mReadBlock && blockIndex < mReadBlock + mReadAheadBlocks;
+}
+
+bool HttpCacheSource::needsFetch_l(int64_t blockIndex) const {
+    return mSlotByBlock.indexOfKey(blockIndex) < 0
+        && (mOnDisk == NULL || !mOnDisk[blockIndex]);
+}
+
+ssize_t HttpCacheSource::allocateSlot_l(int64_t blockIndex) {
+    ssize_t victim = -1;
+    for (size_t i = 0; i < mNumSlots; ++i) {
+        const Block &block = mBlocks[i];
+        if (block.mState == EMPTY) {
+            victim = i;
+            break;
+        }
+
+        if (block.mState == READY && !isReadAhead_l(block.mIndex)
+                && (victim < 0 || block.mLastUsed < mBlocks[victim].mLastUsed)) {
+            victim = i;
+        }
+    }
+
+    if (victim < 0) {
+        return -1;
+    }
+
+    Block *block = &mBlocks[victim];
+    if (block->mState == READY) {
+        ALOGV("evicting block %lld for %lld", (long long)block->mIndex, (long long)blockIndex);
+        mSlotByBlock.removeItem(block->mIndex);
+        ++mNumEvictions;
+    }
+
+    if (block->mData == NULL) {
+        block->mData = new uint8_t[kBlockSize];
+    }
+
+    block->mIndex = blockIndex;
+    block->mState = FETCHING;
+    block->mSize = 0;
+    mSlotByBlock.add(blockIndex, victim);
+
+    return victim;
+}
+
+bool HttpCacheSource::pickBlockToFetch_l(int64_t *blockIndex, size_t *slot) {
+    if (mInitCheck != OK || mFinalStatus != OK) {
+        return false;
+    }
+
+    int64_t end = mReadBlock + mReadAheadBlocks;
+    if (end > mNumBlocks) {
+        end = mNumBlocks;
+    }
+
+    for (int64_t i = mReadBlock; i < end; ++i) {
+        if (!needsFetch_l(i)) {
+            continue;
+        }
+
+        ssize_t index = allocateSlot_l(i);
+        if (index < 0) {
+            return false;
+        }
+
+        *blockIndex = i;
+        *slot = index;
+        return true;
+    }
+
+    return false;
+}
+
+void HttpCacheSource::setReadBlock_l(int64_t blockIndex) {
+    if (blockIndex != mReadBlock) {
+        mReadBlock = blockIndex;
+        mCondition.broadcast();
+    }
+}
+
+bool HttpCacheSource::fetchNextBlock(HttpConnection *connection) {
+    int64_t blockIndex;
+    size_t slot;
+    {
+        Mutex::Autolock autoLock(mLock);
+        while (!pickBlockToFetch_l(&blockIndex, &slot)) {
+            if (mClosing) {
+                return false;
+            }
+            mCondition.wait(mLock);
+        }
+    }
+
+    // The block is FETCHING, nobody else touches it until it is READY.
+    Block *block = &mBlocks[slot];
+    off64_t offset = blockIndex * kBlockSize;
+    size_t size = kBlockSize;
+    if (offset + (off64_t)size > mSize) {
+        size = mSize - offset;
+    }
+
+    size_t numRead = 0;
+    off64_t totalSize;
+    status_t err = connection->getRange(offset, size, block->mData, &numRead, &totalSize);
+    if (err == OK && (numRead != size || totalSize != mSize)) {
+        ALOGE("%s changed size", mUrl.c_str());
+        err = ERROR_MALFORMED;
+    }
+
+    bool written = err == OK && mCacheFd >= 0
+        && pwrite64(mCacheFd, block->mData, size, offset) == (ssize_t)size;
+
+    Mutex::Autolock autoLock(mLock);
+    ++mNumRequests;
+
+    if (err != OK) {
+        mSlotByBlock.removeItem(blockIndex);
+        block->mIndex = -1;
+        block->mState = EMPTY;
+
+        if (mClosing) {
+            return false;
+        }
+
+        ALOGW("fetching block %lld failed: %d", (long long)blockIndex, err);
+        if (++mNumConsecutiveErrors >= kMaxConsecutiveErrors) {
+            mFinalStatus = err;
+            mCondition.broadcast();
+            return false;
+        }
+
+        mCondition.waitRelative(mLock, kRetryDelayNs);
+        return true;
+    }
+
+    mNumConsecutiveErrors = 0;
+    mNumBytesFetched += size;
+
+    block->mState = READY;
+    block->mSize = size;
+    block->mLastUsed = ++mUseCount;
+    if (written) {
+        mOnDisk[blockIndex] = 1;
+    }
+
+    mCondition.broadcast();
+    return true;
+}
+
+ssize_t HttpCacheSource::readAt(off64_t offset, void *data, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+    if (mInitCheck != OK) {
+        return mInitCheck;
+    }
+
+    if (offset < 0) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    if (offset >= mSize) {
+        return 0;
+    }
+
+    if ((off64_t)size > mSize - offset) {
+        size = mSize - offset;
+    }
+
+    uint8_t *dst = static_cast<uint8_t *>(data);
+    int64_t stallStartUs = -1ll;
+    size_t copied = 0;
+    while (copied < size) {
+        off64_t position = offset + copied;
+        int64_t blockIndex = position / kBlockSize;
+        size_t blockOffset = position % kBlockSize;
+        size_t n = kBlockSize - blockOffset;
+        if (n > size - copied) {
+            n = size - copied;
+        }
+
+        setReadBlock_l(blockIndex);
+
+        ssize_t index = mSlotByBlock.indexOfKey(blockIndex);
+        if (index >= 0) {
+            Block *block = &mBlocks[mSlotByBlock.valueAt(index)];
+            if (block->mState == READY) {
+                memcpy(dst + copied, block->mData + blockOffset, n);
+                block->mLastUsed = ++mUseCount;
+                copied += n;
+                continue;
+            }
+        } else if (mOnDisk != NULL && mOnDisk[blockIndex]) {
+            if (pread64(mCacheFd, dst + copied, n, position) == (ssize_t)n) {
+                ++mNumDiskReads;
+                copied += n;
+                continue;
+            }
+
+            ALOGW("failed to read back block %lld: %s", (long long)blockIndex, strerror(errno));
+            mOnDisk[blockIndex] = 0;
+            mCondition.broadcast();
+        }
+
+        if (mClosing || mFinalStatus != OK) {
+            break;
+        }
+
+        if (stallStartUs < 0ll) {
+            stallStartUs = ALooper::GetNowUs();
+            ++mNumStalls;
+            ALOGV("stalled at %lld", (long long)position);
+        }
+
+        mCondition.wait(mLock);
+    }
+
+    if (stallStartUs >= 0ll) {
+        mStallTimeUs += ALooper::GetNowUs() - stallStartUs;
+    }
+
+    if (copied == 0 && size > 0) {
+        return mFinalStatus != OK ? mFinalStatus : ERROR_END_OF_STREAM;
+    }
+
+    return copied;
+}
+
+int64_t HttpCacheSource::connectTimeUs() const {
+    Mutex::Autolock autoLock(mLock);
+    return mConnectTimeUs;
+}
+
+int64_t HttpCacheSource::numRequests() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumRequests;
+}
+
+int64_t HttpCacheSource::numBytesFetched() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumBytesFetched;
+}
+
+int64_t HttpCacheSource::numDiskReads() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumDiskReads;
+}
+
+int64_t HttpCacheSource::numEvictions() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumEvictions;
+}
+
+int64_t HttpCacheSource::numStalls() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumStalls;
+}
+
+int64_t HttpCacheSource::stallTimeUs() const {
+    Mutex::Autolock autoLock(mLock);
+    return mStallTimeUs;
+}
+
+}  // namespace android
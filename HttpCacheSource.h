@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HTTP_CACHE_SOURCE_H
+#define HTTP_CACHE_SOURCE_H
+
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Condition.h>
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct HttpConnection;
+
+// Progressive download of a single http:// resource. A handful of fetcher
+// threads, each with its own kept alive connection, request fixed size
+// blocks with range requests ahead of the last read, nearest first, into
+// a bounded pool of blocks in memory. Blocks are only evicted, least
+// recently used first, to make room for the ones ahead of the reader, so
+// what was just played stays around for seeks back. With a cache file
+// every block fetched is written there as well and never fetched again.
+// readAt() blocks until the data has arrived, each such wait is a stall.
+struct HttpCacheSource : public DataSource {
+    HttpCacheSource(
+            const char *url,
+            size_t cacheBytes,
+            size_t readAheadBytes,
+            size_t numConnections,
+            const char *cacheFilePath /* may be NULL */);
+
+    // Fetches the first block, which tells the size of the resource, and
+    // starts the fetchers. initCheck() fails until this succeeds.
+    status_t connect();
+
+    virtual status_t initCheck() const;
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size);
+    virtual status_t getSize(off64_t *size);
+
+    // Stops the fetchers, pending and later reads fail.
+    virtual void close();
+
+    int64_t connectTimeUs() const;
+    int64_t numRequests() const;
+    int64_t numBytesFetched() const;
+    int64_t numDiskReads() const;
+    int64_t numEvictions() const;
+    int64_t numStalls() const;
+    int64_t stallTimeUs() const;
+
+protected:
+    virtual ~HttpCacheSource();
+
+private:
+    struct Fetcher;
+
+    enum BlockState {
+        EMPTY,
+        FETCHING,
+        READY,
+    };
+
+    struct Block {
+        int64_t mIndex;
+        BlockState mState;
+        uint8_t *mData;
+        size_t mSize;
+        int64_t mLastUsed;
+    };
+
+    AString mUrl;
+    size_t mNumConnections;
+    AString mCacheFilePath;
+    int mCacheFd;
+
+    Vector<sp<Fetcher> > mFetchers;
+
+    mutable Mutex mLock;
+    Condition mCondition;
+    status_t mInitCheck;
+    status_t mFinalStatus;
+    bool mClosing;
+    off64_t mSize;
+    int64_t mNumBlocks;
+
+    Block *mBlocks;
+    size_t mNumSlots;
+    KeyedVector<int64_t, size_t> mSlotByBlock;
+    // One flag per block of the resource, set once it is in the cache file.
+    uint8_t *mOnDisk;
+
+    // Block of the last read and how many after it are fetched.
+    int64_t mReadBlock;
+    int64_t mReadAheadBlocks;
+    int64_t mUseCount;
+    size_t mNumConsecutiveErrors;
+
+    int64_t mConnectTimeUs;
+    int64_t mNumRequests;
+    int64_t mNumBytesFetched;
+    int64_t mNumDiskReads;
+    int64_t mNumEvictions;
+    int64_t mNumStalls;
+    int64_t mStallTimeUs;
+
+    bool needsFetch_l(int64_t blockIndex) const;
+    bool isReadAhead_l(int64_t blockIndex) const;
+    ssize_t allocateSlot_l(int64_t blockIndex);
+    bool pickBlockToFetch_l(int64_t *blockIndex, size_t *slot);
+    void setReadBlock_l(int64_t blockIndex);
+
+    // Runs on the fetcher threads, false once closed.
+    bool fetchNextBlock(HttpConnection *connection);
+
+    DISALLOW_EVIL_CONSTRUCTORS(HttpCacheSource);
+};
+
+}  // namespace android
+
+#endif // HTTP_CACHE_SOURCE_H
@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "HttpConnection"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Log.h>
+
+#include "HttpConnection.h"
+
+namespace android {
+
+// A server that sends nothing for this long is given up on.
+static const int kSocketTimeoutSecs = 10;
+
+HttpConnection::HttpConnection()
+    : mPort(80),
+      mSocket(-1),
+      mAborted(false),
+      mBufferOffset(0),
+      mBufferSize(0) {
+}
+
+HttpConnection::~HttpConnection() {
+    disconnect();
+}
+
+// static
+bool HttpConnection::ParseUrl(const char *url, AString *host, int *port, AString *path) {
+    static const char kScheme[] = "http://";
+    if (strncasecmp(url, kScheme, sizeof(kScheme) - 1)) {
+        return false;
+    }
+
+    const char *hostStart = url + sizeof(kScheme) - 1;
+    const char *pathStart = strchr(hostStart, '/');
+    if (pathStart == NULL) {
+        pathStart = hostStart + strlen(hostStart);
+    }
+
+    const char *colon = (const char *)memchr(hostStart, ':', pathStart - hostStart);
+    const char *hostEnd = colon != NULL ? colon : pathStart;
+    if (hostEnd == hostStart) {
+        return false;
+    }
+
+    *port = 80;
+    if (colon != NULL) {
+        char *end;
+        long value = strtol(colon + 1, &end, 10);
+        if (end != pathStart || value <= 0 || value > 65535) {
+            return false;
+        }
+        *port = value;
+    }
+
+    host->setTo(hostStart, hostEnd - hostStart);
+    path->setTo(*pathStart != '\0' ? pathStart : "/");
+    return true;
+}
+
+status_t HttpConnection::setUrl(const char *url) {
+    disconnect();
+
+    if (!ParseUrl(url, &mHost, &mPort, &mPath)) {
+        ALOGE("unsupported url %s", url);
+        return ERROR_UNSUPPORTED;
+    }
+
+    return OK;
+}
+
+status_t HttpConnection::connect() {
+    char service[16];
+    snprintf(service, sizeof(service), "%d", mPort);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *addresses;
+    int res = getaddrinfo(mHost.c_str(), service, &hints, &addresses);
+    if (res != 0) {
+        ALOGE("failed to resolve %s: %s", mHost.c_str(), gai_strerror(res));
+        return ERROR_UNKNOWN_HOST;
+    }
+
+    int s = -1;
+    for (struct addrinfo *ai = addresses; ai != NULL; ai = ai->ai_next) {
+        s = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (s < 0) {
+            continue;
+        }
+
+        if (::connect(s, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+
+        ::close(s);
+        s = -1;
+    }
+    freeaddrinfo(addresses);
+
+    if (s < 0) {
+        ALOGE("failed to connect to %s:%d: %s", mHost.c_str(), mPort, strerror(errno));
+        return ERROR_CANNOT_CONNECT;
+    }
+
+    // Requests are small and each one waits for its answer.
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct timeval timeout;
+    timeout.tv_sec = kSocketTimeoutSecs;
+    timeout.tv_usec = 0;
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    Mutex::Autolock autoLock(mLock);
+    if (mAborted.load()) {
+        ::close(s);
+        return ERROR_CONNECTION_LOST;
+    }
+
+    mSocket = s;
+    mBufferOffset = 0;
+    mBufferSize = 0;
+
+    return OK;
+}
+
+void HttpConnection::disconnect() {
+    Mutex::Autolock autoLock(mLock);
+    if (mSocket >= 0) {
+        ::close(mSocket);
+        mSocket = -1;
+    }
+}
+
+void HttpConnection::cancel() {
+    Mutex::Autolock autoLock(mLock);
+    mAborted.store(true);
+    if (mSocket >= 0) {
+        shutdown(mSocket, SHUT_RDWR);
+    }
+}
+
+status_t HttpConnection::getRange(
+        off64_t offset, size_t size, uint8_t *data,
+        size_t *numRead, off64_t *totalSize) {
+    CHECK(size > 0);
+
+    for (;;) {
+        if (mAborted.load()) {
+            return ERROR_CONNECTION_LOST;
+        }
+
+        bool reused = mSocket >= 0;
+        status_t err = OK;
+        if (!reused) {
+            err = connect();
+            if (err != OK) {
+                return err;
+            }
+        }
+
+        err = sendRequest(offset, size);
+        if (err == OK) {
+            err = readResponse(offset, size, data, numRead, totalSize);
+        }
+
+        if (err == OK) {
+            return OK;
+        }
+
+        disconnect();
+
+        // A kept alive connection may have been closed by the server in the
+        // meantime, that deserves one more try on a new one.
+        if (!reused || mAborted.load()) {
+            return err;
+        }
+
+        ALOGV("connection to %s:%d went stale, reconnecting", mHost.c_str(), mPort);
+    }
+}
+
+status_t HttpConnection::sendRequest(off64_t offset, size_t size) {
+    AString request = AStringPrintf(
+            "GET %s HTTP/1.1\r\n"
+            "Host: %s:%d\r\n"
+            "Range: bytes=%lld-%lld\r\n"
+            "User-Agent: SimplePlayer\r\n"
+            "\r\n",
+            mPath.c_str(), mHost.c_str(), mPort,
+            (long long)offset, (long long)(offset + size - 1));
+
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t n = send(mSocket, request.c_str() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            ALOGV("send failed: %s", strerror(errno));
+            return ERROR_IO;
+        }
+
+        sent += n;
+    }
+
+    return OK;
+}
+
+status_t HttpConnection::readLine(AString *line) {
+    for (;;) {
+        const uint8_t *start = mBuffer + mBufferOffset;
+        const uint8_t *end =
+            (const uint8_t *)memchr(start, '\n', mBufferSize - mBufferOffset);
+
+        if (end != NULL) {
+            size_t length = end - start;
+            if (length > 0 && start[length - 1] == '\r') {
+                --length;
+            }
+
+            line->setTo((const char *)start, length);
+            mBufferOffset = end + 1 - mBuffer;
+            return OK;
+        }
+
+        memmove(mBuffer, start, mBufferSize - mBufferOffset);
+        mBufferSize -= mBufferOffset;
+        mBufferOffset = 0;
+
+        if (mBufferSize == sizeof(mBuffer)) {
+            ALOGE("header line too long");
+            return ERROR_MALFORMED;
+        }
+
+        ssize_t n = recv(mSocket, mBuffer + mBufferSize, sizeof(mBuffer) - mBufferSize, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            return n == 0 ? ERROR_CONNECTION_LOST : ERROR_IO;
+        }
+
+        mBufferSize += n;
+    }
+}
+
+status_t HttpConnection::readFully(uint8_t *data, size_t size) {
+    size_t buffered = mBufferSize - mBufferOffset;
+    if (buffered > size) {
+        buffered = size;
+    }
+
+    memcpy(data, mBuffer + mBufferOffset, buffered);
+    mBufferOffset += buffered;
+
+    size_t offset = buffered;
+    while (offset < size) {
+        ssize_t n = recv(mSocket, data + offset, size - offset, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            ALOGW("connection lost %zu bytes into a %zu byte body", offset, size);
+            return n == 0 ? ERROR_CONNECTION_LOST : ERROR_IO;
+        }
+
+        offset += n;
+    }
+
+    return OK;
+}
+
+status_t HttpConnection::readResponse(
+        off64_t offset, size_t size, uint8_t *data,
+        size_t *numRead, off64_t *totalSize) {
+    AString line;
+    status_t err = readLine(&line);
+    if (err != OK) {
+        return err;
+    }
+
+    int statusCode;
+    if (sscanf(line.c_str(), "HTTP/%*d.%*d %d", &statusCode) != 1) {
+        ALOGE("malformed status line '%s'", line.c_str());
+        return ERROR_MALFORMED;
+    }
+
+    long long contentLength = -1;
+    long long rangeStart = -1;
+    long long rangeTotal = -1;
+    bool keepAlive = true;
+
+    for (;;) {
+        err = readLine(&line);
+        if (err != OK) {
+            return err;
+        }
+
+        if (line.empty()) {
+            break;
+        }
+
+        const char *header = line.c_str();
+        if (!strncasecmp(header, "Content-Length:", 15)) {
+            contentLength = strtoll(header + 15, NULL, 10);
+        } else if (!strncasecmp(header, "Content-Range:", 14)) {
+            long long rangeEnd;
+            if (sscanf(header + 14, " bytes %lld-%lld/%lld",
+                        &rangeStart, &rangeEnd, &rangeTotal) != 3) {
+                sscanf(header + 14, " bytes */%lld", &rangeTotal);
+            }
+        } else if (!strncasecmp(header, "Connection:", 11)) {
+            keepAlive = strcasestr(header + 11, "close") == NULL;
+        } else if (!strncasecmp(header, "Transfer-Encoding:", 18)) {
+            ALOGE("transfer encoding%s not supported", header + 18);
+            return ERROR_UNSUPPORTED;
+        }
+    }
+
+    if (statusCode == 416) {
+        // Asked for bytes past the end.
+        disconnect();
+        if (rangeTotal < 0) {
+            return ERROR_MALFORMED;
+        }
+
+        *numRead = 0;
+        *totalSize = rangeTotal;
+        return OK;
+    }
+
+    size_t bodySize;
+    if (statusCode == 206) {
+        if (rangeStart != offset || contentLength < 0
+                || (uint64_t)contentLength > size || rangeTotal < 0) {
+            ALOGE("unexpected range %lld+%lld/%lld for %lld+%zu",
+                    rangeStart, contentLength, rangeTotal, (long long)offset, size);
+            return ERROR_MALFORMED;
+        }
+
+        bodySize = contentLength;
+        *totalSize = rangeTotal;
+    } else if (statusCode == 200) {
+        // The server ignored the range, which only helps if it starts at 0.
+        // The rest of the body is not worth reading, the connection goes.
+        if (offset != 0 || contentLength < 0) {
+            ALOGE("server does not support range requests");
+            return ERROR_UNSUPPORTED;
+        }
+
+        bodySize = (uint64_t)contentLength < size ? contentLength : size;
+        keepAlive = keepAlive && bodySize == (uint64_t)contentLength;
+        *totalSize = contentLength;
+    } else {
+        ALOGE("GET %s returned %d", mPath.c_str(), statusCode);
+        disconnect();
+        return ERROR_IO;
+    }
+
+    err = readFully(data, bodySize);
+    if (err != OK) {
+        return err;
+    }
+
+    if (!keepAlive) {
+        disconnect();
+    }
+
+    *numRead = bodySize;
+    return OK;
+}
+
+}  // namespace android
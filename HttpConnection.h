@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HTTP_CONNECTION_H
+#define HTTP_CONNECTION_H
+
+#include <sys/types.h>
+
+#include <atomic>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Errors.h>
+#include <utils/Mutex.h>
+
+namespace android {
+
+// Just enough of an HTTP/1.1 client to fetch byte ranges of one resource:
+// plain http:// only, no redirects, no chunked bodies. The connection is
+// kept alive between requests and reopened whenever the server drops it.
+// Not thread safe, every fetcher owns its own.
+struct HttpConnection {
+    HttpConnection();
+    ~HttpConnection();
+
+    // Splits http://host[:port]/path, false for anything else.
+    static bool ParseUrl(const char *url, AString *host, int *port, AString *path);
+
+    status_t setUrl(const char *url);
+
+    // Fetches [offset, offset + size) into data. *numRead is less than size
+    // only at the end of the resource, *totalSize is the size of the whole
+    // resource as reported by the server.
+    status_t getRange(
+            off64_t offset, size_t size, uint8_t *data,
+            size_t *numRead, off64_t *totalSize);
+
+    // Unblocks a getRange() running on another thread, which then fails, and
+    // every later one.
+    void cancel();
+
+    void disconnect();
+
+private:
+    AString mHost;
+    int mPort;
+    AString mPath;
+
+    // Guards mSocket against cancel(), everything else belongs to the
+    // thread calling getRange().
+    Mutex mLock;
+    int mSocket;
+    std::atomic<bool> mAborted;
+
+    // Bytes received past the end of the headers.
+    uint8_t mBuffer[4096];
+    size_t mBufferOffset;
+    size_t mBufferSize;
+
+    status_t connect();
+    status_t sendRequest(off64_t offset, size_t size);
+    status_t readLine(AString *line);
+    status_t readFully(uint8_t *data, size_t size);
+    status_t readResponse(
+            off64_t offset, size_t size, uint8_t *data,
+            size_t *numRead, off64_t *totalSize);
+
+    DISALLOW_EVIL_CONSTRUCTORS(HttpConnection);
+};
+
+}  // namespace android
+
+#endif // HTTP_CONNECTION_H
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "IndexedSampleSource"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/Log.h>
+
+#include "IndexedSampleSource.h"
+#include "MmapFileSource.h"
+#include "SampleIndexFile.h"
+
+namespace android {
+
+IndexedSampleSource::IndexedSampleSource(
+        const char *mediaPath, const sp<SampleIndexFile> &index)
+    : mFile(new MmapFileSource(mediaPath)),
+      mIndex(index),
+      mEntry(0) {
+    Track track;
+    track.mSelected = false;
+    track.mStartEntry = 0;
+    mTracks.insertAt(track, 0, mIndex->countTracks());
+}
+
+IndexedSampleSource::~IndexedSampleSource() {
+}
+
+status_t IndexedSampleSource::initCheck() const {
+    return mFile->initCheck();
+}
+
+size_t IndexedSampleSource::countTracks() const {
+    return mTracks.size();
+}
+
+status_t IndexedSampleSource::getTrackFormat(size_t index, sp<AMessage> *format) const {
+    if (index >= mTracks.size()) {
+        return -ERANGE;
+    }
+
+    *format = mIndex->getTrackFormat(index)->dup();
+    return OK;
+}
+
+status_t IndexedSampleSource::selectTrack(size_t index) {
+    if (index >= mTracks.size()) {
+        return -ERANGE;
+    }
+
+    mTracks.editItemAt(index).mSelected = true;
+    return OK;
+}
+
+status_t IndexedSampleSource::findSyncEntry(
+        size_t track, int64_t timeUs, MediaSource::ReadOptions::SeekMode mode,
+        size_t *entry) const {
+    size_t numSyncSamples = mIndex->countSyncSamples(track);
+    if (numSyncSamples == 0) {
+        ALOGE("track %zu has no sync samples to seek to", track);
+        return ERROR_MALFORMED;
+    }
+
+    // First sync sample at or after timeUs.
+    size_t lo = 0;
+    size_t hi = numSyncSamples;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mIndex->sampleAt(mIndex->syncSampleAt(track, mid)).mTimeUs < timeUs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    size_t next = lo < numSyncSamples ? lo : numSyncSamples - 1;
+    size_t prev = lo < numSyncSamples
+            && mIndex->sampleAt(mIndex->syncSampleAt(track, lo)).mTimeUs == timeUs
+            ? lo : (lo > 0 ? lo - 1 : 0);
+
+    size_t n;
+    switch (mode) {
+        case MediaSource::ReadOptions::SEEK_NEXT_SYNC:
+            n = next;
+            break;
+
+        case MediaSource::ReadOptions::SEEK_CLOSEST_SYNC:
+        {
+            int64_t prevTimeUs = mIndex->sampleAt(mIndex->syncSampleAt(track, prev)).mTimeUs;
+            int64_t nextTimeUs = mIndex->sampleAt(mIndex->syncSampleAt(track, next)).mTimeUs;
+            n = llabs(nextTimeUs - timeUs) < llabs(timeUs - prevTimeUs) ? next : prev;
+            break;
+        }
+
+        default:
+            n = prev;
+            break;
+    }
+
+    *entry = mIndex->syncSampleAt(track, n);
+    return OK;
+}
+
+status_t IndexedSampleSource::seekTo(
+        int64_t timeUs, MediaSource::ReadOptions::SeekMode mode) {
+    Vector<size_t> startEntries;
+    startEntries.insertAt(0, 0, mTracks.size());
+    size_t entry = mIndex->countSamples();
+
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        if (!mTracks.itemAt(i).mSelected) {
+            continue;
+        }
+
+        status_t err = findSyncEntry(i, timeUs, mode, &startEntries.editItemAt(i));
+        if (err != OK) {
+            return err;
+        }
+        if (startEntries[i] < entry) {
+            entry = startEntries[i];
+        }
+    }
+
+    // Only moved once every track found its sync sample.
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        if (mTracks.itemAt(i).mSelected) {
+            mTracks.editItemAt(i).mStartEntry = startEntries[i];
+        }
+    }
+    mEntry = entry;
+
+    skipUnselected();
+    return OK;
+}
+
+void IndexedSampleSource::skipUnselected() {
+    while (mEntry < mIndex->countSamples()) {
+        const Track &track = mTracks.itemAt(mIndex->sampleAt(mEntry).mTrack);
+        if (track.mSelected && mEntry >= track.mStartEntry) {
+            break;
+        }
+        ++mEntry;
+    }
+}
+
+status_t IndexedSampleSource::advance() {
+    if (mEntry < mIndex->countSamples()) {
+        ++mEntry;
+    }
+
+    skipUnselected();
+    return OK;
+}
+
+status_t IndexedSampleSource::readSampleData(const sp<ABuffer> &buffer) {
+    skipUnselected();
+    if (mEntry >= mIndex->countSamples()) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    const SampleIndexFile::SampleEntry &entry = mIndex->sampleAt(mEntry);
+    if (buffer->capacity() < entry.mSize) {
+        return -ENOMEM;
+    }
+
+    uint8_t *data = buffer->base();
+    // Straight from the mapping into the codec's buffer.
+    if (mFile->readAt(entry.mOffset, data, entry.mSize) != (ssize_t)entry.mSize) {
+        ALOGE("failed to read %u bytes at %lld", entry.mSize, (long long)entry.mOffset);
+        return ERROR_IO;
+    }
+
+    if (mIndex->getTrackFlags(entry.mTrack) & SampleIndexFile::kTrackFlagNALLengthPrefixed) {
+        // Only 4 byte lengths are ever indexed, they turn into start codes
+        // in place.
+        size_t pos = 0;
+        while (pos + 4 <= entry.mSize) {
+            size_t nalLength = (data[pos] << 24) | (data[pos + 1] << 16)
+                    | (data[pos + 2] << 8) | data[pos + 3];
+            if (nalLength > entry.mSize - pos - 4) {
+                break;
+            }
+            data[pos] = data[pos + 1] = data[pos + 2] = 0;
+            data[pos + 3] = 1;
+            pos += 4 + nalLength;
+        }
+
+        if (pos != entry.mSize) {
+            ALOGE("sample at %lld is not made of 4 byte length prefixed NAL units",
+                  (long long)entry.mOffset);
+            return ERROR_MALFORMED;
+        }
+    }
+
+    buffer->setRange(0, entry.mSize);
+    return OK;
+}
+
+status_t IndexedSampleSource::getSampleSize(size_t *sampleSize) {
+    skipUnselected();
+    if (mEntry >= mIndex->countSamples()) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    *sampleSize = mIndex->sampleAt(mEntry).mSize;
+    return OK;
+}
+
+status_t IndexedSampleSource::getSampleTrackIndex(size_t *trackIndex) {
+    skipUnselected();
+    if (mEntry >= mIndex->countSamples()) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    *trackIndex = mIndex->sampleAt(mEntry).mTrack;
+    return OK;
+}
+
+status_t IndexedSampleSource::getSampleTime(int64_t *sampleTimeUs) {
+    skipUnselected();
+    if (mEntry >= mIndex->countSamples()) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    *sampleTimeUs = mIndex->sampleAt(mEntry).mTimeUs;
+    return OK;
+}
+
+status_t IndexedSampleSource::getSampleMeta(sp<MetaData> *sampleMeta) {
+    skipUnselected();
+    if (mEntry >= mIndex->countSamples()) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    const SampleIndexFile::SampleEntry &entry = mIndex->sampleAt(mEntry);
+
+    *sampleMeta = new MetaData;
+    (*sampleMeta)->setInt64(kKeyTime, entry.mTimeUs);
+    (*sampleMeta)->setInt64(kKeySampleFileOffset, entry.mOffset);
+    if (entry.mFlags & SampleIndexFile::kSampleFlagSync) {
+        (*sampleMeta)->setInt32(kKeyIsSyncFrame, 1);
+    }
+
+    return OK;
+}
+
+}  // namespace android
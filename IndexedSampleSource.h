@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDEXED_SAMPLE_SOURCE_H
+#define INDEXED_SAMPLE_SOURCE_H
+
+#include <utils/Vector.h>
+
+#include "SampleSource.h"
+
+namespace android {
+
+struct MmapFileSource;
+struct SampleIndexFile;
+
+// Reads samples straight from the media file at the offsets listed in a
+// SampleIndexFile, without parsing the container. The file is mapped, see
+// MmapFileSource. Track indices are those of the index, which only holds
+// the tracks that were selected when it was written.
+struct IndexedSampleSource : public SampleSource {
+    IndexedSampleSource(const char *mediaPath, const sp<SampleIndexFile> &index);
+
+    status_t initCheck() const;
+
+    const sp<SampleIndexFile> &index() const { return mIndex; }
+
+    virtual size_t countTracks() const;
+    virtual status_t getTrackFormat(size_t index, sp<AMessage> *format) const;
+    virtual status_t selectTrack(size_t index);
+
+    virtual status_t seekTo(
+            int64_t timeUs, MediaSource::ReadOptions::SeekMode mode);
+
+    virtual status_t advance();
+    virtual status_t readSampleData(const sp<ABuffer> &buffer);
+    virtual status_t getSampleSize(size_t *sampleSize);
+    virtual status_t getSampleTrackIndex(size_t *trackIndex);
+    virtual status_t getSampleTime(int64_t *sampleTimeUs);
+    virtual status_t getSampleMeta(sp<MetaData> *sampleMeta);
+
+protected:
+    virtual ~IndexedSampleSource();
+
+private:
+    struct Track {
+        bool mSelected;
+        // Samples of this track before this entry were skipped by a seek.
+        size_t mStartEntry;
+    };
+
+    sp<MmapFileSource> mFile;
+    sp<SampleIndexFile> mIndex;
+    Vector<Track> mTracks;
+    size_t mEntry;
+
+    // Moves mEntry forward to the next sample of a selected track.
+    void skipUnselected();
+
+    // Sample entry of the sync sample a seek to timeUs lands on, an error
+    // if the track has none.
+    status_t findSyncEntry(
+            size_t track, int64_t timeUs, MediaSource::ReadOptions::SeekMode mode,
+            size_t *entry) const;
+
+    DISALLOW_EVIL_CONSTRUCTORS(IndexedSampleSource);
+};
+
+}  // namespace android
+
+#endif // INDEXED_SAMPLE_SOURCE_H
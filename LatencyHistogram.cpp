@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "LatencyHistogram"
+
+#include <string.h>
+
+#include <utils/Log.h>
+
+#include "LatencyHistogram.h"
+
+namespace android {
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    memset(mCounts, 0, sizeof(mCounts));
+    mCount = 0ll;
+    mSumUs = 0ll;
+    mMaxUs = 0ll;
+}
+
+void LatencyHistogram::record(int64_t valueUs) {
+    if (valueUs < 0ll) {
+        valueUs = 0ll;
+    }
+
+    ++mCounts[bucketIndex(valueUs)];
+    ++mCount;
+    mSumUs += valueUs;
+
+    if (valueUs > mMaxUs) {
+        mMaxUs = valueUs;
+    }
+}
+
+int64_t LatencyHistogram::percentileUs(double percentile) const {
+    if (mCount == 0) {
+        return 0ll;
+    }
+
+    int64_t target = (int64_t)(percentile / 100.0 * mCount + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+
+    int64_t seen = 0ll;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+        seen += mCounts[i];
+        if (seen >= target) {
+            int64_t valueUs = bucketValue(i);
+            return valueUs < mMaxUs ? valueUs : mMaxUs;
+        }
+    }
+
+    return mMaxUs;
+}
+
+// static
+size_t LatencyHistogram::bucketIndex(int64_t valueUs) {
+    if (valueUs < 2 * kSubBuckets) {
+        return valueUs;
+    }
+
+    if (valueUs >= (1ll << kMaxValueBits)) {
+        return kNumBuckets - 1;
+    }
+
+    int msb = 63 - __builtin_clzll(valueUs);
+    int shift = msb - kSubBucketBits;
+    size_t sub = (valueUs >> shift) & (kSubBuckets - 1);
+
+    return (shift + 1) * kSubBuckets + sub;
+}
+
+// static
+int64_t LatencyHistogram::bucketValue(size_t index) {
+    if (index < 2 * kSubBuckets) {
+        return index;
+    }
+
+    int shift = index / kSubBuckets - 1;
+    int64_t sub = index % kSubBuckets;
+
+    // Upper bound of the bucket.
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+}  // namespace android
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+
+// Fixed size log-linear histogram of durations in microseconds. Values below
+// 32 us are exact, larger ones land in one of 16 sub-buckets per power of two,
+// which keeps percentiles within ~6% without ever allocating.
+struct LatencyHistogram {
+    LatencyHistogram();
+
+    void record(int64_t valueUs);
+    void reset();
+
+    int64_t count() const { return mCount; }
+    int64_t maxUs() const { return mMaxUs; }
+    int64_t meanUs() const { return mCount > 0 ? mSumUs / mCount : 0ll; }
+
+    // percentile in [0, 100].
+    int64_t percentileUs(double percentile) const;
+
+private:
+    enum {
+        kSubBucketBits = 4,
+        kSubBuckets = 1 << kSubBucketBits,
+        kMaxValueBits = 40,
+        kNumBuckets = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets,
+    };
+
+    int64_t mCounts[kNumBuckets];
+    int64_t mCount;
+    int64_t mSumUs;
+    int64_t mMaxUs;
+
+    static size_t bucketIndex(int64_t valueUs);
+    static int64_t bucketValue(size_t index);
+};
+
+}  // namespace android
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "LoopbackHttpServer"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <utils/Log.h>
+#include <utils/Thread.h>
+
+#include "LoopbackHttpServer.h"
+
+namespace android {
+
+// Bodies go out in chunks of this size, each one paced on its own.
+static const size_t kChunkSize = 16 * 1024;
+
+static const size_t kMaxRequestSize = 8 * 1024;
+
+struct LoopbackHttpServer::Acceptor : public Thread {
+    explicit Acceptor(LoopbackHttpServer *server)
+        : Thread(false /* canCallJava */),
+          mServer(server) {
+    }
+
+private:
+    LoopbackHttpServer *mServer;
+
+    virtual bool threadLoop() {
+        return mServer->acceptConnection();
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(Acceptor);
+};
+
+struct LoopbackHttpServer::Session : public Thread {
+    Session(LoopbackHttpServer *server, int fd)
+        : Thread(false /* canCallJava */),
+          mFd(fd),
+          mSize(0),
+          mServer(server) {
+    }
+
+    int mFd;
+    // Request bytes received and not yet handled.
+    char mBuffer[kMaxRequestSize];
+    size_t mSize;
+
+protected:
+    virtual ~Session() {
+        ::close(mFd);
+    }
+
+private:
+    LoopbackHttpServer *mServer;
+
+    virtual bool threadLoop() {
+        if (mServer->serveRequest(this)) {
+            return true;
+        }
+
+        mServer->removeSession(this);
+        return false;
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(Session);
+};
+
+static bool sendFully(int fd, const void *data, size_t size) {
+    const uint8_t *ptr = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        ssize_t n = send(fd, ptr, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            return false;
+        }
+
+        ptr += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+LoopbackHttpServer::LoopbackHttpServer(int64_t bytesPerSec, int64_t latencyUs)
+    : mBytesPerSec(bytesPerSec),
+      mLatencyUs(latencyUs),
+      mListenFd(-1),
+      mPort(-1),
+      mStopping(false),
+      mLinkBusyUntilUs(0ll),
+      mNumRequests(0ll),
+      mNumBytesServed(0ll) {
+}
+
+LoopbackHttpServer::~LoopbackHttpServer() {
+    stop();
+
+    for (size_t i = 0; i < mFileFds.size(); ++i) {
+        if (mFileFds[i] >= 0) {
+            ::close(mFileFds[i]);
+        }
+    }
+}
+
+status_t LoopbackHttpServer::start() {
+    CHECK_LT(mListenFd, 0);
+
+    mListenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (mListenFd < 0) {
+        ALOGE("failed to create socket: %s", strerror(errno));
+        return -errno;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    socklen_t addrLen = sizeof(addr);
+    if (bind(mListenFd, (const struct sockaddr *)&addr, sizeof(addr)) != 0
+            || listen(mListenFd, 16) != 0
+            || getsockname(mListenFd, (struct sockaddr *)&addr, &addrLen) != 0) {
+        ALOGE("failed to listen on the loopback interface: %s", strerror(errno));
+        ::close(mListenFd);
+        mListenFd = -1;
+        return UNKNOWN_ERROR;
+    }
+
+    mPort = ntohs(addr.sin_port);
+
+    mAcceptor = new Acceptor(this);
+    return mAcceptor->run("LoopbackHttpAccept");
+}
+
+void LoopbackHttpServer::stop() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mStopping = true;
+    }
+
+    if (mAcceptor != NULL) {
+        mAcceptor->requestExit();
+        shutdown(mListenFd, SHUT_RDWR);
+        mAcceptor->requestExitAndWait();
+        mAcceptor.clear();
+    }
+
+    if (mListenFd >= 0) {
+        ::close(mListenFd);
+        mListenFd = -1;
+    }
+
+    Vector<sp<Session> > sessions;
+    {
+        Mutex::Autolock autoLock(mLock);
+        sessions = mSessions;
+        mSessions.clear();
+    }
+
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        sessions[i]->requestExit();
+        shutdown(sessions[i]->mFd, SHUT_RDWR);
+    }
+
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        sessions[i]->requestExitAndWait();
+    }
+}
+
+AString LoopbackHttpServer::addFile(const char *path) {
+    int fd = open(path, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+    ALOGE_IF(fd < 0, "failed to open %s: %s", path, strerror(errno));
+
+    Mutex::Autolock autoLock(mLock);
+    mFileFds.push_back(fd);
+
+    // Keep the extension, it is all the type sniffing some extractors get.
+    const char *extension = strrchr(path, '.');
+    if (extension == NULL || strchr(extension, '/') != NULL) {
+        extension = "";
+    }
+
+    return AStringPrintf(
+            "http://127.0.0.1:%d/%zu%s", mPort, mFileFds.size() - 1, extension);
+}
+
+bool LoopbackHttpServer::acceptConnection() {
+    int fd = accept4(mListenFd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+            return true;
+        }
+
+        ALOGV("stopped accepting: %s", strerror(errno));
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    sp<Session> session = new Session(this, fd);
+
+    Mutex::Autolock autoLock(mLock);
+    if (mStopping) {
+        return false;
+    }
+
+    mSessions.push_back(session);
+    session->run("LoopbackHttpSession");
+    return true;
+}
+
+void LoopbackHttpServer::removeSession(Session *session) {
+    Mutex::Autolock autoLock(mLock);
+
+    for (size_t i = 0; i < mSessions.size(); ++i) {
+        if (mSessions[i].get() == session) {
+            // The thread still holds a reference until it is out of its loop.
+            mSessions.removeAt(i);
+            break;
+        }
+    }
+}
+
+void LoopbackHttpServer::throttle(size_t size) {
+    if (mBytesPerSec <= 0) {
+        return;
+    }
+
+    int64_t doneUs;
+    {
+        Mutex::Autolock autoLock(mLock);
+        int64_t nowUs = ALooper::GetNowUs();
+        if (mLinkBusyUntilUs < nowUs) {
+            mLinkBusyUntilUs = nowUs;
+        }
+
+        mLinkBusyUntilUs += size * 1000000ll / mBytesPerSec;
+        doneUs = mLinkBusyUntilUs;
+    }
+
+    int64_t delayUs = doneUs - ALooper::GetNowUs();
+    if (delayUs > 0ll) {
+        usleep(delayUs);
+    }
+}
+
+status_t LoopbackHttpServer::sendBody(int fd, int fileFd, off64_t offset, off64_t size) {
+    uint8_t buffer[kChunkSize];
+    while (size > 0) {
+        size_t n = size < (off64_t)kChunkSize ? size : kChunkSize;
+        ssize_t numRead = pread64(fileFd, buffer, n, offset);
+        if (numRead <= 0) {
+            return ERROR_IO;
+        }
+
+        throttle(numRead);
+
+        if (!sendFully(fd, buffer, numRead)) {
+            return ERROR_CONNECTION_LOST;
+        }
+
+        {
+            Mutex::Autolock autoLock(mLock);
+            mNumBytesServed += numRead;
+        }
+
+        offset += numRead;
+        size -= numRead;
+    }
+
+    return OK;
+}
+
+bool LoopbackHttpServer::serveRequest(Session *session) {
+    char *end;
+    for (;;) {
+        end = (char *)memmem(session->mBuffer, session->mSize, "\r\n\r\n", 4);
+        if (end != NULL) {
+            break;
+        }
+
+        if (session->mSize == sizeof(session->mBuffer)) {
+            ALOGE("request too large");
+            return false;
+        }
+
+        ssize_t n = recv(session->mFd, session->mBuffer + session->mSize,
+                sizeof(session->mBuffer) - session->mSize, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            return false;
+        }
+
+        session->mSize += n;
+    }
+
+    // Headers are parsed as one string.
+    *end = '\0';
+    size_t requestSize = end + 4 - session->mBuffer;
+
+    unsigned fileIndex;
+    bool known = sscanf(session->mBuffer, "GET /%u", &fileIndex) == 1;
+
+    long long rangeStart = -1;
+    long long rangeEnd = -1;
+    const char *range = strcasestr(session->mBuffer, "\r\nRange: bytes=");
+    if (range != NULL) {
+        int numParsed = sscanf(range, "\r\nRange: bytes=%lld-%lld", &rangeStart, &rangeEnd);
+        if (numParsed < 1) {
+            rangeStart = -1;
+        }
+    }
+
+    memmove(session->mBuffer, session->mBuffer + requestSize, session->mSize - requestSize);
+    session->mSize -= requestSize;
+
+    int fileFd = -1;
+    {
+        Mutex::Autolock autoLock(mLock);
+        ++mNumRequests;
+        if (known && fileIndex < mFileFds.size()) {
+            fileFd = mFileFds[fileIndex];
+        }
+    }
+
+    if (mLatencyUs > 0ll) {
+        usleep(mLatencyUs);
+    }
+
+    struct stat64 st;
+    if (fileFd < 0 || fstat64(fileFd, &st) != 0) {
+        static const char kNotFound[] =
+            "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        return sendFully(session->mFd, kNotFound, sizeof(kNotFound) - 1);
+    }
+
+    long long fileSize = st.st_size;
+    AString headers;
+    off64_t offset = 0;
+    off64_t size = fileSize;
+    if (rangeStart >= fileSize) {
+        headers = AStringPrintf(
+                "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                "Content-Range: bytes */%lld\r\n"
+                "Content-Length: 0\r\n\r\n",
+                fileSize);
+        size = 0;
+    } else if (rangeStart >= 0) {
+        if (rangeEnd < rangeStart || rangeEnd >= fileSize) {
+            rangeEnd = fileSize - 1;
+        }
+
+        offset = rangeStart;
+        size = rangeEnd - rangeStart + 1;
+        headers = AStringPrintf(
+                "HTTP/1.1 206 Partial Content\r\n"
+                "Accept-Ranges: bytes\r\n"
+                "Content-Range: bytes %lld-%lld/%lld\r\n"
+                "Content-Length: %lld\r\n\r\n",
+                rangeStart, rangeEnd, fileSize, (long long)size);
+    } else {
+        headers = AStringPrintf(
+                "HTTP/1.1 200 OK\r\n"
+                "Accept-Ranges: bytes\r\n"
+                "Content-Length: %lld\r\n\r\n",
+                fileSize);
+    }
+
+    if (!sendFully(session->mFd, headers.c_str(), headers.size())) {
+        return false;
+    }
+
+    return sendBody(session->mFd, fileFd, offset, size) == OK;
+}
+
+int64_t LoopbackHttpServer::numRequests() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumRequests;
+}
+
+int64_t LoopbackHttpServer::numBytesServed() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumBytesServed;
+}
+
+}  // namespace android
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOOPBACK_HTTP_SERVER_H
+#define LOOPBACK_HTTP_SERVER_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// HTTP/1.1 server on 127.0.0.1 for local files, to play them through
+// HttpCacheSource under controlled network conditions. GET with or without
+// a single byte range, kept alive connections, one thread per connection.
+// Every response is held back by latencyUs before its headers go out and
+// the bodies of all connections together are paced to bytesPerSec, as if
+// they shared one link. 0 turns either off.
+struct LoopbackHttpServer : public RefBase {
+    LoopbackHttpServer(int64_t bytesPerSec, int64_t latencyUs);
+
+    // Listens on a port picked by the kernel.
+    status_t start();
+    void stop();
+
+    // The url path is served at, once started.
+    AString addFile(const char *path);
+
+    int64_t numRequests() const;
+    int64_t numBytesServed() const;
+
+protected:
+    virtual ~LoopbackHttpServer();
+
+private:
+    struct Acceptor;
+    struct Session;
+
+    int64_t mBytesPerSec;
+    int64_t mLatencyUs;
+    int mListenFd;
+    int mPort;
+    sp<Acceptor> mAcceptor;
+
+    mutable Mutex mLock;
+    bool mStopping;
+    Vector<int> mFileFds;
+    Vector<sp<Session> > mSessions;
+    // When the emulated link is done with what has been sent so far.
+    int64_t mLinkBusyUntilUs;
+    int64_t mNumRequests;
+    int64_t mNumBytesServed;
+
+    // Run on the acceptor and the session threads, false once done.
+    bool acceptConnection();
+    bool serveRequest(Session *session);
+    // A session whose connection is done drops out of mSessions.
+    void removeSession(Session *session);
+
+    status_t sendBody(int fd, int fileFd, off64_t offset, off64_t size);
+    void throttle(size_t size);
+
+    DISALLOW_EVIL_CONSTRUCTORS(LoopbackHttpServer);
+};
+
+}  // namespace android
+
+#endif // LOOPBACK_HTTP_SERVER_H
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MmapFileSource"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Log.h>
+
+#include "MmapFileSource.h"
+
+namespace android {
+
+// How far ahead of the read position the kernel is asked to have the file
+// resident. Once less than half of that is left another half is requested,
+// so sequential reads cost one madvise() per kReadAheadBytes / 2.
+static const off64_t kReadAheadBytes = 4ll * 1024 * 1024;
+
+static off64_t pageAlignDown(off64_t offset) {
+    static const off64_t kPageSize = sysconf(_SC_PAGESIZE);
+    return offset & ~(kPageSize - 1);
+}
+
+MmapFileSource::MmapFileSource(const char *path)
+    : mFd(open(path, O_RDONLY | O_LARGEFILE | O_CLOEXEC)),
+      mSize(0),
+      mData(NULL),
+      mReadAheadStart(0),
+      mReadAheadEnd(0),
+      mNumReads(0ll),
+      mNumReadAheads(0ll),
+      mNumPreads(0ll) {
+    if (mFd < 0) {
+        ALOGE("failed to open %s: %s", path, strerror(errno));
+        return;
+    }
+
+    struct stat64 st;
+    if (fstat64(mFd, &st) != 0) {
+        ALOGE("failed to stat %s: %s", path, strerror(errno));
+        ::close(mFd);
+        mFd = -1;
+        return;
+    }
+    mSize = st.st_size;
+
+    if (mSize == 0 || (uint64_t)mSize > SIZE_MAX) {
+        return;
+    }
+
+    void *data = mmap(NULL, mSize, PROT_READ, MAP_SHARED, mFd, 0);
+    if (data == MAP_FAILED) {
+        ALOGW("failed to map %s, reading it instead: %s", path, strerror(errno));
+        return;
+    }
+
+    mData = static_cast<uint8_t *>(data);
+
+    // Containers are mostly read front to back, pages behind the read
+    // position can go early.
+    madvise(mData, mSize, MADV_SEQUENTIAL);
+}
+
+MmapFileSource::~MmapFileSource() {
+    if (mData != NULL) {
+        munmap(mData, mSize);
+        mData = NULL;
+    }
+
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+status_t MmapFileSource::initCheck() const {
+    return mFd >= 0 ? OK : NO_INIT;
+}
+
+uint32_t MmapFileSource::flags() {
+    return kIsLocalFileSource;
+}
+
+status_t MmapFileSource::getSize(off64_t *size) {
+    if (mFd < 0) {
+        return NO_INIT;
+    }
+
+    *size = mSize;
+    return OK;
+}
+
+const uint8_t *MmapFileSource::getView(off64_t offset, size_t size) {
+    if (mData == NULL || offset < 0 || offset > mSize || (off64_t)size > mSize - offset) {
+        return NULL;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    ++mNumReads;
+    readAhead_l(offset, size);
+
+    return mData + offset;
+}
+
+ssize_t MmapFileSource::readAt(off64_t offset, void *data, size_t size) {
+    if (mFd < 0) {
+        return NO_INIT;
+    }
+
+    if (offset < 0) {
+        return BAD_VALUE;
+    }
+
+    if (mData == NULL) {
+        {
+            Mutex::Autolock autoLock(mLock);
+            ++mNumPreads;
+        }
+
+        ssize_t n = pread64(mFd, data, size, offset);
+        return n < 0 ? ERROR_IO : n;
+    }
+
+    if (offset >= mSize) {
+        return 0;
+    }
+
+    if ((off64_t)size > mSize - offset) {
+        size = mSize - offset;
+    }
+
+    // Touching a page of the mapping past the end of a file that was
+    // truncated since raises SIGBUS, what is left of it is read instead. A
+    // truncation between here and the copy is still fatal.
+    struct stat64 st;
+    if (fstat64(mFd, &st) != 0 || st.st_size < offset + (off64_t)size) {
+        ALOGW("file no longer holds %lld bytes, reading it instead of the mapping",
+              (long long)(offset + size));
+        {
+            Mutex::Autolock autoLock(mLock);
+            ++mNumPreads;
+        }
+
+        ssize_t n = pread64(mFd, data, size, offset);
+        return n < 0 ? ERROR_IO : n;
+    }
+
+    memcpy(data, getView(offset, size), size);
+    return size;
+}
+
+void MmapFileSource::readAhead_l(off64_t offset, size_t size) {
+    off64_t end = offset + size;
+
+    if (offset < mReadAheadStart || offset > mReadAheadEnd) {
+        // Seeked, or read something out of the way like an index.
+        mReadAheadStart = pageAlignDown(offset);
+        mReadAheadEnd = mReadAheadStart;
+    }
+
+    if (mReadAheadEnd - end >= kReadAheadBytes / 2 || mReadAheadEnd >= mSize) {
+        return;
+    }
+
+    off64_t start = mReadAheadEnd > end ? mReadAheadEnd : pageAlignDown(end);
+    off64_t stop = end + kReadAheadBytes;
+    if (stop > mSize) {
+        stop = mSize;
+    }
+
+    madvise(mData + start, stop - start, MADV_WILLNEED);
+    ++mNumReadAheads;
+
+    // Whatever is far enough behind is left to MADV_SEQUENTIAL.
+    if (offset - mReadAheadStart > kReadAheadBytes) {
+        mReadAheadStart = pageAlignDown(offset);
+    }
+    mReadAheadEnd = stop;
+}
+
+int64_t MmapFileSource::numReads() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumReads;
+}
+
+int64_t MmapFileSource::numReadAheads() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumReadAheads;
+}
+
+int64_t MmapFileSource::numPreads() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumPreads;
+}
+
+}  // namespace android
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MMAP_FILE_SOURCE_H
+#define MMAP_FILE_SOURCE_H
+
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Mutex.h>
+
+namespace android {
+
+// Local file source that maps the whole file and serves reads out of the
+// mapping, so reading costs an fstat() rather than a copy through the kernel
+// once the pages are resident. The fstat() catches files truncated while
+// mapped, those are read with pread() rather than faulting on the mapping.
+// The kernel is asked to read ahead of the current position with
+// MADV_WILLNEED, a window at a time, and the window starts over wherever a
+// read lands outside of it. Files that cannot be mapped are read with
+// pread() instead.
+struct MmapFileSource : public DataSource {
+    explicit MmapFileSource(const char *path);
+
+    virtual status_t initCheck() const;
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size);
+    virtual status_t getSize(off64_t *size);
+    virtual uint32_t flags();
+
+    int64_t numReads() const;
+    int64_t numReadAheads() const;
+    int64_t numPreads() const;
+
+protected:
+    virtual ~MmapFileSource();
+
+private:
+    int mFd;
+    off64_t mSize;
+    uint8_t *mData;
+
+    mutable Mutex mLock;
+    // Range the kernel has been asked to read ahead.
+    off64_t mReadAheadStart;
+    off64_t mReadAheadEnd;
+    int64_t mNumReads;
+    int64_t mNumReadAheads;
+    int64_t mNumPreads;
+
+    // The bytes at offset straight from the mapping, NULL unless all of them
+    // are inside the file and it is mapped.
+    const uint8_t *getView(off64_t offset, size_t size);
+    void readAhead_l(off64_t offset, size_t size);
+
+    DISALLOW_EVIL_CONSTRUCTORS(MmapFileSource);
+};
+
+}  // namespace android
+
+#endif // MMAP_FILE_SOURCE_H
@@ -0,0 +1,519 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PcmKernels"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "PcmKernels.h"
+
+namespace android {
+
+// The plain versions are what the vectorized ones are measured against,
+// keep the compiler from vectorizing them behind our back.
+#if defined(__clang__)
+#define NO_VECTORIZE _Pragma("clang loop vectorize(disable) interleave(disable)")
+#else
+#define NO_VECTORIZE
+#endif
+
+static const float kInt16Scale = 32768.0f;
+static const float kInt24Scale = 8388608.0f;
+
+// -3 dB for everything but the front pair, normalized by the largest sum
+// a channel of the output can see.
+static const float kDownmixGain = (float)M_SQRT1_2;
+static const float kDownmix5_1Scale = 1.0f / (1.0f + 2.0f * kDownmixGain);
+static const float kDownmix7_1Scale = 1.0f / (1.0f + 3.0f * kDownmixGain);
+
+static inline float Clamp(float value, float minValue, float maxValue) {
+    return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+}
+
+static inline void PackInt24(int32_t value, uint8_t *out) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+}
+
+static inline int32_t UnpackInt24(const uint8_t *in) {
+    // Assembled in the top bytes so that the shift extends the sign.
+    return (int32_t)((uint32_t)in[0] << 8 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 24) >> 8;
+}
+
+static void Int16ToFloatScalar(const int16_t *in, float *out, size_t numSamples) {
+    NO_VECTORIZE
+    for (size_t i = 0; i < numSamples; ++i) {
+        out[i] = in[i] * (1.0f / kInt16Scale);
+    }
+}
+
+static void FloatToInt16Scalar(const float *in, int16_t *out, size_t numSamples) {
+    NO_VECTORIZE
+    for (size_t i = 0; i < numSamples; ++i) {
+        out[i] = (int16_t)lrintf(Clamp(in[i] * kInt16Scale, -32768.0f, 32767.0f));
+    }
+}
+
+static void Int24ToFloatScalar(const uint8_t *in, float *out, size_t numSamples) {
+    NO_VECTORIZE
+    for (size_t i = 0; i < numSamples; ++i) {
+        out[i] = UnpackInt24(in + 3 * i) * (1.0f / kInt24Scale);
+    }
+}
+
+static void FloatToInt24Scalar(const float *in, uint8_t *out, size_t numSamples) {
+    NO_VECTORIZE
+    for (size_t i = 0; i < numSamples; ++i) {
+        PackInt24(lrintf(Clamp(in[i] * kInt24Scale, -8388608.0f, 8388607.0f)), out + 3 * i);
+    }
+}
+
+static void ApplyGainScalar(
+        float *data, size_t numFrames, int32_t channelCount, float gain, float gainStep) {
+    NO_VECTORIZE
+    for (size_t i = 0; i < numFrames; ++i) {
+        float frameGain = gain + i * gainStep;
+        for (int32_t c = 0; c < channelCount; ++c) {
+            data[i * channelCount + c] *= frameGain;
+        }
+    }
+}
+
+static void Downmix5_1Scalar(const float *in, float *out, size_t numFrames) {
+    NO_VECTORIZE
+    for (size_t i = 0; i < numFrames; ++i) {
+        const float *frame = in + 6 * i;
+        float common = kDownmixGain * frame[2];
+        float left = frame[0] + common + kDownmixGain * frame[4];
+        float right = frame[1] + common + kDownmixGain * frame[5];
+        out[2 * i] = left * kDownmix5_1Scale;
+        out[2 * i + 1] = right * kDownmix5_1Scale;
+    }
+}
+
+static void Downmix7_1Scalar(const float *in, float *out, size_t numFrames) {
+    NO_VECTORIZE
+    for (size_t i = 0; i < numFrames; ++i) {
+        const float *frame = in + 8 * i;
+        float common = kDownmixGain * frame[2];
+        float left = frame[0] + common + kDownmixGain * (frame[4] + frame[6]);
+        float right = frame[1] + common + kDownmixGain * (frame[5] + frame[7]);
+        out[2 * i] = left * kDownmix7_1Scale;
+        out[2 * i + 1] = right * kDownmix7_1Scale;
+    }
+}
+
+static float DotProductScalar(const float *a, const float *b, size_t n) {
+    float sum = 0.0f;
+    NO_VECTORIZE
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static const PcmKernels kScalarKernels = {
+    Int16ToFloatScalar,
+    FloatToInt16Scalar,
+    Int24ToFloatScalar,
+    FloatToInt24Scalar,
+    ApplyGainScalar,
+    Downmix5_1Scalar,
+    Downmix7_1Scalar,
+    DotProductScalar,
+};
+
+#if defined(__ARM_NEON) || defined(__SSE2__)
+
+// Each of these runs the vector loop as far as it goes and leaves the
+// remaining samples to its plain counterpart. In place callers rely on
+// every vector being loaded before anything is stored over it.
+
+#if defined(__ARM_NEON)
+// Round to nearest like lrintf(). armv7 only has the truncating conversion,
+// adding a half with the sign of the value rounds halves away from zero.
+static inline int32x4_t RoundToInt32(float32x4_t v) {
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(v);
+#else
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(v), vdupq_n_u32(0x80000000u));
+    float32x4_t half = vreinterpretq_f32_u32(
+            vorrq_u32(sign, vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+    return vcvtq_s32_f32(vaddq_f32(v, half));
+#endif
+}
+#endif
+
+static void Int16ToFloatVectorized(const int16_t *in, float *out, size_t numSamples) {
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const float32x4_t scale = vdupq_n_f32(1.0f / kInt16Scale);
+    for (; i + 8 <= numSamples; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+#else
+    const __m128 scale = _mm_set1_ps(1.0f / kInt16Scale);
+    for (; i + 8 <= numSamples; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#endif
+
+    Int16ToFloatScalar(in + i, out + i, numSamples - i);
+}
+
+static void FloatToInt16Vectorized(const float *in, int16_t *out, size_t numSamples) {
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    // The conversion saturates to 32 bit, the narrowing move to 16 bit.
+    const float32x4_t scale = vdupq_n_f32(kInt16Scale);
+    for (; i + 8 <= numSamples; i += 8) {
+        float32x4_t lo = vmulq_f32(vld1q_f32(in + i), scale);
+        float32x4_t hi = vmulq_f32(vld1q_f32(in + i + 4), scale);
+        vst1q_s16(out + i,
+                  vcombine_s16(vqmovn_s32(RoundToInt32(lo)), vqmovn_s32(RoundToInt32(hi))));
+    }
+#else
+    // Out of range conversions come out as INT32_MIN, clamp first.
+    const __m128 scale = _mm_set1_ps(kInt16Scale);
+    const __m128 minValue = _mm_set1_ps(-32768.0f);
+    const __m128 maxValue = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= numSamples; i += 8) {
+        __m128 lo = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+        __m128 hi = _mm_mul_ps(_mm_loadu_ps(in + i + 4), scale);
+        __m128i loInt = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(lo, minValue), maxValue));
+        __m128i hiInt = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(hi, minValue), maxValue));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(loInt, hiInt));
+    }
+#endif
+
+    FloatToInt16Scalar(in + i, out + i, numSamples - i);
+}
+
+static void Int24ToFloatVectorized(const uint8_t *in, float *out, size_t numSamples) {
+    size_t i = 0;
+
+    // Four samples at a time out of a 16 byte load, each moved into the
+    // top three bytes of a lane and shifted back down to extend the sign.
+    // The load reaches 4 bytes past the samples used.
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint8_t kShuffle[16] = {
+        0xff, 0, 1, 2, 0xff, 3, 4, 5, 0xff, 6, 7, 8, 0xff, 9, 10, 11,
+    };
+    const uint8x16_t shuffle = vld1q_u8(kShuffle);
+    const float32x4_t scale = vdupq_n_f32(1.0f / kInt24Scale);
+    for (; i + 6 <= numSamples; i += 4) {
+        uint8x16_t bytes = vqtbl1q_u8(vld1q_u8(in + 3 * i), shuffle);
+        int32x4_t v = vshrq_n_s32(vreinterpretq_s32_u8(bytes), 8);
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(v), scale));
+    }
+#elif defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(1.0f / kInt24Scale);
+    for (; i + 6 <= numSamples; i += 4) {
+        __m128i bytes = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 3 * i)), shuffle);
+        __m128i v = _mm_srai_epi32(bytes, 8);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+#endif
+
+    Int24ToFloatScalar(in + 3 * i, out + i, numSamples - i);
+}
+
+static void FloatToInt24Vectorized(const float *in, uint8_t *out, size_t numSamples) {
+    size_t i = 0;
+
+    // Scaled, clamped and converted four at a time. The low three bytes of
+    // each lane are then gathered into 12 bytes, written as 8 + 4 so that
+    // nothing past them is touched.
+#if defined(__ARM_NEON)
+    const float32x4_t scale = vdupq_n_f32(kInt24Scale);
+    const float32x4_t minValue = vdupq_n_f32(-8388608.0f);
+    const float32x4_t maxValue = vdupq_n_f32(8388607.0f);
+#if defined(__aarch64__)
+    static const uint8_t kShuffle[16] = {
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0xff, 0xff, 0xff, 0xff,
+    };
+    const uint8x16_t shuffle = vld1q_u8(kShuffle);
+#endif
+    for (; i + 4 <= numSamples; i += 4) {
+        float32x4_t v = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(in + i), scale), minValue),
+                                  maxValue);
+#if defined(__aarch64__)
+        uint8x16_t bytes = vqtbl1q_u8(vreinterpretq_u8_s32(RoundToInt32(v)), shuffle);
+        uint32_t last = vgetq_lane_u32(vreinterpretq_u32_u8(bytes), 2);
+        vst1_u8(out + 3 * i, vget_low_u8(bytes));
+        memcpy(out + 3 * i + 8, &last, sizeof(last));
+#else
+        int32_t lanes[4];
+        vst1q_s32(lanes, RoundToInt32(v));
+        for (size_t k = 0; k < 4; ++k) {
+            PackInt24(lanes[k], out + 3 * (i + k));
+        }
+#endif
+    }
+#else
+    const __m128 scale = _mm_set1_ps(kInt24Scale);
+    const __m128 minValue = _mm_set1_ps(-8388608.0f);
+    const __m128 maxValue = _mm_set1_ps(8388607.0f);
+#if defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+#endif
+    for (; i + 4 <= numSamples; i += 4) {
+        __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), minValue),
+                              maxValue);
+#if defined(__SSSE3__)
+        __m128i bytes = _mm_shuffle_epi8(_mm_cvtps_epi32(v), shuffle);
+        int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + 3 * i), bytes);
+        memcpy(out + 3 * i + 8, &last, sizeof(last));
+#else
+        int32_t lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), _mm_cvtps_epi32(v));
+        for (size_t k = 0; k < 4; ++k) {
+            PackInt24(lanes[k], out + 3 * (i + k));
+        }
+#endif
+    }
+#endif
+
+    FloatToInt24Scalar(in + i, out + 3 * i, numSamples - i);
+}
+
+static void ApplyGainVectorized(
+        float *data, size_t numFrames, int32_t channelCount, float gain, float gainStep) {
+    // A vector of four samples spans whole frames only for 1, 2 and 4
+    // channels. Past the downmix that covers everything but odd layouts.
+    if (channelCount <= 0 || 4 % channelCount != 0) {
+        ApplyGainScalar(data, numFrames, channelCount, gain, gainStep);
+        return;
+    }
+
+    size_t framesPerVector = 4 / channelCount;
+    float laneFrames[4];
+    for (size_t k = 0; k < 4; ++k) {
+        laneFrames[k] = (float)(k / channelCount);
+    }
+
+    // Gains are computed from the frame index each time rather than
+    // accumulated, long ramps do not drift.
+    size_t numSamples = numFrames * channelCount;
+    size_t i = 0;
+    size_t frame = 0;
+
+#if defined(__ARM_NEON)
+    const float32x4_t lanes = vld1q_f32(laneFrames);
+    const float32x4_t start = vdupq_n_f32(gain);
+    const float32x4_t step = vdupq_n_f32(gainStep);
+    for (; i + 4 <= numSamples; i += 4, frame += framesPerVector) {
+        float32x4_t gains = vmlaq_f32(start, vaddq_f32(vdupq_n_f32((float)frame), lanes), step);
+        vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), gains));
+    }
+#else
+    const __m128 lanes = _mm_loadu_ps(laneFrames);
+    const __m128 start = _mm_set1_ps(gain);
+    const __m128 step = _mm_set1_ps(gainStep);
+    for (; i + 4 <= numSamples; i += 4, frame += framesPerVector) {
+        __m128 gains = _mm_add_ps(
+                start, _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)frame), lanes), step));
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), gains));
+    }
+#endif
+
+    ApplyGainScalar(
+            data + i, numFrames - frame, channelCount, gain + frame * gainStep, gainStep);
+}
+
+// Two frames per vector, [L0 R0 L1 R1], the front pairs and back pairs
+// load as halves and the center is broadcast into both lanes of its frame.
+
+static void Downmix5_1Vectorized(const float *in, float *out, size_t numFrames) {
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const float32x4_t frontScale = vdupq_n_f32(kDownmix5_1Scale);
+    const float32x4_t otherScale = vdupq_n_f32(kDownmixGain * kDownmix5_1Scale);
+    for (; i + 2 <= numFrames; i += 2) {
+        const float *frames = in + 6 * i;
+        float32x4_t front = vcombine_f32(vld1_f32(frames), vld1_f32(frames + 6));
+        float32x4_t center = vcombine_f32(vdup_n_f32(frames[2]), vdup_n_f32(frames[8]));
+        float32x4_t back = vcombine_f32(vld1_f32(frames + 4), vld1_f32(frames + 10));
+        vst1q_f32(out + 2 * i,
+                  vmlaq_f32(vmulq_f32(front, frontScale), vaddq_f32(center, back), otherScale));
+    }
+#else
+    const __m128 frontScale = _mm_set1_ps(kDownmix5_1Scale);
+    const __m128 otherScale = _mm_set1_ps(kDownmixGain * kDownmix5_1Scale);
+    for (; i + 2 <= numFrames; i += 2) {
+        const float *frames = in + 6 * i;
+        __m128 front = _mm_loadh_pi(
+                _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(frames)),
+                reinterpret_cast<const __m64 *>(frames + 6));
+        __m128 center = _mm_set_ps(frames[8], frames[8], frames[2], frames[2]);
+        __m128 back = _mm_loadh_pi(
+                _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(frames + 4)),
+                reinterpret_cast<const __m64 *>(frames + 10));
+        _mm_storeu_ps(out + 2 * i,
+                      _mm_add_ps(_mm_mul_ps(front, frontScale),
+                                 _mm_mul_ps(_mm_add_ps(center, back), otherScale)));
+    }
+#endif
+
+    Downmix5_1Scalar(in + 6 * i, out + 2 * i, numFrames - i);
+}
+
+static void Downmix7_1Vectorized(const float *in, float *out, size_t numFrames) {
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const float32x4_t frontScale = vdupq_n_f32(kDownmix7_1Scale);
+    const float32x4_t otherScale = vdupq_n_f32(kDownmixGain * kDownmix7_1Scale);
+    for (; i + 2 <= numFrames; i += 2) {
+        const float *frames = in + 8 * i;
+        float32x4_t front = vcombine_f32(vld1_f32(frames), vld1_f32(frames + 8));
+        float32x4_t center = vcombine_f32(vdup_n_f32(frames[2]), vdup_n_f32(frames[10]));
+        float32x4_t back = vcombine_f32(vld1_f32(frames + 4), vld1_f32(frames + 12));
+        float32x4_t side = vcombine_f32(vld1_f32(frames + 6), vld1_f32(frames + 14));
+        vst1q_f32(out + 2 * i,
+                  vmlaq_f32(vmulq_f32(front, frontScale),
+                            vaddq_f32(center, vaddq_f32(back, side)), otherScale));
+    }
+#else
+    const __m128 frontScale = _mm_set1_ps(kDownmix7_1Scale);
+    const __m128 otherScale = _mm_set1_ps(kDownmixGain * kDownmix7_1Scale);
+    for (; i + 2 <= numFrames; i += 2) {
+        const float *frames = in + 8 * i;
+        __m128 front = _mm_loadh_pi(
+                _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(frames)),
+                reinterpret_cast<const __m64 *>(frames + 8));
+        __m128 center = _mm_set_ps(frames[10], frames[10], frames[2], frames[2]);
+        __m128 back = _mm_loadh_pi(
+                _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(frames + 4)),
+                reinterpret_cast<const __m64 *>(frames + 12));
+        __m128 side = _mm_loadh_pi(
+                _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(frames + 6)),
+                reinterpret_cast<const __m64 *>(frames + 14));
+        _mm_storeu_ps(out + 2 * i,
+                      _mm_add_ps(_mm_mul_ps(front, frontScale),
+                                 _mm_mul_ps(_mm_add_ps(center, _mm_add_ps(back, side)),
+                                            otherScale)));
+    }
+#endif
+
+    Downmix7_1Scalar(in + 8 * i, out + 2 * i, numFrames - i);
+}
+
+// Two accumulators hide the latency of the multiply-add.
+static float DotProductVectorized(const float *a, const float *b, size_t n) {
+    size_t i = 0;
+    float sum;
+
+#if defined(__ARM_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    if (i + 4 <= n) {
+        acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+        i += 4;
+    }
+#if defined(__aarch64__)
+    sum = vaddvq_f32(acc);
+#else
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+#else
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    if (i + 4 <= n) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        i += 4;
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    return sum + DotProductScalar(a + i, b + i, n - i);
+}
+
+static const PcmKernels kVectorizedKernels = {
+    Int16ToFloatVectorized,
+    FloatToInt16Vectorized,
+    Int24ToFloatVectorized,
+    FloatToInt24Vectorized,
+    ApplyGainVectorized,
+    Downmix5_1Vectorized,
+    Downmix7_1Vectorized,
+    DotProductVectorized,
+};
+
+#endif  // __ARM_NEON || __SSE2__
+
+// static
+const PcmKernels &PcmKernels::Scalar() {
+    return kScalarKernels;
+}
+
+// static
+const PcmKernels &PcmKernels::Vectorized() {
+#if defined(__ARM_NEON) || defined(__SSE2__)
+    return kVectorizedKernels;
+#else
+    return kScalarKernels;
+#endif
+}
+
+// static
+bool PcmKernels::HaveVectorized() {
+#if defined(__ARM_NEON) || defined(__SSE2__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+}  // namespace android
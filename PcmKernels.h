@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PCM_KERNELS_H
+#define PCM_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+
+// The per-sample loops of the audio path, on interleaved PCM. Float samples
+// are normalized to [-1, 1), 24 bit samples are packed little endian.
+//
+// Each kernel exists in plain C++ and vectorized with NEON or SSE2 (SSSE3
+// for the 24 bit packing) where the target has it. Both are kept so that
+// they can be measured against each other, see simple_player -K.
+struct PcmKernels {
+    // Round to nearest and saturate. The narrowing ones may write over
+    // their input in place.
+    void (*int16ToFloat)(const int16_t *in, float *out, size_t numSamples);
+    void (*floatToInt16)(const float *in, int16_t *out, size_t numSamples);
+    void (*int24ToFloat)(const uint8_t *in, float *out, size_t numSamples);
+    void (*floatToInt24)(const float *in, uint8_t *out, size_t numSamples);
+
+    // Frame i is multiplied by gain + i * gainStep, in place.
+    void (*applyGain)(
+            float *data, size_t numFrames, int32_t channelCount, float gain, float gainStep);
+
+    // 5.1 (FL FR FC LFE BL BR) and 7.1 (FL FR FC LFE BL BR SL SR) to
+    // stereo, may run in place. Everything but the LFE goes in at -3 dB
+    // relative to the front pair, scaled so that full scale input does
+    // not clip.
+    void (*downmix5_1)(const float *in, float *out, size_t numFrames);
+    void (*downmix7_1)(const float *in, float *out, size_t numFrames);
+
+    // Sum of a[i] * b[i], the inner loop of filters and correlations.
+    float (*dotProduct)(const float *a, const float *b, size_t n);
+
+    static const PcmKernels &Scalar();
+    // Same as Scalar() on targets without SIMD.
+    static const PcmKernels &Vectorized();
+    static bool HaveVectorized();
+};
+
+}  // namespace android
+
+#endif // PCM_KERNELS_H
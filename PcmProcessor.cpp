@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PcmProcessor"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include "PcmProcessor.h"
+
+namespace android {
+
+// Frames of 16 bit input converted to float at a time, 32 kB of scratch at
+// 8 channels.
+static const size_t kBlockFrames = 1024;
+
+PcmProcessor::PcmProcessor(const PcmKernels &kernels)
+    : mKernels(kernels),
+      mInputChannelCount(0),
+      mInputEncoding(kAudioEncodingPcm16bit),
+      mInputFrameSize(0),
+      mOutputChannelCount(0),
+      mOutputFormat(AUDIO_FORMAT_PCM_16_BIT),
+      mOutputFrameSize(0),
+      mGain(1.0f),
+      mTargetGain(1.0f),
+      mGainStep(0.0f),
+      mNumRampFramesLeft(0),
+      mScratch(NULL),
+      mScratchChannelCount(0),
+      mProcessTimeUs(0ll),
+      mNumFramesProcessed(0ll) {
+}
+
+PcmProcessor::~PcmProcessor() {
+    delete[] mScratch;
+    mScratch = NULL;
+}
+
+status_t PcmProcessor::configure(
+        int32_t channelCount, int32_t inputEncoding, audio_format_t outputFormat) {
+    if (channelCount <= 0) {
+        return BAD_VALUE;
+    }
+
+    if (inputEncoding != kAudioEncodingPcm16bit && inputEncoding != kAudioEncodingPcmFloat) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    // 24 bit output takes more room than 16 bit input, it could not be
+    // written in place.
+    if (outputFormat != AUDIO_FORMAT_PCM_16_BIT
+            && !(outputFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED
+                    && inputEncoding == kAudioEncodingPcmFloat)) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    mInputChannelCount = channelCount;
+    mInputEncoding = inputEncoding;
+    mInputFrameSize = channelCount
+        * (inputEncoding == kAudioEncodingPcmFloat ? sizeof(float) : sizeof(int16_t));
+
+    mOutputChannelCount = (channelCount == 6 || channelCount == 8) ? 2 : channelCount;
+    mOutputFormat = outputFormat;
+    mOutputFrameSize = mOutputChannelCount * audio_bytes_per_sample(outputFormat);
+
+    mGain = mTargetGain;
+    mGainStep = 0.0f;
+    mNumRampFramesLeft = 0;
+
+    if (inputEncoding == kAudioEncodingPcm16bit && channelCount > mScratchChannelCount) {
+        delete[] mScratch;
+        mScratch = new float[kBlockFrames * channelCount];
+        mScratchChannelCount = channelCount;
+    }
+
+    ALOGV("%d channels %s in, %d channels %zu bit out",
+          channelCount,
+          inputEncoding == kAudioEncodingPcmFloat ? "float" : "16 bit",
+          mOutputChannelCount,
+          audio_bytes_per_sample(outputFormat) * 8);
+
+    return OK;
+}
+
+void PcmProcessor::setVolume(float volume, size_t numRampFrames) {
+    CHECK(volume >= 0.0f && volume <= 1.0f);
+
+    mTargetGain = volume;
+    if (numRampFrames == 0 || mInputFrameSize == 0) {
+        mGain = volume;
+        mGainStep = 0.0f;
+        mNumRampFramesLeft = 0;
+        return;
+    }
+
+    // A new ramp starts from wherever the last one got to.
+    mGainStep = (volume - mGain) / numRampFrames;
+    mNumRampFramesLeft = numRampFrames;
+}
+
+bool PcmProcessor::isPassThrough() const {
+    return mInputEncoding == kAudioEncodingPcm16bit
+        && mOutputChannelCount == mInputChannelCount
+        && mGain == 1.0f
+        && mNumRampFramesLeft == 0;
+}
+
+size_t PcmProcessor::process(uint8_t *data, size_t size) {
+    CHECK_GT(mInputFrameSize, 0u);
+
+    size_t numFrames = size / mInputFrameSize;
+    if (numFrames == 0 || isPassThrough()) {
+        return numFrames * mInputFrameSize;
+    }
+
+    nsecs_t startTimeNs = systemTime(SYSTEM_TIME_THREAD);
+
+    if (mInputEncoding == kAudioEncodingPcmFloat) {
+        processFloat(reinterpret_cast<float *>(data), numFrames, data);
+    } else {
+        // Output never outgrows the input here, block n is converted out
+        // before anything is written over it.
+        const int16_t *in = reinterpret_cast<const int16_t *>(data);
+        for (size_t offset = 0; offset < numFrames; offset += kBlockFrames) {
+            size_t numBlockFrames = numFrames - offset;
+            if (numBlockFrames > kBlockFrames) {
+                numBlockFrames = kBlockFrames;
+            }
+
+            mKernels.int16ToFloat(
+                    in + offset * mInputChannelCount,
+                    mScratch,
+                    numBlockFrames * mInputChannelCount);
+            processFloat(mScratch, numBlockFrames, data + offset * mOutputFrameSize);
+        }
+    }
+
+    mProcessTimeUs += (systemTime(SYSTEM_TIME_THREAD) - startTimeNs) / 1000ll;
+    mNumFramesProcessed += numFrames;
+
+    return numFrames * mOutputFrameSize;
+}
+
+void PcmProcessor::processFloat(float *samples, size_t numFrames, uint8_t *out) {
+    if (mInputChannelCount == 6) {
+        mKernels.downmix5_1(samples, samples, numFrames);
+    } else if (mInputChannelCount == 8) {
+        mKernels.downmix7_1(samples, samples, numFrames);
+    }
+
+    applyGain(samples, numFrames);
+
+    size_t numSamples = numFrames * mOutputChannelCount;
+    if (mOutputFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED) {
+        mKernels.floatToInt24(samples, out, numSamples);
+    } else {
+        mKernels.floatToInt16(samples, reinterpret_cast<int16_t *>(out), numSamples);
+    }
+}
+
+void PcmProcessor::applyGain(float *samples, size_t numFrames) {
+    if (mNumRampFramesLeft > 0) {
+        size_t numRampFrames = numFrames;
+        if (numRampFrames > mNumRampFramesLeft) {
+            numRampFrames = mNumRampFramesLeft;
+        }
+
+        mKernels.applyGain(samples, numRampFrames, mOutputChannelCount, mGain, mGainStep);
+
+        mNumRampFramesLeft -= numRampFrames;
+        mGain = mNumRampFramesLeft > 0 ? mGain + numRampFrames * mGainStep : mTargetGain;
+
+        samples += numRampFrames * mOutputChannelCount;
+        numFrames -= numRampFrames;
+    }
+
+    if (numFrames > 0 && mGain != 1.0f) {
+        mKernels.applyGain(samples, numFrames, mOutputChannelCount, mGain, 0.0f);
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PCM_PROCESSOR_H
+#define PCM_PROCESSOR_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <system/audio.h>
+#include <utils/RefBase.h>
+
+#include "PcmKernels.h"
+
+namespace android {
+
+// Turns decoded audio into what the AudioSink plays, in place in the
+// decoder's output buffer: 5.1 and 7.1 are downmixed to stereo, the volume
+// is applied and samples are converted to the sink format. Every stage
+// runs on float, 16 bit input goes through them a block at a time.
+//
+// Not thread safe, owned by the player's looper.
+struct PcmProcessor : public RefBase {
+    explicit PcmProcessor(const PcmKernels &kernels = PcmKernels::Vectorized());
+
+    // inputEncoding is kAudioEncodingPcm16bit or kAudioEncodingPcmFloat.
+    // outputFormat is AUDIO_FORMAT_PCM_16_BIT, or AUDIO_FORMAT_PCM_24_BIT_PACKED
+    // for float input. Any channel count is taken, layouts other than 5.1
+    // and 7.1 keep their channels. The volume carries over without a ramp.
+    status_t configure(int32_t channelCount, int32_t inputEncoding, audio_format_t outputFormat);
+
+    int32_t inputEncoding() const { return mInputEncoding; }
+    int32_t outputChannelCount() const { return mOutputChannelCount; }
+    audio_format_t outputFormat() const { return mOutputFormat; }
+    size_t inputFrameSize() const { return mInputFrameSize; }
+    size_t outputFrameSize() const { return mOutputFrameSize; }
+
+    // 0 to 1, reached over the next numRampFrames frames processed.
+    void setVolume(float volume, size_t numRampFrames);
+    float volume() const { return mTargetGain; }
+
+    // size bytes of whole input frames at data, replaced by the output.
+    // Returns the size of the output.
+    size_t process(uint8_t *data, size_t size);
+
+    // Thread CPU time spent processing and the frames processed.
+    int64_t processTimeUs() const { return mProcessTimeUs; }
+    int64_t numFramesProcessed() const { return mNumFramesProcessed; }
+
+protected:
+    virtual ~PcmProcessor();
+
+private:
+    const PcmKernels &mKernels;
+
+    int32_t mInputChannelCount;
+    int32_t mInputEncoding;
+    size_t mInputFrameSize;
+    int32_t mOutputChannelCount;
+    audio_format_t mOutputFormat;
+    size_t mOutputFrameSize;
+
+    float mGain;
+    float mTargetGain;
+    float mGainStep;
+    size_t mNumRampFramesLeft;
+
+    // 16 bit input is converted into this a block at a time.
+    float *mScratch;
+    int32_t mScratchChannelCount;
+
+    int64_t mProcessTimeUs;
+    int64_t mNumFramesProcessed;
+
+    bool isPassThrough() const;
+    // numFrames input frames at samples, the output starts at out.
+    void processFloat(float *samples, size_t numFrames, uint8_t *out);
+    void applyGain(float *samples, size_t numFrames);
+
+    DISALLOW_EVIL_CONSTRUCTORS(PcmProcessor);
+};
+
+}  // namespace android
+
+#endif // PCM_PROCESSOR_H
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PlaybackClock"
+
+#include <media/AudioTrack.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Log.h>
+
+#include "PlaybackClock.h"
+
+namespace android {
+
+PlaybackClock::PlaybackClock()
+    : mPlaybackRate(1.0f) {
+    reset();
+}
+
+PlaybackClock::~PlaybackClock() {
+}
+
+void PlaybackClock::reset() {
+    mAnchorMediaUs = 0ll;
+    mAnchorRealUs = -1ll;
+    setAudioTrack(NULL);
+}
+
+void PlaybackClock::setAnchor(int64_t mediaTimeUs, int64_t realTimeUs) {
+    mAnchorMediaUs = mediaTimeUs;
+    mAnchorRealUs = realTimeUs;
+}
+
+void PlaybackClock::setPlaybackRate(float rate, int64_t nowUs) {
+    if (mAnchorRealUs >= 0ll) {
+        setAnchor(getMediaTimeUs(nowUs), nowUs);
+    }
+
+    mPlaybackRate = rate;
+}
+
+void PlaybackClock::setAudioTrack(
+        const sp<AudioTrack> &audioTrack, uint32_t numFramesQueued) {
+    mAudioTrack = audioTrack;
+    mSampleRate = audioTrack != NULL ? audioTrack->getSampleRate() : 0;
+    mNumFramesQueued = numFramesQueued;
+    mNumFramesWritten = 0;
+    mLastBufferTimeUs = -1ll;
+    mNumFramesWrittenFromBuffer = 0ll;
+}
+
+void PlaybackClock::onAudioWritten(int64_t timeUs, uint32_t numFrames) {
+    if (mAudioTrack == NULL) {
+        return;
+    }
+
+    if (timeUs != mLastBufferTimeUs) {
+        mLastBufferTimeUs = timeUs;
+        mNumFramesWrittenFromBuffer = 0ll;
+    }
+
+    mNumFramesWrittenFromBuffer += numFrames;
+    mNumFramesWritten += numFrames;
+}
+
+void PlaybackClock::onAudioEOS(int64_t nowUs) {
+    int64_t mediaTimeUs;
+    if (getAudioMediaTimeUs(nowUs, &mediaTimeUs)) {
+        setAnchor(mediaTimeUs, nowUs);
+    }
+
+    setAudioTrack(NULL);
+}
+
+int64_t PlaybackClock::getMediaTimeUs(int64_t nowUs) {
+    int64_t mediaTimeUs;
+    if (getAudioMediaTimeUs(nowUs, &mediaTimeUs)) {
+        return mediaTimeUs;
+    }
+
+    return getSystemMediaTimeUs(nowUs);
+}
+
+int64_t PlaybackClock::getRealTimeUs(int64_t mediaTimeUs, int64_t nowUs) {
+    return nowUs + (int64_t)((mediaTimeUs - getMediaTimeUs(nowUs)) / (double)mPlaybackRate);
+}
+
+int64_t PlaybackClock::getAudioDriftUs(int64_t nowUs) {
+    int64_t mediaTimeUs;
+    if (!getAudioMediaTimeUs(nowUs, &mediaTimeUs)) {
+        return 0ll;
+    }
+
+    return mediaTimeUs - getSystemMediaTimeUs(nowUs);
+}
+
+int64_t PlaybackClock::getAudioPendingUs(int64_t nowUs) {
+    int64_t numFramesPending;
+    if (!getNumFramesPending(nowUs, &numFramesPending)) {
+        return 0ll;
+    }
+
+    return numFramesPending * 1000000ll / mSampleRate;
+}
+
+int64_t PlaybackClock::getSystemMediaTimeUs(int64_t nowUs) const {
+    if (mAnchorRealUs < 0ll) {
+        return mAnchorMediaUs;
+    }
+
+    return mAnchorMediaUs + (int64_t)((nowUs - mAnchorRealUs) * (double)mPlaybackRate);
+}
+
+bool PlaybackClock::getNumFramesPending(int64_t nowUs, int64_t *numFramesPending) {
+    if (!isAudioMaster() || mSampleRate == 0) {
+        return false;
+    }
+
+    // Frames presented so far. The timestamp is the position at the DAC,
+    // getPosition() only tells what the mixer has consumed and is a fallback
+    // until the first timestamp becomes available.
+    int64_t numFramesPlayed;
+
+    AudioTimestamp timestamp;
+    if (mAudioTrack->getTimestamp(timestamp) == OK) {
+        int64_t timestampUs =
+            timestamp.mTime.tv_sec * 1000000ll + timestamp.mTime.tv_nsec / 1000;
+
+        numFramesPlayed = (int64_t)timestamp.mPosition
+            + (nowUs - timestampUs) * mSampleRate / 1000000ll;
+    } else {
+        uint32_t position;
+        if (mAudioTrack->getPosition(&position) != OK) {
+            return false;
+        }
+        numFramesPlayed = position;
+    }
+
+    // Positions are 32 bit and wrap, only their distance matters.
+    *numFramesPending =
+        (int32_t)(mNumFramesQueued + mNumFramesWritten - (uint32_t)numFramesPlayed);
+
+    if (*numFramesPending < 0ll) {
+        // Underrun, playback stopped at the last frame written.
+        *numFramesPending = 0ll;
+    }
+
+    return true;
+}
+
+bool PlaybackClock::getAudioMediaTimeUs(int64_t nowUs, int64_t *mediaTimeUs) {
+    int64_t numFramesPending;
+    if (!getNumFramesPending(nowUs, &numFramesPending)) {
+        return false;
+    }
+
+    *mediaTimeUs = mLastBufferTimeUs
+        + (int64_t)((mNumFramesWrittenFromBuffer - numFramesPending)
+                * 1000000ll * (double)mPlaybackRate / mSampleRate);
+
+    return true;
+}
+
+}  // namespace android
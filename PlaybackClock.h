@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PLAYBACK_CLOCK_H
+#define PLAYBACK_CLOCK_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+class AudioTrack;
+
+// Maps between media time and system time. While audio is being played the
+// position comes from AudioTrack::getTimestamp() (or the frames played so
+// far if no timestamp is available yet), so the clock follows the audio
+// sink, including its latency and any stall. Without audio it runs off the
+// system clock from the anchor set by setAnchor(). Media time advances at
+// the playback rate, audio written is assumed to be time-stretched to it.
+//
+// Not thread safe, owned by the player's looper.
+struct PlaybackClock : public RefBase {
+    PlaybackClock();
+
+    // mediaTimeUs is presented at realTimeUs when running off the system clock.
+    void setAnchor(int64_t mediaTimeUs, int64_t realTimeUs);
+
+    // The system clock is anchored at the current position first. Audio
+    // already written keeps counting at the new rate.
+    void setPlaybackRate(float rate, int64_t nowUs);
+    float playbackRate() const { return mPlaybackRate; }
+
+    // numFramesQueued frames written to audioTrack by someone else, e.g.
+    // the previous item of a playlist, play out ahead of ours.
+    void setAudioTrack(const sp<AudioTrack> &audioTrack, uint32_t numFramesQueued = 0);
+
+    // numFrames of the output buffer with presentation time timeUs were
+    // written to the AudioTrack. Partial writes of the same buffer add up.
+    // Each frame played covers the playback rate times its duration of
+    // media time.
+    void onAudioWritten(int64_t timeUs, uint32_t numFrames);
+
+    // No more audio, continue from the current audio position on the
+    // system clock.
+    void onAudioEOS(int64_t nowUs);
+
+    void reset();
+
+    bool isAudioMaster() const { return mAudioTrack != NULL && mNumFramesWritten > 0; }
+
+    int64_t getMediaTimeUs(int64_t nowUs);
+
+    // System time at which mediaTimeUs is due.
+    int64_t getRealTimeUs(int64_t mediaTimeUs, int64_t nowUs);
+
+    // Audio position minus where the system clock alone would be.
+    int64_t getAudioDriftUs(int64_t nowUs);
+
+    // Duration of the audio written that has not been played yet, in
+    // system time.
+    int64_t getAudioPendingUs(int64_t nowUs);
+
+protected:
+    virtual ~PlaybackClock();
+
+private:
+    int64_t mAnchorMediaUs;
+    int64_t mAnchorRealUs;
+    float mPlaybackRate;
+
+    sp<AudioTrack> mAudioTrack;
+    uint32_t mSampleRate;
+    uint32_t mNumFramesQueued;
+    uint32_t mNumFramesWritten;
+
+    // Position of the last frame written, as its buffer's presentation time
+    // plus the frames of that buffer written so far.
+    int64_t mLastBufferTimeUs;
+    int64_t mNumFramesWrittenFromBuffer;
+
+    int64_t getSystemMediaTimeUs(int64_t nowUs) const;
+    bool getNumFramesPending(int64_t nowUs, int64_t *numFramesPending);
+    bool getAudioMediaTimeUs(int64_t nowUs, int64_t *mediaTimeUs);
+
+    DISALLOW_EVIL_CONSTRUCTORS(PlaybackClock);
+};
+
+}  // namespace android
+
+#endif // PLAYBACK_CLOCK_H
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PrefetchPolicy"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Log.h>
+
+#include "PrefetchPolicy.h"
+
+namespace android {
+
+PrefetchPolicy::PrefetchPolicy(int64_t maxBytes, int64_t maxDurationUs, size_t maxSamples)
+    : mMinBytes(maxBytes / 4),
+      mMinDurationUs(maxDurationUs / 4),
+      mCeilingBytes(maxBytes * 4),
+      mCeilingDurationUs(maxDurationUs * 4),
+      mMaxBytes(maxBytes),
+      mMaxDurationUs(maxDurationUs),
+      mQueuedBytes(0ll),
+      mCapacity(maxSamples),
+      mQueuedTimesUs(new int64_t[maxSamples]),
+      mHead(0),
+      mTail(0),
+      mNumDequeued(0ll),
+      mNumUnderruns(0ll),
+      mStarved(false) {
+    CHECK_GT(maxSamples, 0u);
+}
+
+PrefetchPolicy::~PrefetchPolicy() {
+    delete[] mQueuedTimesUs;
+    mQueuedTimesUs = NULL;
+}
+
+bool PrefetchPolicy::canPrefetch() const {
+    int64_t numQueued = queuedSamples();
+    if (numQueued == 0) {
+        // Always allow one sample, however large, or the track would stall.
+        return true;
+    }
+
+    return numQueued < (int64_t)mCapacity
+            && mQueuedBytes.load() < mMaxBytes.load()
+            && queuedDurationUs() < mMaxDurationUs.load();
+}
+
+void PrefetchPolicy::onSampleQueued(size_t size, int64_t timeUs) {
+    size_t tail = mTail.load(std::memory_order_relaxed);
+    CHECK_LT(tail - mHead.load(std::memory_order_acquire), mCapacity);
+
+    mQueuedTimesUs[tail % mCapacity] = timeUs;
+    mQueuedBytes += size;
+    mTail.store(tail + 1, std::memory_order_release);
+}
+
+void PrefetchPolicy::onSampleDequeued(size_t size) {
+    size_t head = mHead.load(std::memory_order_relaxed);
+    CHECK_NE(head, mTail.load(std::memory_order_acquire));
+
+    mQueuedBytes -= size;
+    mHead.store(head + 1, std::memory_order_release);
+
+    ++mNumDequeued;
+    mStarved.store(false);
+}
+
+void PrefetchPolicy::onSampleReadDirectly() {
+    ++mNumDequeued;
+    mStarved.store(false);
+}
+
+int64_t PrefetchPolicy::queuedSamples() const {
+    return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+}
+
+// Called by either side. The producer never writes the head slot, the
+// ring is full before it would. If the consumer moves on meanwhile, the
+// duration comes out one sample too long.
+int64_t PrefetchPolicy::queuedDurationUs() const {
+    size_t head = mHead.load(std::memory_order_acquire);
+    size_t tail = mTail.load(std::memory_order_acquire);
+    if (head == tail) {
+        return 0ll;
+    }
+
+    int64_t durationUs =
+        mQueuedTimesUs[(tail - 1) % mCapacity] - mQueuedTimesUs[head % mCapacity];
+    return durationUs > 0ll ? durationUs : 0ll;
+}
+
+void PrefetchPolicy::onStarved() {
+    // Only count once per dry spell, and not before the very first sample.
+    if (mNumDequeued.load() == 0 || mStarved.exchange(true)) {
+        return;
+    }
+
+    ++mNumUnderruns;
+    scale(3, 2);
+
+    ALOGV("underrun #%lld, budget now %lld bytes / %lld us",
+          (long long)mNumUnderruns.load(),
+          (long long)mMaxBytes.load(),
+          (long long)mMaxDurationUs.load());
+}
+
+void PrefetchPolicy::onMemoryPressure() {
+    scale(1, 2);
+}
+
+void PrefetchPolicy::scale(int64_t num, int64_t den) {
+    int64_t maxBytes = mMaxBytes.load() * num / den;
+    if (maxBytes < mMinBytes) {
+        maxBytes = mMinBytes;
+    } else if (maxBytes > mCeilingBytes) {
+        maxBytes = mCeilingBytes;
+    }
+    mMaxBytes.store(maxBytes);
+
+    int64_t maxDurationUs = mMaxDurationUs.load() * num / den;
+    if (maxDurationUs < mMinDurationUs) {
+        maxDurationUs = mMinDurationUs;
+    } else if (maxDurationUs > mCeilingDurationUs) {
+        maxDurationUs = mCeilingDurationUs;
+    }
+    mMaxDurationUs.store(maxDurationUs);
+}
+
+}  // namespace android
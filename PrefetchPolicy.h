@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PREFETCH_POLICY_H
+#define PREFETCH_POLICY_H
+
+#include <atomic>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+// Decides how far ahead of the codec the samples of one track are read,
+// as a budget in bytes and in media time. Whichever limit is reached first
+// stops prefetching, as does holding maxSamples samples. The budget grows by
+// half every time the codec runs dry and is halved under memory pressure,
+// never leaving [min, max].
+//
+// onSampleQueued() is called by the producer and onSampleDequeued() by the
+// consumer, which may be different threads. Samples are dequeued in the
+// order they were queued.
+struct PrefetchPolicy : public RefBase {
+    PrefetchPolicy(int64_t maxBytes, int64_t maxDurationUs, size_t maxSamples);
+
+    bool canPrefetch() const;
+
+    void onSampleQueued(size_t size, int64_t timeUs);
+    void onSampleDequeued(size_t size);
+
+    // A sample went straight from the extractor to the codec without being
+    // queued, the codec was fed all the same.
+    void onSampleReadDirectly();
+
+    // The codec asked for input and nothing was queued.
+    void onStarved();
+    void onMemoryPressure();
+
+    int64_t queuedBytes() const { return mQueuedBytes.load(); }
+    int64_t queuedDurationUs() const;
+    int64_t queuedSamples() const;
+    int64_t maxBytes() const { return mMaxBytes.load(); }
+    int64_t maxDurationUs() const { return mMaxDurationUs.load(); }
+    int64_t numUnderruns() const { return mNumUnderruns.load(); }
+
+protected:
+    virtual ~PrefetchPolicy();
+
+private:
+    const int64_t mMinBytes;
+    const int64_t mMinDurationUs;
+    const int64_t mCeilingBytes;
+    const int64_t mCeilingDurationUs;
+
+    std::atomic<int64_t> mMaxBytes;
+    std::atomic<int64_t> mMaxDurationUs;
+
+    std::atomic<int64_t> mQueuedBytes;
+
+    // Times of the queued samples, a ring like SampleQueue's: the producer
+    // owns mTail, the consumer mHead. The queued duration is measured from
+    // the sample at the head.
+    size_t mCapacity;
+    int64_t *mQueuedTimesUs;
+    alignas(64) std::atomic<size_t> mHead;
+    alignas(64) std::atomic<size_t> mTail;
+
+    std::atomic<int64_t> mNumDequeued;
+    std::atomic<int64_t> mNumUnderruns;
+    std::atomic<bool> mStarved;
+
+    void scale(int64_t num, int64_t den);
+
+    DISALLOW_EVIL_CONSTRUCTORS(PrefetchPolicy);
+};
+
+}  // namespace android
+
+#endif // PREFETCH_POLICY_H
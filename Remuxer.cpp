@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "Remuxer"
+
+#include <inttypes.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaMuxer.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/Log.h>
+
+#include "Remuxer.h"
+#include "SampleSource.h"
+
+namespace android {
+
+Remuxer::Remuxer(const sp<SampleSource> &source, int fd)
+    : mSource(source),
+      mFd(fd),
+      mNumSamples(0ll),
+      mNumBytes(0ll),
+      mReadTimeUs(0ll),
+      mWriteTimeUs(0ll),
+      mNumBufferAllocations(0ll) {
+}
+
+Remuxer::~Remuxer() {
+}
+
+void Remuxer::addTrack(size_t trackIndex) {
+    mTracks.add(trackIndex, -1);
+}
+
+void Remuxer::ensureBufferCapacity(size_t capacity) {
+    if (mBuffer != NULL && mBuffer->capacity() >= capacity) {
+        return;
+    }
+
+    mBuffer = new ABuffer(capacity);
+    ++mNumBufferAllocations;
+}
+
+status_t Remuxer::start(sp<MediaMuxer> *muxer) {
+    *muxer = MediaMuxer::create(mFd, MediaMuxer::OUTPUT_FORMAT_MPEG_4);
+    if (*muxer == NULL) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    // Sized for the largest sample up front where the container says, so
+    // that the buffer is allocated once.
+    size_t maxInputSize = 0;
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        size_t trackIndex = mTracks.keyAt(i);
+
+        sp<AMessage> format;
+        status_t err = mSource->getTrackFormat(trackIndex, &format);
+        if (err != OK) {
+            return err;
+        }
+
+        err = mSource->selectTrack(trackIndex);
+        if (err != OK) {
+            return err;
+        }
+
+        int32_t rotationDegrees;
+        if (format->findInt32(KEY_ROTATION, &rotationDegrees)) {
+            (*muxer)->setOrientationHint(rotationDegrees);
+        }
+
+        int32_t size;
+        if (format->findInt32("max-input-size", &size) && size > 0
+                && (size_t)size > maxInputSize) {
+            maxInputSize = size;
+        }
+
+        ssize_t outputIndex = (*muxer)->addTrack(format);
+        if (outputIndex < 0) {
+            AString mime;
+            format->findString("mime", &mime);
+            ALOGE("cannot mux track %zu (%s): %zd", trackIndex, mime.c_str(), outputIndex);
+            return outputIndex;
+        }
+        mTracks.editValueAt(i) = outputIndex;
+    }
+
+    if (maxInputSize > 0) {
+        ensureBufferCapacity(maxInputSize);
+    }
+
+    return (*muxer)->start();
+}
+
+status_t Remuxer::run() {
+    sp<MediaMuxer> muxer;
+    status_t err = start(&muxer);
+    if (err != OK) {
+        return err;
+    }
+
+    for (;;) {
+        int64_t readStartUs = ALooper::GetNowUs();
+
+        size_t trackIndex;
+        if (mSource->getSampleTrackIndex(&trackIndex) != OK) {
+            break;
+        }
+
+        size_t sampleSize;
+        CHECK_EQ(mSource->getSampleSize(&sampleSize), (status_t)OK);
+        ensureBufferCapacity(sampleSize);
+
+        err = mSource->readSampleData(mBuffer);
+        if (err != OK) {
+            break;
+        }
+
+        int64_t timeUs;
+        CHECK_EQ(mSource->getSampleTime(&timeUs), (status_t)OK);
+
+        sp<MetaData> meta;
+        int32_t isSync = 0;
+        if (mSource->getSampleMeta(&meta) == OK) {
+            meta->findInt32(kKeyIsSyncFrame, &isSync);
+        }
+
+        int64_t writeStartUs = ALooper::GetNowUs();
+        mReadTimeUs += writeStartUs - readStartUs;
+
+        err = muxer->writeSampleData(
+                mBuffer,
+                mTracks.valueFor(trackIndex),
+                timeUs,
+                isSync ? MediaCodec::BUFFER_FLAG_SYNCFRAME : 0);
+
+        mWriteTimeUs += ALooper::GetNowUs() - writeStartUs;
+
+        if (err != OK) {
+            ALOGE("cannot write the sample at %" PRId64 " us: %d", timeUs, err);
+            break;
+        }
+
+        ++mNumSamples;
+        mNumBytes += mBuffer->size();
+
+        mSource->advance();
+    }
+
+    status_t stopErr = muxer->stop();
+    return err != OK ? err : stopErr;
+}
+
+}  // namespace android
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef REMUXER_H
+#define REMUXER_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+#include <utils/KeyedVector.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+struct ABuffer;
+struct MediaMuxer;
+struct SampleSource;
+
+// Copies the compressed samples of a SampleSource into an MP4 file, without
+// decoding them. Only tracks added with addTrack() are written, so this
+// both converts the container and strips tracks. Every sample goes through
+// a single buffer, MediaMuxer::writeSampleData() does not return before the
+// writer is done with it.
+struct Remuxer : public RefBase {
+    // Writes to fd, which stays open and belongs to the caller.
+    Remuxer(const sp<SampleSource> &source, int fd);
+
+    void addTrack(size_t trackIndex);
+
+    // Copies every sample of the added tracks, from the source's current
+    // position on, and completes the file.
+    status_t run();
+
+    int64_t numSamples() const { return mNumSamples; }
+    int64_t numBytes() const { return mNumBytes; }
+    // Time spent reading samples and writing them, the rest of run() is
+    // setting up and completing the file.
+    int64_t readTimeUs() const { return mReadTimeUs; }
+    int64_t writeTimeUs() const { return mWriteTimeUs; }
+    // Times the sample buffer had to be (re)allocated.
+    int64_t numBufferAllocations() const { return mNumBufferAllocations; }
+
+protected:
+    virtual ~Remuxer();
+
+private:
+    sp<SampleSource> mSource;
+    int mFd;
+    // Output track by source track.
+    KeyedVector<size_t, ssize_t> mTracks;
+
+    sp<ABuffer> mBuffer;
+
+    int64_t mNumSamples;
+    int64_t mNumBytes;
+    int64_t mReadTimeUs;
+    int64_t mWriteTimeUs;
+    int64_t mNumBufferAllocations;
+
+    status_t start(sp<MediaMuxer> *muxer);
+    void ensureBufferCapacity(size_t capacity);
+
+    DISALLOW_EVIL_CONSTRUCTORS(Remuxer);
+};
+
+}  // namespace android
+
+#endif // REMUXER_H
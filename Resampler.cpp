@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "Resampler"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include "Resampler.h"
+
+namespace android {
+
+// Ratios that would take more phases than this, like 44100 to 48000 does
+// not (160), use the closest of this many below the exact position.
+static const size_t kMaxPhases = 1024;
+
+// Output produced per getOutput().
+static const size_t kMaxOutputFrames = 1024;
+
+// A jump in input timestamps beyond this is a discontinuity.
+static const int64_t kMaxDiscontinuityUs = 100000ll;
+
+static const struct {
+    size_t mNumTaps;
+    double mCutoff;
+    double mKaiserBeta;
+} kQualities[Resampler::NUM_QUALITIES] = {
+    { 16, 0.80, 5.0 },
+    { 32, 0.86, 7.0 },
+    { 64, 0.90, 9.5 },
+};
+
+static uint32_t Gcd(uint32_t a, uint32_t b) {
+    while (b != 0) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Modified Bessel function of the first kind, order 0, for the Kaiser
+// window. The series converges quickly for the betas used here.
+static double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        double factor = x / (2.0 * k);
+        term *= factor * factor;
+        sum += term;
+        if (term < sum * 1E-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+// static
+const char *Resampler::QualityName(Quality quality) {
+    switch (quality) {
+        case QUALITY_LOW:
+            return "low";
+        case QUALITY_MEDIUM:
+            return "medium";
+        case QUALITY_HIGH:
+            return "high";
+        default:
+            return "unknown";
+    }
+}
+
+Resampler::Resampler(
+        uint32_t inputRate,
+        uint32_t outputRate,
+        int32_t channelCount,
+        audio_format_t format,
+        Quality quality,
+        const PcmKernels &kernels)
+    : mKernels(kernels),
+      mInputRate(inputRate),
+      mOutputRate(outputRate),
+      mChannelCount(channelCount),
+      mFormat(format),
+      mFrameSize(channelCount * audio_bytes_per_sample(format)),
+      mHistoryCapacity(0),
+      mDeinterleave(NULL),
+      mDeinterleaveCapacity(0),
+      mProcessTimeUs(0ll),
+      mNumFramesProduced(0ll) {
+    CHECK_GT(inputRate, 0u);
+    CHECK_GT(outputRate, 0u);
+    CHECK_GT(channelCount, 0);
+    CHECK(format == AUDIO_FORMAT_PCM_16_BIT || format == AUDIO_FORMAT_PCM_24_BIT_PACKED);
+    CHECK(quality >= 0 && quality < NUM_QUALITIES);
+
+    uint32_t gcd = Gcd(inputRate, outputRate);
+    mStep = inputRate / gcd;
+    mNumSteps = outputRate / gcd;
+
+    initCoefficients(quality);
+
+    mHistory = new float *[mChannelCount];
+    for (int32_t c = 0; c < mChannelCount; ++c) {
+        mHistory[c] = NULL;
+    }
+
+    mOutputFloat = new float[kMaxOutputFrames * mChannelCount];
+    mOutput = new uint8_t[kMaxOutputFrames * mFrameSize];
+
+    ALOGV("%u to %u Hz, %zu taps, %zu phases, %s quality",
+          inputRate, outputRate, mNumTaps, mNumPhases, QualityName(quality));
+
+    flush();
+}
+
+Resampler::~Resampler() {
+    for (int32_t c = 0; c < mChannelCount; ++c) {
+        delete[] mHistory[c];
+    }
+    delete[] mHistory;
+    delete[] mDeinterleave;
+    delete[] mCoefficients;
+    delete[] mOutputFloat;
+    delete[] mOutput;
+}
+
+void Resampler::initCoefficients(Quality quality) {
+    // Downsampling moves the cutoff below the input Nyquist frequency, the
+    // filter gets longer to keep the same transition band in output terms.
+    double ratio = (double)mOutputRate / mInputRate;
+    if (ratio > 1.0) {
+        ratio = 1.0;
+    }
+
+    mNumTaps = (size_t)ceil(kQualities[quality].mNumTaps / ratio);
+    mNumTaps = (mNumTaps + 1) & ~(size_t)1;
+    mNumPaddedTaps = (mNumTaps + 3) & ~(size_t)3;
+    mNumPhases = mNumSteps < kMaxPhases ? mNumSteps : kMaxPhases;
+
+    // Normalized to the input Nyquist frequency.
+    double cutoff = kQualities[quality].mCutoff * ratio;
+    double beta = kQualities[quality].mKaiserBeta;
+    double halfLength = mNumTaps / 2.0;
+    double i0Beta = BesselI0(beta);
+
+    mCoefficients = new float[mNumPhases * mNumPaddedTaps];
+    for (size_t phase = 0; phase < mNumPhases; ++phase) {
+        float *coefficients = mCoefficients + phase * mNumPaddedTaps;
+        double fraction = (double)phase / mNumPhases;
+
+        // Tap k sits on input frame pos - (mNumTaps / 2 - 1) + k, t is its
+        // distance from the output position pos + fraction.
+        double sum = 0.0;
+        for (size_t k = 0; k < mNumTaps; ++k) {
+            double t = (double)k - (halfLength - 1.0) - fraction;
+            double x = M_PI * cutoff * t;
+            double sinc = fabs(x) < 1E-9 ? 1.0 : sin(x) / x;
+
+            double r = t / halfLength;
+            double window = r * r < 1.0 ? BesselI0(beta * sqrt(1.0 - r * r)) / i0Beta : 0.0;
+
+            coefficients[k] = (float)(cutoff * sinc * window);
+            sum += coefficients[k];
+        }
+
+        // Unity gain at DC for every phase, no ripple from phase to phase.
+        for (size_t k = 0; k < mNumPaddedTaps; ++k) {
+            coefficients[k] = k < mNumTaps ? (float)(coefficients[k] / sum) : 0.0f;
+        }
+    }
+}
+
+int64_t Resampler::delayUs() const {
+    return (int64_t)(mNumTaps / 2) * 1000000ll / mInputRate;
+}
+
+void Resampler::flush() {
+    // Zeros up to the first frame so that the first output falls on it.
+    size_t numLeadingFrames = mNumTaps / 2 - 1;
+
+    mHistoryOffset = 0;
+    mNumHistoryFrames = 0;
+    mHistoryStartFrame = -(int64_t)numLeadingFrames;
+
+    float *zeros = new float[numLeadingFrames * mChannelCount];
+    memset(zeros, 0, numLeadingFrames * mChannelCount * sizeof(float));
+    appendToHistory(zeros, numLeadingFrames);
+    delete[] zeros;
+
+    mPos = 0ll;
+    mPhase = 0;
+    mEndFrame = -1ll;
+    mBaseFrame = 0ll;
+    mBaseTimeUs = -1ll;
+
+    mNumOutputFrames = 0;
+    mOutputOffset = 0;
+    mOutputTimeUs = -1ll;
+}
+
+int64_t Resampler::positionTimeUs(int64_t pos, uint32_t phase) const {
+    return mBaseTimeUs
+        + ((pos - mBaseFrame) * 1000000ll + phase * 1000000ll / mNumSteps) / mInputRate;
+}
+
+void Resampler::appendToHistory(const float *samples, size_t numFrames) {
+    if (mHistoryOffset + mNumHistoryFrames + numFrames > mHistoryCapacity) {
+        if (mNumHistoryFrames + numFrames > mHistoryCapacity) {
+            size_t capacity = 2 * mHistoryCapacity;
+            if (capacity < mNumHistoryFrames + numFrames) {
+                capacity = mNumHistoryFrames + numFrames;
+            }
+
+            for (int32_t c = 0; c < mChannelCount; ++c) {
+                float *history = new float[capacity];
+                if (mNumHistoryFrames > 0) {
+                    memcpy(history,
+                           mHistory[c] + mHistoryOffset,
+                           mNumHistoryFrames * sizeof(float));
+                }
+                delete[] mHistory[c];
+                mHistory[c] = history;
+            }
+            mHistoryCapacity = capacity;
+        } else {
+            for (int32_t c = 0; c < mChannelCount; ++c) {
+                memmove(mHistory[c],
+                        mHistory[c] + mHistoryOffset,
+                        mNumHistoryFrames * sizeof(float));
+            }
+        }
+
+        mHistoryOffset = 0;
+    }
+
+    size_t end = mHistoryOffset + mNumHistoryFrames;
+    for (int32_t c = 0; c < mChannelCount; ++c) {
+        float *history = mHistory[c] + end;
+        for (size_t i = 0; i < numFrames; ++i) {
+            history[i] = samples[i * mChannelCount + c];
+        }
+    }
+
+    mNumHistoryFrames += numFrames;
+}
+
+void Resampler::queueInput(const void *data, size_t numFrames, int64_t timeUs) {
+    if (mEndFrame >= 0ll) {
+        flush();
+    }
+
+    int64_t frame = mHistoryStartFrame + mNumHistoryFrames;
+    if (mBaseTimeUs < 0ll || llabs(positionTimeUs(frame, 0) - timeUs) > kMaxDiscontinuityUs) {
+        mBaseTimeUs = timeUs;
+        mBaseFrame = frame;
+    }
+
+    nsecs_t startTimeNs = systemTime(SYSTEM_TIME_THREAD);
+
+    size_t numSamples = numFrames * mChannelCount;
+    if (numSamples > mDeinterleaveCapacity) {
+        delete[] mDeinterleave;
+        mDeinterleave = new float[numSamples];
+        mDeinterleaveCapacity = numSamples;
+    }
+
+    if (mFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED) {
+        mKernels.int24ToFloat(static_cast<const uint8_t *>(data), mDeinterleave, numSamples);
+    } else {
+        mKernels.int16ToFloat(static_cast<const int16_t *>(data), mDeinterleave, numSamples);
+    }
+
+    appendToHistory(mDeinterleave, numFrames);
+
+    mProcessTimeUs += (systemTime(SYSTEM_TIME_THREAD) - startTimeNs) / 1000ll;
+}
+
+void Resampler::signalEndOfStream() {
+    if (mEndFrame >= 0ll) {
+        return;
+    }
+
+    mEndFrame = mHistoryStartFrame + mNumHistoryFrames;
+
+    // Enough for the taps of an output at the last frame.
+    float *zeros = new float[mNumPaddedTaps * mChannelCount];
+    memset(zeros, 0, mNumPaddedTaps * mChannelCount * sizeof(float));
+    appendToHistory(zeros, mNumPaddedTaps);
+    delete[] zeros;
+}
+
+size_t Resampler::getOutput(const void **data, int64_t *timeUs) {
+    if (mOutputOffset == mNumOutputFrames && !produceOutput()) {
+        return 0;
+    }
+
+    *data = mOutput + mOutputOffset * mFrameSize;
+    *timeUs = mOutputTimeUs;
+
+    return mNumOutputFrames - mOutputOffset;
+}
+
+void Resampler::consumeOutput(size_t numFrames) {
+    CHECK_LE(mOutputOffset + numFrames, mNumOutputFrames);
+    mOutputOffset += numFrames;
+}
+
+bool Resampler::produceOutput() {
+    // The padded taps read past the last real one, they are 0 but the
+    // frames have to be there.
+    int64_t firstTap = mPos - (int64_t)(mNumTaps / 2 - 1);
+    int64_t endFrame = mHistoryStartFrame + (int64_t)mNumHistoryFrames;
+    if (firstTap + (int64_t)mNumPaddedTaps > endFrame
+            || (mEndFrame >= 0ll && mPos >= mEndFrame)) {
+        return false;
+    }
+
+    nsecs_t startTimeNs = systemTime(SYSTEM_TIME_THREAD);
+
+    mOutputTimeUs = positionTimeUs(mPos, mPhase);
+
+    size_t numFrames = 0;
+    while (numFrames < kMaxOutputFrames && firstTap + (int64_t)mNumPaddedTaps <= endFrame
+            && (mEndFrame < 0ll || mPos < mEndFrame)) {
+        size_t phase = mNumPhases == mNumSteps
+            ? mPhase
+            : (size_t)((uint64_t)mPhase * mNumPhases / mNumSteps);
+
+        const float *coefficients = mCoefficients + phase * mNumPaddedTaps;
+        size_t offset = mHistoryOffset + (size_t)(firstTap - mHistoryStartFrame);
+        float *out = mOutputFloat + numFrames * mChannelCount;
+        for (int32_t c = 0; c < mChannelCount; ++c) {
+            out[c] = mKernels.dotProduct(mHistory[c] + offset, coefficients, mNumPaddedTaps);
+        }
+        ++numFrames;
+
+        mPhase += mStep;
+        mPos += mPhase / mNumSteps;
+        mPhase %= mNumSteps;
+        firstTap = mPos - (int64_t)(mNumTaps / 2 - 1);
+    }
+
+    size_t numSamples = numFrames * mChannelCount;
+    if (mFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED) {
+        mKernels.floatToInt24(mOutputFloat, mOutput, numSamples);
+    } else {
+        mKernels.floatToInt16(mOutputFloat, reinterpret_cast<int16_t *>(mOutput), numSamples);
+    }
+
+    mNumOutputFrames = numFrames;
+    mOutputOffset = 0;
+    mNumFramesProduced += numFrames;
+
+    // Everything before the first tap of the next output is done with.
+    int64_t numDoneFrames = firstTap - mHistoryStartFrame;
+    if (numDoneFrames > (int64_t)mNumHistoryFrames) {
+        numDoneFrames = mNumHistoryFrames;
+    }
+    if (numDoneFrames > 0) {
+        mHistoryOffset += numDoneFrames;
+        mNumHistoryFrames -= numDoneFrames;
+        mHistoryStartFrame += numDoneFrames;
+    }
+
+    mProcessTimeUs += (systemTime(SYSTEM_TIME_THREAD) - startTimeNs) / 1000ll;
+
+    return true;
+}
+
+}  // namespace android
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <system/audio.h>
+#include <utils/RefBase.h>
+
+#include "PcmKernels.h"
+
+namespace android {
+
+// Converts interleaved PCM 16 or packed 24 bit from one sample rate to
+// another with a polyphase windowed sinc filter (Kaiser window). The ratio
+// is kept exact as a fraction of the two rates, each output frame uses the
+// filter phase for where it falls between two input frames.
+//
+// Same model as TimeStretcher: input is taken as it comes, output is
+// produced in blocks on demand and has to be consumed before the next one.
+//
+// Not thread safe, owned by the player's looper.
+struct Resampler : public RefBase {
+    // Taps per phase when not downsampling, the -6 dB point as a fraction
+    // of the lower Nyquist frequency, and the stopband attenuation from
+    // that Nyquist frequency on. Downsampling takes proportionally more
+    // taps.
+    enum Quality {
+        QUALITY_LOW,        // 16 taps, 80%, 54 dB
+        QUALITY_MEDIUM,     // 32 taps, 86%, 72 dB
+        QUALITY_HIGH,       // 64 taps, 90%, 95 dB
+        NUM_QUALITIES
+    };
+
+    Resampler(
+            uint32_t inputRate,
+            uint32_t outputRate,
+            int32_t channelCount,
+            audio_format_t format,
+            Quality quality,
+            const PcmKernels &kernels = PcmKernels::Vectorized());
+
+    uint32_t inputRate() const { return mInputRate; }
+    uint32_t outputRate() const { return mOutputRate; }
+    size_t numTaps() const { return mNumTaps; }
+
+    // How far input has to run ahead of the output it makes.
+    int64_t delayUs() const;
+
+    // Input after the end of stream starts over as if after flush().
+    void queueInput(const void *data, size_t numFrames, int64_t timeUs);
+
+    // No more input will follow. The filter runs into silence so that
+    // getOutput() returns output up to the last input frame.
+    void signalEndOfStream();
+
+    size_t getOutput(const void **data, int64_t *timeUs);
+    void consumeOutput(size_t numFrames);
+    void flush();
+
+    // Thread CPU time spent resampling and the output frames produced.
+    int64_t processTimeUs() const { return mProcessTimeUs; }
+    int64_t numFramesProduced() const { return mNumFramesProduced; }
+
+    static const char *QualityName(Quality quality);
+
+protected:
+    virtual ~Resampler();
+
+private:
+    const PcmKernels &mKernels;
+    const uint32_t mInputRate;
+    const uint32_t mOutputRate;
+    const int32_t mChannelCount;
+    const audio_format_t mFormat;
+    const size_t mFrameSize;
+
+    // Output frame n falls at input frame n * mStep / mNumSteps, both
+    // reduced by their greatest common divisor.
+    uint32_t mStep;
+    uint32_t mNumSteps;
+
+    // mNumPhases sets of mNumTaps coefficients, each padded to a multiple
+    // of 4 for the vector loads, the padding is 0.
+    size_t mNumTaps;
+    size_t mNumPaddedTaps;
+    size_t mNumPhases;
+    float *mCoefficients;
+
+    // One history per channel, for contiguous dot products. Frame
+    // mHistoryStartFrame is at mHistory[c][mHistoryOffset], frames count
+    // from the first one queued after flush(), the history starts with
+    // zeros before it.
+    float **mHistory;
+    size_t mHistoryCapacity;
+    size_t mHistoryOffset;
+    size_t mNumHistoryFrames;
+    int64_t mHistoryStartFrame;
+    float *mDeinterleave;
+    size_t mDeinterleaveCapacity;
+
+    // Position of the next output frame, mPos + mPhase / mNumSteps.
+    int64_t mPos;
+    uint32_t mPhase;
+    // The frame after the last one, -1 before signalEndOfStream().
+    int64_t mEndFrame;
+
+    int64_t mBaseFrame;
+    int64_t mBaseTimeUs;
+
+    float *mOutputFloat;
+    uint8_t *mOutput;
+    size_t mNumOutputFrames;
+    size_t mOutputOffset;
+    int64_t mOutputTimeUs;
+
+    int64_t mProcessTimeUs;
+    int64_t mNumFramesProduced;
+
+    void initCoefficients(Quality quality);
+    void appendToHistory(const float *samples, size_t numFrames);
+    bool produceOutput();
+    int64_t positionTimeUs(int64_t pos, uint32_t phase) const;
+
+    DISALLOW_EVIL_CONSTRUCTORS(Resampler);
+};
+
+}  // namespace android
+
+#endif // RESAMPLER_H
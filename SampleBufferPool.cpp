@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleBufferPool"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Log.h>
+
+#include "SampleBufferPool.h"
+
+namespace android {
+
+SampleBufferPool::SampleBufferPool(size_t bufferSize, size_t maxBuffers)
+    : mBufferSize(bufferSize),
+      mMaxBuffers(maxBuffers),
+      mNumHits(0ll),
+      mNumMisses(0ll),
+      mNumWrapHits(0ll),
+      mNumWrapMisses(0ll) {
+    mFreeBuffers.setCapacity(maxBuffers);
+}
+
+SampleBufferPool::~SampleBufferPool() {
+}
+
+sp<ABuffer> SampleBufferPool::acquire(size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (size > mBufferSize) {
+        // Everything pooled so far is too small from now on.
+        ALOGV("growing buffers from %zu to %zu bytes", mBufferSize, size);
+        mBufferSize = size;
+        mFreeBuffers.clear();
+    }
+
+    sp<ABuffer> buffer;
+    if (mFreeBuffers.empty()) {
+        ++mNumMisses;
+        buffer = new ABuffer(mBufferSize);
+    } else {
+        ++mNumHits;
+        buffer = mFreeBuffers.top();
+        mFreeBuffers.pop();
+    }
+
+    buffer->setRange(0, size);
+    return buffer;
+}
+
+void SampleBufferPool::release(const sp<ABuffer> &buffer) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (buffer->capacity() < mBufferSize || mFreeBuffers.size() >= mMaxBuffers) {
+        return;
+    }
+
+    mFreeBuffers.push_back(buffer);
+}
+
+sp<ABuffer> SampleBufferPool::wrap(size_t index, uint8_t *data, size_t capacity) {
+    Mutex::Autolock autoLock(mLock);
+
+    ssize_t i = mWrappers.indexOfKey(index);
+    if (i >= 0) {
+        const sp<ABuffer> &wrapper = mWrappers.valueAt(i);
+        if (wrapper->base() == data && wrapper->capacity() == capacity) {
+            ++mNumWrapHits;
+            wrapper->setRange(0, capacity);
+            return wrapper;
+        }
+    }
+
+    ++mNumWrapMisses;
+    sp<ABuffer> wrapper = new ABuffer(data, capacity);
+    mWrappers.replaceValueFor(index, wrapper);
+    return wrapper;
+}
+
+int64_t SampleBufferPool::numHits() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumHits;
+}
+
+int64_t SampleBufferPool::numMisses() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumMisses;
+}
+
+int64_t SampleBufferPool::numWrapHits() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumWrapHits;
+}
+
+int64_t SampleBufferPool::numWrapMisses() const {
+    Mutex::Autolock autoLock(mLock);
+    return mNumWrapMisses;
+}
+
+}  // namespace android
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_BUFFER_POOL_H
+#define SAMPLE_BUFFER_POOL_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct ABuffer;
+
+// Recycles the compressed sample storage of one track so that steady state
+// playback does not hit the heap for every access unit. Buffers are sized
+// from the track's max-input-size and grow if a larger sample shows up.
+// Buffers may be acquired and released from different threads.
+struct SampleBufferPool : public RefBase {
+    SampleBufferPool(size_t bufferSize, size_t maxBuffers);
+
+    sp<ABuffer> acquire(size_t size);
+    void release(const sp<ABuffer> &buffer);
+
+    // Returns an ABuffer view of a codec input buffer, reusing the view
+    // handed out last time for the same index and memory.
+    sp<ABuffer> wrap(size_t index, uint8_t *data, size_t capacity);
+
+    // Staging buffers handed out by acquire().
+    int64_t numHits() const;
+    int64_t numMisses() const;
+
+    // Views handed out by wrap().
+    int64_t numWrapHits() const;
+    int64_t numWrapMisses() const;
+
+protected:
+    virtual ~SampleBufferPool();
+
+private:
+    mutable Mutex mLock;
+
+    size_t mBufferSize;
+    size_t mMaxBuffers;
+    Vector<sp<ABuffer> > mFreeBuffers;
+    KeyedVector<size_t, sp<ABuffer> > mWrappers;
+
+    int64_t mNumHits;
+    int64_t mNumMisses;
+    int64_t mNumWrapHits;
+    int64_t mNumWrapMisses;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SampleBufferPool);
+};
+
+}  // namespace android
+
+#endif // SAMPLE_BUFFER_POOL_H
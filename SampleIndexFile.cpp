@@ -0,0 +1,606 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleIndexFile"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/Log.h>
+
+#include "SampleIndexFile.h"
+
+namespace android {
+
+static const char kMagic[4] = { 'S', 'P', 'I', 'X' };
+static const uint32_t kVersion = 1;
+
+// Verifying a sample reads it back from the media file, larger ones are
+// compared up to this size only.
+static const size_t kMaxVerifyBytes = 64 * 1024;
+
+struct IndexHeader {
+    char mMagic[4];
+    uint32_t mVersion;
+    int64_t mMediaSize;
+    int64_t mMediaTimeNs;
+    uint32_t mNumTracks;
+    uint32_t mNumSamples;
+    uint64_t mSamplesOffset;
+    uint64_t mSyncSamplesOffset;
+};
+
+struct TrackHeader {
+    uint32_t mFlags;
+    uint32_t mNumSyncSamples;
+    uint32_t mFormatSize;
+    uint32_t mReserved;
+};
+
+static int64_t modificationTimeNs(const struct stat &st) {
+    return st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+}
+
+static size_t align8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+static void appendBytes(Vector<uint8_t> *out, const void *data, size_t size) {
+    out->appendArray(static_cast<const uint8_t *>(data), size);
+}
+
+// Format entries are stored as type (uint8_t), name length (uint16_t), name,
+// value. Strings and buffers carry a uint32_t length. Other entry types do
+// not survive a process boundary and are skipped.
+static void serializeFormat(const sp<AMessage> &format, Vector<uint8_t> *out) {
+    for (size_t i = 0; i < format->countEntries(); ++i) {
+        AMessage::Type type;
+        const char *name = format->getEntryNameAt(i, &type);
+
+        uint8_t tag = type;
+        uint16_t nameLength = strlen(name);
+
+        switch (type) {
+            case AMessage::kTypeInt32:
+            {
+                int32_t value;
+                CHECK(format->findInt32(name, &value));
+                appendBytes(out, &tag, sizeof(tag));
+                appendBytes(out, &nameLength, sizeof(nameLength));
+                appendBytes(out, name, nameLength);
+                appendBytes(out, &value, sizeof(value));
+                break;
+            }
+
+            case AMessage::kTypeInt64:
+            {
+                int64_t value;
+                CHECK(format->findInt64(name, &value));
+                appendBytes(out, &tag, sizeof(tag));
+                appendBytes(out, &nameLength, sizeof(nameLength));
+                appendBytes(out, name, nameLength);
+                appendBytes(out, &value, sizeof(value));
+                break;
+            }
+
+            case AMessage::kTypeFloat:
+            {
+                float value;
+                CHECK(format->findFloat(name, &value));
+                appendBytes(out, &tag, sizeof(tag));
+                appendBytes(out, &nameLength, sizeof(nameLength));
+                appendBytes(out, name, nameLength);
+                appendBytes(out, &value, sizeof(value));
+                break;
+            }
+
+            case AMessage::kTypeString:
+            case AMessage::kTypeBuffer:
+            {
+                const void *data;
+                uint32_t size;
+                AString string;
+                sp<ABuffer> buffer;
+                if (type == AMessage::kTypeString) {
+                    CHECK(format->findString(name, &string));
+                    data = string.c_str();
+                    size = string.size();
+                } else {
+                    CHECK(format->findBuffer(name, &buffer));
+                    data = buffer->data();
+                    size = buffer->size();
+                }
+                appendBytes(out, &tag, sizeof(tag));
+                appendBytes(out, &nameLength, sizeof(nameLength));
+                appendBytes(out, name, nameLength);
+                appendBytes(out, &size, sizeof(size));
+                appendBytes(out, data, size);
+                break;
+            }
+
+            default:
+                ALOGV("not storing format entry '%s'", name);
+                break;
+        }
+    }
+}
+
+static bool readBytes(const uint8_t **ptr, const uint8_t *end, void *data, size_t size) {
+    if ((size_t)(end - *ptr) < size) {
+        return false;
+    }
+    memcpy(data, *ptr, size);
+    *ptr += size;
+    return true;
+}
+
+static sp<AMessage> deserializeFormat(const uint8_t *ptr, size_t size) {
+    const uint8_t *end = ptr + size;
+    sp<AMessage> format = new AMessage;
+
+    while (ptr < end) {
+        uint8_t tag;
+        uint16_t nameLength;
+        if (!readBytes(&ptr, end, &tag, sizeof(tag))
+                || !readBytes(&ptr, end, &nameLength, sizeof(nameLength))
+                || (size_t)(end - ptr) < nameLength) {
+            return NULL;
+        }
+
+        AString name((const char *)ptr, nameLength);
+        ptr += nameLength;
+
+        switch (tag) {
+            case AMessage::kTypeInt32:
+            {
+                int32_t value;
+                if (!readBytes(&ptr, end, &value, sizeof(value))) {
+                    return NULL;
+                }
+                format->setInt32(name.c_str(), value);
+                break;
+            }
+
+            case AMessage::kTypeInt64:
+            {
+                int64_t value;
+                if (!readBytes(&ptr, end, &value, sizeof(value))) {
+                    return NULL;
+                }
+                format->setInt64(name.c_str(), value);
+                break;
+            }
+
+            case AMessage::kTypeFloat:
+            {
+                float value;
+                if (!readBytes(&ptr, end, &value, sizeof(value))) {
+                    return NULL;
+                }
+                format->setFloat(name.c_str(), value);
+                break;
+            }
+
+            case AMessage::kTypeString:
+            case AMessage::kTypeBuffer:
+            {
+                uint32_t length;
+                if (!readBytes(&ptr, end, &length, sizeof(length))
+                        || (size_t)(end - ptr) < length) {
+                    return NULL;
+                }
+                if (tag == AMessage::kTypeString) {
+                    format->setString(name.c_str(), (const char *)ptr, length);
+                } else {
+                    sp<ABuffer> buffer = new ABuffer(length);
+                    memcpy(buffer->data(), ptr, length);
+                    format->setBuffer(name.c_str(), buffer);
+                }
+                ptr += length;
+                break;
+            }
+
+            default:
+                return NULL;
+        }
+    }
+
+    return format;
+}
+
+// static
+AString SampleIndexFile::SidecarPath(const char *mediaPath) {
+    AString path(mediaPath);
+    path.append(".spidx");
+    return path;
+}
+
+// static
+sp<SampleIndexFile> SampleIndexFile::Open(const char *path, const struct stat &mediaStat) {
+    int fd = open(path, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off64_t)sizeof(IndexHeader)) {
+        ::close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        ALOGW("failed to map %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    sp<SampleIndexFile> index = new SampleIndexFile;
+    index->mData = data;
+    index->mSize = st.st_size;
+
+    const IndexHeader *header = static_cast<const IndexHeader *>(data);
+    if (header->mMediaSize != mediaStat.st_size
+            || header->mMediaTimeNs != modificationTimeNs(mediaStat)) {
+        ALOGI("%s is out of date", path);
+        return NULL;
+    }
+
+    if (!index->parse()) {
+        ALOGW("%s is malformed", path);
+        return NULL;
+    }
+
+    return index;
+}
+
+SampleIndexFile::SampleIndexFile()
+    : mData(NULL),
+      mSize(0),
+      mNumSamples(0),
+      mSamples(NULL) {
+}
+
+SampleIndexFile::~SampleIndexFile() {
+    if (mData != NULL) {
+        munmap(mData, mSize);
+        mData = NULL;
+    }
+}
+
+bool SampleIndexFile::parse() {
+    const uint8_t *base = static_cast<const uint8_t *>(mData);
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(base);
+
+    if (memcmp(header->mMagic, kMagic, sizeof(kMagic)) || header->mVersion != kVersion) {
+        return false;
+    }
+
+    uint64_t samplesSize = (uint64_t)header->mNumSamples * sizeof(SampleEntry);
+    if (header->mSamplesOffset < sizeof(IndexHeader)
+            || header->mSamplesOffset % 8 || header->mSamplesOffset > mSize
+            || samplesSize > mSize - header->mSamplesOffset
+            || header->mSyncSamplesOffset % 4
+            || header->mSyncSamplesOffset > mSize) {
+        return false;
+    }
+
+    size_t offset = sizeof(IndexHeader);
+    size_t syncOffset = header->mSyncSamplesOffset;
+
+    for (uint32_t i = 0; i < header->mNumTracks; ++i) {
+        // The padding after the previous format may already run past the
+        // track headers.
+        if (offset + sizeof(TrackHeader) > header->mSamplesOffset) {
+            return false;
+        }
+
+        const TrackHeader *trackHeader =
+            reinterpret_cast<const TrackHeader *>(base + offset);
+        offset += sizeof(TrackHeader);
+
+        if (trackHeader->mFormatSize > header->mSamplesOffset - offset) {
+            return false;
+        }
+
+        uint64_t syncSize = (uint64_t)trackHeader->mNumSyncSamples * sizeof(uint32_t);
+        if (syncOffset + syncSize > mSize) {
+            return false;
+        }
+
+        Track track;
+        track.mFormat = deserializeFormat(base + offset, trackHeader->mFormatSize);
+        track.mFlags = trackHeader->mFlags;
+        track.mNumSyncSamples = trackHeader->mNumSyncSamples;
+        track.mSyncSamples = reinterpret_cast<const uint32_t *>(base + syncOffset);
+        offset = align8(offset + trackHeader->mFormatSize);
+
+        if (track.mFormat == NULL) {
+            return false;
+        }
+        syncOffset += syncSize;
+
+        for (uint32_t n = 0; n < track.mNumSyncSamples; ++n) {
+            if (track.mSyncSamples[n] >= header->mNumSamples) {
+                return false;
+            }
+        }
+
+        mTracks.push_back(track);
+    }
+
+    mNumSamples = header->mNumSamples;
+    mSamples = reinterpret_cast<const SampleEntry *>(base + header->mSamplesOffset);
+
+    for (size_t i = 0; i < mNumSamples; ++i) {
+        if (mSamples[i].mTrack >= mTracks.size()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+SampleIndexWriter::SampleIndexWriter(const char *mediaPath, const struct stat &mediaStat)
+    : mMediaPath(mediaPath),
+      mMediaStat(mediaStat),
+      mFd(open(mediaPath, O_RDONLY | O_LARGEFILE | O_CLOEXEC)),
+      mDone(mFd < 0) {
+}
+
+SampleIndexWriter::~SampleIndexWriter() {
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+void SampleIndexWriter::addTrack(size_t trackIndex, const sp<AMessage> &format) {
+    Track track;
+    track.mFormat = format;
+    track.mFlags = 0;
+    track.mNumSamples = 0;
+    track.mLastPrefixSize = 0;
+    track.mLastOffset = 0;
+    track.mLastSize = 0;
+    mTracks.add(trackIndex, track);
+}
+
+void SampleIndexWriter::addSample(
+        size_t trackIndex, const sp<MetaData> &meta, const sp<ABuffer> &data) {
+    if (mDone) {
+        return;
+    }
+
+    ssize_t index = mTracks.indexOfKey(trackIndex);
+    if (index < 0) {
+        abandon("sample of an unknown track");
+        return;
+    }
+
+    int64_t offset;
+    if (!meta->findInt64(kKeySampleFileOffset, &offset)) {
+        // Only the MPEG4 extractor does, Matroska and the rest cannot be
+        // indexed.
+        ALOGW("not indexing %s: the extractor does not report sample offsets",
+              mMediaPath.c_str());
+        abandon("extractor does not report sample offsets");
+        return;
+    }
+
+    Track *track = &mTracks.editValueAt(index);
+    size_t n = track->mNumSamples++;
+    if ((n & (n - 1)) == 0
+            && !verifySample(track, offset, data->data(), data->size(), data->size())) {
+        abandon("samples differ from the media file");
+        return;
+    }
+
+    // The extractor reuses its buffers, only the start of the last sample
+    // is kept for finish() to compare.
+    track->mLastPrefixSize =
+        data->size() < kLastSamplePrefixBytes ? data->size() : kLastSamplePrefixBytes;
+    memcpy(track->mLastPrefix, data->data(), track->mLastPrefixSize);
+    track->mLastOffset = offset;
+    track->mLastSize = data->size();
+
+    SampleIndexFile::SampleEntry entry;
+    entry.mOffset = offset;
+    CHECK(meta->findInt64(kKeyTime, &entry.mTimeUs));
+    entry.mSize = data->size();
+    entry.mTrack = index;
+    entry.mFlags = 0;
+
+    int32_t isSync;
+    if (meta->findInt32(kKeyIsSyncFrame, &isSync) && isSync) {
+        entry.mFlags |= SampleIndexFile::kSampleFlagSync;
+        track->mSyncSamples.push_back(mSamples.size());
+    }
+
+    mSamples.push_back(entry);
+}
+
+bool SampleIndexWriter::verifySample(
+        Track *track, int64_t offset, const uint8_t *data, size_t dataSize, size_t size) {
+    size_t compareSize = dataSize < kMaxVerifyBytes ? dataSize : kMaxVerifyBytes;
+    uint8_t *raw = new uint8_t[compareSize];
+
+    bool matched = false;
+    uint32_t flags = 0;
+    if (pread64(mFd, raw, compareSize, offset) == (ssize_t)compareSize) {
+        if (!memcmp(raw, data, compareSize)) {
+            matched = true;
+        } else if (hasNALLengths(offset, size)) {
+            // Length prefixed NAL units handed out with start codes.
+            size_t pos = 0;
+            while (pos + 4 <= compareSize) {
+                size_t nalLength = (raw[pos] << 24) | (raw[pos + 1] << 16)
+                        | (raw[pos + 2] << 8) | raw[pos + 3];
+                raw[pos] = raw[pos + 1] = raw[pos + 2] = 0;
+                raw[pos + 3] = 1;
+                pos += 4 + nalLength;
+            }
+
+            if (!memcmp(raw, data, compareSize)) {
+                flags = SampleIndexFile::kTrackFlagNALLengthPrefixed;
+                matched = true;
+            }
+        } else if (size >= 4 && !memcmp(data, "\x00\x00\x00\x01", 4)) {
+            // Shorter lengths are widened into start codes by the extractor,
+            // which changes the sample size. That cannot be played back from
+            // the offsets alone.
+            abandon("NAL unit lengths other than 4 bytes");
+        }
+    }
+
+    delete[] raw;
+
+    if (matched && track->mNumSamples > 1 && flags != track->mFlags) {
+        // Some samples start codes, some lengths.
+        return false;
+    }
+
+    track->mFlags = flags;
+    return matched;
+}
+
+// Whether the sample at offset parses as 4 byte NAL unit lengths, each
+// followed by that many bytes, ending exactly at size.
+bool SampleIndexWriter::hasNALLengths(int64_t offset, size_t size) {
+    size_t pos = 0;
+    while (pos + 4 <= size) {
+        uint8_t length[4];
+        if (pread64(mFd, length, sizeof(length), offset + pos) != (ssize_t)sizeof(length)) {
+            return false;
+        }
+
+        size_t nalLength = (length[0] << 24) | (length[1] << 16)
+                | (length[2] << 8) | length[3];
+        if (nalLength > size - pos - 4) {
+            return false;
+        }
+        pos += 4 + nalLength;
+    }
+
+    return pos == size;
+}
+
+void SampleIndexWriter::abandon(const char *reason) {
+    if (!mDone) {
+        ALOGV("not indexing %s: %s", mMediaPath.c_str(), reason);
+        mDone = true;
+    }
+}
+
+status_t SampleIndexWriter::finish() {
+    for (size_t i = 0; !mDone && i < mTracks.size(); ++i) {
+        Track *track = &mTracks.editValueAt(i);
+        if (track->mNumSamples == 0) {
+            continue;
+        }
+
+        // All of the last sample has to be in the file, not just its start.
+        uint8_t lastByte;
+        if (track->mLastSize > 0
+                && pread64(mFd, &lastByte, 1, track->mLastOffset + track->mLastSize - 1) != 1) {
+            abandon("samples run past the end of the media file");
+        } else if (!verifySample(
+                        track, track->mLastOffset, track->mLastPrefix,
+                        track->mLastPrefixSize, track->mLastSize)) {
+            abandon("samples differ from the media file");
+        }
+    }
+
+    if (mDone) {
+        return OK;
+    }
+    mDone = true;
+
+    Vector<uint8_t> tracks;
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        const Track &track = mTracks.valueAt(i);
+
+        Vector<uint8_t> format;
+        serializeFormat(track.mFormat, &format);
+
+        TrackHeader header;
+        header.mFlags = track.mFlags;
+        header.mNumSyncSamples = track.mSyncSamples.size();
+        header.mFormatSize = format.size();
+        header.mReserved = 0;
+
+        appendBytes(&tracks, &header, sizeof(header));
+        appendBytes(&tracks, format.array(), format.size());
+        while ((sizeof(IndexHeader) + tracks.size()) % 8) {
+            tracks.push_back(0);
+        }
+    }
+
+    IndexHeader header;
+    memcpy(header.mMagic, kMagic, sizeof(kMagic));
+    header.mVersion = kVersion;
+    header.mMediaSize = mMediaStat.st_size;
+    header.mMediaTimeNs = modificationTimeNs(mMediaStat);
+    header.mNumTracks = mTracks.size();
+    header.mNumSamples = mSamples.size();
+    header.mSamplesOffset = sizeof(header) + tracks.size();
+    header.mSyncSamplesOffset =
+        header.mSamplesOffset + mSamples.size() * sizeof(SampleIndexFile::SampleEntry);
+
+    AString path = SampleIndexFile::SidecarPath(mMediaPath.c_str());
+    AString tmpPath = path;
+    tmpPath.append(".tmp");
+
+    FILE *file = fopen(tmpPath.c_str(), "we");
+    if (file == NULL) {
+        ALOGW("failed to create %s: %s", tmpPath.c_str(), strerror(errno));
+        return -errno;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(tracks.array(), 1, tracks.size(), file) == tracks.size()
+        && fwrite(mSamples.array(), sizeof(SampleIndexFile::SampleEntry),
+                mSamples.size(), file) == mSamples.size();
+
+    for (size_t i = 0; ok && i < mTracks.size(); ++i) {
+        const Vector<uint32_t> &syncSamples = mTracks.valueAt(i).mSyncSamples;
+        ok = fwrite(syncSamples.array(), sizeof(uint32_t),
+                syncSamples.size(), file) == syncSamples.size();
+    }
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ALOGW("failed to write %s: %s", path.c_str(), strerror(errno));
+        unlink(tmpPath.c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    ALOGI("indexed %zu samples of %s", mSamples.size(), mMediaPath.c_str());
+    return OK;
+}
+
+}  // namespace android
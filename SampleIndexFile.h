@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_INDEX_FILE_H
+#define SAMPLE_INDEX_FILE_H
+
+#include <sys/stat.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/KeyedVector.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct ABuffer;
+struct AMessage;
+class MetaData;
+
+// Sidecar next to a media file listing every sample of the tracks that were
+// played: file offset, size, timestamp and sync flag, plus the track formats
+// including codec specific data. A later play maps it and reads samples with
+// pread() instead of parsing the container again. It is tied to the size and
+// modification time of the media file and ignored once either changes.
+//
+// Only files whose extractor reports kKeySampleFileOffset for every sample
+// can be indexed, in practice MPEG4. Matroska/WebM and the others do not and
+// are always read through the extractor.
+//
+// Layout, native byte order:
+//   Header
+//   per track: TrackHeader, serialized format padded to 8 bytes
+//   SampleEntry[numSamples], in the order they were read
+//   per track: uint32_t index into the sample entries of each sync sample
+struct SampleIndexFile : public RefBase {
+    enum {
+        kSampleFlagSync = 1,
+    };
+
+    enum {
+        // Samples are stored with 4 byte NAL unit lengths that the extractor
+        // replaced by start codes.
+        kTrackFlagNALLengthPrefixed = 1,
+    };
+
+    struct SampleEntry {
+        int64_t mOffset;
+        int64_t mTimeUs;
+        uint32_t mSize;
+        uint16_t mTrack;
+        uint16_t mFlags;
+    };
+
+    static AString SidecarPath(const char *mediaPath);
+
+    // NULL if there is no sidecar or it does not match mediaStat.
+    static sp<SampleIndexFile> Open(const char *path, const struct stat &mediaStat);
+
+    size_t countTracks() const { return mTracks.size(); }
+    sp<AMessage> getTrackFormat(size_t track) const { return mTracks[track].mFormat; }
+    uint32_t getTrackFlags(size_t track) const { return mTracks[track].mFlags; }
+
+    size_t countSamples() const { return mNumSamples; }
+    const SampleEntry &sampleAt(size_t index) const { return mSamples[index]; }
+
+    size_t countSyncSamples(size_t track) const { return mTracks[track].mNumSyncSamples; }
+    // Index of the sample entry of the n-th sync sample of a track.
+    uint32_t syncSampleAt(size_t track, size_t n) const { return mTracks[track].mSyncSamples[n]; }
+
+protected:
+    virtual ~SampleIndexFile();
+
+private:
+    struct Track {
+        sp<AMessage> mFormat;
+        uint32_t mFlags;
+        uint32_t mNumSyncSamples;
+        const uint32_t *mSyncSamples;
+    };
+
+    void *mData;
+    size_t mSize;
+    Vector<Track> mTracks;
+    size_t mNumSamples;
+    const SampleEntry *mSamples;
+
+    SampleIndexFile();
+    bool parse();
+
+    friend struct SampleIndexWriter;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SampleIndexFile);
+};
+
+// Collects the samples as they are read during a play from start to end and
+// writes the sidecar at the end. Anything that makes the list incomplete or
+// the raw bytes differ from what the extractor returns abandons it. Samples
+// are checked against the media file at doubling intervals, so the first,
+// one in the second half and the last sample of every track are.
+//
+// Only ever used by one thread at a time.
+struct SampleIndexWriter : public RefBase {
+    SampleIndexWriter(const char *mediaPath, const struct stat &mediaStat);
+
+    void addTrack(size_t trackIndex, const sp<AMessage> &format);
+    void addSample(size_t trackIndex, const sp<MetaData> &meta, const sp<ABuffer> &data);
+    void abandon(const char *reason);
+
+    // Writes the sidecar unless abandoned. Only the first call does anything.
+    status_t finish();
+
+protected:
+    virtual ~SampleIndexWriter();
+
+private:
+    enum {
+        kLastSamplePrefixBytes = 64,
+    };
+
+    struct Track {
+        sp<AMessage> mFormat;
+        uint32_t mFlags;
+        size_t mNumSamples;
+        Vector<uint32_t> mSyncSamples;
+
+        // Start of the latest sample, verified by finish().
+        uint8_t mLastPrefix[kLastSamplePrefixBytes];
+        size_t mLastPrefixSize;
+        int64_t mLastOffset;
+        size_t mLastSize;
+    };
+
+    AString mMediaPath;
+    struct stat mMediaStat;
+    int mFd;
+    bool mDone;
+
+    KeyedVector<size_t, Track> mTracks;
+    Vector<SampleIndexFile::SampleEntry> mSamples;
+
+    // Compares the first bytes of a sample of the given size, data holds
+    // dataSize of them.
+    bool verifySample(
+            Track *track, int64_t offset, const uint8_t *data, size_t dataSize, size_t size);
+    bool hasNALLengths(int64_t offset, size_t size);
+
+    DISALLOW_EVIL_CONSTRUCTORS(SampleIndexWriter);
+};
+
+}  // namespace android
+
+#endif // SAMPLE_INDEX_FILE_H
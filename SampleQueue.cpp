@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleQueue"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Log.h>
+
+#include "SampleQueue.h"
+
+namespace android {
+
+SampleQueue::SampleQueue(size_t capacity)
+    : mCapacity(1),
+      mSlots(NULL),
+      mHead(0),
+      mTail(0) {
+    while (mCapacity < capacity) {
+        mCapacity <<= 1;
+    }
+
+    mSlots = new sp<ABuffer>[mCapacity];
+}
+
+SampleQueue::~SampleQueue() {
+    delete[] mSlots;
+    mSlots = NULL;
+}
+
+bool SampleQueue::push(const sp<ABuffer> &buffer) {
+    size_t tail = mTail.load(std::memory_order_relaxed);
+    size_t head = mHead.load(std::memory_order_acquire);
+
+    if (tail - head >= mCapacity) {
+        return false;
+    }
+
+    mSlots[tail & (mCapacity - 1)] = buffer;
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool SampleQueue::pop(sp<ABuffer> *buffer) {
+    size_t head = mHead.load(std::memory_order_relaxed);
+    size_t tail = mTail.load(std::memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+
+    sp<ABuffer> &slot = mSlots[head & (mCapacity - 1)];
+    *buffer = slot;
+    slot.clear();
+
+    mHead.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+size_t SampleQueue::size() const {
+    size_t head = mHead.load(std::memory_order_acquire);
+    size_t tail = mTail.load(std::memory_order_acquire);
+    return tail - head;
+}
+
+}  // namespace android
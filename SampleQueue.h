@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_QUEUE_H
+#define SAMPLE_QUEUE_H
+
+#include <atomic>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+struct ABuffer;
+
+// Lock-free ring of compressed samples between exactly one producer thread
+// (the demuxer) and one consumer thread (the player looper).
+struct SampleQueue : public RefBase {
+    // capacity is rounded up to a power of two.
+    explicit SampleQueue(size_t capacity);
+
+    // Producer side, returns false if the ring is full.
+    bool push(const sp<ABuffer> &buffer);
+
+    // Consumer side, returns false if the ring is empty.
+    bool pop(sp<ABuffer> *buffer);
+
+    size_t size() const;
+    size_t capacity() const { return mCapacity; }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= mCapacity; }
+
+protected:
+    virtual ~SampleQueue();
+
+private:
+    size_t mCapacity;
+    sp<ABuffer> *mSlots;
+
+    // Free running counters, only ever advanced by their owning side.
+    alignas(64) std::atomic<size_t> mHead;
+    alignas(64) std::atomic<size_t> mTail;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SampleQueue);
+};
+
+}  // namespace android
+
+#endif // SAMPLE_QUEUE_H
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_SOURCE_H
+#define SAMPLE_SOURCE_H
+
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+struct ABuffer;
+struct AMessage;
+class MetaData;
+
+// The subset of NuMediaExtractor the player reads samples through, so that
+// samples can also come from a SampleIndexFile instead of the container.
+struct SampleSource : public RefBase {
+    SampleSource() {}
+
+    virtual size_t countTracks() const = 0;
+    virtual status_t getTrackFormat(size_t index, sp<AMessage> *format) const = 0;
+    virtual status_t selectTrack(size_t index) = 0;
+
+    virtual status_t seekTo(
+            int64_t timeUs, MediaSource::ReadOptions::SeekMode mode) = 0;
+
+    virtual status_t advance() = 0;
+    virtual status_t readSampleData(const sp<ABuffer> &buffer) = 0;
+    virtual status_t getSampleSize(size_t *sampleSize) = 0;
+    virtual status_t getSampleTrackIndex(size_t *trackIndex) = 0;
+    virtual status_t getSampleTime(int64_t *sampleTimeUs) = 0;
+    virtual status_t getSampleMeta(sp<MetaData> *sampleMeta) = 0;
+
+protected:
+    virtual ~SampleSource() {}
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(SampleSource);
+};
+
+}  // namespace android
+
+#endif // SAMPLE_SOURCE_H
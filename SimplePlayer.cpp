@@ -17,35 +17,226 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "SimplePlayer"
 
+#include <sys/stat.h>
+#include <time.h>
+
 #include <gui/Surface.h>
-#include <media/AudioTrack.h>
 #include <mediadrm/ICrypto.h>
+#include <media/AudioSystem.h>
 #include <media/IMediaHTTPService.h>
 #include <media/MediaCodecBuffer.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/avc_utils.h>
+#include <media/stagefright/DataSource.h>
 #include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/NuMediaExtractor.h>
 #include <utils/Log.h>
 
+#include "AudioSink.h"
+#include "CodecPool.h"
+#include "CodecStarter.h"
+#include "Demuxer.h"
+#include "ExtractorSampleSource.h"
+#include "HttpCacheSource.h"
+#include "IndexedSampleSource.h"
+#include "PcmProcessor.h"
+#include "PlaybackClock.h"
+#include "PrefetchPolicy.h"
+#include "Resampler.h"
+#include "SampleBufferPool.h"
+#include "SampleIndexFile.h"
+#include "SampleQueue.h"
 #include "SimplePlayer.h"
+#include "SyncSampleIndex.h"
+#include "TimeStretcher.h"
+#include "TranscodeSink.h"
 
 namespace android {
 
+// PCM buffered between the player looper and the AudioTrack callback.
+static const int64_t kAudioSinkBufferDurationUs = 250000ll;
+static const int64_t kLowLatencyAudioSinkBufferDurationUs = 40000ll;
+
+// Decoders in low-latency mode are asked to run as fast as they can rather
+// than at the frame rate.
+static const float kLowLatencyOperatingRate = 32767.0f;
+
+// Enough for the staged samples of a track plus the one being copied out.
+static const size_t kSampleBufferPoolSize = 16;
+
+// Hard cap on queued samples per track, the PrefetchPolicy budget is
+// normally what limits the demux thread.
+static const size_t kSampleQueueSize = 256;
+
+// Output is scheduled this far out after start(), seeks show their first
+// frame right away.
+static const int64_t kStartLeadUs = 100000ll;
+
+static const float kMinPlaybackRate = 0.25f;
+static const float kMaxPlaybackRate = 4.0f;
+
+// Predicted video lag at which input is thinned before decoding, see
+// FrameDropPolicy.
+static const int64_t kDropNonReferenceLagUs = 20000ll;
+static const int64_t kDropToSyncLagUs = 250000ll;
+
+// Volume changes are spread over this much audio so they do not click.
+static const int64_t kVolumeRampUs = 20000ll;
+
+static const int64_t kDefaultVideoPrefetchBytes = 8ll * 1024 * 1024;
+static const int64_t kDefaultAudioPrefetchBytes = 256ll * 1024;
+static const int64_t kDefaultPrefetchDurationUs = 500000ll;
+static const int64_t kDefaultPrefetchTotalBytes = 32ll * 1024 * 1024;
+
+static const int64_t kDefaultHttpCacheBytes = 32ll * 1024 * 1024;
+static const int64_t kDefaultHttpReadAheadBytes = 8ll * 1024 * 1024;
+static const int32_t kDefaultHttpConnections = 3;
+
+static int64_t GetThreadCpuTimeUs() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0ll;
+    }
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+// Charges the CPU time the calling thread spends in its scope to a track.
+struct TrackCpuScope {
+    explicit TrackCpuScope(int64_t *cpuUs)
+        : mCpuUs(cpuUs),
+          mStartUs(GetThreadCpuTimeUs()) {
+    }
+
+    ~TrackCpuScope() {
+        *mCpuUs += GetThreadCpuTimeUs() - mStartUs;
+    }
+
+private:
+    int64_t *mCpuUs;
+    int64_t mStartUs;
+
+    DISALLOW_EVIL_CONSTRUCTORS(TrackCpuScope);
+};
+
+static const unsigned kHEVCNalTypeSPS = 33;
+
+// Raises *maxTemporalId to sps_max_sub_layers_minus1 of the SPS NAL unit.
+static void UpdateHEVCMaxTemporalId(
+        const uint8_t *nalStart, size_t nalSize, int32_t *maxTemporalId) {
+    if (nalSize < 3) {
+        return;
+    }
+
+    int32_t maxSubLayersMinus1 = (nalStart[2] >> 1) & 7;
+    if (maxSubLayersMinus1 > *maxTemporalId) {
+        *maxTemporalId = maxSubLayersMinus1;
+    }
+}
+
+// -1 if the codec specific data holds no SPS.
+static int32_t GetHEVCMaxTemporalId(const Vector<sp<ABuffer> > &csd) {
+    int32_t maxTemporalId = -1;
+    for (size_t i = 0; i < csd.size(); ++i) {
+        const uint8_t *data = csd[i]->data();
+        size_t size = csd[i]->size();
+
+        const uint8_t *nalStart;
+        size_t nalSize;
+        while (getNextNALUnit(&data, &size, &nalStart, &nalSize, true) == OK) {
+            if (nalSize >= 2 && ((nalStart[0] >> 1) & 0x3f) == kHEVCNalTypeSPS) {
+                UpdateHEVCMaxTemporalId(nalStart, nalSize, &maxTemporalId);
+            }
+        }
+    }
+
+    return maxTemporalId;
+}
+
 SimplePlayer::SimplePlayer()
     : mState(UNINITIALIZED),
+      mHttpStallsAtStart(0ll),
       mDoMoreStuffGeneration(0),
+      mCodecGeneration(0),
       mEndOfStream(0),
+      mAsyncMode(false),
+      mUseDemuxThread(false),
+      mBenchmark(false),
+      mPreferSoftwareCodecs(false),
+      mRenderAheadUs(0ll),
+      mVsyncPeriodUs(0ll),
+      mPlaybackRate(1.0f),
+      mVolume(1.0f),
+      mAudioPcm24Bit(false),
+      mResamplerQuality(-1),
+      mLowLatency(false),
+      mDropNonReferenceLagUs(kDropNonReferenceLagUs),
+      mDropToSyncLagUs(kDropToSyncLagUs),
+      mHttpCacheBytes(kDefaultHttpCacheBytes),
+      mHttpReadAheadBytes(kDefaultHttpReadAheadBytes),
+      mHttpConnections(kDefaultHttpConnections),
+      mUseSampleIndex(false),
+      mPreparedFromIndex(false),
+      mPrepareStartTimeUs(-1ll),
+      mSourceOpenUs(-1ll),
+      mFirstSamplesUs(-1ll),
+      mCodecWaitUs(-1ll),
+      mPrepareTimeUs(-1ll),
+      mStartRequestTimeUs(-1ll),
+      mPrefetchDurationUs(kDefaultPrefetchDurationUs),
+      mPrefetchTotalBytes(kDefaultPrefetchTotalBytes),
+      mNumMemoryPressureEvents(0ll),
+      mUnderMemoryPressure(false),
+      mNumWakeups(0ll),
       mStartTimeRealUs(-1ll),
+      mStartMediaTimeUs(-1ll),
+      mStartLeadUs(kStartLeadUs),
+      mCodecsFlushed(false),
+      mSeekStartTimeUs(-1ll),
+      mSeekMode(SEEK_PREVIOUS_SYNC),
+      mSeekTrackIndex(0),
+      mNumIndexedSeeks(0ll),
+      mClock(new PlaybackClock),
+      mNumAVOffsetSamples(0ll),
+      mSumAVOffsetUs(0ll),
+      mMaxAVOffsetUs(0ll),
+      mAVOffsetReportTimeUs(-1ll),
+      mNumAVOffsetSamplesReported(0ll),
+      mSumAVOffsetUsReported(0ll),
+      mPrerolling(false),
+      mHandoffAudioFramesQueued(0),
+      mHandoffEndTimeUs(-1ll),
+      mTransitionType(VIDEO),
+      mTransitionPending(false),
+      mTransitionGapUs(0ll),
       mEncounteredInputEOS(false),
+      mReadProgress(false),
       firstFrameObserved(false) {
+    mPrefetchBytes[VIDEO] = kDefaultVideoPrefetchBytes;
+    mPrefetchBytes[AUDIO] = kDefaultAudioPrefetchBytes;
 }
 
 SimplePlayer::~SimplePlayer() {
 }
 
+// AudioSink and DataSource only derive from RefBase virtually, so they travel
+// wrapped in messages.
+struct AudioSinkHolder : public RefBase {
+    explicit AudioSinkHolder(const sp<AudioSink> &sink) : mSink(sink) {}
+
+    sp<AudioSink> mSink;
+};
+
+struct DataSourceHolder : public RefBase {
+    explicit DataSourceHolder(const sp<DataSource> &source) : mSource(source) {}
+
+    sp<DataSource> mSource;
+};
+
 // static
 status_t PostAndAwaitResponse(
         const sp<AMessage> &msg, sp<AMessage> *response) {
@@ -68,6 +259,13 @@ status_t SimplePlayer::setDataSource(const char *path) {
     return PostAndAwaitResponse(msg, &response);
 }
 
+status_t SimplePlayer::setDataSource(const sp<DataSource> &source) {
+    sp<AMessage> msg = new AMessage(kWhatSetDataSource, this);
+    msg->setObject("source", new DataSourceHolder(source));
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
 status_t SimplePlayer::setSurface(const sp<IGraphicBufferProducer> &bufferProducer) {
     sp<AMessage> msg = new AMessage(kWhatSetSurface, this);
 
@@ -107,18 +305,112 @@ status_t SimplePlayer::reset() {
 }
 
 bool SimplePlayer::isPlaying() {
-    return mEndOfStream;
+    return mState == STARTED && mEndOfStream;
+}
+
+bool SimplePlayer::reachedEndOfStream() {
+    return !mEndOfStream;
+}
+
+status_t SimplePlayer::seekTo(int64_t timeUs, SeekMode mode) {
+    sp<AMessage> msg = new AMessage(kWhatSeek, this);
+    msg->setInt64("timeUs", timeUs);
+    msg->setInt32("mode", mode);
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
+status_t SimplePlayer::setPlaybackRate(float rate) {
+    sp<AMessage> msg = new AMessage(kWhatSetPlaybackRate, this);
+    msg->setFloat("rate", rate);
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
+status_t SimplePlayer::setVolume(float volume) {
+    sp<AMessage> msg = new AMessage(kWhatSetVolume, this);
+    msg->setFloat("volume", volume);
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
+status_t SimplePlayer::preroll() {
+    sp<AMessage> msg = new AMessage(kWhatPreroll, this);
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
+status_t SimplePlayer::setNextPlayer(const sp<SimplePlayer> &next) {
+    if (next != NULL) {
+        status_t err = next->preroll();
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    sp<AMessage> msg = new AMessage(kWhatSetNextPlayer, this);
+    msg->setObject("next", next);
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
+status_t SimplePlayer::setParameters(const sp<AMessage> &params) {
+    sp<AMessage> msg = new AMessage(kWhatSetParameters, this);
+    msg->setMessage("params", params);
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
+status_t SimplePlayer::getLatencyStats(sp<AMessage> *stats) {
+    sp<AMessage> msg = new AMessage(kWhatGetLatencyStats, this);
+    sp<AMessage> response;
+    status_t err = PostAndAwaitResponse(msg, &response);
+
+    if (err == OK) {
+        CHECK(response->findMessage("stats", stats));
+    }
+
+    return err;
+}
+
+status_t SimplePlayer::getStats(sp<AMessage> *stats) {
+    sp<AMessage> msg = new AMessage(kWhatGetStats, this);
+    sp<AMessage> response;
+    status_t err = PostAndAwaitResponse(msg, &response);
+
+    if (err == OK) {
+        CHECK(response->findMessage("stats", stats));
+    }
+
+    return err;
+}
+
+status_t SimplePlayer::getStartupStats(sp<AMessage> *stats) {
+    sp<AMessage> msg = new AMessage(kWhatGetStartupStats, this);
+    sp<AMessage> response;
+    status_t err = PostAndAwaitResponse(msg, &response);
+
+    if (err == OK) {
+        CHECK(response->findMessage("stats", stats));
+    }
+
+    return err;
 }
 
 void SimplePlayer::onMessageReceived(const sp<AMessage> &msg) {
     switch (msg->what()) {
         case kWhatSetDataSource:
         {
-            status_t err;
+            status_t err = OK;
             if (mState != UNINITIALIZED) {
                 err = INVALID_OPERATION;
             } else {
-                CHECK(msg->findString("path", &mPath));
+                sp<RefBase> obj;
+                if (msg->findObject("source", &obj)) {
+                    mDataSource = static_cast<DataSourceHolder *>(obj.get())->mSource;
+                } else {
+                    CHECK(msg->findString("path", &mPath));
+                }
                 mState = UNPREPARED;
             }
 
@@ -207,6 +499,63 @@ void SimplePlayer::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatPreroll:
+        {
+            status_t err = OK;
+
+            if (mState == UNPREPARED) {
+                err = onPrepare();
+
+                if (err == OK) {
+                    mState = STOPPED;
+                }
+            }
+
+            if (err == OK) {
+                if (mState != STOPPED) {
+                    err = INVALID_OPERATION;
+                } else {
+                    // Output is held back until onStart().
+                    mPrerolling = true;
+                    scheduleDoMoreStuff(0ll);
+                }
+            }
+
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
+
+            sp<AMessage> response = new AMessage;
+            response->setInt32("err", err);
+            response->postReply(replyID);
+            break;
+        }
+
+        case kWhatSetNextPlayer:
+        {
+            sp<RefBase> obj;
+            CHECK(msg->findObject("next", &obj));
+            mNextPlayer = static_cast<SimplePlayer *>(obj.get());
+
+            if (mNextPlayer != NULL && mState == STARTED && !mEndOfStream) {
+                // Already done playing.
+                handOffToNextPlayer(ALooper::GetNowUs());
+            }
+
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
+
+            sp<AMessage> response = new AMessage;
+            response->setInt32("err", OK);
+            response->postReply(replyID);
+            break;
+        }
+
+        case kWhatHandoff:
+        {
+            onHandoff(msg);
+            break;
+        }
+
         case kWhatStop:
         {
             status_t err;
@@ -262,369 +611,2288 @@ void SimplePlayer::onMessageReceived(const sp<AMessage> &msg) {
                 break;
             }
 
+            ++mNumWakeups;
             status_t err = onDoMoreStuff();
 
             if (err == OK) {
-                msg->post(5000ll);
+                if (mAsyncMode) {
+                    postDoMoreStuffIfNeeded();
+                } else {
+                    msg->post(5000ll);
+                }
             }
             break;
         }
 
-        default:
-            TRESPASS();
-    }
-}
-
-status_t SimplePlayer::onPrepare() {
-    CHECK_EQ(mState, UNPREPARED);
+        case kWhatSetParameters:
+        {
+            status_t err;
+            if (mState != UNINITIALIZED && mState != UNPREPARED) {
+                err = INVALID_OPERATION;
+            } else {
+                sp<AMessage> params;
+                CHECK(msg->findMessage("params", &params));
+                err = onSetParameters(params);
+            }
 
-    mExtractor = new NuMediaExtractor(NuMediaExtractor::EntryPoint::OTHER);
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
 
-    status_t err = mExtractor->setDataSource(
-            NULL /* httpService */, mPath.c_str());
+            sp<AMessage> response = new AMessage;
+            response->setInt32("err", err);
+            response->postReply(replyID);
+            break;
+        }
 
-    if (err != OK) {
-        mExtractor.clear();
-        return err;
-    }
+        case kWhatGetStats:
+        {
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
 
-    if (mCodecLooper == NULL) {
-        mCodecLooper = new ALooper;
-        mCodecLooper->start();
-    }
+            sp<AMessage> response = new AMessage;
+            response->setMessage("stats", onGetStats());
+            response->postReply(replyID);
+            break;
+        }
 
-    bool haveAudio = false;
-    bool haveVideo = false;
-    for (size_t i = 0; i < mExtractor->countTracks(); ++i) {
-        sp<AMessage> format;
-        status_t err = mExtractor->getTrackFormat(i, &format);
-        CHECK_EQ(err, (status_t)OK);
+        case kWhatGetStartupStats:
+        {
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
 
-        AString mime;
-        CHECK(format->findString("mime", &mime));
+            sp<AMessage> response = new AMessage;
+            response->setMessage("stats", onGetStartupStats());
+            response->postReply(replyID);
+            break;
+        }
 
-        bool isVideo = !strncasecmp(mime.c_str(), "video/", 6);
-        bool isAudio = !strncasecmp(mime.c_str(), "audio/", 6);
+        case kWhatGetLatencyStats:
+        {
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
 
-        if (!haveAudio && isAudio) {
-            haveAudio = true;
-        } else if (!haveVideo && isVideo) {
-            haveVideo = true;
-        } else {
-            continue;
+            sp<AMessage> response = new AMessage;
+            response->setMessage("stats", onGetLatencyStats());
+            response->postReply(replyID);
+            break;
         }
 
-        err = mExtractor->selectTrack(i);
-        CHECK_EQ(err, (status_t)OK);
-
-        CodecState *state =
-            &mStateByTrackIndex.editValueAt(
-                    mStateByTrackIndex.add(i, CodecState()));
+        case kWhatSeek:
+        {
+            status_t err;
+            if (mState != STARTED && mState != STOPPED) {
+                err = INVALID_OPERATION;
+            } else {
+                int64_t timeUs;
+                CHECK(msg->findInt64("timeUs", &timeUs));
 
-        if(isVideo) state->mType = VIDEO;
-        if(isAudio) state->mType = AUDIO;
+                int32_t mode;
+                CHECK(msg->findInt32("mode", &mode));
 
-        mEndOfStream |= 0x1 << state->mType;
+                if (mode < 0 || mode >= NUM_SEEK_MODES) {
+                    err = BAD_VALUE;
+                } else {
+                    err = onSeek(timeUs, (SeekMode)mode);
+                }
+            }
 
-        state->mNumFramesWritten = 0;
-        state->mCodec = MediaCodec::CreateByType(
-                mCodecLooper, mime.c_str(), false /* encoder */);
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
 
-        CHECK(state->mCodec != NULL);
+            sp<AMessage> response = new AMessage;
+            response->setInt32("err", err);
+            response->postReply(replyID);
+            break;
+        }
 
-        err = state->mCodec->configure(
-                format,
-                isVideo ? mSurface : NULL,
-                NULL /* crypto */,
-                0 /* flags */);
+        case kWhatSetPlaybackRate:
+        {
+            float rate;
+            CHECK(msg->findFloat("rate", &rate));
 
-        CHECK_EQ(err, (status_t)OK);
+            status_t err = onSetPlaybackRate(rate);
 
-        size_t j = 0;
-        sp<ABuffer> buffer;
-        while (format->findBuffer(AStringPrintf("csd-%d", j).c_str(), &buffer)) {
-            state->mCSD.push_back(buffer);
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
 
-            ++j;
+            sp<AMessage> response = new AMessage;
+            response->setInt32("err", err);
+            response->postReply(replyID);
+            break;
         }
-    }
-
-    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
-        CodecState *state = &mStateByTrackIndex.editValueAt(i);
 
-        status_t err = state->mCodec->start();
-        CHECK_EQ(err, (status_t)OK);
+        case kWhatSetVolume:
+        {
+            float volume;
+            CHECK(msg->findFloat("volume", &volume));
 
-        err = state->mCodec->getInputBuffers(&state->mBuffers[0]);
-        CHECK_EQ(err, (status_t)OK);
+            status_t err = onSetVolume(volume);
 
-        err = state->mCodec->getOutputBuffers(&state->mBuffers[1]);
-        CHECK_EQ(err, (status_t)OK);
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
 
-        for (size_t j = 0; j < state->mCSD.size(); ++j) {
-            const sp<ABuffer> &srcBuffer = state->mCSD.itemAt(j);
+            sp<AMessage> response = new AMessage;
+            response->setInt32("err", err);
+            response->postReply(replyID);
+            break;
+        }
 
-            size_t index;
-            err = state->mCodec->dequeueInputBuffer(&index, -1ll);
-            CHECK_EQ(err, (status_t)OK);
+        case kWhatResumeCodecs:
+        {
+            int32_t generation;
+            CHECK(msg->findInt32("generation", &generation));
 
-            const sp<MediaCodecBuffer> &dstBuffer = state->mBuffers[0].itemAt(index);
+            if (generation != mCodecGeneration || !mCodecsFlushed) {
+                break;
+            }
 
-            CHECK_LE(srcBuffer->size(), dstBuffer->capacity());
-            dstBuffer->setRange(0, srcBuffer->size());
-            memcpy(dstBuffer->data(), srcBuffer->data(), srcBuffer->size());
+            mCodecsFlushed = false;
 
-            err = state->mCodec->queueInputBuffer(
+            for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+                CHECK_EQ(mStateByTrackIndex.valueAt(i).mCodec->start(), (status_t)OK);
+            }
+            break;
+        }
+
+        case kWhatCodecNotify:
+        case kWhatDemuxerNotify:
+        {
+            if (msg->what() == kWhatCodecNotify) {
+                if (mCodecsFlushed) {
+                    // Posted before the flush, the buffer it refers to is gone.
+                    break;
+                }
+                onCodecNotify(msg);
+            }
+
+            if ((mState == STARTED || mPrerolling) && mAsyncMode) {
+                ++mNumWakeups;
+                if (onDoMoreStuff() == OK) {
+                    postDoMoreStuffIfNeeded();
+                }
+            }
+            break;
+        }
+
+        case kWhatFrameRendered:
+        {
+            onFrameRendered(msg);
+            break;
+        }
+
+        default:
+            TRESPASS();
+    }
+}
+
+status_t SimplePlayer::openSampleSource() {
+    // Sidecars are only kept next to local files.
+    struct stat st;
+    bool useSampleIndex =
+        mUseSampleIndex && mDataSource == NULL && stat(mPath.c_str(), &st) == 0;
+
+    mPreparedFromIndex = false;
+    if (useSampleIndex) {
+        AString indexPath = SampleIndexFile::SidecarPath(mPath.c_str());
+        sp<SampleIndexFile> index = SampleIndexFile::Open(indexPath.c_str(), st);
+
+        if (index != NULL) {
+            sp<IndexedSampleSource> source = new IndexedSampleSource(mPath.c_str(), index);
+            if (source->initCheck() == OK) {
+                ALOGV("preparing from %s", indexPath.c_str());
+                mExtractor = source;
+                mPreparedFromIndex = true;
+                return OK;
+            }
+        }
+    }
+
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor(NuMediaExtractor::EntryPoint::OTHER);
+
+    status_t err;
+    if (mDataSource == NULL && mPath.startsWithIgnoreCase("http://")) {
+        mHttpSource = new HttpCacheSource(
+                mPath.c_str(),
+                mHttpCacheBytes,
+                mHttpReadAheadBytes,
+                mHttpConnections,
+                mHttpCacheFile.empty() ? NULL : mHttpCacheFile.c_str());
+
+        err = mHttpSource->connect();
+        if (err != OK) {
+            mHttpSource->close();
+            mHttpSource.clear();
+            return err;
+        }
+
+        err = extractor->setDataSource(mHttpSource);
+        if (err != OK) {
+            mHttpSource->close();
+            mHttpSource.clear();
+            return err;
+        }
+    } else if (mDataSource != NULL) {
+        err = extractor->setDataSource(mDataSource);
+    } else {
+        err = extractor->setDataSource(NULL /* httpService */, mPath.c_str());
+    }
+
+    if (err != OK) {
+        return err;
+    }
+
+    sp<ExtractorSampleSource> source = new ExtractorSampleSource(extractor);
+    if (useSampleIndex) {
+        source->setIndexWriter(new SampleIndexWriter(mPath.c_str(), st));
+    }
+
+    mExtractor = source;
+    return OK;
+}
+
+// static
+void SimplePlayer::FindTracks(
+        const sp<SampleSource> &source, ssize_t *audioTrack, ssize_t *videoTrack) {
+    *audioTrack = -1;
+    *videoTrack = -1;
+
+    for (size_t i = 0; i < source->countTracks(); ++i) {
+        sp<AMessage> format;
+        CHECK_EQ(source->getTrackFormat(i, &format), (status_t)OK);
+
+        AString mime;
+        CHECK(format->findString("mime", &mime));
+
+        if (*audioTrack < 0 && !strncasecmp(mime.c_str(), "audio/", 6)) {
+            *audioTrack = i;
+        } else if (*videoTrack < 0 && !strncasecmp(mime.c_str(), "video/", 6)) {
+            *videoTrack = i;
+        }
+    }
+}
+
+status_t SimplePlayer::onPrepare() {
+    CHECK_EQ(mState, UNPREPARED);
+
+    mPrepareStartTimeUs = ALooper::GetNowUs();
+
+    status_t err = openSampleSource();
+    if (err != OK) {
+        mExtractor.clear();
+        return err;
+    }
+
+    mSourceOpenUs = ALooper::GetNowUs() - mPrepareStartTimeUs;
+
+    if (mCodecLooper == NULL) {
+        mCodecLooper = new ALooper;
+        mCodecLooper->start();
+    }
+
+    ssize_t audioTrack;
+    ssize_t videoTrack;
+    FindTracks(mExtractor, &audioTrack, &videoTrack);
+
+    KeyedVector<size_t, sp<CodecStarter> > starters;
+    for (size_t i = 0; i < mExtractor->countTracks(); ++i) {
+        bool isVideo = (ssize_t)i == videoTrack;
+        bool isAudio = (ssize_t)i == audioTrack && mTranscodeSink == NULL;
+        if (!isAudio && !isVideo) {
+            continue;
+        }
+
+        sp<AMessage> format;
+        status_t err = mExtractor->getTrackFormat(i, &format);
+        CHECK_EQ(err, (status_t)OK);
+
+        if (isAudio) {
+            // Downmix and volume run on float, decoders that cannot
+            // deliver it stay on 16 bit.
+            format = format->dup();
+            format->setInt32(KEY_PCM_ENCODING, kAudioEncodingPcmFloat);
+        } else if (mFrameExport != NULL) {
+            format = format->dup();
+            format->setInt32(KEY_COLOR_FORMAT, COLOR_FormatYUV420Flexible);
+        } else if (mTranscodeSink != NULL) {
+            // The encoder has to see every frame.
+            format = format->dup();
+            format->setInt32(KEY_ALLOW_FRAME_DROP, 0);
+        }
+
+        if (mLowLatency) {
+            format = format->dup();
+            format->setInt32(KEY_PRIORITY, 0 /* realtime */);
+            if (isVideo) {
+                format->setInt32(KEY_LOW_LATENCY, 1);
+                format->setFloat(KEY_OPERATING_RATE, kLowLatencyOperatingRate);
+            }
+        }
+
+        err = mExtractor->selectTrack(i);
+        CHECK_EQ(err, (status_t)OK);
+
+        CodecState *state =
+            &mStateByTrackIndex.editValueAt(
+                    mStateByTrackIndex.add(i, CodecState()));
+
+        if(isVideo) state->mType = VIDEO;
+        if(isAudio) state->mType = AUDIO;
+
+        mEndOfStream |= 0x1 << state->mType;
+
+        state->mSampleRate = 0;
+        state->mChannelCount = 0;
+        state->mAudioFormat = AUDIO_FORMAT_PCM_16_BIT;
+        state->mInputEOSQueued = false;
+        state->mNumFramesWritten = 0;
+        state->mNumBytesCopied = 0ll;
+        state->mNumBytesDirect = 0ll;
+        state->mNumFramesRendered = 0ll;
+        state->mNumFramesDropped = 0ll;
+        state->mSumRenderJitterUs = 0ll;
+        state->mMaxRenderJitterUs = 0ll;
+        state->mNumFramesDecoded = 0ll;
+        state->mClientCpuUs = 0ll;
+        state->mCanExport = false;
+        state->mNumFramesExported = 0ll;
+        state->mNumFramesNotExported = 0ll;
+        state->mFirstQueueTimeUs = -1ll;
+        state->mLastOutputTimeUs = -1ll;
+        state->mLastRenderedTimeUs = -1ll;
+        state->mNumFrameIntervals = 0ll;
+        state->mNumFramesWithinInterval = 0ll;
+
+        int32_t maxInputSize = 0;
+        format->findInt32("max-input-size", &maxInputSize);
+        state->mBufferPool = new SampleBufferPool(maxInputSize, kSampleBufferPoolSize);
+        state->mPrefetchPolicy =
+            new PrefetchPolicy(
+                    mPrefetchBytes[state->mType], mPrefetchDurationUs, kSampleQueueSize);
+        state->mSyncIndex = new SyncSampleIndex;
+        if (mPreparedFromIndex) {
+            // Every sync sample is known up front.
+            const sp<SampleIndexFile> &index =
+                static_cast<IndexedSampleSource *>(mExtractor.get())->index();
+            for (size_t n = 0; n < index->countSyncSamples(i); ++n) {
+                state->mSyncIndex->addSample(
+                        index->sampleAt(index->syncSampleAt(i, n)).mTimeUs, true /* isSync */);
+            }
+        }
+        state->mSeekTargetUs = -1ll;
+        state->mNumFramesSkipped = 0ll;
+        state->mDropPolicy.setThresholds(mDropNonReferenceLagUs, mDropToSyncLagUs);
+        state->mNumFramesSkippedNonReference = 0ll;
+        state->mNumFramesSkippedToSync = 0ll;
+
+        state->mFormat = format;
+        state->mCodecFromPool = false;
+        state->mCodecReadyTimeUs = -1ll;
+        state->mFirstOutputTimeUs = -1ll;
+        state->mFirstPresentTimeUs = -1ll;
+
+        size_t j = 0;
+        sp<ABuffer> buffer;
+        while (format->findBuffer(AStringPrintf("csd-%d", j).c_str(), &buffer)) {
+            state->mCSD.push_back(buffer);
+
+            ++j;
+        }
+        AString mime;
+        CHECK(format->findString("mime", &mime));
+        state->mMaxTemporalId = -1;
+        if (!strcasecmp(mime.c_str(), MEDIA_MIMETYPE_VIDEO_HEVC)) {
+            state->mMaxTemporalId = GetHEVCMaxTemporalId(state->mCSD);
+        }
+
+        sp<CodecStarter> starter =
+            new CodecStarter(mCodecLooper, format, mCodecPool, mPreferSoftwareCodecs);
+
+        if (mAsyncMode) {
+            sp<AMessage> notify = new AMessage(kWhatCodecNotify, this);
+            notify->setSize("trackIndex", i);
+            notify->setInt32("generation", mCodecGeneration);
+
+            starter->setCallback(notify);
+        } else {
+            starter->setCodecSpecificData(state->mCSD);
+        }
+
+        if (isVideo && mSurface != NULL && mFrameExport == NULL) {
+            sp<AMessage> notify = new AMessage(kWhatFrameRendered, this);
+            notify->setSize("trackIndex", i);
+            notify->setInt32("generation", mCodecGeneration);
+
+            starter->setSurface(mSurface);
+            starter->setOnFrameRenderedNotification(notify);
+        }
+
+        err = starter->start();
+        if (err != OK) {
+            abortPrepare(starters);
+            return err;
+        }
+        starters.add(i, starter);
+    }
+
+    // The decoders come up on threads of their own, the first samples are
+    // read in the meantime.
+    int64_t readStartTimeUs = ALooper::GetNowUs();
+
+    if (mUseDemuxThread) {
+        startDemuxer();
+    } else {
+        for (;;) {
+            bool started = true;
+            for (size_t i = 0; i < starters.size(); ++i) {
+                started &= starters.valueAt(i)->done();
+            }
+
+            if (started || mEncounteredInputEOS) {
+                break;
+            }
+
+            int64_t numSamplesQueued = numSamplesPrefetched();
+            readSamples();
+
+            if (numSamplesPrefetched() == numSamplesQueued) {
+                // The next sample is over the budget of its track.
+                break;
+            }
+        }
+    }
+
+    int64_t waitStartTimeUs = ALooper::GetNowUs();
+    mFirstSamplesUs = waitStartTimeUs - readStartTimeUs;
+
+    for (size_t i = 0; i < starters.size(); ++i) {
+        const sp<CodecStarter> &starter = starters.valueAt(i);
+        err = starter->wait();
+        if (err != OK) {
+            abortPrepare(starters);
+            return err;
+        }
+
+        CodecState *state = &mStateByTrackIndex.editValueFor(starters.keyAt(i));
+        state->mCodec = starter->codec();
+        state->mCodecFromPool = starter->fromPool();
+        state->mCodecReadyTimeUs = starter->doneTimeUs();
+        for (size_t phase = 0; phase < CodecStarter::NUM_PHASES; ++phase) {
+            state->mCodecPhaseUs[phase] =
+                starter->phaseUs(static_cast<CodecStarter::Phase>(phase));
+        }
+
+        if (mAsyncMode) {
+            // Input buffers only show up through CB_INPUT_AVAILABLE, so the
+            // codec specific data is queued ahead of the first sample instead.
+            for (size_t j = state->mCSD.size(); j-- > 0;) {
+                // The buffers are shared with the track format, the flag
+                // goes on a copy.
+                const sp<ABuffer> &src = state->mCSD.itemAt(j);
+                sp<ABuffer> csd = new ABuffer(src->size());
+                memcpy(csd->data(), src->data(), src->size());
+                csd->meta()->setInt32("csd", true);
+                state->mSampleData.insertAt(csd, 0);
+            }
+        } else {
+            state->mBuffers[0] = starter->inputBuffers();
+            state->mBuffers[1] = starter->outputBuffers();
+        }
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    mCodecWaitUs = nowUs - waitStartTimeUs;
+    mPrepareTimeUs = nowUs - mPrepareStartTimeUs;
+    ALOGV("prepared in %lld us", (long long)mPrepareTimeUs);
+
+    return OK;
+}
+
+void SimplePlayer::abortPrepare(const KeyedVector<size_t, sp<CodecStarter> > &starters) {
+    if (mDemuxer != NULL) {
+        mDemuxer->stop();
+        mDemuxer.clear();
+    }
+
+    // Every decoder that did come up is released, none of them is known
+    // to be in a state the pool could hand out again.
+    for (size_t i = 0; i < starters.size(); ++i) {
+        const sp<CodecStarter> &starter = starters.valueAt(i);
+        if (starter->wait() == OK) {
+            starter->codec()->release();
+        }
+    }
+
+    ++mCodecGeneration;
+    mStateByTrackIndex.clear();
+    mEndOfStream = 0;
+    mEncounteredInputEOS = false;
+    mExtractor.clear();
+}
+
+int64_t SimplePlayer::numSamplesPrefetched() const {
+    int64_t numSamples = 0ll;
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        numSamples += mStateByTrackIndex.valueAt(i).mPrefetchPolicy->queuedSamples();
+    }
+
+    return numSamples;
+}
+
+void SimplePlayer::startDemuxer() {
+    mDemuxer = new Demuxer(mExtractor, new AMessage(kWhatDemuxerNotify, this));
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+        if (state->mSampleQueue == NULL) {
+            state->mSampleQueue = new SampleQueue(kSampleQueueSize);
+        }
+        mDemuxer->addTrack(
+                mStateByTrackIndex.keyAt(i),
+                state->mSampleQueue,
+                state->mBufferPool,
+                state->mPrefetchPolicy,
+                state->mSyncIndex);
+    }
+
+    status_t err = mDemuxer->start();
+    CHECK_EQ(err, (status_t)OK);
+}
+
+status_t SimplePlayer::onStart() {
+    CHECK_EQ(mState, STOPPED);
+
+    mStartTimeRealUs = -1ll;
+    mStartMediaTimeUs = -1ll;
+    mStartLeadUs = mLowLatency ? 0ll : kStartLeadUs;
+    mPrerolling = false;
+
+    if (mStartRequestTimeUs < 0ll) {
+        mStartRequestTimeUs = ALooper::GetNowUs();
+        if (mHttpSource != NULL) {
+            mHttpStallsAtStart = mHttpSource->numStalls();
+        }
+    }
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+
+        // The output format showed up while prerolling.
+        if (state->mSampleRate > 0 && state->mAudioSink == NULL && !adoptAudioSink(state)) {
+            status_t err = openAudioSink(state);
+            if (err != OK) {
+                return err;
+            }
+        }
+    }
+
+    scheduleDoMoreStuff(0ll);
+
+    return OK;
+}
+
+status_t SimplePlayer::onStop() {
+    CHECK_EQ(mState, STARTED);
+
+    ++mDoMoreStuffGeneration;
+
+    dumpLatencyStats();
+
+    return OK;
+}
+
+status_t SimplePlayer::onReset() {
+    CHECK_EQ(mState, STOPPED);
+
+    if (mDemuxer != NULL) {
+        mDemuxer->stop();
+        mDemuxer.clear();
+    }
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+        state->mSampleData.clear();
+        if (state->mAudioSink != NULL) {
+            state->mAudioSink->close();
+        }
+        if (mCodecPool != NULL) {
+            AString mime;
+            CHECK(state->mFormat->findString("mime", &mime));
+            mCodecPool->release(state->mCodec, mime, state->mFormat);
+        } else {
+            CHECK_EQ(state->mCodec->release(), (status_t)OK);
+        }
+    }
+
+    if (mHandoffAudioSink != NULL) {
+        mHandoffAudioSink->close();
+        mHandoffAudioSink.clear();
+    }
+
+    mNextPlayer.clear();
+    mPrerolling = false;
+    mHandoffAudioFramesQueued = 0;
+    mHandoffEndTimeUs = -1ll;
+    mTransitionPending = false;
+    mTransitionGapUs = 0ll;
+
+    mStartTimeRealUs = -1ll;
+    mPreparedFromIndex = false;
+    mPrepareStartTimeUs = -1ll;
+    mSourceOpenUs = -1ll;
+    mFirstSamplesUs = -1ll;
+    mCodecWaitUs = -1ll;
+    mPrepareTimeUs = -1ll;
+    mStartRequestTimeUs = -1ll;
+    mCodecsFlushed = false;
+    mSeekStartTimeUs = -1ll;
+    mNumIndexedSeeks = 0ll;
+    for (size_t i = 0; i < NUM_SEEK_MODES; ++i) {
+        mSeekLatency[i].reset();
+    }
+    mEncounteredInputEOS = false;
+    mNumWakeups = 0ll;
+    mNumMemoryPressureEvents = 0ll;
+    mUnderMemoryPressure = false;
+    mClock->reset();
+    mNumAVOffsetSamples = 0ll;
+    mSumAVOffsetUs = 0ll;
+    mMaxAVOffsetUs = 0ll;
+    mAVOffsetReportTimeUs = -1ll;
+    mNumAVOffsetSamplesReported = 0ll;
+    mSumAVOffsetUsReported = 0ll;
+    ++mCodecGeneration;
+
+    mStateByTrackIndex.clear();
+    mCodecLooper.clear();
+    mExtractor.clear();
+    mSurface.clear();
+    mPath.clear();
+    mDataSource.clear();
+
+    if (mHttpSource != NULL) {
+        mHttpSource->close();
+        mHttpSource.clear();
+    }
+    mHttpStallsAtStart = 0ll;
+
+    return OK;
+}
+
+void SimplePlayer::handOffToNextPlayer(int64_t nowUs) {
+    sp<AMessage> msg = new AMessage(kWhatHandoff, mNextPlayer);
+    msg->setInt64("endTimeUs", nowUs + mClock->getAudioPendingUs(nowUs));
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+        if (state->mAudioSink == NULL) {
+            continue;
+        }
+
+        // What is still buffered plays out, the sink belongs to the next
+        // player from here on.
+        msg->setObject("audioSink", new AudioSinkHolder(state->mAudioSink));
+        msg->setInt32("audioFramesQueued", mHandoffAudioFramesQueued + state->mNumFramesWritten);
+        state->mAudioSink.clear();
+        break;
+    }
+
+    ALOGV("handing off to the next player");
+    msg->post();
+    mNextPlayer.clear();
+}
+
+void SimplePlayer::onHandoff(const sp<AMessage> &msg) {
+    int64_t nowUs = ALooper::GetNowUs();
+
+    sp<RefBase> obj;
+    if (msg->findObject("audioSink", &obj)) {
+        int32_t numFramesQueued;
+        CHECK(msg->findInt32("audioFramesQueued", &numFramesQueued));
+
+        mHandoffAudioSink = static_cast<AudioSinkHolder *>(obj.get())->mSink;
+        mHandoffAudioFramesQueued = numFramesQueued;
+        // Not an underrun if it runs dry before it is taken over, if ever.
+        mHandoffAudioSink->signalEndOfStream();
+    }
+
+    if (mState != STOPPED) {
+        ALOGW("not prepared, ignoring the handoff");
+        return;
+    }
+
+    CHECK(msg->findInt64("endTimeUs", &mHandoffEndTimeUs));
+
+    mTransitionType = VIDEO;
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        if (mStateByTrackIndex.valueAt(i).mType == AUDIO) {
+            mTransitionType = AUDIO;
+            break;
+        }
+    }
+    mTransitionPending = true;
+
+    status_t err = onStart();
+    if (err != OK) {
+        ALOGE("failed to start after the handoff (%d)", err);
+        mEndOfStream = 0;
+        return;
+    }
+
+    mState = STARTED;
+
+    // The first frame is due when the previous item ends.
+    mStartLeadUs = mHandoffEndTimeUs > nowUs ? mHandoffEndTimeUs - nowUs : 0ll;
+}
+
+bool SimplePlayer::adoptAudioSink(CodecState *state) {
+    const sp<AudioSink> &sink = mHandoffAudioSink;
+    if (sink == NULL
+            || sink->sampleRate() != (uint32_t)state->mSampleRate
+            || sink->format() != state->mAudioFormat
+            || sink->frameSize()
+                    != state->mChannelCount * audio_bytes_per_sample(state->mAudioFormat)) {
+        return false;
+    }
+
+    ALOGV("continuing in the previous player's AudioSink");
+
+    state->mAudioSink = sink;
+    state->mNumFramesWritten = 0;
+    mClock->setAudioTrack(sink->getAudioTrack(), mHandoffAudioFramesQueued);
+
+    mHandoffAudioSink.clear();
+
+    return true;
+}
+
+status_t SimplePlayer::openAudioSink(CodecState *state) {
+    if (state->mAudioSink != NULL) {
+        state->mAudioSink->close();
+    }
+
+    state->mAudioSink = new AudioSink;
+    status_t err = state->mAudioSink->open(
+            state->mSampleRate,
+            state->mChannelCount,
+            state->mAudioFormat,
+            mLowLatency ? kLowLatencyAudioSinkBufferDurationUs : kAudioSinkBufferDurationUs,
+            mLowLatency);
+    if (err != OK) {
+        state->mAudioSink.clear();
+        return err;
+    }
+
+    state->mNumFramesWritten = 0;
+    mHandoffAudioFramesQueued = 0;
+    mClock->setAudioTrack(state->mAudioSink->getAudioTrack());
+
+    return OK;
+}
+
+void SimplePlayer::onQueueToRender(CodecState *state, int64_t timeUs, int64_t latencyUs) {
+    // The frame interval comes from the timestamps, a frame that took less
+    // than that from queueInputBuffer to render was not delayed by a frame.
+    if (latencyUs >= 0ll && state->mLastRenderedTimeUs >= 0ll
+            && timeUs > state->mLastRenderedTimeUs) {
+        int64_t intervalUs =
+            (int64_t)((timeUs - state->mLastRenderedTimeUs) / (double)mPlaybackRate);
+
+        ++state->mNumFrameIntervals;
+        if (latencyUs < intervalUs) {
+            ++state->mNumFramesWithinInterval;
+        }
+
+        ALOGV("frame at %lld us rendered %lld us after queueing, interval %lld us",
+              (long long)timeUs, (long long)latencyUs, (long long)intervalUs);
+    }
+
+    state->mLastRenderedTimeUs = timeUs;
+}
+
+void SimplePlayer::onFramePresented(CodecState *state, int64_t presentTimeUs) {
+    if (state->mFirstPresentTimeUs < 0ll) {
+        state->mFirstPresentTimeUs = presentTimeUs;
+    }
+
+    if (!mTransitionPending || state->mType != mTransitionType) {
+        return;
+    }
+
+    mTransitionPending = false;
+    mTransitionGapUs = presentTimeUs - mHandoffEndTimeUs;
+
+    ALOGI("transition gap %lld us", (long long)mTransitionGapUs);
+}
+
+status_t SimplePlayer::onSeek(int64_t timeUs, SeekMode mode) {
+    int64_t seekStartTimeUs = ALooper::GetNowUs();
+
+    // Resolve the target on the video track if there is one, the other
+    // tracks follow the extractor.
+    size_t seekTrackIndex = mStateByTrackIndex.keyAt(0);
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        if (mStateByTrackIndex.valueAt(i).mType == VIDEO) {
+            seekTrackIndex = mStateByTrackIndex.keyAt(i);
+            break;
+        }
+    }
+    const sp<SyncSampleIndex> &syncIndex =
+        mStateByTrackIndex.valueFor(seekTrackIndex).mSyncIndex;
+
+    int64_t syncTimeUs = -1ll;
+    bool indexed;
+    if (mode == SEEK_CLOSEST_SYNC) {
+        int64_t previousTimeUs, nextTimeUs;
+        bool hasPrevious = syncIndex->findPrevious(timeUs, &previousTimeUs);
+        bool hasNext = syncIndex->findNext(timeUs, &nextTimeUs);
+
+        indexed = hasNext;
+        if (hasPrevious && hasNext) {
+            syncTimeUs = timeUs - previousTimeUs <= nextTimeUs - timeUs
+                ? previousTimeUs : nextTimeUs;
+        } else if (hasNext) {
+            syncTimeUs = nextTimeUs;
+        }
+    } else {
+        indexed = syncIndex->findPrevious(timeUs, &syncTimeUs);
+    }
+
+    if (mDemuxer != NULL) {
+        mDemuxer->stop();
+        mDemuxer.clear();
+    }
+
+    status_t err;
+    if (indexed) {
+        ++mNumIndexedSeeks;
+        err = mExtractor->seekTo(syncTimeUs, MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC);
+    } else {
+        err = mExtractor->seekTo(
+                timeUs,
+                mode == SEEK_CLOSEST_SYNC
+                    ? MediaSource::ReadOptions::SEEK_CLOSEST_SYNC
+                    : MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC);
+
+        if (err == OK && mExtractor->getSampleTime(&syncTimeUs) != OK) {
+            syncTimeUs = timeUs;
+        }
+    }
+
+    if (err != OK) {
+        ALOGE("seek to %lld us failed (%d)", (long long)timeUs, err);
+        if (mUseDemuxThread) {
+            startDemuxer();
+        }
+        return err;
+    }
+
+    ALOGV("seeking to %lld us, mode %d, from sync sample at %lld us%s",
+          (long long)timeUs, mode, (long long)syncTimeUs, indexed ? " (indexed)" : "");
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+
+        flushSamples(state);
+        state->mSyncIndex->onSeek(syncTimeUs);
+
+        CHECK_EQ(state->mCodec->flush(), (status_t)OK);
+        state->mAvailInputBufferIndices.clear();
+        state->mAvailOutputBufferInfos.clear();
+
+        if (state->mResampler != NULL) {
+            state->mResampler->flush();
+        }
+
+        if (state->mTimeStretcher != NULL) {
+            state->mTimeStretcher->flush();
+        }
+
+        if (state->mAudioSink != NULL) {
+            state->mAudioSink->flush();
+            state->mNumFramesWritten = 0;
+            mHandoffAudioFramesQueued = 0;
+            mClock->setAudioTrack(state->mAudioSink->getAudioTrack());
+        }
+
+        state->mTimeline.clearPending();
+        state->mPacing.onDiscontinuity();
+        state->mSeekTargetUs = mode == SEEK_FRAME_ACCURATE ? timeUs : -1ll;
+        state->mDropPolicy.reset();
+        state->mInputEOSQueued = false;
+
+        mEndOfStream |= 0x1 << state->mType;
+    }
+
+    if (mTransitionPending) {
+        mTransitionPending = false;
+        mHandoffEndTimeUs = -1ll;
+    }
+
+    mEncounteredInputEOS = false;
+    mStartTimeRealUs = -1ll;
+    mStartMediaTimeUs = mode == SEEK_FRAME_ACCURATE ? timeUs : -1ll;
+    mStartLeadUs = 0ll;
+
+    mSeekStartTimeUs = seekStartTimeUs;
+    mSeekMode = mode;
+    mSeekTrackIndex = seekTrackIndex;
+
+    if (mUseDemuxThread) {
+        startDemuxer();
+    }
+
+    if (mAsyncMode) {
+        // Callbacks the codecs posted before flush() returned are still
+        // queued on our looper, they are dropped until this comes around.
+        mCodecsFlushed = true;
+
+        sp<AMessage> msg = new AMessage(kWhatResumeCodecs, this);
+        msg->setInt32("generation", mCodecGeneration);
+        msg->post();
+    } else if (mState == STARTED) {
+        scheduleDoMoreStuff(0ll);
+    }
+
+    return OK;
+}
+
+status_t SimplePlayer::onSetPlaybackRate(float rate) {
+    if (!(rate >= kMinPlaybackRate && rate <= kMaxPlaybackRate)) {
+        return BAD_VALUE;
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    if (mStartTimeRealUs >= 0ll) {
+        // Audio due from here on follows the new rate.
+        mStartMediaTimeUs += (int64_t)((nowUs - mStartTimeRealUs) * (double)mPlaybackRate);
+        mStartTimeRealUs = nowUs;
+    }
+
+    mClock->setPlaybackRate(rate, nowUs);
+    mPlaybackRate = rate;
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+
+        if (state->mTimeStretcher != NULL) {
+            state->mTimeStretcher->setRate(rate);
+        }
+    }
+
+    if (mState == STARTED) {
+        scheduleDoMoreStuff(0ll);
+    }
+
+    return OK;
+}
+
+status_t SimplePlayer::onSetVolume(float volume) {
+    if (!(volume >= 0.0f && volume <= 1.0f)) {
+        return BAD_VALUE;
+    }
+
+    mVolume = volume;
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+
+        if (state->mPcmProcessor != NULL) {
+            state->mPcmProcessor->setVolume(
+                    volume, state->mSampleRate * kVolumeRampUs / 1000000ll);
+        }
+    }
+
+    return OK;
+}
+
+int64_t SimplePlayer::getScheduledRealTimeUs(int64_t mediaTimeUs) const {
+    return mStartTimeRealUs
+        + (int64_t)((mediaTimeUs - mStartMediaTimeUs) / (double)mPlaybackRate);
+}
+
+// Sub-layer non-reference pictures have even VCL NAL unit types up to
+// RSV_VCL_N14, but pictures of higher temporal sub-layers may still refer
+// to them. Only those in the highest sub-layer, as far as the SPS and the
+// stream so far tell, are dropped.
+static bool IsHEVCReferenceFrame(const sp<ABuffer> &accessUnit, int32_t *maxTemporalId) {
+    const uint8_t *data = accessUnit->data();
+    size_t size = accessUnit->size();
+
+    const uint8_t *nalStart;
+    size_t nalSize;
+    while (getNextNALUnit(&data, &size, &nalStart, &nalSize, true) == OK) {
+        if (nalSize < 2) {
+            continue;
+        }
+
+        unsigned nalType = (nalStart[0] >> 1) & 0x3f;
+        if (nalType == kHEVCNalTypeSPS) {
+            UpdateHEVCMaxTemporalId(nalStart, nalSize, maxTemporalId);
+        } else if (nalType < 32) {
+            int32_t temporalId = (nalStart[1] & 7) - 1;
+            if (temporalId > *maxTemporalId) {
+                *maxTemporalId = temporalId;
+            }
+            return nalType > 14 || (nalType & 1) || temporalId < *maxTemporalId;
+        }
+    }
+
+    return true;
+}
+
+bool SimplePlayer::shouldSkipSample(
+        CodecState *state, const sp<ABuffer> &sample, int64_t timeUs, bool isSync) {
+    FrameDropPolicy *policy = &state->mDropPolicy;
+
+    if (policy->level() == FrameDropPolicy::DROP_TO_SYNC) {
+        // A sync sample already due is no better than the frames before it.
+        int64_t nowUs = ALooper::GetNowUs();
+        if (!isSync || (mStartTimeRealUs >= 0ll && timeUs < mClock->getMediaTimeUs(nowUs))) {
+            ++state->mNumFramesSkippedToSync;
+            return true;
+        }
+
+        ALOGI("video skipped ahead to the sync sample at %lld us", (long long)timeUs);
+        policy->onSyncSampleQueued(timeUs, nowUs);
+        return false;
+    }
+
+    if (policy->level() != FrameDropPolicy::DROP_NON_REFERENCE) {
+        return false;
+    }
+
+    AString mime;
+    CHECK(state->mFormat->findString("mime", &mime));
+
+    bool isReference = true;
+    if (!strcasecmp(mime.c_str(), MEDIA_MIMETYPE_VIDEO_AVC)) {
+        isReference = IsAVCReferenceFrame(sample);
+    } else if (!strcasecmp(mime.c_str(), MEDIA_MIMETYPE_VIDEO_HEVC)) {
+        isReference = IsHEVCReferenceFrame(sample, &state->mMaxTemporalId);
+    }
+
+    if (!isReference) {
+        ++state->mNumFramesSkippedNonReference;
+    }
+
+    return !isReference;
+}
+
+void SimplePlayer::flushSamples(CodecState *state) {
+    Vector<sp<ABuffer> > csd;
+
+    sp<ABuffer> buffer;
+    while (dequeueSample(state, &buffer)) {
+        int32_t isCSD;
+        if (buffer->meta()->findInt32("csd", &isCSD) && isCSD) {
+            // Not queued yet, it still has to go first.
+            csd.push_back(buffer);
+        } else {
+            state->mBufferPool->release(buffer);
+        }
+    }
+
+    state->mSampleData = csd;
+}
+
+status_t SimplePlayer::onDoMoreStuff() {
+    ALOGV("onDoMoreStuff");
+
+    if (!mAsyncMode) {
+        for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+            dequeueBuffers(mStateByTrackIndex.keyAt(i), &mStateByTrackIndex.editValueAt(i));
+        }
+    }
+
+    readSamples();
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        queueInputBuffers(mStateByTrackIndex.keyAt(i), &mStateByTrackIndex.editValueAt(i));
+    }
+
+    return renderOutputBuffers();
+}
+
+void SimplePlayer::dequeueBuffers(size_t trackIndex, CodecState *state) {
+    TrackCpuScope cpu(&state->mClientCpuUs);
+
+    status_t err;
+    do {
+        size_t index;
+        err = state->mCodec->dequeueInputBuffer(&index);
+
+        if (err == OK) {
+            ALOGV("dequeued input buffer on track %zu,type %zu",
+                trackIndex, state->mType);
+
+            state->mAvailInputBufferIndices.push_back(index);
+        } else {
+            ALOGV("dequeueInputBuffer on track %zu,type %zu returned %d",
+                trackIndex, state->mType, err);
+        }
+    } while (err == OK);
+
+    do {
+        BufferInfo info;
+        err = state->mCodec->dequeueOutputBuffer(
+                &info.mIndex,
+                &info.mOffset,
+                &info.mSize,
+                &info.mPresentationTimeUs,
+                &info.mFlags);
+
+        if (err == OK) {
+            ALOGV("OK: dequeued output buffer on track %zu,type %zu",
+                trackIndex, state->mType);
+
+            onOutputBufferAvailable(state, info);
+        } else if (err == INFO_FORMAT_CHANGED) {
+            err = onOutputFormatChanged(trackIndex, state);
+            if (err != OK) {
+                ALOGE("cannot play the output of track %zu,type %zu: %d",
+                      trackIndex, state->mType, err);
+                mEndOfStream = 0;
+                break;
+            }
+        } else if (err == INFO_OUTPUT_BUFFERS_CHANGED) {
+            err = state->mCodec->getOutputBuffers(&state->mBuffers[1]);
+            CHECK_EQ(err, (status_t)OK);
+        } else {
+            ALOGV("ERROR: dequeueOutputBuffer on track %zu,type %zu returned %d",
+                trackIndex, state->mType, err);
+        }
+    } while (err == OK
+            || err == INFO_FORMAT_CHANGED
+            || err == INFO_OUTPUT_BUFFERS_CHANGED);
+}
+
+void SimplePlayer::readSamples() {
+    checkPrefetchMemory();
+
+    if (mDemuxer != NULL) {
+        // The extractor belongs to the demux thread, samples are picked up
+        // from the queues by queueInputBuffers().
+        if (mDemuxer->reachedEOS()) {
+            mEncounteredInputEOS = true;
+        }
+        return;
+    }
+
+    mReadProgress = false;
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        size_t trackIndex;
+        status_t err = mExtractor->getSampleTrackIndex(&trackIndex);
+
+        if (err != OK) {
+            mEncounteredInputEOS = true;
+            mReadProgress = true;
+            break;
+        }
+
+        CodecState *state = &mStateByTrackIndex.editValueFor(trackIndex);
+        TrackCpuScope cpu(&state->mClientCpuUs);
+
+        if (state->mSampleData.empty() && !state->mAvailInputBufferIndices.empty()
+                && readSampleIntoInputBuffer(trackIndex, state)) {
+            mExtractor->advance();
+            mReadProgress = true;
+            continue;
+        }
+
+        if (state->mPrefetchPolicy->canPrefetch()) {
+            bool isSync = state->mSyncIndex->addCurrentSample(mExtractor);
+
+            size_t sampleSize = 0;
+            CHECK_EQ(mExtractor->getSampleSize(&sampleSize), (status_t)OK);
+
+            sp<ABuffer> abuffer = state->mBufferPool->acquire(sampleSize);
+            CHECK_EQ(mExtractor->readSampleData(abuffer), (status_t)OK);
+            abuffer->meta()->setInt64("demuxTimeUs", ALooper::GetNowUs());
+
+            int64_t timeUs = 0;
+            CHECK_EQ(mExtractor->getSampleTime(&timeUs), (status_t)OK);
+            abuffer->meta()->setInt64("timeUs" , timeUs);
+            abuffer->meta()->setInt32("sync", isSync);
+
+            state->mPrefetchPolicy->onSampleQueued(abuffer->size(), timeUs);
+            state->mSampleData.push_back(abuffer);
+            ALOGV("push_back => track %zu,type %zu, sample data size=%d", trackIndex, state->mType, state->mSampleData.size());
+            mExtractor->advance();
+            mReadProgress = true;
+        }
+    }
+}
+
+void SimplePlayer::checkPrefetchMemory() {
+    int64_t totalBytes = 0ll;
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        totalBytes += mStateByTrackIndex.valueAt(i).mPrefetchPolicy->queuedBytes();
+    }
+
+    if (mUnderMemoryPressure) {
+        // The queues only drain as the codecs take samples, cutting again
+        // before they did would take every budget down to its minimum.
+        if (totalBytes < mPrefetchTotalBytes / 4 * 3) {
+            mUnderMemoryPressure = false;
+        }
+        return;
+    }
+
+    if (totalBytes <= mPrefetchTotalBytes) {
+        return;
+    }
+
+    mUnderMemoryPressure = true;
+
+    ALOGV("%lld bytes prefetched, shrinking budgets", (long long)totalBytes);
+    ++mNumMemoryPressureEvents;
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        mStateByTrackIndex.editValueAt(i).mPrefetchPolicy->onMemoryPressure();
+    }
+}
+
+bool SimplePlayer::readSampleIntoInputBuffer(size_t trackIndex, CodecState *state) {
+    size_t sampleSize = 0;
+    CHECK_EQ(mExtractor->getSampleSize(&sampleSize), (status_t)OK);
+
+    size_t index = *state->mAvailInputBufferIndices.begin();
+    sp<MediaCodecBuffer> dstBuffer = getInputBuffer(state, index);
+
+    if (sampleSize > dstBuffer->capacity()) {
+        return false;
+    }
+
+    state->mAvailInputBufferIndices.erase(
+            state->mAvailInputBufferIndices.begin());
+
+    bool isSync = state->mSyncIndex->addCurrentSample(mExtractor);
+
+    sp<ABuffer> abuffer =
+        state->mBufferPool->wrap(index, dstBuffer->base(), dstBuffer->capacity());
+    CHECK_EQ(mExtractor->readSampleData(abuffer), (status_t)OK);
+    int64_t demuxTimeUs = ALooper::GetNowUs();
+    state->mPrefetchPolicy->onSampleReadDirectly();
+
+    int64_t timeUs = 0;
+    CHECK_EQ(mExtractor->getSampleTime(&timeUs), (status_t)OK);
+
+    if (shouldSkipSample(state, abuffer, timeUs, isSync)) {
+        // Nothing queued, the input buffer is up for the next sample.
+        state->mAvailInputBufferIndices.push_front(index);
+        return true;
+    }
+
+    dstBuffer->setRange(0, abuffer->size());
+
+    status_t err = state->mCodec->queueInputBuffer(
+            index,
+            dstBuffer->offset(),
+            dstBuffer->size(),
+            timeUs,
+            0);
+    CHECK_EQ(err, (status_t)OK);
+
+    state->mNumBytesDirect += abuffer->size();
+    onInputBufferQueued(state, timeUs, demuxTimeUs);
+
+    ALOGV("read directly into input buffer on track %zu,type %zu,timeUs=%lld",
+          trackIndex, state->mType, (long long)timeUs);
+
+    return true;
+}
+
+void SimplePlayer::queueInputBuffers(size_t trackIndex, CodecState *state) {
+    TrackCpuScope cpu(&state->mClientCpuUs);
+
+    if (state->mAvailInputBufferIndices.empty()) {
+        ALOGV("available InputBuffer empty on track %zu,type %zu.", trackIndex, state->mType);
+        return;
+    }
+
+    status_t err;
+    if (!hasPendingSample(state)) {
+        if (!mEncounteredInputEOS) {
+            state->mPrefetchPolicy->onStarved();
+            if (mDemuxer != NULL) {
+                mDemuxer->signalSpaceAvailable();
+            }
+        } else if (!state->mInputEOSQueued) {
+            size_t index = *state->mAvailInputBufferIndices.begin();
+            state->mAvailInputBufferIndices.erase(
+                    state->mAvailInputBufferIndices.begin());
+            err = state->mCodec->queueInputBuffer(
                     index,
                     0,
-                    dstBuffer->size(),
-                    0ll,
-                    MediaCodec::BUFFER_FLAG_CODECCONFIG);
+                    0,
+                    0,
+                    MediaCodec::BUFFER_FLAG_EOS);
+            ALOGI("encountered input EOS on track %zu,type %zu %s.", trackIndex, state->mType, statusToString(err).c_str());
             CHECK_EQ(err, (status_t)OK);
+            state->mInputEOSQueued = true;
+        }
+        return;
+    }
+
+    do {
+        int64_t timeUs = 0;
+        int64_t demuxTimeUs = 0;
+        int32_t csd = false;
+        int32_t isSync = false;
+        sp<ABuffer> srcBuffer;
+        CHECK(dequeueSample(state, &srcBuffer));
+        srcBuffer->meta()->findInt32("csd", &csd);
+        srcBuffer->meta()->findInt64("timeUs", &timeUs);
+        srcBuffer->meta()->findInt32("sync", &isSync);
+
+        if (!csd && shouldSkipSample(state, srcBuffer, timeUs, isSync)) {
+            state->mBufferPool->release(srcBuffer);
+            continue;
+        }
+
+        size_t index = *state->mAvailInputBufferIndices.begin();
+        state->mAvailInputBufferIndices.erase(
+                state->mAvailInputBufferIndices.begin());
+
+        sp<MediaCodecBuffer> dstBuffer = getInputBuffer(state, index);
+        CHECK_LE(srcBuffer->size(), dstBuffer->capacity());
+        memcpy(dstBuffer->base(), srcBuffer->data(), srcBuffer->size());
+        dstBuffer->setRange(0, srcBuffer->size());
+        srcBuffer->meta()->findInt64("demuxTimeUs", &demuxTimeUs);
+        state->mNumBytesCopied += srcBuffer->size();
+
+        if (!csd) {
+            state->mBufferPool->release(srcBuffer);
+        }
+        ALOGV("erase => track %zu,type %zu, sample data size=%d", trackIndex, state->mType, state->mSampleData.size());
+
+        err = state->mCodec->queueInputBuffer(
+                index,
+                dstBuffer->offset(),
+                dstBuffer->size(),
+                timeUs,
+                csd ? MediaCodec::BUFFER_FLAG_CODECCONFIG : 0);
+        CHECK_EQ(err, (status_t)OK);
+
+        if (!csd) {
+            onInputBufferQueued(state, timeUs, demuxTimeUs);
+        }
+
+        ALOGV("enqueued input data on track %zu,type %zu,timeUs=%lld", trackIndex, state->mType, timeUs);
+    } while (hasPendingSample(state)
+            && !state->mAvailInputBufferIndices.empty());
+}
+
+void SimplePlayer::onInputBufferQueued(
+        CodecState *state, int64_t timeUs, int64_t demuxTimeUs) {
+    int64_t nowUs = ALooper::GetNowUs();
+
+    if (state->mFirstQueueTimeUs < 0ll) {
+        state->mFirstQueueTimeUs = nowUs;
+    }
+
+    state->mTimeline.onQueued(timeUs, demuxTimeUs, nowUs);
+}
+
+void SimplePlayer::onOutputBufferAvailable(CodecState *state, BufferInfo info) {
+    if (state->mPcmProcessor != NULL && info.mSize > 0) {
+        // Once, in place, however many writes the sink takes it in.
+        sp<MediaCodecBuffer> buffer = getOutputBuffer(state, info.mIndex);
+        info.mSize = state->mPcmProcessor->process(buffer->base() + info.mOffset, info.mSize);
+    }
+
+    state->mAvailOutputBufferInfos.push_back(info);
+
+    if (info.mFlags & MediaCodec::BUFFER_FLAG_EOS) {
+        return;
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    if (state->mFirstOutputTimeUs < 0ll) {
+        state->mFirstOutputTimeUs = nowUs;
+    }
+    state->mLastOutputTimeUs = nowUs;
+    ++state->mNumFramesDecoded;
+
+    state->mTimeline.onOutput(info.mPresentationTimeUs, nowUs);
+}
+
+bool SimplePlayer::hasPendingSample(const CodecState *state) const {
+    return !state->mSampleData.empty()
+            || (state->mSampleQueue != NULL && !state->mSampleQueue->empty());
+}
+
+bool SimplePlayer::dequeueSample(CodecState *state, sp<ABuffer> *buffer) {
+    if (!state->mSampleData.empty()) {
+        *buffer = *state->mSampleData.begin();
+        state->mSampleData.erase(state->mSampleData.begin());
+
+        int32_t csd;
+        if ((*buffer)->meta()->findInt32("csd", &csd) && csd) {
+            // Codec specific data never counted against the budget.
+            return true;
+        }
+    } else if (state->mSampleQueue == NULL || !state->mSampleQueue->pop(buffer)) {
+        return false;
+    }
+
+    state->mPrefetchPolicy->onSampleDequeued((*buffer)->size());
+
+    if (mDemuxer != NULL) {
+        mDemuxer->signalSpaceAvailable();
+    }
+
+    return true;
+}
+
+status_t SimplePlayer::renderOutputBuffers() {
+    if (mPrerolling) {
+        return OK;
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+        TrackCpuScope cpu(&state->mClientCpuUs);
+
+        while (!state->mAvailOutputBufferInfos.empty()) {
+            BufferInfo *info = &*state->mAvailOutputBufferInfos.begin();
+
+            if(info->mFlags & MediaCodec::BUFFER_FLAG_EOS) {
+                if (state->mAudioSink != NULL && info->mSize == 0
+                        && !drainStagedAudio(state)) {
+                    break;
+                }
+
+                mEndOfStream &= ~(0x1 << state->mType);
+                ALOGI("encountered output EOS on track %zu,type %zu, mEndOfStream %x.", i, state->mType, mEndOfStream);
+                if (state->mType == VIDEO && mTranscodeSink != NULL) {
+                    mTranscodeSink->signalEndOfInputStream();
+                }
+                if(!mEndOfStream) {
+                    if (mNextPlayer != NULL) {
+                        handOffToNextPlayer(nowUs);
+                    }
+                    return ERROR_END_OF_STREAM;
+                }
+
+                if (state->mAudioSink != NULL) {
+                    state->mAudioSink->signalEndOfStream();
+                    mClock->onAudioEOS(nowUs);
+                }
+            }
+
+            if (mBenchmark) {
+                if (state->mType == VIDEO && mFrameExport != NULL) {
+                    exportFrame(state, *info);
+                }
+                if (state->mType == VIDEO && mTranscodeSink != NULL
+                        && !(info->mFlags & MediaCodec::BUFFER_FLAG_EOS)) {
+                    state->mCodec->renderOutputBufferAndRelease(info->mIndex);
+                } else {
+                    state->mCodec->releaseOutputBuffer(info->mIndex);
+                }
+                state->mTimeline.onRendered(
+                        info->mPresentationTimeUs, nowUs, false /* dropped */);
+                state->mAvailOutputBufferInfos.erase(
+                        state->mAvailOutputBufferInfos.begin());
+                continue;
+            }
+
+            if (info->mPresentationTimeUs < state->mSeekTargetUs
+                    && !(info->mFlags & MediaCodec::BUFFER_FLAG_EOS)) {
+                state->mCodec->releaseOutputBuffer(info->mIndex);
+                state->mTimeline.onRendered(
+                        info->mPresentationTimeUs, nowUs, false /* dropped */);
+                ++state->mNumFramesSkipped;
+                state->mAvailOutputBufferInfos.erase(
+                        state->mAvailOutputBufferInfos.begin());
+                continue;
+            }
+
+            if (mStartTimeRealUs < 0ll) {
+                if (mStartMediaTimeUs < 0ll) {
+                    mStartMediaTimeUs = info->mPresentationTimeUs;
+                }
+                mStartTimeRealUs = nowUs + mStartLeadUs;
+                mClock->setAnchor(mStartMediaTimeUs, mStartTimeRealUs);
+            }
+
+            // Audio drives the clock rather than following it, so it is
+            // written as soon as it is due and never dropped for being late.
+            int64_t lateByUs;
+            if (state->mAudioSink != NULL) {
+                lateByUs = nowUs + getAudioWriteAheadUs(state, nowUs)
+                    - getScheduledRealTimeUs(info->mPresentationTimeUs);
+            } else {
+                // In system time, media time passes faster or slower than that.
+                lateByUs = (int64_t)((mClock->getMediaTimeUs(nowUs) - info->mPresentationTimeUs)
+                        / (double)mPlaybackRate);
+            }
+
+            // Timed video frames go out as soon as they are within the
+            // render-ahead window, SurfaceFlinger holds them until due.
+            int64_t renderWindowUs = 10000ll;
+            if (state->mType == VIDEO && mRenderAheadUs > 0ll) {
+                renderWindowUs = mRenderAheadUs;
+            }
+
+            // In low-latency mode video is neither held back nor dropped.
+            bool renderNow = mLowLatency && state->mType == VIDEO;
+
+            if (lateByUs > -renderWindowUs || renderNow) {
+                bool release = true;
+
+                if (state->mType == VIDEO && !renderNow) {
+                    state->mDropPolicy.onFrameReleased(
+                            info->mPresentationTimeUs, lateByUs, nowUs);
+                }
+
+                if (lateByUs > 50000ll && state->mAudioSink == NULL && !renderNow) {
+                    ALOGI("track %zu,type %zu, buffer late by %lld us, dropping.",
+                          mStateByTrackIndex.keyAt(i), state->mType, (long long)lateByUs);
+                    state->mCodec->releaseOutputBuffer(info->mIndex);
+                    state->mTimeline.onRendered(
+                            info->mPresentationTimeUs, nowUs, true /* dropped */);
+                    ++state->mNumFramesDropped;
+                } else {
+                    if (state->mAudioSink != NULL) {
+                        sp<MediaCodecBuffer> srcBuffer =
+                            getOutputBuffer(state, info->mIndex);
+
+                        renderAudio(state, info, srcBuffer);
+
+                        if (info->mSize > 0) {
+                            release = false;
+                        }
+                    }
+
+                    if (release) {
+                        if (mSeekStartTimeUs >= 0ll
+                                && mStateByTrackIndex.keyAt(i) == mSeekTrackIndex) {
+                            mSeekLatency[mSeekMode].record(nowUs - mSeekStartTimeUs);
+                            mSeekStartTimeUs = -1ll;
+                        }
+
+                        if(!firstFrameObserved && state->mType == VIDEO) {
+                            firstFrameObserved = true;
+                            sp<CodecEventListener> listener(mListener.promote());
+                            if (listener != nullptr) {
+                                listener->onFirstFrameAvailable();
+                            }
+                        }
+                        if (state->mType == VIDEO && mFrameExport != NULL) {
+                            exportFrame(state, *info);
+                            state->mCodec->releaseOutputBuffer(info->mIndex);
+                        } else if (state->mType == VIDEO && mRenderAheadUs > 0ll) {
+                            int64_t presentTimeUs = nowUs - lateByUs - mVsyncPeriodUs / 2;
+
+                            state->mCodec->renderOutputBufferAndRelease(
+                                    info->mIndex, presentTimeUs * 1000ll);
+                        } else {
+                            state->mCodec->renderOutputBufferAndRelease(
+                                    info->mIndex);
+                        }
+                        int64_t queueToRenderUs = state->mTimeline.onRendered(
+                                info->mPresentationTimeUs, ALooper::GetNowUs(),
+                                false /* dropped */);
+                        if (state->mType == VIDEO) {
+                            onQueueToRender(state, info->mPresentationTimeUs, queueToRenderUs);
+                        }
+                        onFramePresented(
+                                state,
+                                mRenderAheadUs > 0ll && lateByUs < 0ll ? nowUs - lateByUs : nowUs);
+
+                        ++state->mNumFramesRendered;
+                        if (state->mType == VIDEO) {
+                            int64_t jitterUs = lateByUs < 0ll ? -lateByUs : lateByUs;
+                            state->mSumRenderJitterUs += jitterUs;
+                            if (jitterUs > state->mMaxRenderJitterUs) {
+                                state->mMaxRenderJitterUs = jitterUs;
+                            }
+
+                            if (mClock->isAudioMaster()) {
+                                onAVOffset(lateByUs, nowUs);
+                            }
+                        }
+                    }
+                }
+
+                if (release) {
+                    state->mAvailOutputBufferInfos.erase(
+                            state->mAvailOutputBufferInfos.begin());
+
+                    info = NULL;
+                } else {
+                    break;
+                }
+            } else {
+                ALOGV("track %zu,type %zu, buffer early by %lld us.",
+                      mStateByTrackIndex.keyAt(i), state->mType, (long long)-lateByUs);
+                break;
+            }
+        }
+    }
+
+    return OK;
+}
+
+void SimplePlayer::onAVOffset(int64_t offsetUs, int64_t nowUs) {
+    int64_t absOffsetUs = offsetUs < 0ll ? -offsetUs : offsetUs;
+
+    ++mNumAVOffsetSamples;
+    mSumAVOffsetUs += offsetUs;
+    if (absOffsetUs > mMaxAVOffsetUs) {
+        mMaxAVOffsetUs = absOffsetUs;
+    }
+
+    if (mAVOffsetReportTimeUs < 0ll) {
+        mAVOffsetReportTimeUs = nowUs;
+    } else if (nowUs - mAVOffsetReportTimeUs >= 1000000ll) {
+        int64_t numSamples = mNumAVOffsetSamples - mNumAVOffsetSamplesReported;
+
+        ALOGI("A/V offset %lld us over the last %lld frames, audio clock drift %lld us",
+              (long long)((mSumAVOffsetUs - mSumAVOffsetUsReported) / numSamples),
+              (long long)numSamples,
+              (long long)mClock->getAudioDriftUs(nowUs));
+
+        mAVOffsetReportTimeUs = nowUs;
+        mNumAVOffsetSamplesReported = mNumAVOffsetSamples;
+        mSumAVOffsetUsReported = mSumAVOffsetUs;
+    }
+}
+
+sp<MediaCodecBuffer> SimplePlayer::getInputBuffer(CodecState *state, size_t index) {
+    if (!mAsyncMode) {
+        return state->mBuffers[0].itemAt(index);
+    }
+
+    sp<MediaCodecBuffer> buffer;
+    CHECK_EQ(state->mCodec->getInputBuffer(index, &buffer), (status_t)OK);
+    return buffer;
+}
+
+sp<MediaCodecBuffer> SimplePlayer::getOutputBuffer(CodecState *state, size_t index) {
+    if (!mAsyncMode) {
+        return state->mBuffers[1].itemAt(index);
+    }
+
+    sp<MediaCodecBuffer> buffer;
+    CHECK_EQ(state->mCodec->getOutputBuffer(index, &buffer), (status_t)OK);
+    return buffer;
+}
+
+// The one copy a frame takes, out of the codec's buffer into the ring.
+void SimplePlayer::exportFrame(CodecState *state, const BufferInfo &info) {
+    if (info.mSize == 0) {
+        return;
+    }
+
+    sp<MediaCodecBuffer> buffer = getOutputBuffer(state, info.mIndex);
+
+    uint64_t index;
+    if (!state->mCanExport
+            || mFrameExport->publish(
+                    buffer->base() + info.mOffset,
+                    info.mSize,
+                    info.mPresentationTimeUs,
+                    state->mExportInfo,
+                    &index) != OK) {
+        ++state->mNumFramesNotExported;
+        return;
+    }
+
+    ++state->mNumFramesExported;
+
+    sp<CodecEventListener> listener(mListener.promote());
+    if (listener != nullptr) {
+        listener->onFrameExported(index, info.mPresentationTimeUs);
+    }
+}
+
+void SimplePlayer::scheduleDoMoreStuff(int64_t delayUs) {
+    sp<AMessage> msg = new AMessage(kWhatDoMoreStuff, this);
+    msg->setInt32("generation", ++mDoMoreStuffGeneration);
+    msg->post(delayUs);
+}
+
+void SimplePlayer::postDoMoreStuffIfNeeded() {
+    // In async mode the codec callbacks wake us up whenever a buffer changes
+    // hands, so a timed wakeup is only needed for work that is waiting on the
+    // clock: reading more samples, an early output buffer or a full audio ring.
+    int64_t nowUs = ALooper::GetNowUs();
+    int64_t delayUs = -1ll;
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+        int64_t trackDelayUs = -1ll;
+
+        // Reading again right away only helps if the last pass got
+        // somewhere, a full budget on the other track frees up with a codec
+        // callback.
+        if (!state->mAvailInputBufferIndices.empty()
+                && (hasPendingSample(state)
+                    || (mDemuxer == NULL && !mEncounteredInputEOS && mReadProgress))) {
+            trackDelayUs = 0ll;
+        } else if (!state->mAvailOutputBufferInfos.empty() && !mPrerolling) {
+            const BufferInfo &info = *state->mAvailOutputBufferInfos.begin();
+            if (mBenchmark || (mLowLatency && state->mType == VIDEO)) {
+                trackDelayUs = 0ll;
+            } else if (mStartTimeRealUs < 0ll) {
+                trackDelayUs = 0ll;
+            } else if (state->mAudioSink != NULL) {
+                trackDelayUs = getScheduledRealTimeUs(info.mPresentationTimeUs)
+                        - getAudioWriteAheadUs(state, nowUs) - 10000ll - nowUs;
+            } else {
+                trackDelayUs = mClock->getRealTimeUs(info.mPresentationTimeUs, nowUs)
+                        - (mRenderAheadUs > 0ll ? mRenderAheadUs : 10000ll) - nowUs;
+            }
+
+            if (trackDelayUs <= 0ll && state->mAudioSink != NULL) {
+                // Due but the ring is full, come back once the rest of the
+                // buffer or half of the ring fits, whichever is less.
+                const sp<AudioSink> &sink = state->mAudioSink;
+                size_t numBytesWanted =
+                    info.mSize > 0 ? info.mSize : sink->capacityBytes() / 2;
+                if (numBytesWanted > sink->capacityBytes() / 2) {
+                    numBytesWanted = sink->capacityBytes() / 2;
+                }
+
+                size_t numBytesAvailable = sink->availableBytes();
+                trackDelayUs = numBytesWanted > numBytesAvailable
+                    ? sink->bytesToDurationUs(numBytesWanted - numBytesAvailable) : 0ll;
+                if (trackDelayUs < 1000ll) {
+                    trackDelayUs = 1000ll;
+                }
+            }
+
+            if (trackDelayUs < 0ll) {
+                trackDelayUs = 0ll;
+            }
+        }
+
+        if (trackDelayUs >= 0ll && (delayUs < 0ll || trackDelayUs < delayUs)) {
+            delayUs = trackDelayUs;
         }
     }
 
-    return OK;
-}
+    if (delayUs >= 0ll) {
+        scheduleDoMoreStuff(delayUs);
+    }
+}
+
+status_t SimplePlayer::onSetParameters(const sp<AMessage> &params) {
+    int32_t asyncMode;
+    if (params->findInt32("async-mode", &asyncMode)) {
+        mAsyncMode = asyncMode != 0;
+    }
+
+    int32_t demuxThread;
+    if (params->findInt32("demux-thread", &demuxThread)) {
+        mUseDemuxThread = demuxThread != 0;
+    }
+
+    int32_t benchmark;
+    if (params->findInt32("benchmark", &benchmark)) {
+        mBenchmark = benchmark != 0;
+    }
+
+    int32_t preferSoftwareCodecs;
+    if (params->findInt32("prefer-software-codecs", &preferSoftwareCodecs)) {
+        mPreferSoftwareCodecs = preferSoftwareCodecs != 0;
+    }
+
+    sp<RefBase> obj;
+    if (params->findObject("codec-pool", &obj)) {
+        mCodecPool = static_cast<CodecPool *>(obj.get());
+    }
+
+    if (params->findObject("frame-export-ring", &obj)) {
+        mFrameExport = static_cast<FrameExportRing *>(obj.get());
+    }
+
+    if (params->findObject("transcode-sink", &obj)) {
+        mTranscodeSink = static_cast<TranscodeSink *>(obj.get());
+        mBenchmark = true;
+    }
+
+    int32_t sampleIndex;
+    if (params->findInt32("sample-index", &sampleIndex)) {
+        mUseSampleIndex = sampleIndex != 0;
+    }
 
-status_t SimplePlayer::onStart() {
-    CHECK_EQ(mState, STOPPED);
+    params->findInt64("render-ahead-us", &mRenderAheadUs);
+    params->findInt64("vsync-period-us", &mVsyncPeriodUs);
 
-    mStartTimeRealUs = -1ll;
+    params->findInt64("video-prefetch-bytes", &mPrefetchBytes[VIDEO]);
+    params->findInt64("audio-prefetch-bytes", &mPrefetchBytes[AUDIO]);
+    params->findInt64("prefetch-duration-us", &mPrefetchDurationUs);
+    params->findInt64("prefetch-total-bytes", &mPrefetchTotalBytes);
 
-    sp<AMessage> msg = new AMessage(kWhatDoMoreStuff, this);
-    msg->setInt32("generation", ++mDoMoreStuffGeneration);
-    msg->post();
+    int32_t audioPcm24Bit;
+    if (params->findInt32("audio-pcm-24-bit", &audioPcm24Bit)) {
+        mAudioPcm24Bit = audioPcm24Bit != 0;
+    }
 
-    return OK;
-}
+    int32_t lowLatency;
+    if (params->findInt32("low-latency", &lowLatency)) {
+        mLowLatency = lowLatency != 0;
+    }
 
-status_t SimplePlayer::onStop() {
-    CHECK_EQ(mState, STARTED);
+    if (mLowLatency) {
+        // Frames go out once decoded, and codec callbacks instead of a 5 ms
+        // poll pick them up.
+        mAsyncMode = true;
+        mRenderAheadUs = 0ll;
+    }
 
-    ++mDoMoreStuffGeneration;
+    int32_t resamplerQuality;
+    if (params->findInt32("audio-resampler-quality", &resamplerQuality)) {
+        if (resamplerQuality >= Resampler::NUM_QUALITIES) {
+            return BAD_VALUE;
+        }
+        mResamplerQuality = resamplerQuality;
+    }
+
+    params->findInt64("drop-non-ref-lag-us", &mDropNonReferenceLagUs);
+    params->findInt64("drop-to-sync-lag-us", &mDropToSyncLagUs);
+
+    params->findInt64("http-cache-bytes", &mHttpCacheBytes);
+    params->findInt64("http-read-ahead-bytes", &mHttpReadAheadBytes);
+    params->findInt32("http-connections", &mHttpConnections);
+    params->findString("http-cache-file", &mHttpCacheFile);
+
+    float volume;
+    if (params->findFloat("volume", &volume)) {
+        status_t err = onSetVolume(volume);
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    float playbackRate;
+    if (params->findFloat("playback-rate", &playbackRate)) {
+        return onSetPlaybackRate(playbackRate);
+    }
 
     return OK;
 }
 
-status_t SimplePlayer::onReset() {
-    CHECK_EQ(mState, STOPPED);
+sp<AMessage> SimplePlayer::onGetLatencyStats() const {
+    sp<AMessage> stats = new AMessage;
 
     for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
-        CodecState *state = &mStateByTrackIndex.editValueAt(i);
-        state->mSampleData.clear();
-        CHECK_EQ(state->mCodec->release(), (status_t)OK);
-    }
+        const CodecState &state = mStateByTrackIndex.valueAt(i);
+
+        sp<AMessage> trackStats = new AMessage;
+        trackStats->setString("type", state.mType == VIDEO ? "video" : "audio");
+        state.mTimeline.writeToMessage(trackStats);
+
+        const LatencyHistogram &outputLatency = state.mAudioOutputLatency;
+        if (outputLatency.count() > 0) {
+            trackStats->setInt64("audio-output-count", outputLatency.count());
+            trackStats->setInt64("audio-output-p50-us", outputLatency.percentileUs(50));
+            trackStats->setInt64("audio-output-p90-us", outputLatency.percentileUs(90));
+            trackStats->setInt64("audio-output-p99-us", outputLatency.percentileUs(99));
+            trackStats->setInt64("audio-output-max-us", outputLatency.maxUs());
+        }
 
-    mStartTimeRealUs = -1ll;
+        if (state.mNumFrameIntervals > 0ll) {
+            trackStats->setInt64("frame-intervals", state.mNumFrameIntervals);
+            trackStats->setInt64("frames-within-interval", state.mNumFramesWithinInterval);
+        }
 
-    mStateByTrackIndex.clear();
-    mCodecLooper.clear();
-    mExtractor.clear();
-    mSurface.clear();
-    mPath.clear();
+        stats->setMessage(
+                AStringPrintf("track-%zu", mStateByTrackIndex.keyAt(i)).c_str(),
+                trackStats);
+    }
 
-    return OK;
+    return stats;
 }
 
-status_t SimplePlayer::onDoMoreStuff() {
-    ALOGV("onDoMoreStuff");
-
+void SimplePlayer::dumpLatencyStats() const {
     for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
-        size_t trackIndex;
-        status_t err = mExtractor->getSampleTrackIndex(&trackIndex);
-        CodecState *state = &mStateByTrackIndex.editValueFor(trackIndex);
+        const CodecState &state = mStateByTrackIndex.valueAt(i);
 
-        if(state->mSampleData.size() <= 10) {
-            if(err == OK) {
-                size_t sampleSize = 0;
-                CHECK_EQ(mExtractor->getSampleSize(&sampleSize), (status_t)OK);
+        AString dump;
+        state.mTimeline.dump(&dump);
 
-                sp<ABuffer> abuffer = new ABuffer(sampleSize);
-                CHECK_EQ(mExtractor->readSampleData(abuffer), (status_t)OK);
+        ALOGI("latency on track %zu,type %zu:\n%s",
+              mStateByTrackIndex.keyAt(i), state.mType, dump.c_str());
+    }
+}
 
-                int64_t timeUs = 0;
-                CHECK_EQ(mExtractor->getSampleTime(&timeUs), (status_t)OK);
-                abuffer->meta()->setInt64("timeUs" , timeUs);
+sp<AMessage> SimplePlayer::onGetStartupStats() const {
+    sp<AMessage> stats = new AMessage;
+    if (mPrepareStartTimeUs < 0ll) {
+        return stats;
+    }
 
-                state->mSampleData.push_back(abuffer);
-                ALOGV("push_back => track %zu,type %zu, sample data size=%d", trackIndex, state->mType, state->mSampleData.size());
-                mExtractor->advance();
-            } else {
-                mEncounteredInputEOS = true;
-            }
-        }
+    // Points in time are relative to the start of prepare().
+    stats->setInt64("source-open-us", mSourceOpenUs);
+    stats->setInt64("first-samples-us", mFirstSamplesUs);
+    stats->setInt64("codec-wait-us", mCodecWaitUs);
+    stats->setInt64("prepare-us", mPrepareTimeUs);
+    if (mStartRequestTimeUs >= 0ll) {
+        stats->setInt64("start-at-us", mStartRequestTimeUs - mPrepareStartTimeUs);
     }
 
     for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
-        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+        const CodecState &state = mStateByTrackIndex.valueAt(i);
+
+        sp<AMessage> trackStats = new AMessage;
+        trackStats->setString("type", state.mType == VIDEO ? "video" : "audio");
+        trackStats->setInt32("codec-from-pool", state.mCodecFromPool);
+        for (size_t phase = 0; phase < CodecStarter::NUM_PHASES; ++phase) {
+            trackStats->setInt64(
+                    AStringPrintf(
+                        "codec-%s-us",
+                        CodecStarter::PhaseName(static_cast<CodecStarter::Phase>(phase))).c_str(),
+                    state.mCodecPhaseUs[phase]);
+        }
 
-        status_t err;
-        do {
-            size_t index;
-            err = state->mCodec->dequeueInputBuffer(&index);
+        const struct {
+            const char *mName;
+            int64_t mTimeUs;
+        } kEvents[] = {
+            { "codec-ready-at-us", state.mCodecReadyTimeUs },
+            { "first-input-at-us", state.mFirstQueueTimeUs },
+            { "first-output-at-us", state.mFirstOutputTimeUs },
+            { "first-present-at-us", state.mFirstPresentTimeUs },
+        };
+
+        for (size_t j = 0; j < sizeof(kEvents) / sizeof(kEvents[0]); ++j) {
+            if (kEvents[j].mTimeUs >= 0ll) {
+                trackStats->setInt64(kEvents[j].mName, kEvents[j].mTimeUs - mPrepareStartTimeUs);
+            }
+        }
 
-            if (err == OK) {
-                ALOGV("dequeued input buffer on track %zu,type %zu",
-                    mStateByTrackIndex.keyAt(i), state->mType);
+        if (state.mFirstPresentTimeUs >= 0ll) {
+            stats->setInt64(
+                    state.mType == VIDEO ? "time-to-first-frame-us" : "time-to-first-audio-us",
+                    state.mFirstPresentTimeUs - mPrepareStartTimeUs);
+        }
 
-                state->mAvailInputBufferIndices.push_back(index);
-            } else {
-                ALOGV("dequeueInputBuffer on track %zu,type %zu returned %d",
-                    mStateByTrackIndex.keyAt(i), state->mType, err);
-            }
-        } while (err == OK);
+        stats->setMessage(
+                AStringPrintf("track-%zu", mStateByTrackIndex.keyAt(i)).c_str(), trackStats);
+    }
 
-        do {
-            BufferInfo info;
-            err = state->mCodec->dequeueOutputBuffer(
-                    &info.mIndex,
-                    &info.mOffset,
-                    &info.mSize,
-                    &info.mPresentationTimeUs,
-                    &info.mFlags);
+    return stats;
+}
 
-            if (err == OK) {
-                ALOGV("OK: dequeued output buffer on track %zu,type %zu",
-                    mStateByTrackIndex.keyAt(i), state->mType);
-
-                state->mAvailOutputBufferInfos.push_back(info);
-            } else if (err == INFO_FORMAT_CHANGED) {
-                err = onOutputFormatChanged(mStateByTrackIndex.keyAt(i), state);
-                CHECK_EQ(err, (status_t)OK);
-            } else if (err == INFO_OUTPUT_BUFFERS_CHANGED) {
-                err = state->mCodec->getOutputBuffers(&state->mBuffers[1]);
-                CHECK_EQ(err, (status_t)OK);
-            } else {
-                ALOGV("ERROR: dequeueOutputBuffer on track %zu,type %zu returned %d",
-                    mStateByTrackIndex.keyAt(i), state->mType, err);
-            }
-        } while (err == OK
-                || err == INFO_FORMAT_CHANGED
-                || err == INFO_OUTPUT_BUFFERS_CHANGED);
+sp<AMessage> SimplePlayer::onGetStats() const {
+    sp<AMessage> stats = new AMessage;
+    stats->setInt32("async-mode", mAsyncMode);
+    stats->setInt64("wakeups", mNumWakeups);
+    stats->setInt32("demux-thread", mDemuxer != NULL);
+    stats->setInt64("prefetch-memory-pressure", mNumMemoryPressureEvents);
+    stats->setInt64("prepare-time-us", mPrepareTimeUs);
+    stats->setInt32("prepare-from-sample-index", mPreparedFromIndex);
+    stats->setFloat("playback-rate", mPlaybackRate);
+    if (mCodecPool != NULL) {
+        stats->setInt64("codec-pool-hits", mCodecPool->numHits());
+        stats->setInt64("codec-pool-misses", mCodecPool->numMisses());
+        stats->setInt64("codec-pool-evictions", mCodecPool->numEvictions());
+        stats->setInt64("codec-pool-size", mCodecPool->size());
+    }
+    if (mFrameExport != NULL) {
+        stats->setInt64("frame-export-published", mFrameExport->numPublished());
+        stats->setInt64("frame-export-bytes-copied", mFrameExport->numBytesCopied());
+    }
+    if (mTranscodeSink != NULL) {
+        stats->setInt64("transcode-frames-encoded", mTranscodeSink->numFramesEncoded());
+        stats->setInt64("transcode-bytes-written", mTranscodeSink->numBytesWritten());
+    }
+    if (mHttpSource != NULL) {
+        int64_t numStalls = mHttpSource->numStalls();
+        stats->setInt64(
+                "http-rebuffers",
+                mStartRequestTimeUs >= 0ll ? numStalls - mHttpStallsAtStart : 0ll);
+        stats->setInt64("http-stalls", numStalls);
+        stats->setInt64("http-stall-us", mHttpSource->stallTimeUs());
+        stats->setInt64("http-connect-us", mHttpSource->connectTimeUs());
+        stats->setInt64("http-requests", mHttpSource->numRequests());
+        stats->setInt64("http-bytes-fetched", mHttpSource->numBytesFetched());
+        stats->setInt64("http-cache-evictions", mHttpSource->numEvictions());
+        stats->setInt64("http-cache-file-reads", mHttpSource->numDiskReads());
+    }
+    if (mHandoffEndTimeUs >= 0ll && !mTransitionPending) {
+        stats->setInt64("transition-gap-us", mTransitionGapUs);
+    }
+
+    static const char *kSeekModeNames[NUM_SEEK_MODES] = {
+        "previous-sync", "closest-sync", "frame-accurate",
+    };
 
-        if (state->mAvailInputBufferIndices.empty()) {
-            ALOGI("available InputBuffer empty on track %zu,type %zu.", i, state->mType);
+    stats->setInt64("seeks-indexed", mNumIndexedSeeks);
+    for (size_t i = 0; i < NUM_SEEK_MODES; ++i) {
+        const LatencyHistogram &latency = mSeekLatency[i];
+        if (latency.count() == 0) {
             continue;
         }
 
-        if (state->mSampleData.empty()) {
-            if(mEncounteredInputEOS) {
-                size_t index = *state->mAvailInputBufferIndices.begin();
-                state->mAvailInputBufferIndices.erase(
-                        state->mAvailInputBufferIndices.begin());
-                err = state->mCodec->queueInputBuffer(
-                        index,
-                        0,
-                        0,
-                        0,
-                        MediaCodec::BUFFER_FLAG_EOS);
-                ALOGI("encountered input EOS on track %zu,type %zu %s.", i, state->mType, statusToString(err).c_str());
-                CHECK_EQ(err, (status_t)OK);
+        // Request to first frame shown.
+        const char *name = kSeekModeNames[i];
+        stats->setInt64(AStringPrintf("seek-%s-count", name).c_str(), latency.count());
+        stats->setInt64(AStringPrintf("seek-%s-avg-us", name).c_str(), latency.meanUs());
+        stats->setInt64(AStringPrintf("seek-%s-p50-us", name).c_str(), latency.percentileUs(50));
+        stats->setInt64(AStringPrintf("seek-%s-max-us", name).c_str(), latency.maxUs());
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    stats->setString("clock-source", mClock->isAudioMaster() ? "audio" : "system");
+    stats->setInt64("audio-clock-drift-us", mClock->getAudioDriftUs(nowUs));
+    if (mNumAVOffsetSamples > 0) {
+        stats->setInt64("av-offset-avg-us", mSumAVOffsetUs / mNumAVOffsetSamples);
+        stats->setInt64("av-offset-max-us", mMaxAVOffsetUs);
+    }
+
+    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
+        const CodecState &state = mStateByTrackIndex.valueAt(i);
+
+        sp<AMessage> trackStats = new AMessage;
+        trackStats->setString("type", state.mType == VIDEO ? "video" : "audio");
+        trackStats->setInt64("bytes-copied", state.mNumBytesCopied);
+        trackStats->setInt64("bytes-direct", state.mNumBytesDirect);
+        trackStats->setInt64("pool-hits", state.mBufferPool->numHits());
+        trackStats->setInt64("pool-misses", state.mBufferPool->numMisses());
+        trackStats->setInt64("pool-wrap-hits", state.mBufferPool->numWrapHits());
+        trackStats->setInt64("pool-wrap-misses", state.mBufferPool->numWrapMisses());
+        trackStats->setInt64("prefetch-bytes", state.mPrefetchPolicy->queuedBytes());
+        trackStats->setInt64("prefetch-us", state.mPrefetchPolicy->queuedDurationUs());
+        trackStats->setInt64("prefetch-samples", state.mPrefetchPolicy->queuedSamples());
+        trackStats->setInt64("prefetch-budget-bytes", state.mPrefetchPolicy->maxBytes());
+        trackStats->setInt64("prefetch-budget-us", state.mPrefetchPolicy->maxDurationUs());
+        trackStats->setInt64("prefetch-underruns", state.mPrefetchPolicy->numUnderruns());
+        trackStats->setInt64("frames-rendered", state.mNumFramesRendered);
+        trackStats->setInt64("frames-dropped", state.mNumFramesDropped);
+
+        trackStats->setInt32("codec-from-pool", state.mCodecFromPool);
+        int64_t codecSetupUs = 0ll;
+        for (size_t phase = 0; phase < CodecStarter::NUM_PHASES; ++phase) {
+            codecSetupUs += state.mCodecPhaseUs[phase];
+        }
+        trackStats->setInt64("codec-setup-us", codecSetupUs);
+        trackStats->setInt64("frames-decoded", state.mNumFramesDecoded);
+        trackStats->setInt64("client-cpu-us", state.mClientCpuUs);
+        AString codecName;
+        if (state.mCodec != NULL && state.mCodec->getName(&codecName) == OK) {
+            trackStats->setString("codec-name", codecName);
+        }
+        if (state.mType == VIDEO && mFrameExport != NULL) {
+            trackStats->setInt64("frames-exported", state.mNumFramesExported);
+            trackStats->setInt64("frames-not-exported", state.mNumFramesNotExported);
+        }
+        trackStats->setInt64("frames-skipped-seek", state.mNumFramesSkipped);
+        if (state.mType == VIDEO) {
+            const FrameDropPolicy &policy = state.mDropPolicy;
+            trackStats->setInt64(
+                    "frames-dropped-before-decode",
+                    state.mNumFramesSkippedNonReference + state.mNumFramesSkippedToSync);
+            trackStats->setInt64(
+                    "frames-skipped-non-ref", state.mNumFramesSkippedNonReference);
+            trackStats->setInt64("frames-skipped-to-sync", state.mNumFramesSkippedToSync);
+            trackStats->setInt64("sync-skips", policy.numSyncSkips());
+            trackStats->setString("drop-level", FrameDropPolicy::LevelName(policy.level()));
+            trackStats->setInt64("decode-lag-us", policy.lagUs());
+            trackStats->setInt64("decode-lag-max-us", policy.maxLagUs());
+        }
+        if (state.mTimeStretcher != NULL) {
+            int64_t numFrames = state.mTimeStretcher->numFramesProduced();
+            trackStats->setInt64("time-stretch-cpu-us", state.mTimeStretcher->processTimeUs());
+            if (numFrames > 0) {
+                // Per second of audio played.
+                trackStats->setInt64(
+                        "time-stretch-cpu-us-per-s",
+                        state.mTimeStretcher->processTimeUs() * state.mSampleRate / numFrames);
             }
-            continue;
         }
+        if (state.mResampler != NULL) {
+            const sp<Resampler> &resampler = state.mResampler;
+            int64_t numFrames = resampler->numFramesProduced();
+            trackStats->setString(
+                    "resampler-quality",
+                    Resampler::QualityName(static_cast<Resampler::Quality>(mResamplerQuality)));
+            trackStats->setInt32("resampler-input-rate", resampler->inputRate());
+            trackStats->setInt32("resampler-output-rate", resampler->outputRate());
+            trackStats->setInt64("resampler-delay-us", resampler->delayUs());
+            trackStats->setInt64("resample-cpu-us", resampler->processTimeUs());
+            if (numFrames > 0) {
+                trackStats->setInt64(
+                        "resample-cpu-us-per-s",
+                        resampler->processTimeUs() * state.mSampleRate / numFrames);
+            }
+        }
+        if (state.mAudioSink != NULL && state.mAudioSink->getAudioTrack() != NULL) {
+            trackStats->setInt32("audio-sink-rate", state.mAudioSink->sampleRate());
+            trackStats->setInt64(
+                    "audio-track-latency-us",
+                    state.mAudioSink->getAudioTrack()->latency() * 1000ll);
+        }
+        if (state.mPcmProcessor != NULL) {
+            const sp<PcmProcessor> &processor = state.mPcmProcessor;
+            int64_t numFrames = processor->numFramesProcessed();
+            trackStats->setInt32(
+                    "pcm-float-decode", processor->inputEncoding() == kAudioEncodingPcmFloat);
+            trackStats->setInt32("pcm-output-bits", audio_bytes_per_sample(state.mAudioFormat) * 8);
+            trackStats->setFloat("volume", processor->volume());
+            trackStats->setInt64("pcm-process-cpu-us", processor->processTimeUs());
+            if (numFrames > 0) {
+                int32_t sampleRate = state.mResampler != NULL
+                    ? state.mResampler->inputRate() : state.mSampleRate;
+                trackStats->setInt64(
+                        "pcm-process-cpu-us-per-s",
+                        processor->processTimeUs() * sampleRate / numFrames);
+            }
+        }
+        trackStats->setInt64("sync-samples-indexed", state.mSyncIndex->size());
 
-        do {
-            size_t index = *state->mAvailInputBufferIndices.begin();
-            state->mAvailInputBufferIndices.erase(
-                    state->mAvailInputBufferIndices.begin());
+        if (state.mFirstQueueTimeUs >= 0ll && state.mLastOutputTimeUs >= 0ll) {
+            trackStats->setInt64(
+                    "decode-time-us", state.mLastOutputTimeUs - state.mFirstQueueTimeUs);
+        }
 
-            const sp<MediaCodecBuffer> &dstBuffer =
-                state->mBuffers[0].itemAt(index);
-            sp<ABuffer> abuffer = new ABuffer(dstBuffer->base(), dstBuffer->capacity());
-            int64_t timeUs = 0;
-            sp<ABuffer> srcBuffer = *state->mSampleData.begin();
-            state->mSampleData.erase(state->mSampleData.begin());
-            memcpy(dstBuffer->base(), srcBuffer->data(), srcBuffer->size());
-            dstBuffer->setRange(0, srcBuffer->size());
-            srcBuffer->meta()->findInt64("timeUs", &timeUs);
-            ALOGV("erase => track %zu,type %zu, sample data size=%d", i, state->mType, state->mSampleData.size());
+        const LatencyHistogram &decodeLatency =
+            state.mTimeline.histogram(FrameTimeline::QUEUE_TO_OUTPUT);
+        if (decodeLatency.count() > 0) {
+            trackStats->setInt64("decode-latency-p50-us", decodeLatency.percentileUs(50));
+            trackStats->setInt64("decode-latency-p90-us", decodeLatency.percentileUs(90));
+            trackStats->setInt64("decode-latency-p99-us", decodeLatency.percentileUs(99));
+            trackStats->setInt64("decode-latency-max-us", decodeLatency.maxUs());
+        }
 
-            err = state->mCodec->queueInputBuffer(
-                    index,
-                    dstBuffer->offset(),
-                    dstBuffer->size(),
-                    timeUs,
-                    0);
-            CHECK_EQ(err, (status_t)OK);
+        if (state.mType == VIDEO && state.mNumFramesRendered > 0) {
+            trackStats->setInt64(
+                    "render-jitter-avg-us",
+                    state.mSumRenderJitterUs / state.mNumFramesRendered);
+            trackStats->setInt64("render-jitter-max-us", state.mMaxRenderJitterUs);
+        }
+
+        if (state.mAudioSink != NULL) {
+            trackStats->setInt64("audio-ring-underruns", state.mAudioSink->numUnderruns());
+            trackStats->setInt64("audio-track-underruns", state.mAudioSink->numTrackUnderruns());
+            trackStats->setInt64("audio-ring-capacity-bytes", state.mAudioSink->capacityBytes());
+            trackStats->setInt64("audio-ring-fill-bytes", state.mAudioSink->fillBytes());
+            trackStats->setInt64(
+                    "audio-ring-fill-us",
+                    state.mAudioSink->bytesToDurationUs(state.mAudioSink->fillBytes()));
+        }
+
+        if (state.mPacing.numFrames() > 0) {
+            trackStats->setInt64("frames-presented", state.mPacing.numFrames());
+            trackStats->setInt64("present-interval-avg-us", state.mPacing.intervalMeanUs());
+            trackStats->setInt64("present-interval-stddev-us", state.mPacing.intervalStdDevUs());
+            trackStats->setInt64("judder-us", state.mPacing.judderUs());
+        }
 
-            ALOGV("enqueued input data on track %zu,type %zu,timeUs=%lld", i, state->mType, timeUs);
-        } while (!state->mSampleData.empty()
-                && !state->mAvailInputBufferIndices.empty());
+        stats->setMessage(
+                AStringPrintf("track-%zu", mStateByTrackIndex.keyAt(i)).c_str(), trackStats);
     }
 
-    int64_t nowUs = ALooper::GetNowUs();
+    return stats;
+}
+
+void SimplePlayer::onFrameRendered(const sp<AMessage> &msg) {
+    int32_t generation;
+    CHECK(msg->findInt32("generation", &generation));
+
+    size_t trackIndex;
+    CHECK(msg->findSize("trackIndex", &trackIndex));
 
-    if (mStartTimeRealUs < 0ll) {
-        mStartTimeRealUs = nowUs + 100000ll;
+    ssize_t stateIndex = mStateByTrackIndex.indexOfKey(trackIndex);
+    if (generation != mCodecGeneration || stateIndex < 0) {
+        return;
     }
 
-    for (size_t i = 0; i < mStateByTrackIndex.size(); ++i) {
-        CodecState *state = &mStateByTrackIndex.editValueAt(i);
+    CodecState *state = &mStateByTrackIndex.editValueAt(stateIndex);
 
-        while (!state->mAvailOutputBufferInfos.empty()) {
-            BufferInfo *info = &*state->mAvailOutputBufferInfos.begin();
+    for (size_t i = 0;; ++i) {
+        int64_t mediaTimeUs;
+        int64_t systemNano;
+        if (!msg->findInt64(AStringPrintf("%zu-media-time-us", i).c_str(), &mediaTimeUs)
+                || !msg->findInt64(AStringPrintf("%zu-system-nano", i).c_str(), &systemNano)) {
+            break;
+        }
 
-            if(info->mFlags & MediaCodec::BUFFER_FLAG_EOS) {
-                mEndOfStream &= ~(0x1 << state->mType);
-                ALOGI("encountered output EOS on track %zu,type %zu, mEndOfStream %x.", i, state->mType, mEndOfStream);
-                if(!mEndOfStream)
-                    return ERROR_END_OF_STREAM;
-            }
+        state->mPacing.onFrameRendered(mediaTimeUs, systemNano);
+    }
+}
 
-            int64_t whenRealUs = info->mPresentationTimeUs + mStartTimeRealUs;
-            int64_t lateByUs = nowUs - whenRealUs;
+void SimplePlayer::onCodecNotify(const sp<AMessage> &msg) {
+    int32_t generation;
+    CHECK(msg->findInt32("generation", &generation));
 
-            if (lateByUs > -10000ll) {
-                bool release = true;
+    size_t trackIndex;
+    CHECK(msg->findSize("trackIndex", &trackIndex));
 
-                if (lateByUs > 50000ll) {
-                    ALOGI("track %zu,type %zu, buffer late by %lld us, dropping.",
-                          mStateByTrackIndex.keyAt(i), state->mType, (long long)lateByUs);
-                    state->mCodec->releaseOutputBuffer(info->mIndex);
-                } else {
-                    if (state->mAudioTrack != NULL) {
-                        const sp<MediaCodecBuffer> &srcBuffer =
-                            state->mBuffers[1].itemAt(info->mIndex);
+    ssize_t stateIndex = mStateByTrackIndex.indexOfKey(trackIndex);
+    if (generation != mCodecGeneration || stateIndex < 0) {
+        // Stale notification from a codec that has been released since.
+        return;
+    }
 
-                        renderAudio(state, info, srcBuffer);
+    CodecState *state = &mStateByTrackIndex.editValueAt(stateIndex);
+    TrackCpuScope cpu(&state->mClientCpuUs);
 
-                        if (info->mSize > 0) {
-                            release = false;
-                        }
-                    }
+    int32_t cbID;
+    CHECK(msg->findInt32("callbackID", &cbID));
 
-                    if (release) {
-                        if(!firstFrameObserved && state->mType == VIDEO) {
-                            firstFrameObserved = true;
-                            sp<CodecEventListener> listener(mListener.promote());
-                            if (listener != nullptr) {
-                                listener->onFirstFrameAvailable();
-                            }
-                        }
-                        state->mCodec->renderOutputBufferAndRelease(
-                                info->mIndex);
-                    }
-                }
+    switch (cbID) {
+        case MediaCodec::CB_INPUT_AVAILABLE:
+        {
+            int32_t index;
+            CHECK(msg->findInt32("index", &index));
 
-                if (release) {
-                    state->mAvailOutputBufferInfos.erase(
-                            state->mAvailOutputBufferInfos.begin());
+            state->mAvailInputBufferIndices.push_back(index);
+            break;
+        }
 
-                    info = NULL;
-                } else {
-                    break;
-                }
-            } else {
-                ALOGV("track %zu,type %zu, buffer early by %lld us.",
-                      mStateByTrackIndex.keyAt(i), state->mType, (long long)-lateByUs);
-                break;
+        case MediaCodec::CB_OUTPUT_AVAILABLE:
+        {
+            int32_t index;
+            int32_t flags;
+            BufferInfo info;
+            CHECK(msg->findInt32("index", &index));
+            CHECK(msg->findSize("offset", &info.mOffset));
+            CHECK(msg->findSize("size", &info.mSize));
+            CHECK(msg->findInt64("timeUs", &info.mPresentationTimeUs));
+            CHECK(msg->findInt32("flags", &flags));
+            info.mIndex = index;
+            info.mFlags = flags;
+
+            onOutputBufferAvailable(state, info);
+            break;
+        }
+
+        case MediaCodec::CB_OUTPUT_FORMAT_CHANGED:
+        {
+            status_t err = onOutputFormatChanged(trackIndex, state);
+            if (err != OK) {
+                ALOGE("cannot play the output of track %zu,type %zu: %d",
+                      trackIndex, state->mType, err);
+
+                // As with a codec error, nothing sensible left to play.
+                mEndOfStream = 0;
             }
+            break;
         }
-    }
 
-    return OK;
+        case MediaCodec::CB_ERROR:
+        {
+            int32_t err;
+            CHECK(msg->findInt32("err", &err));
+            ALOGE("codec error on track %zu,type %zu: %s",
+                  trackIndex, state->mType, statusToString(err).c_str());
+
+            // Nothing sensible left to play, let reachedEndOfStream() return true.
+            mEndOfStream = 0;
+            break;
+        }
+
+        default:
+            break;
+    }
 }
 
 status_t SimplePlayer::onOutputFormatChanged(
@@ -639,20 +2907,75 @@ status_t SimplePlayer::onOutputFormatChanged(
     AString mime;
     CHECK(format->findString("mime", &mime));
 
-    if (!strncasecmp(mime.c_str(), "audio/", 6)) {
+    if (!strncasecmp(mime.c_str(), "video/", 6) && mFrameExport != NULL) {
+        err = FrameExportRing::GetFrameInfo(format, &state->mExportInfo);
+        state->mCanExport = err == OK;
+        if (err != OK) {
+            ALOGW("frames in color format %d cannot be exported", state->mExportInfo.mColorFormat);
+        }
+        return OK;
+    }
+
+    if (!strncasecmp(mime.c_str(), "audio/", 6) && !mBenchmark) {
         int32_t channelCount;
         int32_t sampleRate;
         CHECK(format->findInt32("channel-count", &channelCount));
         CHECK(format->findInt32("sample-rate", &sampleRate));
 
-        state->mAudioTrack = new AudioTrack(
-                AUDIO_STREAM_MUSIC,
-                sampleRate,
-                AUDIO_FORMAT_PCM_16_BIT,
-                audio_channel_out_mask_from_count(channelCount),
-                0);
+        int32_t pcmEncoding;
+        if (!format->findInt32(KEY_PCM_ENCODING, &pcmEncoding)) {
+            pcmEncoding = kAudioEncodingPcm16bit;
+        }
+
+        audio_format_t audioFormat = AUDIO_FORMAT_PCM_16_BIT;
+        if (mAudioPcm24Bit && pcmEncoding == kAudioEncodingPcmFloat) {
+            audioFormat = AUDIO_FORMAT_PCM_24_BIT_PACKED;
+        }
 
-        state->mNumFramesWritten = 0;
+        if (state->mPcmProcessor == NULL) {
+            state->mPcmProcessor = new PcmProcessor;
+            state->mPcmProcessor->setVolume(mVolume, 0 /* numRampFrames */);
+        }
+
+        err = state->mPcmProcessor->configure(channelCount, pcmEncoding, audioFormat);
+        if (err != OK) {
+            ALOGE("unsupported audio output, %d channels, encoding %d",
+                  channelCount, pcmEncoding);
+            state->mPcmProcessor.clear();
+            return err;
+        }
+
+        state->mSampleRate = sampleRate;
+        state->mChannelCount = state->mPcmProcessor->outputChannelCount();
+        state->mAudioFormat = audioFormat;
+        state->mResampler.clear();
+        state->mTimeStretcher.clear();
+
+        uint32_t nativeRate;
+        if (mResamplerQuality >= 0
+                && AudioSystem::getOutputSamplingRate(&nativeRate, AUDIO_STREAM_MUSIC) == OK
+                && nativeRate != (uint32_t)sampleRate) {
+            state->mResampler = new Resampler(
+                    sampleRate,
+                    nativeRate,
+                    state->mChannelCount,
+                    audioFormat,
+                    static_cast<Resampler::Quality>(mResamplerQuality));
+            state->mSampleRate = nativeRate;
+        }
+
+        if (mState != STARTED) {
+            // Prerolling, onStart() opens the sink.
+            if (state->mAudioSink != NULL) {
+                state->mAudioSink->close();
+                state->mAudioSink.clear();
+            }
+            return OK;
+        }
+
+        if (!adoptAudioSink(state)) {
+            return openAudioSink(state);
+        }
     }
 
     return OK;
@@ -660,52 +2983,205 @@ status_t SimplePlayer::onOutputFormatChanged(
 
 void SimplePlayer::renderAudio(
         CodecState *state, BufferInfo *info, const sp<MediaCodecBuffer> &buffer) {
-    CHECK(state->mAudioTrack != NULL);
+    CHECK(state->mAudioSink != NULL);
+
+    if (mPlaybackRate != 1.0f && state->mTimeStretcher == NULL) {
+        state->mTimeStretcher = new TimeStretcher(
+                state->mSampleRate, state->mChannelCount, state->mAudioFormat);
+        state->mTimeStretcher->setRate(mPlaybackRate);
+    }
+
+    if (state->mResampler != NULL || state->mTimeStretcher != NULL) {
+        renderStagedAudio(state, info, buffer);
+        return;
+    }
+
+    size_t nbytes = writeAudio(state, buffer->base() + info->mOffset, info->mSize);
+
+    if (nbytes == 0) {
+        return;
+    }
+
+    info->mOffset += nbytes;
+    info->mSize -= nbytes;
+
+    onAudioWritten(state, info->mPresentationTimeUs, nbytes);
+}
+
+// Resampler, then time stretcher, either one optional. Each holds on to at
+// most a block of output, so the ring still pushes back.
+void SimplePlayer::renderStagedAudio(
+        CodecState *state, BufferInfo *info, const sp<MediaCodecBuffer> &buffer) {
+    const sp<Resampler> &resampler = state->mResampler;
+    const sp<TimeStretcher> &stretcher = state->mTimeStretcher;
+    size_t frameSize = state->mAudioSink->frameSize();
+
+    for (;;) {
+        const void *data;
+        int64_t timeUs;
+        size_t numFrames = stretcher != NULL
+            ? stretcher->getOutput(&data, &timeUs)
+            : resampler->getOutput(&data, &timeUs);
+
+        if (numFrames > 0) {
+            size_t nbytes = writeAudio(state, data, numFrames * frameSize);
+
+            if (nbytes == 0) {
+                break;
+            }
+
+            if (stretcher != NULL) {
+                stretcher->consumeOutput(nbytes / frameSize);
+            } else {
+                resampler->consumeOutput(nbytes / frameSize);
+            }
+            onAudioWritten(state, timeUs, nbytes);
+            continue;
+        }
+
+        if (stretcher != NULL && resampler != NULL) {
+            numFrames = resampler->getOutput(&data, &timeUs);
+            if (numFrames > 0) {
+                stretcher->queueInput(data, numFrames, timeUs);
+                resampler->consumeOutput(numFrames);
+                continue;
+            }
+        }
+
+        if (info->mSize == 0) {
+            break;
+        }
+
+        // The first stage takes all of the buffer. Part of it may have been
+        // written already if the stretcher just came in.
+        int64_t numFramesWritten = (info->mOffset - buffer->offset()) / frameSize;
+        if (resampler != NULL) {
+            resampler->queueInput(
+                    buffer->base() + info->mOffset,
+                    info->mSize / frameSize,
+                    info->mPresentationTimeUs
+                        + numFramesWritten * 1000000ll / resampler->inputRate());
+        } else {
+            stretcher->queueInput(
+                    buffer->base() + info->mOffset,
+                    info->mSize / frameSize,
+                    info->mPresentationTimeUs
+                        + numFramesWritten * 1000000ll / state->mSampleRate);
+        }
+
+        info->mOffset += info->mSize;
+        info->mSize = 0;
+    }
+}
+
+bool SimplePlayer::drainStagedAudio(CodecState *state) {
+    const sp<Resampler> &resampler = state->mResampler;
+    const sp<TimeStretcher> &stretcher = state->mTimeStretcher;
+    size_t frameSize = state->mAudioSink->frameSize();
+
+    const void *data;
+    int64_t timeUs;
+    size_t numFrames;
+    if (resampler != NULL) {
+        // The last frames are still in the filter history.
+        resampler->signalEndOfStream();
+
+        while ((numFrames = resampler->getOutput(&data, &timeUs)) > 0) {
+            if (stretcher != NULL) {
+                stretcher->queueInput(data, numFrames, timeUs);
+                resampler->consumeOutput(numFrames);
+                continue;
+            }
+
+            size_t nbytes = writeAudio(state, data, numFrames * frameSize);
+            if (nbytes == 0) {
+                return false;
+            }
 
-    if (state->mAudioTrack->stopped()) {
-        state->mAudioTrack->start();
+            resampler->consumeOutput(nbytes / frameSize);
+            onAudioWritten(state, timeUs, nbytes);
+        }
     }
 
-    uint32_t numFramesPlayed;
-    CHECK_EQ(state->mAudioTrack->getPosition(&numFramesPlayed), (status_t)OK);
+    if (stretcher == NULL) {
+        return true;
+    }
 
-    uint32_t numFramesAvailableToWrite =
-        state->mAudioTrack->frameCount()
-            - (state->mNumFramesWritten - numFramesPlayed);
+    stretcher->signalEndOfStream();
 
-    size_t numBytesAvailableToWrite =
-        numFramesAvailableToWrite * state->mAudioTrack->frameSize();
+    while ((numFrames = stretcher->getOutput(&data, &timeUs)) > 0) {
+        size_t nbytes = writeAudio(state, data, numFrames * frameSize);
+        if (nbytes == 0) {
+            return false;
+        }
 
-    size_t copy = info->mSize;
-    if (copy > numBytesAvailableToWrite) {
-        copy = numBytesAvailableToWrite;
+        stretcher->consumeOutput(nbytes / frameSize);
+        onAudioWritten(state, timeUs, nbytes);
     }
 
-    if (copy == 0) {
-        return;
+    return true;
+}
+
+// Audio is written this much ahead of its due time while a sink taken over
+// at the handoff still holds audio of the previous item: what is pending in
+// the sink, less what this player wrote that is still in the ring. Until
+// the first write the end of the previous item is all there is to go by.
+int64_t SimplePlayer::getAudioWriteAheadUs(const CodecState *state, int64_t nowUs) const {
+    if (mHandoffAudioFramesQueued == 0) {
+        return 0ll;
     }
 
-    int64_t startTimeUs = ALooper::GetNowUs();
+    if (state->mNumFramesWritten == 0) {
+        return mHandoffEndTimeUs > nowUs ? mHandoffEndTimeUs - nowUs : 0ll;
+    }
 
-    ssize_t nbytes = state->mAudioTrack->write(
-            buffer->base() + info->mOffset, copy);
+    const sp<AudioSink> &sink = state->mAudioSink;
+    size_t fillBytes = sink->fillBytes();
+    size_t ownBytes = (size_t)state->mNumFramesWritten * sink->frameSize();
+    if (ownBytes > fillBytes) {
+        ownBytes = fillBytes;
+    }
 
-    CHECK_EQ(nbytes, (ssize_t)copy);
+    int64_t writeAheadUs = mClock->getAudioPendingUs(nowUs) - sink->bytesToDurationUs(ownBytes);
+    return writeAheadUs > 0ll ? writeAheadUs : 0ll;
+}
 
-    int64_t delayUs = ALooper::GetNowUs() - startTimeUs;
+size_t SimplePlayer::writeAudio(CodecState *state, const void *data, size_t size) {
+    const sp<AudioSink> &sink = state->mAudioSink;
 
-    uint32_t numFramesWritten = nbytes / state->mAudioTrack->frameSize();
+    size_t nbytes = sink->write(data, size);
 
-    if (delayUs > 2000ll) {
-        ALOGW("AudioTrack::write took %lld us, numFramesAvailableToWrite=%u, "
-              "numFramesWritten=%u",
-              (long long)delayUs, numFramesAvailableToWrite, numFramesWritten);
+    if (nbytes == 0 && !sink->started() && sink->discardPending()) {
+        // The ring only frees up what a seek flushed once the track runs.
+        CHECK_EQ(sink->start(), (status_t)OK);
     }
 
-    info->mOffset += nbytes;
-    info->mSize -= nbytes;
+    return nbytes;
+}
+
+void SimplePlayer::onAudioWritten(CodecState *state, int64_t timeUs, size_t numBytes) {
+    if (!state->mAudioSink->started()) {
+        CHECK_EQ(state->mAudioSink->start(), (status_t)OK);
+    }
+
+    uint32_t numFramesWritten = numBytes / state->mAudioSink->frameSize();
 
     state->mNumFramesWritten += numFramesWritten;
+    mClock->onAudioWritten(timeUs, numFramesWritten);
+
+    // Until the first frame just written plays out.
+    int64_t nowUs = ALooper::GetNowUs();
+    int64_t pendingUs = mClock->getAudioPendingUs(nowUs);
+    int64_t latencyUs = pendingUs - state->mAudioSink->bytesToDurationUs(numBytes);
+
+    if (pendingUs > 0ll) {
+        state->mAudioOutputLatency.record(
+                latencyUs + (state->mResampler != NULL ? state->mResampler->delayUs() : 0ll));
+    }
+
+    if (mTransitionPending || state->mFirstPresentTimeUs < 0ll) {
+        onFramePresented(state, nowUs + latencyUs);
+    }
 }
 
 }  // namespace android
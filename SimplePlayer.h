@@ -19,35 +19,207 @@
 
 #include <media/stagefright/foundation/AHandler.h>
 #include <media/stagefright/foundation/AString.h>
+#include <system/audio.h>
 #include <utils/KeyedVector.h>
 
+#include "CodecStarter.h"
+#include "FrameDropPolicy.h"
+#include "FrameExportRing.h"
+#include "FramePacing.h"
+#include "FrameTimeline.h"
+
 namespace android {
 
 struct ABuffer;
 struct ALooper;
-class AudioTrack;
+struct AudioSink;
+struct CodecPool;
+class DataSource;
+struct Demuxer;
+struct HttpCacheSource;
 class IGraphicBufferProducer;
 struct MediaCodec;
 class MediaCodecBuffer;
-struct NuMediaExtractor;
+struct PcmProcessor;
+struct PlaybackClock;
+struct PrefetchPolicy;
+struct Resampler;
+struct SampleBufferPool;
+struct SampleQueue;
+struct SampleSource;
 class Surface;
+struct SyncSampleIndex;
+struct TimeStretcher;
+struct TranscodeSink;
 
 struct CodecEventListener: virtual public RefBase {
     virtual void onFirstFrameAvailable() = 0;
+
+    // Every video frame published to the "frame-export-ring", on the
+    // player's looper.
+    virtual void onFrameExported(uint64_t index __unused, int64_t timeUs __unused) {}
 };
 
 struct SimplePlayer : public AHandler {
+    enum SeekMode {
+        // Sync sample at or before the target.
+        SEEK_PREVIOUS_SYNC,
+        // Sync sample nearest to the target.
+        SEEK_CLOSEST_SYNC,
+        // Decode from the previous sync sample, show nothing before the target.
+        SEEK_FRAME_ACCURATE,
+        NUM_SEEK_MODES
+    };
+
     SimplePlayer();
 
     status_t setDataSource(const char *path);
+    status_t setDataSource(const sp<DataSource> &source);
     status_t setSurface(const sp<IGraphicBufferProducer> &bufferProducer);
     status_t prepare();
     status_t start();
     status_t stop();
     status_t reset();
+    // Started and not at the end of every track yet.
     bool isPlaying();
+
+    // Every track reached the end of its output, or playback gave up on an
+    // error. A player that is prerolled and waiting for its handoff has not.
+    bool reachedEndOfStream();
+
+    // Flushes the codecs in place, valid once prepared. Sync samples seen
+    // during playback are indexed, seeks within the part played so far
+    // resolve their target from that index.
+    status_t seekTo(int64_t timeUs, SeekMode mode = SEEK_PREVIOUS_SYNC);
+
+    // 0.25 to 4, valid at any time. Audio is time-stretched and keeps its
+    // pitch.
+    status_t setPlaybackRate(float rate);
+
+    // 0 to 1, valid at any time. Applied to the decoded audio with a short
+    // ramp, after 5.1 and 7.1 have been downmixed to stereo.
+    status_t setVolume(float volume);
+
+    // Prepares if needed and starts decoding without presenting anything,
+    // so that start() or a handoff shows the first frames right away.
+    status_t preroll();
+
+    // Gapless playlists: next is prerolled now and started by this player
+    // the moment its last track reaches the end of stream, timed to follow
+    // the audio still buffered. The AudioSink is handed over as well and
+    // next keeps writing into it if its audio format is the same, so there
+    // is no gap in the audio. next must run on a looper of its own.
+    status_t setNextPlayer(const sp<SimplePlayer> &next);
+
+    // Parameters are consumed by prepare(), so they must be set before it.
+    //   "async-mode" (int32): drive the codecs from MediaCodec::setCallback
+    //                         notifications instead of polling every 5 ms.
+    //   "demux-thread" (int32): run the extractor on its own thread and hand
+    //                           samples over through per-track rings.
+    //   "video-prefetch-bytes", "audio-prefetch-bytes" (int64): initial
+    //                           read-ahead budget per track, in bytes.
+    //   "prefetch-duration-us" (int64): initial read-ahead budget per track,
+    //                           in media time.
+    //   "prefetch-total-bytes" (int64): read-ahead across all tracks above
+    //                           which every budget is halved, once until
+    //                           it is back below three quarters of it.
+    //   "benchmark" (int32): decode as fast as possible, without AudioTrack
+    //                        and without pacing output against the clock.
+    //   "prefer-software-codecs" (int32): pick c2.android.* decoders first.
+    //   "render-ahead-us" (int64): queue video frames to the Surface this far
+    //                        ahead of their due time, with that time as
+    //                        their presentation timestamp. 0 renders frames
+    //                        immediately once due.
+    //   "vsync-period-us" (int64): display refresh period, frames are timed
+    //                        half a period early so they latch on the vsync
+    //                        they are due on.
+    //   "codec-pool" (object): CodecPool to take decoders from and to return
+    //                        them to on reset(), instead of creating and
+    //                        releasing them.
+    //   "sample-index" (int32): for local files, read samples through the
+    //                        SampleIndexFile sidecar next to the file instead
+    //                        of parsing the container, and write that sidecar
+    //                        after a play through from start to end.
+    //   "playback-rate" (float): see setPlaybackRate().
+    //   "volume" (float): see setVolume().
+    //   "audio-pcm-24-bit" (int32): play audio as packed 24 bit when the
+    //                        decoder delivers float, 16 bit otherwise.
+    //   "audio-resampler-quality" (int32): convert audio to the native
+    //                        output rate of the device in the player, with a
+    //                        Resampler::Quality, rather than leaving it to the
+    //                        AudioFlinger mixer.
+    //   "frame-export-ring" (object): FrameExportRing the decoded video
+    //                        frames are published to instead of being
+    //                        rendered to the Surface, for consumers in other
+    //                        processes. The decoder outputs flexible YUV 420.
+    //   "drop-non-ref-lag-us", "drop-to-sync-lag-us" (int64): predicted
+    //                        video lag at which access units stop reaching
+    //                        the decoder, non-reference ones (AVC and HEVC
+    //                        only) or all up to the next sync sample. -1
+    //                        never drops at that level, see FrameDropPolicy.
+    //   "http-cache-bytes", "http-read-ahead-bytes" (int64): for http://
+    //                        paths, memory for blocks of the resource and
+    //                        how far ahead of the last read blocks are
+    //                        fetched, see HttpCacheSource.
+    //   "http-connections" (int32): range requests in flight at once.
+    //   "http-cache-file" (string): keep every block fetched in this file
+    //                        as well, so that none is fetched twice.
+    //   "low-latency" (int32): for live and interactive sources. Decoders
+    //                        run at realtime priority, as fast as they can
+    //                        and with low-latency on for video, playback
+    //                        starts with the first frame without a lead,
+    //                        video is rendered as soon as it is decoded, and
+    //                        audio goes to a fast AudioTrack through a short
+    //                        ring. Implies "async-mode", "render-ahead-us"
+    //                        is ignored.
+    //   "transcode-sink" (object): TranscodeSink whose input Surface is the
+    //                        one set with setSurface(). Video is decoded into
+    //                        it as fast as the encoder takes it, its end of
+    //                        stream is signalled to the encoder, and audio
+    //                        is left to the sink. Implies "benchmark".
+    status_t setParameters(const sp<AMessage> &params);
+
+    // Playback counters, one "track-<index>" sub-message per selected track.
+    // Video frames decoded and then dropped for being late are counted as
+    // "frames-dropped", access units never decoded because video was
+    // falling behind as "frames-dropped-before-decode".
+    // A player started by a handoff reports "transition-gap-us", the time
+    // from the end of the previous item to its own first frame, audio if it
+    // has any. Negative values are an overlap.
+    // http:// paths add "http-rebuffers", reads after the first start() that
+    // had to wait for the network, and the HttpCacheSource counters.
+    status_t getStats(sp<AMessage> *stats);
+
+    // Per-stage latency histograms of every frame that made it through the
+    // pipeline, one "track-<index>" sub-message per selected track, see
+    // FrameTimeline::writeToMessage. Also logged on stop(). Audio tracks add
+    // "audio-output-count", "audio-output-p50-us" and so on, the time from
+    // the player writing audio to it playing out, the resampler's delay
+    // included, sampled at every write. Video tracks add "frame-intervals",
+    // the frames whose "queue-to-render" latency was timed against the
+    // interval to the frame before them, and "frames-within-interval", those
+    // it was shorter for, i.e. that the pipeline delayed by less than a frame.
+    status_t getLatencyStats(sp<AMessage> *stats);
+
+    // Where the time from prepare() to the first frame and the first audio
+    // went. The source is opened first, then the decoders are brought up
+    // concurrently while the first samples are read:
+    //   "source-open-us", "first-samples-us", "codec-wait-us" (waiting for
+    //   decoders still coming up once reading is done), "prepare-us",
+    //   "start-at-us", "time-to-first-frame-us", "time-to-first-audio-us".
+    // One "track-<index>" sub-message per selected track with the duration
+    // of each CodecStarter phase, "codec-<phase>-us", and "codec-ready-at-us",
+    // "first-input-at-us", "first-output-at-us", "first-present-at-us".
+    // Every "-at-us" value and the time-to-first values are relative to the
+    // start of prepare().
+    status_t getStartupStats(sp<AMessage> *stats);
     void registerListener(const wp<CodecEventListener>& listener) { mListener = listener; }
 
+    // The tracks prepare() plays, the first audio and the first video track
+    // of source, -1 for none. Any other track is ignored.
+    static void FindTracks(
+            const sp<SampleSource> &source, ssize_t *audioTrack, ssize_t *videoTrack);
+
 protected:
     virtual ~SimplePlayer();
 
@@ -69,6 +241,20 @@ private:
         kWhatStop,
         kWhatReset,
         kWhatDoMoreStuff,
+        kWhatSetParameters,
+        kWhatGetStats,
+        kWhatGetLatencyStats,
+        kWhatGetStartupStats,
+        kWhatCodecNotify,
+        kWhatDemuxerNotify,
+        kWhatFrameRendered,
+        kWhatSeek,
+        kWhatResumeCodecs,
+        kWhatPreroll,
+        kWhatSetNextPlayer,
+        kWhatHandoff,
+        kWhatSetPlaybackRate,
+        kWhatSetVolume,
     };
 
     enum SourceType {
@@ -88,42 +274,237 @@ private:
     struct CodecState
     {
         sp<MediaCodec> mCodec;
+        sp<AMessage> mFormat;
+        bool mCodecFromPool;
+        int64_t mCodecPhaseUs[CodecStarter::NUM_PHASES];
+        int64_t mCodecReadyTimeUs;
         Vector<sp<ABuffer> > mCSD;
         Vector<sp<MediaCodecBuffer> > mBuffers[2];
         Vector<sp<ABuffer> > mSampleData;
+        // The empty input buffer flagged EOS went to the codec.
+        bool mInputEOSQueued;
+        sp<SampleBufferPool> mBufferPool;
+        sp<SampleQueue> mSampleQueue;
+        sp<PrefetchPolicy> mPrefetchPolicy;
+        sp<SyncSampleIndex> mSyncIndex;
 
         List<size_t> mAvailInputBufferIndices;
         List<BufferInfo> mAvailOutputBufferInfos;
         SourceType mType;
 
-        sp<AudioTrack> mAudioTrack;
+        // Audio as the AudioSink takes it, after mPcmProcessor and
+        // mResampler. The sink is only opened once playback starts.
+        int32_t mSampleRate;
+        int32_t mChannelCount;
+        audio_format_t mAudioFormat;
+        sp<PcmProcessor> mPcmProcessor;
+        sp<Resampler> mResampler;
+        sp<AudioSink> mAudioSink;
         uint32_t mNumFramesWritten;
+        // Created the first time the rate is not 1.
+        sp<TimeStretcher> mTimeStretcher;
+        LatencyHistogram mAudioOutputLatency;
+
+        // Compressed bytes staged through mSampleData versus read by the
+        // extractor straight into a codec input buffer.
+        int64_t mNumBytesCopied;
+        int64_t mNumBytesDirect;
+
+        // How far from its due time each video frame was released.
+        int64_t mNumFramesRendered;
+        int64_t mNumFramesDropped;
+        int64_t mSumRenderJitterUs;
+        int64_t mMaxRenderJitterUs;
+
+        FrameTimeline mTimeline;
+        FramePacing mPacing;
+        int64_t mNumFramesDecoded;
+        // Time the player looper spent on this track, the decoding itself
+        // mostly happens in the codec service.
+        int64_t mClientCpuUs;
+        int64_t mFirstQueueTimeUs;
+        int64_t mFirstOutputTimeUs;
+        int64_t mFirstPresentTimeUs;
+        int64_t mLastOutputTimeUs;
+
+        // Video only, frames whose queue-to-render latency is below the
+        // interval to the frame before them, out of all that were timed.
+        int64_t mLastRenderedTimeUs;
+        int64_t mNumFrameIntervals;
+        int64_t mNumFramesWithinInterval;
+
+        // Output before this is only decoded to reach a frame accurate seek.
+        int64_t mSeekTargetUs;
+        int64_t mNumFramesSkipped;
+
+        // Video only, with mFrameExport. Frames the ring has no room for or
+        // that cannot be described are not exported.
+        FrameExportRing::FrameInfo mExportInfo;
+        bool mCanExport;
+        int64_t mNumFramesExported;
+        int64_t mNumFramesNotExported;
+
+        // Video only, input dropped before it is decoded.
+        FrameDropPolicy mDropPolicy;
+        int64_t mNumFramesSkippedNonReference;
+        int64_t mNumFramesSkippedToSync;
+        // HEVC only, the highest TemporalId of the stream, -1 until known.
+        int32_t mMaxTemporalId;
     };
 
     State mState;
     AString mPath;
+    sp<DataSource> mDataSource;
+    sp<HttpCacheSource> mHttpSource;
+    // Stalls of mHttpSource before the first start().
+    int64_t mHttpStallsAtStart;
     sp<Surface> mSurface;
 
-    sp<NuMediaExtractor> mExtractor;
+    sp<SampleSource> mExtractor;
+    sp<Demuxer> mDemuxer;
     sp<ALooper> mCodecLooper;
     KeyedVector<size_t, CodecState> mStateByTrackIndex;
     int32_t mDoMoreStuffGeneration;
+    int32_t mCodecGeneration;
     int32_t mEndOfStream;
+    bool mAsyncMode;
+    bool mUseDemuxThread;
+    bool mBenchmark;
+    bool mPreferSoftwareCodecs;
+    sp<CodecPool> mCodecPool;
+    sp<FrameExportRing> mFrameExport;
+    sp<TranscodeSink> mTranscodeSink;
+    int64_t mRenderAheadUs;
+    int64_t mVsyncPeriodUs;
+    float mPlaybackRate;
+    float mVolume;
+    bool mAudioPcm24Bit;
+    int32_t mResamplerQuality;
+    bool mLowLatency;
+    int64_t mDropNonReferenceLagUs;
+    int64_t mDropToSyncLagUs;
+    int64_t mHttpCacheBytes;
+    int64_t mHttpReadAheadBytes;
+    int32_t mHttpConnections;
+    AString mHttpCacheFile;
+    bool mUseSampleIndex;
+    bool mPreparedFromIndex;
+    // Startup breakdown, see getStartupStats().
+    int64_t mPrepareStartTimeUs;
+    int64_t mSourceOpenUs;
+    int64_t mFirstSamplesUs;
+    int64_t mCodecWaitUs;
+    int64_t mPrepareTimeUs;
+    int64_t mStartRequestTimeUs;
+    int64_t mPrefetchBytes[NUM_SOURCE_TYPES];
+    int64_t mPrefetchDurationUs;
+    int64_t mPrefetchTotalBytes;
+    int64_t mNumMemoryPressureEvents;
+    // Set once the budgets were cut for crossing mPrefetchTotalBytes, until
+    // the total is back below the low watermark.
+    bool mUnderMemoryPressure;
+    int64_t mNumWakeups;
 
+    // mStartMediaTimeUs is due at mStartTimeRealUs, both are picked when the
+    // first output buffer after start() or seekTo() shows up.
     int64_t mStartTimeRealUs;
+    int64_t mStartMediaTimeUs;
+    int64_t mStartLeadUs;
+
+    // Async codecs are started again once callbacks posted before the flush
+    // have been drained, see onSeek().
+    bool mCodecsFlushed;
+    int64_t mSeekStartTimeUs;
+    SeekMode mSeekMode;
+    size_t mSeekTrackIndex;
+    int64_t mNumIndexedSeeks;
+    LatencyHistogram mSeekLatency[NUM_SEEK_MODES];
+
+    // Video follows the audio position whenever there is audio.
+    sp<PlaybackClock> mClock;
+    int64_t mNumAVOffsetSamples;
+    int64_t mSumAVOffsetUs;
+    int64_t mMaxAVOffsetUs;
+    int64_t mAVOffsetReportTimeUs;
+    int64_t mNumAVOffsetSamplesReported;
+    int64_t mSumAVOffsetUsReported;
+    // Gapless playback, see setNextPlayer().
+    sp<SimplePlayer> mNextPlayer;
+    bool mPrerolling;
+    sp<AudioSink> mHandoffAudioSink;
+    uint32_t mHandoffAudioFramesQueued;
+    int64_t mHandoffEndTimeUs;
+    SourceType mTransitionType;
+    bool mTransitionPending;
+    int64_t mTransitionGapUs;
+
     bool mEncounteredInputEOS;
+    // The last readSamples() took a sample from the extractor or found its
+    // end.
+    bool mReadProgress;
     bool firstFrameObserved;
     wp<CodecEventListener> mListener;
 
+    status_t openSampleSource();
     status_t onPrepare();
+    void abortPrepare(const KeyedVector<size_t, sp<CodecStarter> > &starters);
     status_t onStart();
     status_t onStop();
     status_t onReset();
+    status_t onSeek(int64_t timeUs, SeekMode mode);
+    status_t onSetPlaybackRate(float rate);
+    status_t onSetVolume(float volume);
+    int64_t getScheduledRealTimeUs(int64_t mediaTimeUs) const;
+    bool shouldSkipSample(
+            CodecState *state, const sp<ABuffer> &sample, int64_t timeUs, bool isSync);
+    void onHandoff(const sp<AMessage> &msg);
+    void handOffToNextPlayer(int64_t nowUs);
+    bool adoptAudioSink(CodecState *state);
+    status_t openAudioSink(CodecState *state);
+    void onQueueToRender(CodecState *state, int64_t timeUs, int64_t latencyUs);
+    void onFramePresented(CodecState *state, int64_t presentTimeUs);
+    int64_t numSamplesPrefetched() const;
+    void startDemuxer();
+    void flushSamples(CodecState *state);
     status_t onDoMoreStuff();
     status_t onOutputFormatChanged(size_t trackIndex, CodecState *state);
+    status_t onSetParameters(const sp<AMessage> &params);
+    sp<AMessage> onGetStats() const;
+    sp<AMessage> onGetLatencyStats() const;
+    sp<AMessage> onGetStartupStats() const;
+    void dumpLatencyStats() const;
+    void onCodecNotify(const sp<AMessage> &msg);
+    void onFrameRendered(const sp<AMessage> &msg);
+
+    void scheduleDoMoreStuff(int64_t delayUs);
+    void postDoMoreStuffIfNeeded();
+
+    void dequeueBuffers(size_t trackIndex, CodecState *state);
+    void readSamples();
+    void checkPrefetchMemory();
+    bool readSampleIntoInputBuffer(size_t trackIndex, CodecState *state);
+    void queueInputBuffers(size_t trackIndex, CodecState *state);
+    void onInputBufferQueued(CodecState *state, int64_t timeUs, int64_t demuxTimeUs);
+    void onOutputBufferAvailable(CodecState *state, BufferInfo info);
+    bool hasPendingSample(const CodecState *state) const;
+    bool dequeueSample(CodecState *state, sp<ABuffer> *buffer);
+    status_t renderOutputBuffers();
+    void onAVOffset(int64_t offsetUs, int64_t nowUs);
+
+    sp<MediaCodecBuffer> getInputBuffer(CodecState *state, size_t index);
+    sp<MediaCodecBuffer> getOutputBuffer(CodecState *state, size_t index);
+    void exportFrame(CodecState *state, const BufferInfo &info);
 
     void renderAudio(
             CodecState *state, BufferInfo *info, const sp<MediaCodecBuffer> &buffer);
+    // At the end of stream, writes out what the audio stages still hold.
+    // False while the sink has no room for all of it.
+    bool drainStagedAudio(CodecState *state);
+    void renderStagedAudio(
+            CodecState *state, BufferInfo *info, const sp<MediaCodecBuffer> &buffer);
+    int64_t getAudioWriteAheadUs(const CodecState *state, int64_t nowUs) const;
+    size_t writeAudio(CodecState *state, const void *data, size_t size);
+    void onAudioWritten(CodecState *state, int64_t timeUs, size_t numBytes);
 
     DISALLOW_EVIL_CONSTRUCTORS(SimplePlayer);
 };
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SyncSampleIndex"
+
+#include <media/stagefright/MetaData.h>
+#include <utils/Log.h>
+
+#include "SampleSource.h"
+#include "SyncSampleIndex.h"
+
+namespace android {
+
+SyncSampleIndex::SyncSampleIndex()
+    : mMaxTimeUs(-1ll),
+      mExtending(true) {
+}
+
+SyncSampleIndex::~SyncSampleIndex() {
+}
+
+void SyncSampleIndex::addSample(int64_t timeUs, bool isSync) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (timeUs > mMaxTimeUs) {
+        if (!mExtending) {
+            return;
+        }
+        mMaxTimeUs = timeUs;
+    }
+
+    if (!isSync) {
+        return;
+    }
+
+    // Usually appends, samples are only read again after seeking back.
+    size_t index = lowerBound_l(timeUs);
+    if (index < mSyncTimesUs.size() && mSyncTimesUs.itemAt(index) == timeUs) {
+        return;
+    }
+
+    mSyncTimesUs.insertAt(timeUs, index);
+}
+
+bool SyncSampleIndex::addCurrentSample(const sp<SampleSource> &source) {
+    sp<MetaData> meta;
+    if (source->getSampleMeta(&meta) != OK) {
+        return false;
+    }
+
+    int64_t timeUs;
+    if (!meta->findInt64(kKeyTime, &timeUs)) {
+        return false;
+    }
+
+    int32_t isSync;
+    bool sync = meta->findInt32(kKeyIsSyncFrame, &isSync) && isSync;
+    addSample(timeUs, sync);
+
+    return sync;
+}
+
+bool SyncSampleIndex::findPrevious(int64_t timeUs, int64_t *syncTimeUs) const {
+    Mutex::Autolock autoLock(mLock);
+
+    size_t index = lowerBound_l(timeUs);
+    if (index < mSyncTimesUs.size() && mSyncTimesUs.itemAt(index) == timeUs) {
+        *syncTimeUs = timeUs;
+        return true;
+    }
+
+    if (index == 0 || timeUs > mMaxTimeUs) {
+        return false;
+    }
+
+    *syncTimeUs = mSyncTimesUs.itemAt(index - 1);
+    return true;
+}
+
+bool SyncSampleIndex::findNext(int64_t timeUs, int64_t *syncTimeUs) const {
+    Mutex::Autolock autoLock(mLock);
+
+    if (timeUs > mMaxTimeUs) {
+        // Not read yet, there may well be one.
+        return false;
+    }
+
+    size_t index = lowerBound_l(timeUs);
+    if (index == mSyncTimesUs.size()) {
+        return false;
+    }
+
+    *syncTimeUs = mSyncTimesUs.itemAt(index);
+    return true;
+}
+
+void SyncSampleIndex::onSeek(int64_t timeUs) {
+    Mutex::Autolock autoLock(mLock);
+    mExtending = timeUs <= mMaxTimeUs || mMaxTimeUs < 0ll;
+}
+
+size_t SyncSampleIndex::size() const {
+    Mutex::Autolock autoLock(mLock);
+    return mSyncTimesUs.size();
+}
+
+size_t SyncSampleIndex::lowerBound_l(int64_t timeUs) const {
+    size_t lo = 0;
+    size_t hi = mSyncTimesUs.size();
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mSyncTimesUs.itemAt(mid) < timeUs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+}  // namespace android
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SYNC_SAMPLE_INDEX_H
+#define SYNC_SAMPLE_INDEX_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct SampleSource;
+
+// Sorted presentation times of the sync samples of one track, filled in as
+// the samples go by during playback. Lookups are binary searches and only
+// answer for the part of the track that has been read so far.
+//
+// Written by whichever thread reads the extractor, read by the player looper.
+struct SyncSampleIndex : public RefBase {
+    SyncSampleIndex();
+
+    void addSample(int64_t timeUs, bool isSync);
+
+    // Records the sample the source currently points at, returns whether
+    // it is a sync sample.
+    bool addCurrentSample(const sp<SampleSource> &source);
+
+    // Latest sync sample at or before timeUs.
+    bool findPrevious(int64_t timeUs, int64_t *syncTimeUs) const;
+
+    // Earliest sync sample at or after timeUs, only if that part of the
+    // track has been read. Returning false does not mean there is none,
+    // the rest of the track may just not have been read yet.
+    bool findNext(int64_t timeUs, int64_t *syncTimeUs) const;
+
+    // The extractor was repositioned to timeUs. Jumping past what has been
+    // read leaves a hole, so the index stops growing until playback is back
+    // inside the covered range.
+    void onSeek(int64_t timeUs);
+
+    size_t size() const;
+
+protected:
+    virtual ~SyncSampleIndex();
+
+private:
+    mutable Mutex mLock;
+    Vector<int64_t> mSyncTimesUs;
+    int64_t mMaxTimeUs;
+    bool mExtending;
+
+    // Index of the first sync time >= timeUs, mSyncTimesUs.size() if none.
+    size_t lowerBound_l(int64_t timeUs) const;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SyncSampleIndex);
+};
+
+}  // namespace android
+
+#endif // SYNC_SAMPLE_INDEX_H
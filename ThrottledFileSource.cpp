@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ThrottledFileSource"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Log.h>
+
+#include "ThrottledFileSource.h"
+
+namespace android {
+
+ThrottledFileSource::ThrottledFileSource(const char *path, int64_t bytesPerSec)
+    : mFd(open(path, O_RDONLY | O_LARGEFILE | O_CLOEXEC)),
+      mBytesPerSec(bytesPerSec) {
+    ALOGE_IF(mFd < 0, "failed to open %s: %s", path, strerror(errno));
+}
+
+ThrottledFileSource::~ThrottledFileSource() {
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+status_t ThrottledFileSource::initCheck() const {
+    return mFd >= 0 ? OK : NO_INIT;
+}
+
+ssize_t ThrottledFileSource::readAt(off64_t offset, void *data, size_t size) {
+    if (mFd < 0) {
+        return NO_INIT;
+    }
+
+    ssize_t n = pread64(mFd, data, size, offset);
+
+    if (n > 0 && mBytesPerSec > 0) {
+        usleep(n * 1000000ll / mBytesPerSec);
+    }
+
+    return n < 0 ? ERROR_IO : n;
+}
+
+status_t ThrottledFileSource::getSize(off64_t *size) {
+    struct stat64 st;
+    if (mFd < 0 || fstat64(mFd, &st) != 0) {
+        return ERROR_IO;
+    }
+
+    *size = st.st_size;
+    return OK;
+}
+
+}  // namespace android
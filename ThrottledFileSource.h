@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef THROTTLED_FILE_SOURCE_H
+#define THROTTLED_FILE_SOURCE_H
+
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/foundation/ABase.h>
+
+namespace android {
+
+// Local file source that sleeps after every read so that the average read
+// bandwidth stays below bytesPerSec, to emulate slow storage.
+struct ThrottledFileSource : public DataSource {
+    ThrottledFileSource(const char *path, int64_t bytesPerSec);
+
+    virtual status_t initCheck() const;
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size);
+    virtual status_t getSize(off64_t *size);
+
+protected:
+    virtual ~ThrottledFileSource();
+
+private:
+    int mFd;
+    int64_t mBytesPerSec;
+
+    DISALLOW_EVIL_CONSTRUCTORS(ThrottledFileSource);
+};
+
+}  // namespace android
+
+#endif // THROTTLED_FILE_SOURCE_H
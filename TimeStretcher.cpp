@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "TimeStretcher"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include "PcmKernels.h"
+#include "TimeStretcher.h"
+
+namespace android {
+
+// Segments are twice a hop long, 24 ms keeps pitch periods of voice and
+// most instruments within one while still hiding the seams.
+static const uint32_t kHopMs = 12;
+static const uint32_t kSearchMs = 6;
+
+// A jump in input timestamps beyond this is a discontinuity.
+static const int64_t kMaxDiscontinuityUs = 100000ll;
+
+// Keeps the search score finite over silence, about one LSB of 16 bit
+// squared.
+static const float kMinEnergy = 1E-9f;
+
+// The inner loop of every output sample, vectorized with NEON or SSE2
+// where available. The search runs on PcmKernels::dotProduct.
+
+// out = from + (to - from) * window
+static void CrossFade(
+        const float *from, const float *to, const float *window, float *out, size_t n) {
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t f = vld1q_f32(from + i);
+        float32x4_t t = vld1q_f32(to + i);
+        vst1q_f32(out + i, vmlaq_f32(f, vsubq_f32(t, f), vld1q_f32(window + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= n; i += 4) {
+        __m128 f = _mm_loadu_ps(from + i);
+        __m128 t = _mm_loadu_ps(to + i);
+        _mm_storeu_ps(
+                out + i, _mm_add_ps(f, _mm_mul_ps(_mm_sub_ps(t, f), _mm_loadu_ps(window + i))));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        out[i] = from[i] + (to[i] - from[i]) * window[i];
+    }
+}
+
+TimeStretcher::TimeStretcher(
+        uint32_t sampleRate, int32_t channelCount, audio_format_t format)
+    : mSampleRate(sampleRate),
+      mChannelCount(channelCount),
+      mFormat(format),
+      mFrameSize(channelCount * audio_bytes_per_sample(format)),
+      mHopFrames(sampleRate * kHopMs / 1000),
+      mSearchFrames(sampleRate * kSearchMs / 1000),
+      mRate(1.0f),
+      mInput(NULL),
+      mMono(NULL),
+      mInputCapacity(0),
+      mProcessTimeUs(0ll),
+      mNumFramesProduced(0ll) {
+    CHECK_GT(mHopFrames, 0u);
+    CHECK_GT(mChannelCount, 0);
+    CHECK(mFormat == AUDIO_FORMAT_PCM_16_BIT || mFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED);
+
+    size_t numSamples = mHopFrames * mChannelCount;
+    mTail = new float[numSamples];
+    mTailMono = new float[mHopFrames];
+    mWindow = new float[numSamples];
+    mOutput = new uint8_t[mHopFrames * mFrameSize];
+
+    // Raised cosine, fading out with 1 - w keeps the sum at unity gain.
+    for (size_t i = 0; i < mHopFrames; ++i) {
+        float w = 0.5f - 0.5f * cosf(M_PI * (i + 0.5f) / mHopFrames);
+        for (int32_t c = 0; c < mChannelCount; ++c) {
+            mWindow[i * mChannelCount + c] = w;
+        }
+    }
+
+    flush();
+}
+
+TimeStretcher::~TimeStretcher() {
+    delete[] mInput;
+    delete[] mMono;
+    delete[] mTail;
+    delete[] mTailMono;
+    delete[] mWindow;
+    delete[] mOutput;
+}
+
+void TimeStretcher::setRate(float rate) {
+    CHECK_GT(rate, 0.0f);
+    mRate = rate;
+}
+
+void TimeStretcher::flush() {
+    mInputOffset = 0;
+    mNumInputFrames = 0;
+    mInputStartFrame = 0ll;
+    mBaseFrame = 0ll;
+    mBaseTimeUs = -1ll;
+    mEndFrame = -1ll;
+    mNextPos = 0.0;
+    mLastPos = -1;
+    mHaveTail = false;
+    mNumOutputFrames = 0;
+    mOutputOffset = 0;
+    mOutputTimeUs = -1ll;
+}
+
+int64_t TimeStretcher::frameTimeUs(int64_t frame) const {
+    return mBaseTimeUs + (frame - mBaseFrame) * 1000000ll / mSampleRate;
+}
+
+void TimeStretcher::reserveInput(size_t numFrames) {
+    if (mInputOffset + mNumInputFrames + numFrames > mInputCapacity) {
+        if (mNumInputFrames + numFrames > mInputCapacity) {
+            size_t capacity = 2 * mInputCapacity;
+            if (capacity < mNumInputFrames + numFrames) {
+                capacity = mNumInputFrames + numFrames;
+            }
+
+            float *input = new float[capacity * mChannelCount];
+            float *mono = new float[capacity];
+            if (mNumInputFrames > 0) {
+                memcpy(input,
+                       mInput + mInputOffset * mChannelCount,
+                       mNumInputFrames * mChannelCount * sizeof(float));
+                memcpy(mono, mMono + mInputOffset, mNumInputFrames * sizeof(float));
+            }
+
+            delete[] mInput;
+            delete[] mMono;
+            mInput = input;
+            mMono = mono;
+            mInputCapacity = capacity;
+        } else {
+            memmove(mInput,
+                    mInput + mInputOffset * mChannelCount,
+                    mNumInputFrames * mChannelCount * sizeof(float));
+            memmove(mMono, mMono + mInputOffset, mNumInputFrames * sizeof(float));
+        }
+
+        mInputOffset = 0;
+    }
+}
+
+void TimeStretcher::queueInput(const void *data, size_t numFrames, int64_t timeUs) {
+    if (mEndFrame >= 0ll) {
+        flush();
+    }
+
+    int64_t frame = mInputStartFrame + mNumInputFrames;
+    if (mBaseTimeUs < 0ll || llabs(frameTimeUs(frame) - timeUs) > kMaxDiscontinuityUs) {
+        mBaseTimeUs = timeUs;
+        mBaseFrame = frame;
+    }
+
+    reserveInput(numFrames);
+
+    nsecs_t startTimeNs = systemTime(SYSTEM_TIME_THREAD);
+
+    size_t end = mInputOffset + mNumInputFrames;
+    float *input = mInput + end * mChannelCount;
+    if (mFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED) {
+        PcmKernels::Vectorized().int24ToFloat(
+                static_cast<const uint8_t *>(data), input, numFrames * mChannelCount);
+    } else {
+        PcmKernels::Vectorized().int16ToFloat(
+                static_cast<const int16_t *>(data), input, numFrames * mChannelCount);
+    }
+
+    float *mono = mMono + end;
+    if (mChannelCount == 1) {
+        memcpy(mono, input, numFrames * sizeof(float));
+    } else {
+        float scale = 1.0f / mChannelCount;
+        for (size_t i = 0; i < numFrames; ++i) {
+            float sum = 0.0f;
+            for (int32_t c = 0; c < mChannelCount; ++c) {
+                sum += input[i * mChannelCount + c];
+            }
+            mono[i] = sum * scale;
+        }
+    }
+
+    mNumInputFrames += numFrames;
+
+    mProcessTimeUs += (systemTime(SYSTEM_TIME_THREAD) - startTimeNs) / 1000ll;
+}
+
+void TimeStretcher::signalEndOfStream() {
+    if (mEndFrame >= 0ll) {
+        return;
+    }
+
+    mEndFrame = mInputStartFrame + mNumInputFrames;
+
+    // Silence for the last segments and their search window to run into.
+    size_t numFrames = 2 * mHopFrames + mSearchFrames;
+    reserveInput(numFrames);
+
+    size_t end = mInputOffset + mNumInputFrames;
+    memset(mInput + end * mChannelCount, 0, numFrames * mChannelCount * sizeof(float));
+    memset(mMono + end, 0, numFrames * sizeof(float));
+    mNumInputFrames += numFrames;
+}
+
+size_t TimeStretcher::getOutput(const void **data, int64_t *timeUs) {
+    if (mOutputOffset == mNumOutputFrames && !produceHop()) {
+        return 0;
+    }
+
+    *data = mOutput + mOutputOffset * mFrameSize;
+    *timeUs = mOutputTimeUs;
+
+    return mNumOutputFrames - mOutputOffset;
+}
+
+void TimeStretcher::consumeOutput(size_t numFrames) {
+    CHECK_LE(mOutputOffset + numFrames, mNumOutputFrames);
+    mOutputOffset += numFrames;
+}
+
+void TimeStretcher::discardInput(size_t numFrames) {
+    CHECK_LE(numFrames, mNumInputFrames);
+
+    mInputOffset += numFrames;
+    mNumInputFrames -= numFrames;
+    mInputStartFrame += numFrames;
+    mNextPos -= numFrames;
+    mLastPos -= numFrames;
+}
+
+ssize_t TimeStretcher::findBestPos(ssize_t nominalPos) const {
+    ssize_t lo = nominalPos - (ssize_t)mSearchFrames;
+    if (lo < 0) {
+        lo = 0;
+    }
+    ssize_t hi = nominalPos + (ssize_t)mSearchFrames;
+
+    // Normalized cross-correlation against the frames that followed the
+    // last segment, the energy of the candidate slides along with it.
+    const float *mono = mMono + mInputOffset;
+    float energy = PcmKernels::Vectorized().dotProduct(mono + lo, mono + lo, mHopFrames);
+
+    ssize_t bestPos = nominalPos;
+    float bestScore = -FLT_MAX;
+    for (ssize_t pos = lo; pos <= hi; ++pos) {
+        float corr = PcmKernels::Vectorized().dotProduct(mono + pos, mTailMono, mHopFrames);
+
+        // Sign preserving square, avoids the square root.
+        float score = corr * fabsf(corr) / (energy + kMinEnergy);
+        if (score > bestScore) {
+            bestScore = score;
+            bestPos = pos;
+        }
+
+        float leaving = mono[pos];
+        float entering = mono[pos + mHopFrames];
+        energy += entering * entering - leaving * leaving;
+        if (energy < 0.0f) {
+            energy = 0.0f;
+        }
+    }
+
+    return bestPos;
+}
+
+void TimeStretcher::writeOutput(const float *samples, size_t numSamples) {
+    if (mFormat == AUDIO_FORMAT_PCM_24_BIT_PACKED) {
+        PcmKernels::Vectorized().floatToInt24(samples, mOutput, numSamples);
+    } else {
+        PcmKernels::Vectorized().floatToInt16(
+                samples, reinterpret_cast<int16_t *>(mOutput), numSamples);
+    }
+}
+
+bool TimeStretcher::produceHop() {
+    // At 1.0 the next segment is the one that naturally follows, the
+    // output then is the input.
+    bool search = mHaveTail && mRate != 1.0f;
+    ssize_t pos = mHaveTail && !search ? mLastPos + (ssize_t)mHopFrames : (ssize_t)mNextPos;
+
+    size_t numFramesNeeded = pos + 2 * mHopFrames + (search ? mSearchFrames : 0);
+    if (mNumInputFrames < numFramesNeeded) {
+        return false;
+    }
+
+    // Past the end of stream only the silence appended to the input is
+    // left, the hop reaching into it is cut short.
+    size_t numOutputFrames = mHopFrames;
+    if (mEndFrame >= 0ll) {
+        double numFramesLeft = (mEndFrame - mInputStartFrame) - mNextPos;
+        if (numFramesLeft <= 0.0) {
+            return false;
+        }
+        if (numFramesLeft < mHopFrames * (double)mRate) {
+            numOutputFrames = (size_t)ceil(numFramesLeft / mRate);
+        }
+    }
+
+    nsecs_t startTimeNs = systemTime(SYSTEM_TIME_THREAD);
+
+    if (search) {
+        pos = findBestPos(pos);
+    }
+
+    size_t numSamples = mHopFrames * mChannelCount;
+    const float *segment = mInput + (mInputOffset + pos) * mChannelCount;
+
+    if (mHaveTail) {
+        // The tail is done with once faded out, it holds the result.
+        CrossFade(mTail, segment, mWindow, mTail, numSamples);
+        writeOutput(mTail, numSamples);
+    } else {
+        writeOutput(segment, numSamples);
+    }
+
+    memcpy(mTail, segment + numSamples, numSamples * sizeof(float));
+    memcpy(mTailMono, mMono + mInputOffset + pos + mHopFrames, mHopFrames * sizeof(float));
+    mHaveTail = true;
+
+    mNumOutputFrames = numOutputFrames;
+    mOutputOffset = 0;
+    mOutputTimeUs = frameTimeUs(mInputStartFrame + pos);
+    mNumFramesProduced += numOutputFrames;
+
+    mNextPos = (search ? mNextPos : pos) + mHopFrames * (double)mRate;
+    mLastPos = pos;
+
+    // Neither the next segment at 1.0 nor the search window reaches back
+    // further than this.
+    ssize_t keepFrom = (ssize_t)mNextPos - (ssize_t)mSearchFrames;
+    if (keepFrom > pos + (ssize_t)mHopFrames) {
+        keepFrom = pos + mHopFrames;
+    }
+    if (keepFrom > 0) {
+        discardInput(keepFrom);
+    }
+
+    mProcessTimeUs += (systemTime(SYSTEM_TIME_THREAD) - startTimeNs) / 1000ll;
+
+    return true;
+}
+
+}  // namespace android
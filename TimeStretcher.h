@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_STRETCHER_H
+#define TIME_STRETCHER_H
+
+#include <media/stagefright/foundation/ABase.h>
+#include <system/audio.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+// Changes the tempo of interleaved PCM 16 or packed 24 bit without changing
+// its pitch (WSOLA). Output is made of overlapping segments of the input,
+// taken rate times a hop apart, each one shifted within a small window to
+// where it lines up best with the one before, and cross-faded into it.
+//
+// Output is produced one hop at a time and has to be consumed before more
+// input is taken, so at most one hop is buffered on the output side.
+//
+// Not thread safe, owned by the player's looper.
+struct TimeStretcher : public RefBase {
+    TimeStretcher(
+            uint32_t sampleRate,
+            int32_t channelCount,
+            audio_format_t format = AUDIO_FORMAT_PCM_16_BIT);
+
+    // Takes effect with the next hop. At 1.0 segments follow each other
+    // without any search and the output equals the input.
+    void setRate(float rate);
+    float rate() const { return mRate; }
+
+    // numFrames frames, the first of which has media time timeUs. Input
+    // is assumed contiguous unless timeUs says otherwise. Input after the
+    // end of stream starts over as if after flush().
+    void queueInput(const void *data, size_t numFrames, int64_t timeUs);
+
+    // No more input will follow. getOutput() then returns the rest of the
+    // input stretched, the last hop cut short at the end of the input.
+    void signalEndOfStream();
+
+    // Output not consumed yet and the media time of its first frame. 0 if
+    // more input is needed first.
+    size_t getOutput(const void **data, int64_t *timeUs);
+    void consumeOutput(size_t numFrames);
+
+    // Drops all input and output, the next segment starts without a
+    // cross-fade.
+    void flush();
+
+    // Thread CPU time spent stretching and the output frames produced.
+    int64_t processTimeUs() const { return mProcessTimeUs; }
+    int64_t numFramesProduced() const { return mNumFramesProduced; }
+
+protected:
+    virtual ~TimeStretcher();
+
+private:
+    const uint32_t mSampleRate;
+    const int32_t mChannelCount;
+    const audio_format_t mFormat;
+    const size_t mFrameSize;
+    // Output per step, also the length of the cross-fade and the segment
+    // compared when searching.
+    const size_t mHopFrames;
+    // How far a segment may move off its nominal position.
+    const size_t mSearchFrames;
+    float mRate;
+
+    // Input from mInput + mInputOffset on, interleaved and normalized, along
+    // with its downmix to mono that the search runs on.
+    float *mInput;
+    float *mMono;
+    size_t mInputCapacity;
+    size_t mInputOffset;
+    size_t mNumInputFrames;
+    // Frames dropped off the front since flush(), and the frame at which
+    // mBaseTimeUs was taken.
+    int64_t mInputStartFrame;
+    int64_t mBaseFrame;
+    int64_t mBaseTimeUs;
+    // The frame after the last one, -1 before signalEndOfStream().
+    int64_t mEndFrame;
+
+    // Nominal position of the next segment and where the last one started,
+    // relative to the start of the input.
+    double mNextPos;
+    ssize_t mLastPos;
+
+    // The frames that followed the last segment, faded out under the next.
+    float *mTail;
+    float *mTailMono;
+    bool mHaveTail;
+
+    // Fade-in ramp, one value per sample of a hop.
+    float *mWindow;
+
+    uint8_t *mOutput;
+    size_t mNumOutputFrames;
+    size_t mOutputOffset;
+    int64_t mOutputTimeUs;
+
+    int64_t mProcessTimeUs;
+    int64_t mNumFramesProduced;
+
+    void reserveInput(size_t numFrames);
+    bool produceHop();
+    void writeOutput(const float *samples, size_t numSamples);
+    ssize_t findBestPos(ssize_t nominalPos) const;
+    int64_t frameTimeUs(int64_t frame) const;
+    void discardInput(size_t numFrames);
+
+    DISALLOW_EVIL_CONSTRUCTORS(TimeStretcher);
+};
+
+}  // namespace android
+
+#endif // TIME_STRETCHER_H
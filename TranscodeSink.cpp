@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "TranscodeSink"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include <gui/Surface.h>
+#include <media/MediaCodecBuffer.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaMuxer.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <utils/Log.h>
+#include <utils/Thread.h>
+
+#include "CodecStarter.h"
+#include "TranscodeSink.h"
+
+namespace android {
+
+// How long the drain loop blocks on the encoder at most.
+static const int64_t kDequeueTimeoutUs = 10000ll;
+
+static const int32_t kDefaultFrameRate = 30;
+static const int32_t kIFrameIntervalS = 1;
+// Bitrate derived from the resolution when none is given, in pixels per bit
+// and second.
+static const int64_t kPixelsPerBit = 8;
+
+struct TranscodeSink::Drainer : public Thread {
+    explicit Drainer(TranscodeSink *sink)
+        : Thread(false /* canCallJava */),
+          mSink(sink) {
+    }
+
+private:
+    // The sink joins the thread before it goes away.
+    TranscodeSink *mSink;
+
+    virtual bool threadLoop() {
+        return mSink->drainOutput();
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(Drainer);
+};
+
+TranscodeSink::TranscodeSink(
+        const char *sourcePath,
+        const char *outputPath,
+        const char *mime,
+        int32_t bitrate,
+        bool preferSoftwareCodecs)
+    : mSourcePath(sourcePath),
+      mOutputPath(outputPath),
+      mMime(mime),
+      mBitrate(bitrate),
+      mPreferSoftwareCodecs(preferSoftwareCodecs),
+      mFd(-1),
+      mMuxerStarted(false),
+      mVideoTrack(-1),
+      mAudioSourceTrack(-1),
+      mAudioTrack(-1),
+      mAudioEOS(false),
+      mStartTimeUs(-1ll),
+      mDone(false),
+      mFinalStatus(OK),
+      mNumFramesEncoded(0ll),
+      mEncodeTimeUs(0ll),
+      mNumBytesWritten(0ll),
+      mNumAudioSamplesCopied(0ll) {
+}
+
+TranscodeSink::~TranscodeSink() {
+    if (mDrainer != NULL) {
+        mDrainer->requestExitAndWait();
+    }
+
+    if (mEncoder != NULL) {
+        mEncoder->release();
+    }
+
+    if (mFd >= 0) {
+        close(mFd);
+    }
+
+    if (mCodecLooper != NULL) {
+        mCodecLooper->stop();
+    }
+}
+
+status_t TranscodeSink::init() {
+    mExtractor = new NuMediaExtractor(NuMediaExtractor::EntryPoint::OTHER);
+
+    status_t err = mExtractor->setDataSource(NULL /* httpService */, mSourcePath.c_str());
+    if (err != OK) {
+        ALOGE("cannot open %s: %d", mSourcePath.c_str(), err);
+        return err;
+    }
+
+    sp<AMessage> videoFormat;
+    for (size_t i = 0; i < mExtractor->countTracks(); ++i) {
+        sp<AMessage> format;
+        CHECK_EQ(mExtractor->getTrackFormat(i, &format), (status_t)OK);
+
+        AString mime;
+        CHECK(format->findString("mime", &mime));
+
+        if (videoFormat == NULL && !strncasecmp(mime.c_str(), "video/", 6)) {
+            videoFormat = format;
+        } else if (mAudioSourceTrack < 0 && !strncasecmp(mime.c_str(), "audio/", 6)) {
+            mAudioSourceTrack = i;
+            CHECK_EQ(mExtractor->selectTrack(i), (status_t)OK);
+        }
+    }
+
+    if (videoFormat == NULL) {
+        ALOGE("%s has no video track", mSourcePath.c_str());
+        return ERROR_UNSUPPORTED;
+    }
+
+    int32_t width;
+    int32_t height;
+    CHECK(videoFormat->findInt32(KEY_WIDTH, &width));
+    CHECK(videoFormat->findInt32(KEY_HEIGHT, &height));
+
+    int32_t frameRate;
+    if (!videoFormat->findInt32(KEY_FRAME_RATE, &frameRate) || frameRate <= 0) {
+        frameRate = kDefaultFrameRate;
+    }
+
+    int32_t bitrate = mBitrate;
+    if (bitrate <= 0) {
+        bitrate = (int32_t)((int64_t)width * height * frameRate / kPixelsPerBit);
+    }
+
+    sp<AMessage> format = new AMessage;
+    format->setString(KEY_MIME, mMime);
+    format->setInt32(KEY_WIDTH, width);
+    format->setInt32(KEY_HEIGHT, height);
+    format->setInt32(KEY_COLOR_FORMAT, COLOR_FormatSurface);
+    format->setInt32(KEY_BIT_RATE, bitrate);
+    format->setInt32(KEY_FRAME_RATE, frameRate);
+    format->setInt32(KEY_I_FRAME_INTERVAL, kIFrameIntervalS);
+
+    mCodecLooper = new ALooper;
+    mCodecLooper->setName("TranscodeSink");
+    mCodecLooper->start();
+
+    mEncoder = CodecStarter::CreateCodec(
+            mCodecLooper, mMime, true /* encoder */, mPreferSoftwareCodecs);
+    if (mEncoder == NULL) {
+        ALOGE("no encoder for %s", mMime.c_str());
+        return ERROR_UNSUPPORTED;
+    }
+
+    err = mEncoder->configure(
+            format, NULL /* surface */, NULL /* crypto */, MediaCodec::CONFIGURE_FLAG_ENCODE);
+    if (err != OK) {
+        ALOGE("cannot configure the encoder for %dx%d at %d bps: %d",
+                width, height, bitrate, err);
+        return err;
+    }
+
+    err = mEncoder->createInputSurface(&mInputSurface);
+    if (err != OK) {
+        return err;
+    }
+
+    err = mEncoder->start();
+    if (err != OK) {
+        return err;
+    }
+
+    mFd = open(mOutputPath.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (mFd < 0) {
+        ALOGE("cannot create %s: %s", mOutputPath.c_str(), strerror(errno));
+        return -errno;
+    }
+
+    mMuxer = MediaMuxer::create(mFd, MediaMuxer::OUTPUT_FORMAT_MPEG_4);
+    if (mMuxer == NULL) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    // The decoder does not rotate frames rendered to the encoder.
+    int32_t rotationDegrees;
+    if (videoFormat->findInt32(KEY_ROTATION, &rotationDegrees)) {
+        mMuxer->setOrientationHint(rotationDegrees);
+    }
+
+    ALOGV("encoding %dx%d at %d fps, %d bps", width, height, frameRate, bitrate);
+
+    return OK;
+}
+
+status_t TranscodeSink::start() {
+    CHECK(mDrainer == NULL);
+
+    mStartTimeUs = ALooper::GetNowUs();
+    mDrainer = new Drainer(this);
+    return mDrainer->run("TranscodeSink");
+}
+
+status_t TranscodeSink::signalEndOfInputStream() {
+    return mEncoder->signalEndOfInputStream();
+}
+
+status_t TranscodeSink::waitForCompletion() {
+    Mutex::Autolock autoLock(mLock);
+    while (!mDone) {
+        mCondition.wait(mLock);
+    }
+    return mFinalStatus;
+}
+
+status_t TranscodeSink::onFormatChanged() {
+    // Only the encoder knows the codec specific data, nothing can be muxed
+    // before it does.
+    CHECK(!mMuxerStarted);
+
+    sp<AMessage> format;
+    status_t err = mEncoder->getOutputFormat(&format);
+    if (err != OK) {
+        return err;
+    }
+
+    mVideoTrack = mMuxer->addTrack(format);
+    if (mVideoTrack < 0) {
+        return mVideoTrack;
+    }
+
+    if (mAudioSourceTrack >= 0) {
+        sp<AMessage> audioFormat;
+        CHECK_EQ(mExtractor->getTrackFormat(mAudioSourceTrack, &audioFormat), (status_t)OK);
+
+        mAudioTrack = mMuxer->addTrack(audioFormat);
+        if (mAudioTrack < 0) {
+            return mAudioTrack;
+        }
+    }
+
+    err = mMuxer->start();
+    mMuxerStarted = err == OK;
+    return err;
+}
+
+status_t TranscodeSink::copyAudio(int64_t timeUs) {
+    while (mAudioTrack >= 0 && !mAudioEOS) {
+        int64_t sampleTimeUs;
+        if (mExtractor->getSampleTime(&sampleTimeUs) != OK) {
+            mAudioEOS = true;
+            break;
+        }
+
+        if (sampleTimeUs > timeUs) {
+            break;
+        }
+
+        size_t sampleSize;
+        CHECK_EQ(mExtractor->getSampleSize(&sampleSize), (status_t)OK);
+
+        if (mAudioBuffer == NULL || mAudioBuffer->capacity() < sampleSize) {
+            mAudioBuffer = new ABuffer(sampleSize);
+        }
+
+        status_t err = mExtractor->readSampleData(mAudioBuffer);
+        if (err != OK) {
+            return err;
+        }
+
+        err = mMuxer->writeSampleData(
+                mAudioBuffer, mAudioTrack, sampleTimeUs, MediaCodec::BUFFER_FLAG_SYNCFRAME);
+        if (err != OK) {
+            return err;
+        }
+
+        ++mNumAudioSamplesCopied;
+        mNumBytesWritten += mAudioBuffer->size();
+
+        mExtractor->advance();
+    }
+
+    return OK;
+}
+
+void TranscodeSink::finish(status_t err) {
+    mEncodeTimeUs.store(ALooper::GetNowUs() - mStartTimeUs);
+
+    if (mMuxerStarted) {
+        status_t stopErr = mMuxer->stop();
+        if (err == OK) {
+            err = stopErr;
+        }
+    } else if (err == OK) {
+        ALOGE("the encoder ended without output");
+        err = ERROR_MALFORMED;
+    }
+    mMuxer.clear();
+
+    close(mFd);
+    mFd = -1;
+
+    // Released with the sink, the player may still signal the end of
+    // stream to it.
+    mEncoder->stop();
+
+    ALOGV("%" PRId64 " frames, %" PRId64 " audio samples, %" PRId64 " bytes in %" PRId64 " us",
+            mNumFramesEncoded.load(), mNumAudioSamplesCopied.load(),
+            mNumBytesWritten.load(), mEncodeTimeUs.load());
+
+    Mutex::Autolock autoLock(mLock);
+    mDone = true;
+    mFinalStatus = err;
+    mCondition.broadcast();
+}
+
+bool TranscodeSink::drainOutput() {
+    size_t index;
+    size_t offset;
+    size_t size;
+    int64_t timeUs;
+    uint32_t flags;
+    status_t err = mEncoder->dequeueOutputBuffer(
+            &index, &offset, &size, &timeUs, &flags, kDequeueTimeoutUs);
+
+    if (err == -EAGAIN || err == INFO_OUTPUT_BUFFERS_CHANGED) {
+        return true;
+    } else if (err == INFO_FORMAT_CHANGED) {
+        err = onFormatChanged();
+        if (err != OK) {
+            ALOGE("cannot set up the muxer: %d", err);
+            finish(err);
+            return false;
+        }
+        return true;
+    } else if (err != OK) {
+        ALOGE("dequeueOutputBuffer returned %d", err);
+        finish(err);
+        return false;
+    }
+
+    // The codec specific data already went out with the output format.
+    if (size > 0 && !(flags & MediaCodec::BUFFER_FLAG_CODECCONFIG)) {
+        CHECK(mMuxerStarted);
+
+        sp<MediaCodecBuffer> buffer;
+        CHECK_EQ(mEncoder->getOutputBuffer(index, &buffer), (status_t)OK);
+
+        err = copyAudio(timeUs);
+        if (err == OK) {
+            err = mMuxer->writeSampleData(
+                    new ABuffer(buffer->data(), buffer->size()),
+                    mVideoTrack,
+                    timeUs,
+                    flags & MediaCodec::BUFFER_FLAG_SYNCFRAME);
+        }
+
+        ++mNumFramesEncoded;
+        mNumBytesWritten += size;
+    }
+
+    mEncoder->releaseOutputBuffer(index);
+
+    if (err != OK) {
+        ALOGE("cannot write the sample at %" PRId64 " us: %d", timeUs, err);
+        finish(err);
+        return false;
+    }
+
+    if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+        finish(copyAudio(INT64_MAX));
+        return false;
+    }
+
+    return true;
+}
+
+}  // namespace android
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRANSCODE_SINK_H
+#define TRANSCODE_SINK_H
+
+#include <atomic>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Condition.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+struct ABuffer;
+struct ALooper;
+class IGraphicBufferProducer;
+struct MediaCodec;
+struct MediaMuxer;
+struct NuMediaExtractor;
+
+// Re-encodes the video a player decodes and writes it to an MP4 file. The
+// decoder renders into inputSurface(), the input Surface of a MediaCodec
+// encoder, so decoded frames are handed to the encoder as graphic buffers
+// and never copied through CPU memory. A thread of its own drains the encoder
+// into a MediaMuxer and copies the audio of the source over as it is, read
+// through a separate extractor and interleaved by timestamp.
+struct TranscodeSink : public RefBase {
+    // mime is the video format to encode to, bitrate in bits per second,
+    // 0 for one derived from the source.
+    TranscodeSink(
+            const char *sourcePath,
+            const char *outputPath,
+            const char *mime,
+            int32_t bitrate,
+            bool preferSoftwareCodecs);
+
+    // Sets up the encoder and the muxer from the source's video track.
+    status_t init();
+
+    const sp<IGraphicBufferProducer> &inputSurface() const { return mInputSurface; }
+
+    // Starts draining the encoder on a thread of its own.
+    status_t start();
+
+    // Once the decoder rendering into inputSurface() has output its last
+    // frame.
+    status_t signalEndOfInputStream();
+
+    // Blocks until the encoder has output its last frame and the file is
+    // complete.
+    status_t waitForCompletion();
+
+    int64_t numFramesEncoded() const { return mNumFramesEncoded.load(); }
+    // From start() to the encoder's last frame.
+    int64_t encodeTimeUs() const { return mEncodeTimeUs.load(); }
+    int64_t numBytesWritten() const { return mNumBytesWritten.load(); }
+    int64_t numAudioSamplesCopied() const { return mNumAudioSamplesCopied.load(); }
+
+protected:
+    virtual ~TranscodeSink();
+
+private:
+    struct Drainer;
+
+    AString mSourcePath;
+    AString mOutputPath;
+    AString mMime;
+    int32_t mBitrate;
+    bool mPreferSoftwareCodecs;
+
+    sp<ALooper> mCodecLooper;
+    sp<MediaCodec> mEncoder;
+    sp<IGraphicBufferProducer> mInputSurface;
+    int mFd;
+    sp<MediaMuxer> mMuxer;
+    bool mMuxerStarted;
+    ssize_t mVideoTrack;
+
+    sp<NuMediaExtractor> mExtractor;
+    ssize_t mAudioSourceTrack;
+    ssize_t mAudioTrack;
+    bool mAudioEOS;
+    sp<ABuffer> mAudioBuffer;
+
+    sp<Drainer> mDrainer;
+    int64_t mStartTimeUs;
+
+    Mutex mLock;
+    Condition mCondition;
+    bool mDone;
+    status_t mFinalStatus;
+
+    std::atomic<int64_t> mNumFramesEncoded;
+    std::atomic<int64_t> mEncodeTimeUs;
+    std::atomic<int64_t> mNumBytesWritten;
+    std::atomic<int64_t> mNumAudioSamplesCopied;
+
+    status_t onFormatChanged();
+    // Writes the audio samples up to and including timeUs.
+    status_t copyAudio(int64_t timeUs);
+    void finish(status_t err);
+    bool drainOutput();
+
+    DISALLOW_EVIL_CONSTRUCTORS(TranscodeSink);
+};
+
+}  // namespace android
+
+#endif // TRANSCODE_SINK_H
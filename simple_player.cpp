@@ -16,10 +16,34 @@
 
 //#define LOG_NDEBUG 0
 #define LOG_TAG "simple_player"
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
 #include <inttypes.h>
+#include <linux/perf_event.h>
+#include <math.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utils/KeyedVector.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
+#include "CodecPool.h"
+#include "ExtractorSampleSource.h"
+#include "FrameExportRing.h"
+#include "LatencyHistogram.h"
+#include "LoopbackHttpServer.h"
+#include "MmapFileSource.h"
+#include "PcmKernels.h"
+#include "Remuxer.h"
+#include "Resampler.h"
 #include "SimplePlayer.h"
+#include "ThrottledFileSource.h"
+#include "TimeStretcher.h"
+#include "TranscodeSink.h"
 
 #include <binder/IServiceManager.h>
 #include <binder/ProcessState.h>
@@ -43,20 +67,1205 @@
 
 using namespace android;
 
+// Stopped decoders kept by -p, with gapless playback an item reuses the
+// decoders of the one before the previous item.
+static const int64_t kCodecPoolMaxBytes = 128ll * 1024 * 1024;
+static const int64_t kCodecPoolMaxIdleUs = 30000000ll;
+
+// Room for a padded 1080p frame at up to 16 bits per sample, -x.
+static const size_t kFrameExportSlotSize = 8 * 1024 * 1024;
+static const int64_t kFrameConsumerPollUs = 1000ll;
+
 static void usage(const char *me) {
-    fprintf(stderr, "usage: %s \n"
-                    "\tsimple_player /sdcard/video.mp4 \n",
+    fprintf(stderr, "usage: %s [-a] [-b] [-c file] [-d] [-e out.mp4] [-i] [-k seconds] [-K] [-l] [-m] [-M file] [-p] [-Q] [-r rate] [-R quality] [-s] [-S] [-t KB/s] [-T] [-u] [-v] [-w KB/s[:ms]] [-x slots] [-X out.mp4] /sdcard/video.mp4 [/sdcard/next.mp4 ...]\n"
+                    "\tseveral files play back to back, each prerolled while the previous one plays\n"
+                    "\t-a drive the codecs asynchronously (MediaCodec callbacks)\n"
+                    "\t-b benchmark: decode as fast as possible, no surface/audio\n"
+                    "\t-c keep what is downloaded of http:// urls in the given file too, one per item\n"
+                    "\t-d demux on a dedicated thread\n"
+                    "\t-e transcode the video of a single file to AVC in out.mp4, decoded into the\n"
+                    "\t   encoder's input surface, audio copied as is, as fast as the encoder goes\n"
+                    "\t-i read samples through a sample index sidecar, written on the first full play\n"
+                    "\t-k seek around the first given seconds in every seek mode\n"
+                    "\t-K measure the throughput of the audio sample kernels, plain and vectorized, then exit\n"
+                    "\t-l low-latency mode: no start lead, video rendered once decoded, fast audio,\n"
+                    "\t   reports the time from queueing each frame to rendering it\n"
+                    "\t-m read local files through a memory mapped source with read-ahead\n"
+                    "\t-M compare reading every sample of a file through the path and through -m, then exit\n"
+                    "\t-p keep decoders in a pool across playlist items instead of releasing them\n"
+                    "\t-Q measure the cost of resampling audio at each quality, then exit\n"
+                    "\t-r play back at the given rate, 0.25 to 4, audio keeps its pitch\n"
+                    "\t-R resample audio to the native output rate in the player, quality 0 (low) to 2 (high)\n"
+                    "\t-s print playback statistics, frame latencies and CPU usage at the end\n"
+                    "\t-S prefer software (c2.android.*) decoders\n"
+                    "\t-t throttle file reads to the given bandwidth\n"
+                    "\t-T measure the CPU cost of time-stretching audio at each rate, then exit\n"
+                    "\t-u print where the time to the first frame and the first audio went\n"
+                    "\t-v hand video frames to the display two vsyncs ahead, timestamped\n"
+                    "\t-w play the files over http from a loopback server that sends at most the\n"
+                    "\t   given bandwidth, 0 for unlimited, and answers every request ms late\n"
+                    "\t-x export decoded video into a shared memory ring with the given number of\n"
+                    "\t   slots instead of the display, read by a consumer process in place\n"
+                    "\t-X copy the tracks a player would play from a file into out.mp4 without decoding,\n"
+                    "\t   through -m if given, report the throughput, then exit\n",
                     me);
     exit(1);
 }
 
+static int64_t getCpuTimeUs() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1ll;
+    }
+
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ll
+            + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// CPU time of the threads of the processes hosting the decoders, sampled
+// from /proc before and after playback. c2.android.* run in media.swcodec,
+// each component on a looper thread named after it.
+struct CodecServiceCpu {
+    struct Thread {
+        AString mName;
+        int64_t mCpuUs;
+    };
+
+    KeyedVector<pid_t, Thread> mThreads;
+};
+
+// What the kernel keeps of a thread name.
+static const size_t kMaxThreadNameLength = 15;
+
+static bool isCodecServiceProcess(const char *pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%s/cmdline", pid);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    char cmdline[256];
+    ssize_t n = read(fd, cmdline, sizeof(cmdline) - 1);
+    close(fd);
+    if (n <= 0) {
+        return false;
+    }
+    cmdline[n] = '\0';
+
+    return strstr(cmdline, "mediaswcodec") != NULL
+        || strstr(cmdline, "media.c2") != NULL
+        || strstr(cmdline, "media.codec") != NULL;
+}
+
+static bool readThreadCpu(const char *path, CodecServiceCpu::Thread *thread) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    char stat[512];
+    ssize_t n = read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+    if (n <= 0) {
+        return false;
+    }
+    stat[n] = '\0';
+
+    // "tid (name) state ppid ...", the name may hold anything but the
+    // fields after it do not, utime and stime are fields 14 and 15.
+    char *nameStart = strchr(stat, '(');
+    char *nameEnd = strrchr(stat, ')');
+    if (nameStart == NULL || nameEnd == NULL || nameEnd < nameStart) {
+        return false;
+    }
+
+    unsigned long long utime, stime;
+    if (sscanf(nameEnd + 1,
+               " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+               &utime, &stime) != 2) {
+        return false;
+    }
+
+    thread->mName.setTo(nameStart + 1, nameEnd - nameStart - 1);
+    thread->mCpuUs = (int64_t)(utime + stime) * 1000000ll / sysconf(_SC_CLK_TCK);
+    return true;
+}
+
+static void sampleCodecServiceCpu(CodecServiceCpu *cpu) {
+    cpu->mThreads.clear();
+
+    DIR *procDir = opendir("/proc");
+    if (procDir == NULL) {
+        return;
+    }
+
+    struct dirent *process;
+    while ((process = readdir(procDir)) != NULL) {
+        if (!isdigit(process->d_name[0]) || !isCodecServiceProcess(process->d_name)) {
+            continue;
+        }
+
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%s/task", process->d_name);
+        DIR *taskDir = opendir(path);
+        if (taskDir == NULL) {
+            continue;
+        }
+
+        struct dirent *task;
+        while ((task = readdir(taskDir)) != NULL) {
+            if (!isdigit(task->d_name[0])) {
+                continue;
+            }
+
+            snprintf(path, sizeof(path), "/proc/%s/task/%s/stat", process->d_name, task->d_name);
+            CodecServiceCpu::Thread thread;
+            if (readThreadCpu(path, &thread)) {
+                cpu->mThreads.add(atoi(task->d_name), thread);
+            }
+        }
+        closedir(taskDir);
+    }
+    closedir(procDir);
+}
+
+// CPU time the codec service threads took between the two samples, only that
+// of the threads named after the codec if one is given. Threads that went
+// away in between are not accounted for.
+static int64_t getCodecServiceCpuUs(
+        const CodecServiceCpu &start, const CodecServiceCpu &end, const char *codecName) {
+    AString threadName;
+    if (codecName != NULL) {
+        size_t length = strlen(codecName);
+        threadName.setTo(codecName, length < kMaxThreadNameLength ? length : kMaxThreadNameLength);
+    }
+
+    int64_t cpuUs = 0ll;
+    for (size_t i = 0; i < end.mThreads.size(); ++i) {
+        const CodecServiceCpu::Thread &thread = end.mThreads.valueAt(i);
+        if (codecName != NULL && thread.mName != threadName) {
+            continue;
+        }
+
+        cpuUs += thread.mCpuUs;
+        ssize_t index = start.mThreads.indexOfKey(end.mThreads.keyAt(i));
+        if (index >= 0) {
+            cpuUs -= start.mThreads.valueAt(index).mCpuUs;
+        }
+    }
+
+    return cpuUs;
+}
+
+// Stands in for a consumer in another process. Maps the ring from fd and
+// reads every frame in place, summing up its luma plane, until the ring is
+// closed and drained.
+static void runFrameConsumer(int fd) {
+    sp<FrameExportRing> ring = FrameExportRing::Map(fd);
+    if (ring == NULL) {
+        fprintf(stderr, "frame consumer: cannot map the ring\n");
+        return;
+    }
+
+    uint64_t next = 0;
+    int64_t numRead = 0ll;
+    int64_t numMissed = 0ll;
+    int64_t numTorn = 0ll;
+    int64_t numBytesRead = 0ll;
+    int64_t firstUs = -1ll;
+    int64_t lastUs = -1ll;
+    uint64_t lumaSum = 0;
+
+    for (;;) {
+        FrameExportRing::Frame frame;
+        status_t err = ring->acquireFrame(next, &frame);
+
+        if (err == NOT_ENOUGH_DATA) {
+            if (ring->closed() && next >= ring->numPublished()) {
+                break;
+            }
+            usleep(kFrameConsumerPollUs);
+            continue;
+        } else if (err == BAD_INDEX) {
+            // Fell behind by a whole ring.
+            uint64_t oldest = ring->oldestIndex();
+            if (oldest > next) {
+                numMissed += oldest - next;
+                next = oldest;
+            }
+            continue;
+        }
+
+        const FrameExportRing::FrameInfo &info = frame.mInfo;
+        const FrameExportRing::Plane &luma = info.mPlanes[0];
+        if (info.mNumPlanes > 0 && info.mWidth > 0 && info.mHeight > 0
+                && luma.mOffset + (int64_t)(info.mHeight - 1) * luma.mRowInc
+                        + (int64_t)(info.mWidth - 1) * luma.mColInc < (int64_t)frame.mSize) {
+            for (uint32_t y = 0; y < info.mHeight; ++y) {
+                const uint8_t *row = frame.mData + luma.mOffset + (int64_t)y * luma.mRowInc;
+                for (uint32_t x = 0; x < info.mWidth; ++x) {
+                    lumaSum += row[(int64_t)x * luma.mColInc];
+                }
+            }
+        }
+
+        if (ring->validateFrame(frame)) {
+            ++numRead;
+            numBytesRead += frame.mSize;
+        } else {
+            ++numTorn;
+        }
+        ++next;
+
+        lastUs = ALooper::GetNowUs();
+        if (firstUs < 0ll) {
+            firstUs = lastUs;
+        }
+    }
+
+    double seconds = (lastUs - firstUs) / 1E6;
+    printf("frame consumer: %" PRId64 " frames read in place, no copies",
+           numRead);
+    if (seconds > 0.0) {
+        printf(", %.1f frames/s, %.1f MB/s", numRead / seconds, numBytesRead / seconds / 1E6);
+    }
+    printf(", %" PRId64 " overrun, %" PRId64 " torn (luma sum %" PRIu64 ")\n",
+           numMissed, numTorn, lumaSum);
+}
+
+// read() and pread() calls of this process so far, -1 if unknown.
+static int64_t getReadSyscalls() {
+    FILE *file = fopen("/proc/self/io", "r");
+    if (file == NULL) {
+        return -1ll;
+    }
+
+    char line[64];
+    long long value;
+    int64_t numSyscalls = -1ll;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "syscr: %lld", &value) == 1) {
+            numSyscalls = value;
+            break;
+        }
+    }
+
+    fclose(file);
+    return numSyscalls;
+}
+
+// Reads every sample of path with NuMediaExtractor, once from the path and
+// once through MmapFileSource. The file's pages are dropped from the page
+// cache before each pass so both start cold.
+static void runDataSourceBenchmark(const char *path) {
+    for (int pass = 0; pass < 2; ++pass) {
+        bool mapped = pass == 1;
+
+        int fd = open(path, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+        if (fd < 0) {
+            fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+            return;
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+
+        struct rusage startUsage;
+        getrusage(RUSAGE_SELF, &startUsage);
+        int64_t startSyscalls = getReadSyscalls();
+        int64_t startUs = ALooper::GetNowUs();
+
+        sp<NuMediaExtractor> extractor =
+            new NuMediaExtractor(NuMediaExtractor::EntryPoint::OTHER);
+        sp<MmapFileSource> source;
+
+        status_t err;
+        if (mapped) {
+            source = new MmapFileSource(path);
+            err = extractor->setDataSource(source);
+        } else {
+            err = extractor->setDataSource(NULL /* httpService */, path);
+        }
+
+        if (err != OK) {
+            fprintf(stderr, "cannot extract %s: %d\n", path, err);
+            return;
+        }
+
+        for (size_t i = 0; i < extractor->countTracks(); ++i) {
+            extractor->selectTrack(i);
+        }
+
+        LatencyHistogram latency;
+        int64_t numSamples = 0ll;
+        int64_t numBytes = 0ll;
+        sp<ABuffer> buffer = new ABuffer(1024 * 1024);
+
+        size_t sampleSize;
+        while (extractor->getSampleSize(&sampleSize) == OK) {
+            if (sampleSize > buffer->capacity()) {
+                buffer = new ABuffer(sampleSize);
+            }
+
+            nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+            CHECK_EQ(extractor->readSampleData(buffer), (status_t)OK);
+            latency.record((systemTime(SYSTEM_TIME_MONOTONIC) - startNs) / 1000ll);
+
+            ++numSamples;
+            numBytes += buffer->size();
+            extractor->advance();
+        }
+
+        double seconds = (ALooper::GetNowUs() - startUs) / 1E6;
+        int64_t numSyscalls = getReadSyscalls() - startSyscalls;
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        printf("%s: %" PRId64 " samples, %.1f MB in %.2f s\n",
+               mapped ? "mmap source" : "path source", numSamples, numBytes / 1E6, seconds);
+        if (startSyscalls >= 0ll) {
+            printf("  %" PRId64 " read syscalls, %.0f/s, %.2f per sample\n",
+                   numSyscalls,
+                   seconds > 0.0 ? numSyscalls / seconds : 0.0,
+                   numSamples > 0 ? (double)numSyscalls / numSamples : 0.0);
+        }
+        printf("  %ld page faults, %ld major\n",
+               (usage.ru_minflt + usage.ru_majflt) - (startUsage.ru_minflt + startUsage.ru_majflt),
+               usage.ru_majflt - startUsage.ru_majflt);
+        printf("  sample read latency avg %" PRId64 " us, p50 %" PRId64 " us, p99 %" PRId64
+               " us, max %" PRId64 " us\n",
+               latency.meanUs(), latency.percentileUs(50), latency.percentileUs(99),
+               latency.maxUs());
+        if (mapped) {
+            printf("  %" PRId64 " reads, %" PRId64 " read-aheads, %" PRId64 " preads\n",
+                   source->numReads(), source->numReadAheads(), source->numPreads());
+        }
+    }
+}
+
+// Remuxes the tracks a player would play from path into outputPath, from a
+// cold page cache and with the output synced to disk, and reports where the
+// time went. The samples are copied through a single buffer, so what is left
+// is reading the source and writing the file.
+static void runRemuxBenchmark(const char *path, const char *outputPath, bool mapped) {
+    int fd = open(path, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+
+    int outputFd = open(outputPath, O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644);
+    if (outputFd < 0) {
+        fprintf(stderr, "cannot create %s: %s\n", outputPath, strerror(errno));
+        return;
+    }
+
+    int64_t startCpuUs = getCpuTimeUs();
+    int64_t startUs = ALooper::GetNowUs();
+
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor(NuMediaExtractor::EntryPoint::OTHER);
+    status_t err;
+    if (mapped) {
+        err = extractor->setDataSource(new MmapFileSource(path));
+    } else {
+        err = extractor->setDataSource(NULL /* httpService */, path);
+    }
+
+    if (err != OK) {
+        fprintf(stderr, "cannot extract %s: %d\n", path, err);
+        close(outputFd);
+        return;
+    }
+
+    sp<SampleSource> source = new ExtractorSampleSource(extractor);
+
+    ssize_t audioTrack;
+    ssize_t videoTrack;
+    SimplePlayer::FindTracks(source, &audioTrack, &videoTrack);
+
+    sp<Remuxer> remuxer = new Remuxer(source, outputFd);
+    size_t numTracks = 0;
+    if (audioTrack >= 0) {
+        remuxer->addTrack(audioTrack);
+        ++numTracks;
+    }
+    if (videoTrack >= 0) {
+        remuxer->addTrack(videoTrack);
+        ++numTracks;
+    }
+
+    err = remuxer->run();
+    fsync(outputFd);
+    close(outputFd);
+
+    int64_t elapsedUs = ALooper::GetNowUs() - startUs;
+    int64_t cpuUs = getCpuTimeUs() - startCpuUs;
+
+    if (err != OK) {
+        fprintf(stderr, "cannot remux %s: %d\n", path, err);
+        return;
+    }
+
+    double seconds = elapsedUs / 1E6;
+    printf("remux: %zu of %zu tracks, %" PRId64 " samples, %.1f MB in %.2f s, %.1f MB/s\n",
+           numTracks, source->countTracks(), remuxer->numSamples(),
+           remuxer->numBytes() / 1E6, seconds,
+           seconds > 0.0 ? remuxer->numBytes() / 1E6 / seconds : 0.0);
+    printf("  reading %.1f%%, writing %.1f%% of the time, cpu %.1f%%\n",
+           elapsedUs > 0 ? remuxer->readTimeUs() * 100.0 / elapsedUs : 0.0,
+           elapsedUs > 0 ? remuxer->writeTimeUs() * 100.0 / elapsedUs : 0.0,
+           elapsedUs > 0 ? cpuUs * 100.0 / elapsedUs : 0.0);
+    printf("  %" PRId64 " sample buffer allocations for %" PRId64 " samples\n",
+           remuxer->numBufferAllocations(), remuxer->numSamples());
+}
+
+// CPU time the time stretcher takes per second of audio played, at each
+// rate, on synthetic 48 kHz stereo: a chord with some noise on top.
+static void runTimeStretchBenchmark() {
+    static const uint32_t kSampleRate = 48000;
+    static const int32_t kChannelCount = 2;
+    static const size_t kDurationSecs = 30;
+    static const size_t kFramesPerBuffer = 1024;
+    static const float kRates[] = {
+        0.25f, 0.5f, 0.75f, 1.0f, 1.25f, 1.5f, 2.0f, 3.0f, 4.0f,
+    };
+
+    size_t numFrames = kSampleRate * kDurationSecs;
+    int16_t *pcm = new int16_t[numFrames * kChannelCount];
+
+    uint32_t seed = 1;
+    for (size_t i = 0; i < numFrames; ++i) {
+        double t = (double)i / kSampleRate;
+        double value = 6000.0 * sin(2.0 * M_PI * 220.0 * t)
+            + 4000.0 * sin(2.0 * M_PI * 277.2 * t)
+            + 3000.0 * sin(2.0 * M_PI * 329.6 * t);
+
+        for (int32_t c = 0; c < kChannelCount; ++c) {
+            seed = seed * 1103515245u + 12345u;
+            pcm[i * kChannelCount + c] = (int16_t)(value + (int32_t)((seed >> 16) & 0x7ff) - 1024);
+        }
+    }
+
+    printf("time stretch, %u Hz, %d channels:\n", kSampleRate, kChannelCount);
+    for (size_t i = 0; i < sizeof(kRates) / sizeof(kRates[0]); ++i) {
+        sp<TimeStretcher> stretcher = new TimeStretcher(kSampleRate, kChannelCount);
+        stretcher->setRate(kRates[i]);
+
+        size_t offset = 0;
+        for (;;) {
+            const void *data;
+            int64_t timeUs;
+            size_t numFramesOut = stretcher->getOutput(&data, &timeUs);
+            if (numFramesOut > 0) {
+                stretcher->consumeOutput(numFramesOut);
+                continue;
+            }
+
+            if (offset == numFrames) {
+                break;
+            }
+
+            size_t numFramesIn = numFrames - offset;
+            if (numFramesIn > kFramesPerBuffer) {
+                numFramesIn = kFramesPerBuffer;
+            }
+
+            stretcher->queueInput(
+                    pcm + offset * kChannelCount,
+                    numFramesIn,
+                    offset * 1000000ll / kSampleRate);
+            offset += numFramesIn;
+        }
+
+        double secondsPlayed = (double)stretcher->numFramesProduced() / kSampleRate;
+        double cpuUsPerSecond = stretcher->processTimeUs() / secondsPlayed;
+        printf("  %.2fx: %.3f ms cpu per s played (%.2f%% of a core)\n",
+               kRates[i], cpuUsPerSecond / 1E3, cpuUsPerSecond / 1E4);
+    }
+
+    delete[] pcm;
+}
+
+// Frames per second each PcmKernels kernel gets through, plain C++ against
+// vectorized, on blocks of white noise small enough to stay in cache.
+static void runPcmKernelBenchmark() {
+    static const size_t kNumFrames = 1024;
+    static const int32_t kMaxChannelCount = 8;
+    // Per kernel and variant.
+    static const nsecs_t kRunTimeNs = 250000000ll;
+
+    enum {
+        INT16_TO_FLOAT,
+        FLOAT_TO_INT16,
+        INT24_TO_FLOAT,
+        FLOAT_TO_INT24,
+        GAIN_RAMP,
+        DOWNMIX_5_1,
+        DOWNMIX_7_1,
+        DOT_PRODUCT,
+        NUM_KERNELS
+    };
+    static const char *kNames[NUM_KERNELS] = {
+        "int16 to float, stereo",
+        "float to int16, stereo",
+        "int24 to float, stereo",
+        "float to int24, stereo",
+        "gain ramp, stereo",
+        "downmix 5.1 to stereo",
+        "downmix 7.1 to stereo",
+        "dot product, 32 taps",
+    };
+
+    size_t numSamples = kNumFrames * kMaxChannelCount;
+    float *in = new float[numSamples];
+    float *out = new float[numSamples];
+    int16_t *int16Samples = new int16_t[numSamples];
+    uint8_t *int24Samples = new uint8_t[numSamples * 3];
+
+    uint32_t seed = 1;
+    for (size_t i = 0; i < numSamples; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        in[i] = (int32_t)(seed >> 8) / 8388608.0f - 1.0f;
+    }
+    PcmKernels::Scalar().floatToInt16(in, int16Samples, numSamples);
+    PcmKernels::Scalar().floatToInt24(in, int24Samples, numSamples);
+
+    auto runKernel = [&](const PcmKernels &kernels, size_t kernel) {
+        size_t numStereoSamples = kNumFrames * 2;
+        switch (kernel) {
+            case INT16_TO_FLOAT:
+                kernels.int16ToFloat(int16Samples, out, numStereoSamples);
+                break;
+            case FLOAT_TO_INT16:
+                kernels.floatToInt16(in, int16Samples, numStereoSamples);
+                break;
+            case INT24_TO_FLOAT:
+                kernels.int24ToFloat(int24Samples, out, numStereoSamples);
+                break;
+            case FLOAT_TO_INT24:
+                kernels.floatToInt24(in, int24Samples, numStereoSamples);
+                break;
+            case GAIN_RAMP:
+                // Up and straight back down, the samples stay where they were.
+                kernels.applyGain(out, kNumFrames, 2, 1.0f, 1E-6f);
+                kernels.applyGain(out, kNumFrames, 2, 1.0f, -1E-6f);
+                break;
+            case DOWNMIX_5_1:
+                kernels.downmix5_1(in, out, kNumFrames);
+                break;
+            case DOWNMIX_7_1:
+                kernels.downmix7_1(in, out, kNumFrames);
+                break;
+            case DOT_PRODUCT:
+                // One stereo frame of a 32 tap filter each.
+                for (size_t i = 0; i < kNumFrames * 2; ++i) {
+                    out[i] = kernels.dotProduct(in + (i & 255), in + 4096, 32);
+                }
+                break;
+        }
+    };
+
+    printf("pcm kernels, %zu frame blocks, million frames per second:\n", kNumFrames);
+    if (!PcmKernels::HaveVectorized()) {
+        printf("  no vectorized kernels on this target\n");
+    }
+
+    for (size_t kernel = 0; kernel < NUM_KERNELS; ++kernel) {
+        double framesPerSec[2];
+        for (size_t vectorized = 0; vectorized < 2; ++vectorized) {
+            const PcmKernels &kernels =
+                vectorized ? PcmKernels::Vectorized() : PcmKernels::Scalar();
+
+            size_t numBlocks = 0;
+            nsecs_t startTimeNs = systemTime(SYSTEM_TIME_THREAD);
+            nsecs_t elapsedNs;
+            do {
+                runKernel(kernels, kernel);
+                ++numBlocks;
+                elapsedNs = systemTime(SYSTEM_TIME_THREAD) - startTimeNs;
+            } while (elapsedNs < kRunTimeNs);
+
+            size_t numFrames = numBlocks * kNumFrames * (kernel == GAIN_RAMP ? 2 : 1);
+            framesPerSec[vectorized] = numFrames * 1E9 / elapsedNs;
+        }
+
+        printf("  %-24s plain %8.2f, vectorized %8.2f, %.2fx\n",
+               kNames[kernel],
+               framesPerSec[0] / 1E6,
+               framesPerSec[1] / 1E6,
+               framesPerSec[1] / framesPerSec[0]);
+    }
+
+    delete[] in;
+    delete[] out;
+    delete[] int16Samples;
+    delete[] int24Samples;
+}
+
+// Cycles the calling thread spends in user space, where perf events are
+// allowed, -1 otherwise.
+static int openCycleCounter() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(__NR_perf_event_open, &attr, 0 /* pid */, -1 /* cpu */, -1 /* group */, 0);
+}
+
+static int64_t readCycleCounter(int fd) {
+    uint64_t cycles;
+    if (fd < 0 || read(fd, &cycles, sizeof(cycles)) != sizeof(cycles)) {
+        return -1ll;
+    }
+
+    return cycles;
+}
+
+// Cost per output sample of the Resampler at each quality, plain and
+// vectorized, on 10 s of synthetic stereo: a chord with noise on top.
+static void runResamplerBenchmark() {
+    static const int32_t kChannelCount = 2;
+    static const size_t kDurationSecs = 10;
+    static const size_t kFramesPerBuffer = 1024;
+    static const struct {
+        uint32_t mInputRate;
+        uint32_t mOutputRate;
+    } kRates[] = {
+        { 44100, 48000 },
+        { 48000, 44100 },
+        { 96000, 48000 },
+        { 22050, 48000 },
+    };
+
+    int cycleCounter = openCycleCounter();
+    if (cycleCounter < 0) {
+        printf("cpu cycle counter not available, time only\n");
+    }
+
+    for (size_t r = 0; r < sizeof(kRates) / sizeof(kRates[0]); ++r) {
+        uint32_t inputRate = kRates[r].mInputRate;
+        uint32_t outputRate = kRates[r].mOutputRate;
+
+        size_t numFrames = inputRate * kDurationSecs;
+        int16_t *pcm = new int16_t[numFrames * kChannelCount];
+
+        uint32_t seed = 1;
+        for (size_t i = 0; i < numFrames; ++i) {
+            double t = (double)i / inputRate;
+            double value = 6000.0 * sin(2.0 * M_PI * 220.0 * t)
+                + 4000.0 * sin(2.0 * M_PI * 2772.0 * t)
+                + 3000.0 * sin(2.0 * M_PI * 9960.0 * t);
+
+            for (int32_t c = 0; c < kChannelCount; ++c) {
+                seed = seed * 1103515245u + 12345u;
+                pcm[i * kChannelCount + c] =
+                    (int16_t)(value + (int32_t)((seed >> 16) & 0x7ff) - 1024);
+            }
+        }
+
+        printf("resample %u to %u Hz, %d channels:\n", inputRate, outputRate, kChannelCount);
+        for (size_t quality = 0; quality < Resampler::NUM_QUALITIES; ++quality) {
+            for (size_t vectorized = 0; vectorized < 2; ++vectorized) {
+                sp<Resampler> resampler = new Resampler(
+                        inputRate,
+                        outputRate,
+                        kChannelCount,
+                        AUDIO_FORMAT_PCM_16_BIT,
+                        static_cast<Resampler::Quality>(quality),
+                        vectorized ? PcmKernels::Vectorized() : PcmKernels::Scalar());
+
+                int64_t startCycles = readCycleCounter(cycleCounter);
+
+                size_t offset = 0;
+                for (;;) {
+                    const void *data;
+                    int64_t timeUs;
+                    size_t numFramesOut = resampler->getOutput(&data, &timeUs);
+                    if (numFramesOut > 0) {
+                        resampler->consumeOutput(numFramesOut);
+                        continue;
+                    }
+
+                    if (offset == numFrames) {
+                        break;
+                    }
+
+                    size_t numFramesIn = numFrames - offset;
+                    if (numFramesIn > kFramesPerBuffer) {
+                        numFramesIn = kFramesPerBuffer;
+                    }
+
+                    resampler->queueInput(
+                            pcm + offset * kChannelCount,
+                            numFramesIn,
+                            offset * 1000000ll / inputRate);
+                    offset += numFramesIn;
+                }
+
+                int64_t endCycles = readCycleCounter(cycleCounter);
+
+                double numSamples = (double)resampler->numFramesProduced() * kChannelCount;
+                double secondsPlayed = (double)resampler->numFramesProduced() / outputRate;
+                printf("  %-6s %2zu taps %-10s %6.2f ns/sample",
+                       Resampler::QualityName(static_cast<Resampler::Quality>(quality)),
+                       resampler->numTaps(),
+                       vectorized ? "vectorized" : "plain",
+                       resampler->processTimeUs() * 1E3 / numSamples);
+                if (startCycles >= 0ll && endCycles >= 0ll) {
+                    printf(", %6.1f cycles/sample", (endCycles - startCycles) / numSamples);
+                }
+                printf(", %.2f%% of a core\n",
+                       resampler->processTimeUs() / secondsPlayed / 1E4);
+            }
+        }
+
+        delete[] pcm;
+    }
+
+    if (cycleCounter >= 0) {
+        close(cycleCounter);
+    }
+}
+
+static void printBenchmarkResults(
+        const sp<AMessage> &stats, int64_t cpuUs, int64_t realUs,
+        const CodecServiceCpu &codecStart, const CodecServiceCpu &codecEnd) {
+    int64_t totalFrames = 0ll;
+    for (size_t i = 0; i < stats->countEntries(); ++i) {
+        AMessage::Type type;
+        const char *name = stats->getEntryNameAt(i, &type);
+
+        sp<AMessage> trackStats;
+        if (type != AMessage::kTypeMessage
+                || strncmp(name, "track-", 6)
+                || !stats->findMessage(name, &trackStats)) {
+            continue;
+        }
+
+        AString mime;
+        int64_t frames = 0, decodeTimeUs = 0, bytesCopied = 0, bytesDirect = 0;
+        trackStats->findString("type", &mime);
+        trackStats->findInt64("frames-decoded", &frames);
+        trackStats->findInt64("decode-time-us", &decodeTimeUs);
+        trackStats->findInt64("bytes-copied", &bytesCopied);
+        trackStats->findInt64("bytes-direct", &bytesDirect);
+
+        int32_t fromPool = 0;
+        int64_t setupUs = 0;
+        trackStats->findInt32("codec-from-pool", &fromPool);
+        trackStats->findInt64("codec-setup-us", &setupUs);
+
+        int64_t p50Us = 0, p90Us = 0, p99Us = 0, maxUs = 0;
+        trackStats->findInt64("decode-latency-p50-us", &p50Us);
+        trackStats->findInt64("decode-latency-p90-us", &p90Us);
+        trackStats->findInt64("decode-latency-p99-us", &p99Us);
+        trackStats->findInt64("decode-latency-max-us", &maxUs);
+
+        double seconds = decodeTimeUs / 1E6;
+        printf("%s (%s): %" PRId64 " frames in %.2f s, %.2f fps, %.2f MB/s\n",
+               name, mime.c_str(), frames, seconds,
+               seconds > 0 ? frames / seconds : 0.0,
+               seconds > 0 ? (bytesCopied + bytesDirect) / seconds / 1E6 : 0.0);
+        printf("  decode latency p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+               p50Us / 1E3, p90Us / 1E3, p99Us / 1E3, maxUs / 1E3);
+        printf("  codec setup %.2f ms%s\n", setupUs / 1E3, fromPool ? " (pooled)" : "");
+
+        // The codec thread is where a software decoder does its work, some
+        // hand part of it to helper threads that are only in the total.
+        AString codecName;
+        int64_t clientCpuUs = 0;
+        trackStats->findString("codec-name", &codecName);
+        trackStats->findInt64("client-cpu-us", &clientCpuUs);
+        printf("  cpu: player %.2f ms", clientCpuUs / 1E3);
+        if (!codecEnd.mThreads.isEmpty() && !codecName.empty()) {
+            int64_t codecCpuUs = getCodecServiceCpuUs(codecStart, codecEnd, codecName.c_str());
+            printf(", %s thread %.2f ms, %.2f ms per frame",
+                   codecName.c_str(), codecCpuUs / 1E3,
+                   frames > 0 ? (clientCpuUs + codecCpuUs) / 1E3 / frames : 0.0);
+        }
+        printf("\n");
+
+        totalFrames += frames;
+    }
+
+    int64_t prepareTimeUs = 0;
+    int32_t fromIndex = 0;
+    stats->findInt64("prepare-time-us", &prepareTimeUs);
+    stats->findInt32("prepare-from-sample-index", &fromIndex);
+    printf("prepare: %.2f ms%s\n", prepareTimeUs / 1E3, fromIndex ? " (sample index)" : "");
+
+    printf("total: client-process cpu (excludes codec service) %.2f ms over %.2f s (%.2f%%), "
+           "%.2f ms per frame of any track\n",
+           cpuUs / 1E3, realUs / 1E6, realUs > 0 ? cpuUs * 100.0 / realUs : 0.0,
+           totalFrames > 0 ? cpuUs / 1E3 / totalFrames : 0.0);
+
+    if (codecEnd.mThreads.isEmpty()) {
+        printf("codec service: cpu not readable\n");
+    } else {
+        int64_t codecCpuUs = getCodecServiceCpuUs(codecStart, codecEnd, NULL /* codecName */);
+        printf("codec service: cpu %.2f ms (%.2f%%), %.2f ms per frame of any track\n",
+               codecCpuUs / 1E3, realUs > 0 ? codecCpuUs * 100.0 / realUs : 0.0,
+               totalFrames > 0 ? codecCpuUs / 1E3 / totalFrames : 0.0);
+    }
+}
+
+static void printStartupStats(const sp<SimplePlayer> &player) {
+    sp<AMessage> stats;
+    if (player->getStartupStats(&stats) != OK) {
+        return;
+    }
+
+    int64_t sourceOpenUs = 0, firstSamplesUs = 0, codecWaitUs = 0, prepareUs = 0;
+    stats->findInt64("source-open-us", &sourceOpenUs);
+    stats->findInt64("first-samples-us", &firstSamplesUs);
+    stats->findInt64("codec-wait-us", &codecWaitUs);
+    stats->findInt64("prepare-us", &prepareUs);
+    printf("startup: source %.2f ms, first samples %.2f ms, codec wait %.2f ms, "
+           "prepared at %.2f ms\n",
+           sourceOpenUs / 1E3, firstSamplesUs / 1E3, codecWaitUs / 1E3, prepareUs / 1E3);
+
+    for (size_t i = 0; i < stats->countEntries(); ++i) {
+        AMessage::Type type;
+        const char *name = stats->getEntryNameAt(i, &type);
+
+        sp<AMessage> trackStats;
+        if (type != AMessage::kTypeMessage || !stats->findMessage(name, &trackStats)) {
+            continue;
+        }
+
+        AString mime;
+        int32_t fromPool = 0;
+        int64_t createUs = 0, configureUs = 0, startUs = 0, csdUs = 0;
+        trackStats->findString("type", &mime);
+        trackStats->findInt32("codec-from-pool", &fromPool);
+        trackStats->findInt64("codec-create-us", &createUs);
+        trackStats->findInt64("codec-configure-us", &configureUs);
+        trackStats->findInt64("codec-start-us", &startUs);
+        trackStats->findInt64("codec-csd-us", &csdUs);
+        printf("  %s (%s): create %.2f ms%s, configure %.2f ms, start %.2f ms, csd %.2f ms\n",
+               name, mime.c_str(), createUs / 1E3, fromPool ? " (pooled)" : "",
+               configureUs / 1E3, startUs / 1E3, csdUs / 1E3);
+
+        static const char *kEvents[] = {
+            "codec-ready-at-us", "first-input-at-us", "first-output-at-us", "first-present-at-us",
+        };
+
+        printf("   ");
+        for (size_t j = 0; j < sizeof(kEvents) / sizeof(kEvents[0]); ++j) {
+            int64_t atUs;
+            if (trackStats->findInt64(kEvents[j], &atUs)) {
+                printf(" %s %.2f ms", kEvents[j], atUs / 1E3);
+            }
+        }
+        printf("\n");
+    }
+
+    int64_t startAtUs, firstUs;
+    if (stats->findInt64("start-at-us", &startAtUs)) {
+        printf("  start() at %.2f ms\n", startAtUs / 1E3);
+    }
+    if (stats->findInt64("time-to-first-frame-us", &firstUs)) {
+        printf("  time to first frame %.2f ms\n", firstUs / 1E3);
+    }
+    if (stats->findInt64("time-to-first-audio-us", &firstUs)) {
+        printf("  time to first audio %.2f ms\n", firstUs / 1E3);
+    }
+}
+
+static void printPlayerStats(
+        const sp<SimplePlayer> &player, bool printStats, bool benchmark,
+        int64_t cpuUs, int64_t realUs,
+        const CodecServiceCpu &codecStart, const CodecServiceCpu &codecEnd) {
+    sp<AMessage> stats;
+    if (player->getStats(&stats) == OK) {
+        if (printStats) {
+            printf("%s\n", stats->debugString().c_str());
+        }
+
+        sp<AMessage> latencyStats;
+        if (printStats && player->getLatencyStats(&latencyStats) == OK) {
+            printf("%s\n", latencyStats->debugString().c_str());
+        }
+        if (benchmark) {
+            printBenchmarkResults(stats, cpuUs, realUs, codecStart, codecEnd);
+        }
+    }
+
+    if (!benchmark) {
+        printf("client-process cpu (excludes codec service) %.2f ms over %.2f s (%.2f%%)\n",
+               cpuUs / 1E3, realUs / 1E6, realUs > 0 ? cpuUs * 100.0 / realUs : 0.0);
+    }
+}
+
+// How long video frames took from queueInputBuffer to render, in -l.
+static void printQueueToRenderStats(const sp<SimplePlayer> &player) {
+    sp<AMessage> stats;
+    if (player->getLatencyStats(&stats) != OK) {
+        return;
+    }
+
+    for (size_t i = 0; i < stats->countEntries(); ++i) {
+        AMessage::Type type;
+        const char *name = stats->getEntryNameAt(i, &type);
+
+        sp<AMessage> trackStats;
+        int64_t intervals;
+        if (type != AMessage::kTypeMessage
+                || !stats->findMessage(name, &trackStats)
+                || !trackStats->findInt64("frame-intervals", &intervals)) {
+            continue;
+        }
+
+        int64_t withinInterval = 0, p50Us = 0, p90Us = 0, p99Us = 0, maxUs = 0;
+        trackStats->findInt64("frames-within-interval", &withinInterval);
+        trackStats->findInt64("queue-to-render-p50-us", &p50Us);
+        trackStats->findInt64("queue-to-render-p90-us", &p90Us);
+        trackStats->findInt64("queue-to-render-p99-us", &p99Us);
+        trackStats->findInt64("queue-to-render-max-us", &maxUs);
+        printf("%s: queue to render p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms, "
+               "%" PRId64 " of %" PRId64 " frames within a frame interval\n",
+               name, p50Us / 1E3, p90Us / 1E3, p99Us / 1E3, maxUs / 1E3,
+               withinInterval, intervals);
+    }
+}
+
+// Time to the first frame and rebuffers of an item played over http://.
+static void printHttpStats(const sp<SimplePlayer> &player) {
+    sp<AMessage> stats;
+    int64_t rebuffers;
+    if (player->getStats(&stats) != OK || !stats->findInt64("http-rebuffers", &rebuffers)) {
+        return;
+    }
+
+    int64_t stalls = 0, stallUs = 0, connectUs = 0, requests = 0, bytesFetched = 0;
+    int64_t evictions = 0, cacheFileReads = 0;
+    stats->findInt64("http-stalls", &stalls);
+    stats->findInt64("http-stall-us", &stallUs);
+    stats->findInt64("http-connect-us", &connectUs);
+    stats->findInt64("http-requests", &requests);
+    stats->findInt64("http-bytes-fetched", &bytesFetched);
+    stats->findInt64("http-cache-evictions", &evictions);
+    stats->findInt64("http-cache-file-reads", &cacheFileReads);
+
+    int64_t firstUs = -1ll;
+    sp<AMessage> startupStats;
+    if (player->getStartupStats(&startupStats) == OK
+            && !startupStats->findInt64("time-to-first-frame-us", &firstUs)) {
+        startupStats->findInt64("time-to-first-audio-us", &firstUs);
+    }
+
+    printf("http: startup %.2f ms (connect %.2f ms), %" PRId64 " rebuffers, "
+           "%" PRId64 " stalls for %.2f ms in all\n",
+           firstUs / 1E3, connectUs / 1E3, rebuffers, stalls, stallUs / 1E3);
+    printf("  %" PRId64 " range requests, %.2f MB fetched, %" PRId64 " blocks evicted, "
+           "%" PRId64 " reads from the cache file\n",
+           requests, bytesFetched / 1E6, evictions, cacheFileReads);
+}
+
+struct PlaylistItem {
+    sp<ALooper> mLooper;
+    sp<SimplePlayer> mPlayer;
+    sp<SurfaceControl> mControl;
+    sp<MmapFileSource> mSource;
+};
+
 int main(int argc, char **argv) {
     ALOGD("start playback ...");
     const char *me = argv[0];
 
+    sp<AMessage> params = new AMessage;
+    bool printStats = false;
+    bool benchmark = false;
+    bool printStartup = false;
+    bool timeStretchBenchmark = false;
+    bool pcmKernelBenchmark = false;
+    bool resamplerBenchmark = false;
+    bool timedRender = false;
+    bool mmapSource = false;
+    bool lowLatency = false;
+    const char *dataSourceBenchmarkPath = NULL;
+    const char *remuxOutputPath = NULL;
+    int64_t throttleBytesPerSec = 0;
+    int64_t loopbackBytesPerSec = -1;
+    int64_t loopbackLatencyUs = 0;
+    const char *httpCacheFile = NULL;
+    const char *transcodeOutputPath = NULL;
+    bool preferSoftwareCodecs = false;
+    int64_t seekRangeUs = 0;
+    sp<CodecPool> codecPool;
+    sp<FrameExportRing> frameExport;
+
     int res;
-    while ((res = getopt(argc, argv, "h")) >= 0) {
+    while ((res = getopt(argc, argv, "abc:de:ik:KlmM:pQr:R:sSt:Tuvw:x:X:h")) >= 0) {
         switch (res) {
+            case 'a':
+            {
+                params->setInt32("async-mode", true);
+                break;
+            }
+
+            case 'b':
+            {
+                // Headless runs only make sense with the callback-driven
+                // pipeline, the polling loop would throttle the codecs.
+                benchmark = true;
+                params->setInt32("benchmark", true);
+                params->setInt32("async-mode", true);
+                break;
+            }
+
+            case 'c':
+            {
+                httpCacheFile = optarg;
+                break;
+            }
+
+            case 'd':
+            {
+                params->setInt32("demux-thread", true);
+                break;
+            }
+
+            case 'e':
+            {
+                transcodeOutputPath = optarg;
+                benchmark = true;
+                params->setInt32("async-mode", true);
+                break;
+            }
+
+            case 'i':
+            {
+                params->setInt32("sample-index", true);
+                break;
+            }
+
+            case 'k':
+            {
+                seekRangeUs = atoll(optarg) * 1000000ll;
+                break;
+            }
+
+            case 'K':
+            {
+                pcmKernelBenchmark = true;
+                break;
+            }
+
+            case 'l':
+            {
+                lowLatency = true;
+                params->setInt32("low-latency", true);
+                break;
+            }
+
+            case 'm':
+            {
+                mmapSource = true;
+                break;
+            }
+
+            case 'M':
+            {
+                dataSourceBenchmarkPath = optarg;
+                break;
+            }
+
+            case 'p':
+            {
+                codecPool = new CodecPool(kCodecPoolMaxBytes, kCodecPoolMaxIdleUs);
+                params->setObject("codec-pool", codecPool);
+                break;
+            }
+
+            case 'Q':
+            {
+                resamplerBenchmark = true;
+                break;
+            }
+
+            case 'r':
+            {
+                params->setFloat("playback-rate", atof(optarg));
+                break;
+            }
+
+            case 'R':
+            {
+                params->setInt32("audio-resampler-quality", atoi(optarg));
+                break;
+            }
+
+            case 's':
+            {
+                printStats = true;
+                break;
+            }
+
+            case 'S':
+            {
+                preferSoftwareCodecs = true;
+                params->setInt32("prefer-software-codecs", true);
+                break;
+            }
+
+            case 't':
+            {
+                throttleBytesPerSec = atoll(optarg) * 1024;
+                break;
+            }
+
+            case 'T':
+            {
+                timeStretchBenchmark = true;
+                break;
+            }
+
+            case 'u':
+            {
+                printStartup = true;
+                break;
+            }
+
+            case 'v':
+            {
+                timedRender = true;
+                break;
+            }
+
+            case 'w':
+            {
+                long long kBytesPerSec, latencyMs = 0;
+                if (sscanf(optarg, "%lld:%lld", &kBytesPerSec, &latencyMs) < 1) {
+                    usage(me);
+                }
+                loopbackBytesPerSec = kBytesPerSec * 1024;
+                loopbackLatencyUs = latencyMs * 1000;
+                break;
+            }
+
+            case 'x':
+            {
+                frameExport = FrameExportRing::Create(atoi(optarg), kFrameExportSlotSize);
+                CHECK(frameExport != NULL);
+                params->setObject("frame-export-ring", frameExport);
+                break;
+            }
+
+            case 'X':
+            {
+                remuxOutputPath = optarg;
+                break;
+            }
+
             case '?':
             case 'h':
             default:
@@ -69,57 +1278,108 @@ int main(int argc, char **argv) {
     argc -= optind;
     argv += optind;
 
-    if (argc != 1) {
+    if (timeStretchBenchmark || pcmKernelBenchmark || resamplerBenchmark
+            || dataSourceBenchmarkPath != NULL || remuxOutputPath != NULL) {
+        if (dataSourceBenchmarkPath != NULL) {
+            runDataSourceBenchmark(dataSourceBenchmarkPath);
+        }
+        if (remuxOutputPath != NULL) {
+            if (argc != 1) {
+                usage(me);
+            }
+            runRemuxBenchmark(argv[0], remuxOutputPath, mmapSource);
+        }
+        if (pcmKernelBenchmark) {
+            runPcmKernelBenchmark();
+        }
+        if (resamplerBenchmark) {
+            runResamplerBenchmark();
+        }
+        if (timeStretchBenchmark) {
+            runTimeStretchBenchmark();
+        }
+        return 0;
+    }
+
+    if (argc < 1) {
         usage(me);
     }
 
+    // Before any threads are started.
+    pid_t consumerPid = -1;
+    if (frameExport != NULL) {
+        consumerPid = fork();
+        if (consumerPid == 0) {
+            runFrameConsumer(frameExport->fd());
+            fflush(stdout);
+            _exit(0);
+        }
+        CHECK_GE(consumerPid, 0);
+    }
+
     ProcessState::self()->startThreadPool();
 
-    sp<android::ALooper> looper = new android::ALooper;
-    looper->start();
+    sp<TranscodeSink> transcodeSink;
+    if (transcodeOutputPath != NULL) {
+        if (argc != 1) {
+            usage(me);
+        }
 
-    sp<SurfaceComposerClient> composerClient;
-    sp<SurfaceControl> control;
-    sp<Surface> surface;
+        transcodeSink = new TranscodeSink(
+                argv[0], transcodeOutputPath, MEDIA_MIMETYPE_VIDEO_AVC, 0 /* bitrate */,
+                preferSoftwareCodecs);
+        status_t err = transcodeSink->init();
+        if (err != OK) {
+            fprintf(stderr, "cannot transcode %s: %d\n", argv[0], err);
+            return 1;
+        }
+        params->setObject("transcode-sink", transcodeSink);
+    }
 
-    composerClient = new SurfaceComposerClient;
-    CHECK_EQ(composerClient->initCheck(), (status_t)OK);
+    // The players fetch through HttpCacheSource from these urls instead.
+    sp<LoopbackHttpServer> loopbackServer;
+    Vector<AString> urls;
+    if (loopbackBytesPerSec >= 0) {
+        loopbackServer = new LoopbackHttpServer(loopbackBytesPerSec, loopbackLatencyUs);
+        CHECK_EQ(loopbackServer->start(), (status_t)OK);
 
-    const std::vector<PhysicalDisplayId> ids = SurfaceComposerClient::getPhysicalDisplayIds();
-    CHECK(!ids.empty());
+        for (int i = 0; i < argc; ++i) {
+            urls.push_back(loopbackServer->addFile(argv[i]));
+        }
+    }
 
-    const sp<IBinder> display = SurfaceComposerClient::getPhysicalDisplayToken(ids.front());
-    CHECK(display != nullptr);
+    sp<SurfaceComposerClient> composerClient;
+    ssize_t displayWidth = 0;
+    ssize_t displayHeight = 0;
 
-    ui::DisplayMode mode;
-    CHECK_EQ(SurfaceComposerClient::getActiveDisplayMode(display, &mode), NO_ERROR);
+    if (!benchmark) {
+        composerClient = new SurfaceComposerClient;
+        CHECK_EQ(composerClient->initCheck(), (status_t)OK);
 
-    const ui::Size& resolution = mode.resolution;
-    const ssize_t displayWidth = resolution.getWidth();
-    const ssize_t displayHeight = resolution.getHeight();
+        const std::vector<PhysicalDisplayId> ids = SurfaceComposerClient::getPhysicalDisplayIds();
+        CHECK(!ids.empty());
 
-    ALOGD("display is %zd x %zd\n", displayWidth, displayHeight);
+        const sp<IBinder> display = SurfaceComposerClient::getPhysicalDisplayToken(ids.front());
+        CHECK(display != nullptr);
 
-    control = composerClient->createSurface(
-            String8("A Surface"),
-            displayWidth,
-            displayHeight,
-            PIXEL_FORMAT_RGB_565,
-            0);
+        ui::DisplayMode mode;
+        CHECK_EQ(SurfaceComposerClient::getActiveDisplayMode(display, &mode), NO_ERROR);
 
-    CHECK(control != NULL);
-    CHECK(control->isValid());
+        const ui::Size& resolution = mode.resolution;
+        displayWidth = resolution.getWidth();
+        displayHeight = resolution.getHeight();
 
-    SurfaceComposerClient::Transaction{}
-             .setLayer(control, INT_MAX)
-             .show(control)
-             .apply();
+        ALOGD("display is %zd x %zd\n", displayWidth, displayHeight);
 
-    surface = control->getSurface();
-    CHECK(surface != NULL);
+        if (mode.refreshRate > 0) {
+            int64_t vsyncPeriodUs = (int64_t)(1E6 / mode.refreshRate);
+            params->setInt64("vsync-period-us", vsyncPeriodUs);
 
-    sp<SimplePlayer> player = new SimplePlayer;
-    looper->registerHandler(player);
+            if (timedRender) {
+                params->setInt64("render-ahead-us", 2 * vsyncPeriodUs);
+            }
+        }
+    }
 
     class CodecListener : public CodecEventListener {
     public:
@@ -128,20 +1388,199 @@ int main(int argc, char **argv) {
         virtual void onFirstFrameAvailable() {
             ALOGD("onFirstFrameAvailable");
         }
+        virtual void onFrameExported(uint64_t index, int64_t timeUs) {
+            ALOGV("frame %" PRIu64 " at %" PRId64 " us exported", index, timeUs);
+        }
     };
     sp<CodecListener> listener = new CodecListener;
-    player->registerListener(listener);
-    player->setDataSource(argv[0]);
-    player->setSurface(surface->getIGraphicBufferProducer());
-    player->start();
-    while(player->isPlaying())
-        usleep(50000);
-    player->stop();
-    player->reset();
-
-    composerClient->dispose();
-
-    looper->stop();
+
+    // Every playlist item gets a player on a looper of its own, so preparing
+    // the next item does not hold up the current one, and a layer of its own
+    // above the previous one, which keeps showing its last frame until the
+    // next item's first frame covers it.
+    auto openItem = [&](size_t index) {
+        PlaylistItem item;
+        item.mLooper = new android::ALooper;
+        item.mLooper->start();
+
+        item.mPlayer = new SimplePlayer;
+        item.mLooper->registerHandler(item.mPlayer);
+        item.mPlayer->registerListener(listener);
+
+        // Players preroll while the one before them plays, each needs a
+        // cache file of its own.
+        sp<AMessage> itemParams = params;
+        if (httpCacheFile != NULL) {
+            itemParams = params->dup();
+            itemParams->setString(
+                    "http-cache-file", AStringPrintf("%s.%zu", httpCacheFile, index).c_str());
+        }
+        item.mPlayer->setParameters(itemParams);
+
+        if (!urls.isEmpty()) {
+            item.mPlayer->setDataSource(urls[index].c_str());
+        } else if (throttleBytesPerSec > 0) {
+            item.mPlayer->setDataSource(
+                    new ThrottledFileSource(argv[index], throttleBytesPerSec));
+        } else if (mmapSource) {
+            item.mSource = new MmapFileSource(argv[index]);
+            item.mPlayer->setDataSource(item.mSource);
+        } else {
+            item.mPlayer->setDataSource(argv[index]);
+        }
+
+        if (composerClient != NULL) {
+            item.mControl = composerClient->createSurface(
+                    String8("A Surface"),
+                    displayWidth,
+                    displayHeight,
+                    PIXEL_FORMAT_RGB_565,
+                    0);
+
+            CHECK(item.mControl != NULL);
+            CHECK(item.mControl->isValid());
+
+            SurfaceComposerClient::Transaction{}
+                     .setLayer(item.mControl, INT_MAX - argc + index + 1)
+                     .show(item.mControl)
+                     .apply();
+
+            sp<Surface> surface = item.mControl->getSurface();
+            CHECK(surface != NULL);
+
+            item.mPlayer->setSurface(surface->getIGraphicBufferProducer());
+        } else if (transcodeSink != NULL) {
+            item.mPlayer->setSurface(transcodeSink->inputSurface());
+        }
+
+        return item;
+    };
+
+    PlaylistItem item = openItem(0);
+
+    int64_t startCpuUs = getCpuTimeUs();
+    int64_t startRealUs = ALooper::GetNowUs();
+    CodecServiceCpu startCodecCpu;
+    sampleCodecServiceCpu(&startCodecCpu);
+
+    if (transcodeSink != NULL) {
+        CHECK_EQ(transcodeSink->start(), (status_t)OK);
+    }
+    item.mPlayer->start();
+
+    if (seekRangeUs > 0) {
+        // Play the range once so most seeks resolve from the sync sample
+        // index, then jump around it in every mode.
+        usleep(seekRangeUs);
+
+        static const size_t kNumSeeksPerMode = 8;
+        for (int mode = 0; mode < SimplePlayer::NUM_SEEK_MODES; ++mode) {
+            for (size_t i = 0; i < kNumSeeksPerMode; ++i) {
+                int64_t timeUs = seekRangeUs * ((i * 5) % kNumSeeksPerMode) / kNumSeeksPerMode;
+                item.mPlayer->seekTo(timeUs, (SimplePlayer::SeekMode)mode);
+                usleep(500000);
+            }
+        }
+    }
+
+    for (int i = 0; i < argc; ++i) {
+        PlaylistItem next;
+        if (i + 1 < argc) {
+            // Prerolled now, started by the current player once it is done.
+            next = openItem(i + 1);
+            CHECK_EQ(item.mPlayer->setNextPlayer(next.mPlayer), (status_t)OK);
+        }
+
+        while(!item.mPlayer->reachedEndOfStream())
+            usleep(50000);
+
+        int64_t cpuUs = getCpuTimeUs();
+        int64_t realUs = ALooper::GetNowUs();
+        CodecServiceCpu codecCpu;
+        sampleCodecServiceCpu(&codecCpu);
+
+        sp<AMessage> stats;
+        int64_t gapUs;
+        if (item.mPlayer->getStats(&stats) == OK
+                && stats->findInt64("transition-gap-us", &gapUs)) {
+            printf("%s: transition gap %.2f ms\n", argv[i], gapUs / 1E3);
+        }
+
+        if (printStartup) {
+            if (argc > 1) {
+                printf("%s:\n", argv[i]);
+            }
+            printStartupStats(item.mPlayer);
+        }
+
+        printHttpStats(item.mPlayer);
+
+        if (lowLatency) {
+            printQueueToRenderStats(item.mPlayer);
+        }
+
+        if (printStats || benchmark) {
+            if (argc > 1) {
+                printf("%s:\n", argv[i]);
+            }
+            printPlayerStats(
+                    item.mPlayer, printStats, benchmark,
+                    cpuUs - startCpuUs, realUs - startRealUs, startCodecCpu, codecCpu);
+
+            if (item.mSource != NULL) {
+                printf("mmap source: %" PRId64 " reads, %" PRId64 " read-aheads, %" PRId64
+                       " preads\n",
+                       item.mSource->numReads(),
+                       item.mSource->numReadAheads(),
+                       item.mSource->numPreads());
+            }
+        }
+
+        startCpuUs = cpuUs;
+        startRealUs = realUs;
+        startCodecCpu = codecCpu;
+
+        item.mPlayer->stop();
+        item.mPlayer->reset();
+        item.mLooper->stop();
+
+        item = next;
+    }
+
+    if (transcodeSink != NULL) {
+        status_t err = transcodeSink->waitForCompletion();
+        int64_t encodeTimeUs = transcodeSink->encodeTimeUs();
+        printf("transcode: %" PRId64 " frames in %.2f s, %.1f fps encoded, %.2f MB written%s\n",
+               transcodeSink->numFramesEncoded(),
+               encodeTimeUs / 1E6,
+               encodeTimeUs > 0 ? transcodeSink->numFramesEncoded() * 1E6 / encodeTimeUs : 0.0,
+               transcodeSink->numBytesWritten() / 1E6,
+               err == OK ? "" : ", failed");
+    }
+
+    if (frameExport != NULL) {
+        frameExport->close();
+        waitpid(consumerPid, NULL, 0);
+
+        printf("frame export: %" PRIu64 " frames published, one copy each, %.1f MB copied\n",
+               frameExport->numPublished(), frameExport->numBytesCopied() / 1E6);
+    }
+
+    if (loopbackServer != NULL) {
+        loopbackServer->stop();
+        printf("loopback server: %" PRId64 " requests, %.2f MB sent\n",
+               loopbackServer->numRequests(), loopbackServer->numBytesServed() / 1E6);
+    }
+
+    if (codecPool != NULL) {
+        printf("codec pool: %" PRId64 " hits, %" PRId64 " misses, %" PRId64 " evictions\n",
+               codecPool->numHits(), codecPool->numMisses(), codecPool->numEvictions());
+        codecPool->clear();
+    }
+
+    if (composerClient != NULL) {
+        composerClient->dispose();
+    }
 
     return 0;
 }
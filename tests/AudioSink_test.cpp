@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AudioSink_test"
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ALooper.h>
+
+#include "AudioSink.h"
+
+namespace android {
+
+// 10 ms of 48 kHz stereo, 480 frames of 4 bytes.
+static const uint32_t kSampleRate = 48000;
+static const int32_t kChannelCount = 2;
+static const int64_t kBufferDurationUs = 10000ll;
+static const size_t kCapacityBytes = 480 * 4;
+
+static const int64_t kDrainTimeoutUs = 2000000ll;
+
+class AudioSinkTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mSink = new AudioSink;
+        if (mSink->open(kSampleRate, kChannelCount, AUDIO_FORMAT_PCM_16_BIT,
+                        kBufferDurationUs, false /* lowLatency */) != OK) {
+            GTEST_SKIP() << "no AudioTrack to play to";
+        }
+
+        memset(mSilence, 0, sizeof(mSilence));
+    }
+
+    void TearDown() override {
+        mSink->close();
+    }
+
+    // Lets the callback run until pred holds.
+    template<typename Pred>
+    bool waitFor(Pred pred) {
+        int64_t endUs = ALooper::GetNowUs() + kDrainTimeoutUs;
+        while (!pred()) {
+            if (ALooper::GetNowUs() > endUs) {
+                return false;
+            }
+            usleep(1000);
+        }
+        return true;
+    }
+
+    sp<AudioSink> mSink;
+    uint8_t mSilence[2 * kCapacityBytes];
+};
+
+TEST_F(AudioSinkTest, TakesWholeFramesUpToCapacity) {
+    EXPECT_EQ(kCapacityBytes, mSink->capacityBytes());
+    EXPECT_EQ(kBufferDurationUs, mSink->bytesToDurationUs(kCapacityBytes));
+
+    EXPECT_EQ(0u, mSink->write(mSilence, 3));
+    EXPECT_EQ(4u, mSink->write(mSilence, 7));
+    EXPECT_EQ(kCapacityBytes - 4, mSink->write(mSilence, sizeof(mSilence)));
+
+    EXPECT_EQ(kCapacityBytes, mSink->fillBytes());
+    EXPECT_EQ(0u, mSink->availableBytes());
+    EXPECT_EQ(0u, mSink->write(mSilence, 4));
+}
+
+TEST_F(AudioSinkTest, CallbackDrainsTheRing) {
+    // More than the ring holds goes through it as it drains.
+    size_t total = 0;
+    ASSERT_EQ(kCapacityBytes, mSink->write(mSilence, sizeof(mSilence)));
+    total += kCapacityBytes;
+
+    ASSERT_EQ((status_t)OK, mSink->start());
+    while (total < 8 * kCapacityBytes) {
+        ASSERT_TRUE(waitFor([this]() { return mSink->availableBytes() > 0; }));
+        total += mSink->write(mSilence, sizeof(mSilence));
+    }
+
+    mSink->signalEndOfStream();
+    EXPECT_TRUE(waitFor([this]() { return mSink->fillBytes() == 0; }));
+
+    // Running dry after the end of stream is not an underrun.
+    int64_t numUnderruns = mSink->numUnderruns();
+    usleep(50000);
+    EXPECT_EQ(numUnderruns, mSink->numUnderruns());
+}
+
+TEST_F(AudioSinkTest, FlushDiscardsBufferedData) {
+    ASSERT_EQ(kCapacityBytes, mSink->write(mSilence, sizeof(mSilence)));
+
+    mSink->flush();
+    EXPECT_EQ(0u, mSink->fillBytes());
+    EXPECT_FALSE(mSink->started());
+
+    // The callback still has to skip the flushed bytes, until then they
+    // hold the ring.
+    EXPECT_TRUE(mSink->discardPending());
+    EXPECT_EQ(0u, mSink->write(mSilence, 4));
+
+    ASSERT_EQ((status_t)OK, mSink->start());
+    EXPECT_TRUE(waitFor([this]() { return !mSink->discardPending(); }));
+    EXPECT_EQ(4u, mSink->write(mSilence, 4));
+}
+
+}  // namespace android
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FrameExportRing_test"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cutils/ashmem.h>
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include "FrameExportRing.h"
+
+namespace android {
+
+static const size_t kNumSlots = 3;
+static const size_t kSlotSize = 4096;
+
+static void FillFrame(uint8_t *data, size_t size, uint64_t index) {
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = (uint8_t)(index * 31 + i);
+    }
+}
+
+class FrameExportRingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mWriter = FrameExportRing::Create(kNumSlots, kSlotSize);
+        ASSERT_TRUE(mWriter != NULL);
+        mReader = FrameExportRing::Map(mWriter->fd());
+        ASSERT_TRUE(mReader != NULL);
+
+        memset(&mInfo, 0, sizeof(mInfo));
+        mInfo.mWidth = 64;
+        mInfo.mHeight = 32;
+        mInfo.mColorFormat = COLOR_FormatYUV420SemiPlanar;
+        mInfo.mBitDepth = 8;
+        mInfo.mNumPlanes = 3;
+    }
+
+    void publish(uint64_t expectedIndex, size_t size = kSlotSize) {
+        uint8_t data[kSlotSize];
+        FillFrame(data, size, expectedIndex);
+
+        uint64_t index;
+        ASSERT_EQ((status_t)OK,
+                  mWriter->publish(data, size, expectedIndex * 1000ll, mInfo, &index));
+        EXPECT_EQ(expectedIndex, index);
+    }
+
+    sp<FrameExportRing> mWriter;
+    sp<FrameExportRing> mReader;
+    FrameExportRing::FrameInfo mInfo;
+};
+
+TEST_F(FrameExportRingTest, ReaderSeesPublishedFrames) {
+    EXPECT_EQ(kNumSlots, mReader->numSlots());
+    EXPECT_EQ(kSlotSize, mReader->slotSize());
+
+    FrameExportRing::Frame frame;
+    EXPECT_EQ((status_t)NOT_ENOUGH_DATA, mReader->acquireFrame(0, &frame));
+
+    publish(0);
+    publish(1, 100);
+    EXPECT_EQ(2u, mReader->numPublished());
+    EXPECT_EQ(0u, mReader->oldestIndex());
+
+    for (uint64_t index = 0; index < 2; ++index) {
+        ASSERT_EQ((status_t)OK, mReader->acquireFrame(index, &frame));
+        EXPECT_EQ(index, frame.mIndex);
+        EXPECT_EQ((int64_t)index * 1000ll, frame.mTimeUs);
+        EXPECT_EQ(index == 0 ? kSlotSize : 100u, frame.mSize);
+        EXPECT_EQ(0, memcmp(&mInfo, &frame.mInfo, sizeof(mInfo)));
+
+        uint8_t expected[kSlotSize];
+        FillFrame(expected, frame.mSize, index);
+        EXPECT_EQ(0, memcmp(expected, frame.mData, frame.mSize));
+        EXPECT_TRUE(mReader->validateFrame(frame));
+    }
+
+    EXPECT_EQ((status_t)NOT_ENOUGH_DATA, mReader->acquireFrame(2, &frame));
+    EXPECT_EQ(kSlotSize + 100, (size_t)mWriter->numBytesCopied());
+}
+
+TEST_F(FrameExportRingTest, WriterOverwritesTheOldestFrame) {
+    for (uint64_t index = 0; index < kNumSlots; ++index) {
+        publish(index);
+    }
+
+    FrameExportRing::Frame frame;
+    ASSERT_EQ((status_t)OK, mReader->acquireFrame(0, &frame));
+
+    // Frame 0 is still being used when frame kNumSlots lands in its slot.
+    publish(kNumSlots);
+    EXPECT_FALSE(mReader->validateFrame(frame));
+    EXPECT_EQ((status_t)BAD_INDEX, mReader->acquireFrame(0, &frame));
+
+    EXPECT_EQ(1u, mReader->oldestIndex());
+    for (uint64_t index = 1; index <= kNumSlots; ++index) {
+        ASSERT_EQ((status_t)OK, mReader->acquireFrame(index, &frame));
+        EXPECT_EQ(index, frame.mIndex);
+        EXPECT_TRUE(mReader->validateFrame(frame));
+    }
+}
+
+TEST_F(FrameExportRingTest, RejectsFramesLargerThanASlot) {
+    uint8_t data[kSlotSize + 1];
+    memset(data, 0, sizeof(data));
+
+    uint64_t index;
+    EXPECT_EQ((status_t)BAD_VALUE,
+              mWriter->publish(data, sizeof(data), 0ll, mInfo, &index));
+    EXPECT_EQ(0u, mReader->numPublished());
+}
+
+TEST_F(FrameExportRingTest, ReaderSeesClose) {
+    EXPECT_FALSE(mReader->closed());
+    mWriter->close();
+    EXPECT_TRUE(mReader->closed());
+}
+
+TEST(FrameExportRingMapTest, RejectsOtherRegions) {
+    int fd = ashmem_create_region("FrameExportRingTest", 4096);
+    ASSERT_GE(fd, 0);
+    EXPECT_TRUE(FrameExportRing::Map(fd) == NULL);
+    close(fd);
+}
+
+TEST(FrameExportRingInfoTest, GetsSemiPlanarLayoutFromStride) {
+    sp<AMessage> format = new AMessage;
+    format->setInt32(KEY_COLOR_FORMAT, COLOR_FormatYUV420SemiPlanar);
+    format->setInt32(KEY_WIDTH, 1280);
+    format->setInt32(KEY_HEIGHT, 720);
+    format->setInt32(KEY_STRIDE, 1344);
+    format->setInt32(KEY_SLICE_HEIGHT, 736);
+
+    FrameExportRing::FrameInfo info;
+    ASSERT_EQ((status_t)OK, FrameExportRing::GetFrameInfo(format, &info));
+    EXPECT_EQ(1280u, info.mWidth);
+    EXPECT_EQ(720u, info.mHeight);
+    ASSERT_EQ(3u, info.mNumPlanes);
+    EXPECT_EQ(1344, info.mPlanes[0].mRowInc);
+    EXPECT_EQ(1344u * 736u, info.mPlanes[1].mOffset);
+    EXPECT_EQ(2, info.mPlanes[1].mColInc);
+    EXPECT_EQ(1344u * 736u + 1, info.mPlanes[2].mOffset);
+    EXPECT_EQ(2u, info.mPlanes[2].mVertSubsampling);
+}
+
+TEST(FrameExportRingInfoTest, GetsPlanarLayoutWithoutStride) {
+    sp<AMessage> format = new AMessage;
+    format->setInt32(KEY_COLOR_FORMAT, COLOR_FormatYUV420Planar);
+    format->setInt32(KEY_WIDTH, 320);
+    format->setInt32(KEY_HEIGHT, 240);
+
+    FrameExportRing::FrameInfo info;
+    ASSERT_EQ((status_t)OK, FrameExportRing::GetFrameInfo(format, &info));
+    EXPECT_EQ(320, info.mPlanes[0].mRowInc);
+    EXPECT_EQ(320u * 240u, info.mPlanes[1].mOffset);
+    EXPECT_EQ(160, info.mPlanes[1].mRowInc);
+    EXPECT_EQ(320u * 240u + 160u * 120u, info.mPlanes[2].mOffset);
+
+    format->setInt32(KEY_COLOR_FORMAT, COLOR_FormatSurface);
+    EXPECT_EQ((status_t)ERROR_UNSUPPORTED, FrameExportRing::GetFrameInfo(format, &info));
+}
+
+}  // namespace android
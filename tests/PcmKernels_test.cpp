@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PcmKernels_test"
+
+#include <math.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include <utils/Vector.h>
+
+#include "PcmKernels.h"
+
+namespace android {
+
+// Not a multiple of any vector width, the scalar tails run too.
+static const size_t kNumSamples = 4099;
+
+// Deterministic samples spread over [-range, range).
+static void MakeFloats(
+        Vector<float> *samples, size_t numSamples, float range, uint32_t seed = 12345) {
+    samples->resize(numSamples);
+    for (size_t i = 0; i < numSamples; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        samples->editItemAt(i) = ((seed >> 8) / 8388608.0f - 1.0f) * range;
+    }
+
+#if defined(__arm__)
+    // armv7 NEON rounds halves away from zero, lrintf() to even. The two
+    // only agree off the halfway points.
+    for (size_t i = 0; i < numSamples; ++i) {
+        float value = samples->itemAt(i);
+        while (fabsf(fmodf(value * 8388608.0f, 1.0f)) == 0.5f
+                || fabsf(fmodf(value * 32768.0f, 1.0f)) == 0.5f) {
+            value = nextafterf(value, 0.0f);
+        }
+        samples->editItemAt(i) = value;
+    }
+#endif
+}
+
+TEST(PcmKernelsTest, Int16ConversionsAreBitExact) {
+    const PcmKernels &scalar = PcmKernels::Scalar();
+    const PcmKernels &vectorized = PcmKernels::Vectorized();
+
+    Vector<int16_t> in;
+    in.resize(65536 + 3);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in.editItemAt(i) = (int16_t)(i - 32768);
+    }
+
+    Vector<float> expected, actual;
+    expected.resize(in.size());
+    actual.resize(in.size());
+    scalar.int16ToFloat(in.array(), expected.editArray(), in.size());
+    vectorized.int16ToFloat(in.array(), actual.editArray(), in.size());
+    ASSERT_EQ(0, memcmp(expected.array(), actual.array(), in.size() * sizeof(float)));
+
+    // Back to where it came from, and beyond full scale.
+    Vector<int16_t> out;
+    out.resize(in.size());
+    vectorized.floatToInt16(actual.array(), out.editArray(), in.size());
+    EXPECT_EQ(0, memcmp(in.array(), out.array(), in.size() * sizeof(int16_t)));
+
+    Vector<float> floats;
+    MakeFloats(&floats, kNumSamples, 1.5f);
+    Vector<int16_t> expectedInt, actualInt;
+    expectedInt.resize(kNumSamples);
+    actualInt.resize(kNumSamples);
+    scalar.floatToInt16(floats.array(), expectedInt.editArray(), kNumSamples);
+    vectorized.floatToInt16(floats.array(), actualInt.editArray(), kNumSamples);
+    EXPECT_EQ(0, memcmp(expectedInt.array(), actualInt.array(), kNumSamples * sizeof(int16_t)));
+}
+
+TEST(PcmKernelsTest, Int24ConversionsAreBitExact) {
+    const PcmKernels &scalar = PcmKernels::Scalar();
+    const PcmKernels &vectorized = PcmKernels::Vectorized();
+
+    Vector<float> floats;
+    MakeFloats(&floats, kNumSamples, 1.5f);
+
+    Vector<uint8_t> expected, actual;
+    expected.resize(3 * kNumSamples);
+    actual.resize(3 * kNumSamples);
+    scalar.floatToInt24(floats.array(), expected.editArray(), kNumSamples);
+    vectorized.floatToInt24(floats.array(), actual.editArray(), kNumSamples);
+    ASSERT_EQ(0, memcmp(expected.array(), actual.array(), 3 * kNumSamples));
+
+    Vector<float> expectedFloats, actualFloats;
+    expectedFloats.resize(kNumSamples);
+    actualFloats.resize(kNumSamples);
+    scalar.int24ToFloat(expected.array(), expectedFloats.editArray(), kNumSamples);
+    vectorized.int24ToFloat(expected.array(), actualFloats.editArray(), kNumSamples);
+    EXPECT_EQ(0, memcmp(expectedFloats.array(), actualFloats.array(),
+                        kNumSamples * sizeof(float)));
+
+    // Beyond full scale saturates.
+    static const float kOverRange[4] = { 1.5f, -1.5f, 1.0f, -1.0f };
+    uint8_t packed[12];
+    vectorized.floatToInt24(kOverRange, packed, 4);
+    static const uint8_t kSaturated[12] = {
+        0xff, 0xff, 0x7f, 0x00, 0x00, 0x80, 0xff, 0xff, 0x7f, 0x00, 0x00, 0x80,
+    };
+    EXPECT_EQ(0, memcmp(kSaturated, packed, sizeof(packed)));
+}
+
+TEST(PcmKernelsTest, NarrowsInPlace) {
+    const PcmKernels &vectorized = PcmKernels::Vectorized();
+
+    Vector<float> floats;
+    MakeFloats(&floats, kNumSamples, 1.0f);
+
+    Vector<int16_t> expected;
+    expected.resize(kNumSamples);
+    PcmKernels::Scalar().floatToInt16(floats.array(), expected.editArray(), kNumSamples);
+
+    Vector<float> data = floats;
+    int16_t *out = reinterpret_cast<int16_t *>(data.editArray());
+    vectorized.floatToInt16(data.array(), out, kNumSamples);
+    EXPECT_EQ(0, memcmp(expected.array(), out, kNumSamples * sizeof(int16_t)));
+
+    Vector<uint8_t> expected24;
+    expected24.resize(3 * kNumSamples);
+    PcmKernels::Scalar().floatToInt24(floats.array(), expected24.editArray(), kNumSamples);
+
+    data = floats;
+    uint8_t *out24 = reinterpret_cast<uint8_t *>(data.editArray());
+    vectorized.floatToInt24(data.array(), out24, kNumSamples);
+    EXPECT_EQ(0, memcmp(expected24.array(), out24, 3 * kNumSamples));
+}
+
+// The arithmetic kernels sum in a different order, they agree to within
+// float rounding rather than bit for bit.
+
+TEST(PcmKernelsTest, ApplyGainMatchesScalar) {
+    static const int32_t kChannelCounts[] = { 1, 2, 3, 4, 6 };
+
+    for (size_t k = 0; k < sizeof(kChannelCounts) / sizeof(kChannelCounts[0]); ++k) {
+        int32_t channelCount = kChannelCounts[k];
+        size_t numFrames = kNumSamples / channelCount;
+
+        Vector<float> expected, actual;
+        MakeFloats(&expected, numFrames * channelCount, 1.0f);
+        actual = expected;
+
+        PcmKernels::Scalar().applyGain(
+                expected.editArray(), numFrames, channelCount, 1.0f, -1.0f / numFrames);
+        PcmKernels::Vectorized().applyGain(
+                actual.editArray(), numFrames, channelCount, 1.0f, -1.0f / numFrames);
+
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_NEAR(expected[i], actual[i], 1E-6f) << channelCount << " channels, " << i;
+        }
+    }
+}
+
+TEST(PcmKernelsTest, DownmixMatchesScalar) {
+    Vector<float> in;
+    MakeFloats(&in, 8 * 1001, 1.0f);
+
+    Vector<float> expected, actual;
+    expected.resize(2 * 1001);
+    actual.resize(2 * 1001);
+
+    PcmKernels::Scalar().downmix5_1(in.array(), expected.editArray(), 1001);
+    PcmKernels::Vectorized().downmix5_1(in.array(), actual.editArray(), 1001);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_NEAR(expected[i], actual[i], 1E-6f) << "5.1 " << i;
+    }
+
+    PcmKernels::Scalar().downmix7_1(in.array(), expected.editArray(), 1001);
+    PcmKernels::Vectorized().downmix7_1(in.array(), actual.editArray(), 1001);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_NEAR(expected[i], actual[i], 1E-6f) << "7.1 " << i;
+    }
+
+    // Full scale on every channel stays within range.
+    Vector<float> full;
+    full.resize(8);
+    for (size_t i = 0; i < full.size(); ++i) {
+        full.editItemAt(i) = 1.0f;
+    }
+    float out[2];
+    PcmKernels::Vectorized().downmix7_1(full.array(), out, 1);
+    EXPECT_LE(out[0], 1.0f);
+    EXPECT_LE(out[1], 1.0f);
+}
+
+TEST(PcmKernelsTest, DotProductMatchesScalar) {
+    Vector<float> a, b;
+    MakeFloats(&a, kNumSamples, 1.0f);
+    MakeFloats(&b, kNumSamples, 0.5f, 54321);
+
+    for (size_t n = 0; n <= 17; ++n) {
+        EXPECT_NEAR(PcmKernels::Scalar().dotProduct(a.array(), b.array(), n),
+                    PcmKernels::Vectorized().dotProduct(a.array(), b.array(), n), 1E-5f) << n;
+    }
+
+    float expected = PcmKernels::Scalar().dotProduct(a.array(), b.array(), kNumSamples);
+    float actual = PcmKernels::Vectorized().dotProduct(a.array(), b.array(), kNumSamples);
+    EXPECT_NEAR(expected, actual, fabsf(expected) * 1E-4f + 1E-3f);
+}
+
+}  // namespace android
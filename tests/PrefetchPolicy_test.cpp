@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PrefetchPolicy_test"
+
+#include <gtest/gtest.h>
+
+#include "PrefetchPolicy.h"
+
+namespace android {
+
+TEST(PrefetchPolicyTest, StopsAtTheByteBudget) {
+    sp<PrefetchPolicy> policy = new PrefetchPolicy(1000, 10000000ll, 64);
+
+    int64_t timeUs = 0;
+    while (policy->canPrefetch()) {
+        policy->onSampleQueued(300, timeUs);
+        timeUs += 1000;
+    }
+    EXPECT_EQ(4, policy->queuedSamples());
+    EXPECT_EQ(1200, policy->queuedBytes());
+
+    policy->onSampleDequeued(300);
+    EXPECT_TRUE(policy->canPrefetch());
+}
+
+TEST(PrefetchPolicyTest, MeasuresDurationFromTheHead) {
+    sp<PrefetchPolicy> policy = new PrefetchPolicy(1 << 20, 100000ll, 64);
+
+    for (int64_t timeUs = 0; timeUs <= 100000ll; timeUs += 20000ll) {
+        ASSERT_TRUE(policy->canPrefetch());
+        policy->onSampleQueued(10, timeUs);
+    }
+    EXPECT_EQ(100000ll, policy->queuedDurationUs());
+    EXPECT_FALSE(policy->canPrefetch());
+
+    policy->onSampleDequeued(10);
+    policy->onSampleDequeued(10);
+    EXPECT_EQ(60000ll, policy->queuedDurationUs());
+    EXPECT_TRUE(policy->canPrefetch());
+}
+
+TEST(PrefetchPolicyTest, AlwaysAllowsOneSample) {
+    sp<PrefetchPolicy> policy = new PrefetchPolicy(100, 1000ll, 4);
+
+    EXPECT_TRUE(policy->canPrefetch());
+    policy->onSampleQueued(1 << 20, 0);
+    EXPECT_FALSE(policy->canPrefetch());
+}
+
+TEST(PrefetchPolicyTest, StopsAtMaxSamples) {
+    sp<PrefetchPolicy> policy = new PrefetchPolicy(1 << 20, 10000000ll, 4);
+
+    for (int64_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(policy->canPrefetch());
+        policy->onSampleQueued(1, i);
+    }
+    EXPECT_FALSE(policy->canPrefetch());
+
+    // The ring of sample times wraps around.
+    for (int64_t i = 4; i < 100; ++i) {
+        policy->onSampleDequeued(1);
+        ASSERT_TRUE(policy->canPrefetch());
+        policy->onSampleQueued(1, i);
+        EXPECT_EQ(3, policy->queuedDurationUs());
+    }
+}
+
+TEST(PrefetchPolicyTest, GrowsOncePerDrySpell) {
+    sp<PrefetchPolicy> policy = new PrefetchPolicy(1000, 100000ll, 64);
+
+    // Not fed yet, that is startup rather than an underrun.
+    policy->onStarved();
+    EXPECT_EQ(0, policy->numUnderruns());
+
+    policy->onSampleReadDirectly();
+    policy->onStarved();
+    policy->onStarved();
+    EXPECT_EQ(1, policy->numUnderruns());
+    EXPECT_EQ(1500, policy->maxBytes());
+    EXPECT_EQ(150000ll, policy->maxDurationUs());
+
+    policy->onSampleQueued(10, 0);
+    policy->onSampleDequeued(10);
+    policy->onStarved();
+    EXPECT_EQ(2, policy->numUnderruns());
+    EXPECT_EQ(2250, policy->maxBytes());
+}
+
+TEST(PrefetchPolicyTest, KeepsTheBudgetWithinBounds) {
+    sp<PrefetchPolicy> policy = new PrefetchPolicy(1000, 100000ll, 64);
+
+    for (size_t i = 0; i < 10; ++i) {
+        policy->onMemoryPressure();
+    }
+    EXPECT_EQ(250, policy->maxBytes());
+    EXPECT_EQ(25000ll, policy->maxDurationUs());
+
+    for (size_t i = 0; i < 20; ++i) {
+        policy->onSampleReadDirectly();
+        policy->onStarved();
+    }
+    EXPECT_EQ(4000, policy->maxBytes());
+    EXPECT_EQ(400000ll, policy->maxDurationUs());
+}
+
+}  // namespace android
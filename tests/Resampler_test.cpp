@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "Resampler_test"
+
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+#include <utils/Vector.h>
+
+#include "Resampler.h"
+
+namespace android {
+
+static const int32_t kChannelCount = 2;
+
+// A second of a tone at frequency, left at amplitude and right inverted.
+static void MakeTone(
+        Vector<int16_t> *samples, uint32_t sampleRate, double frequency, double amplitude) {
+    samples->resize(sampleRate * kChannelCount);
+    for (size_t i = 0; i < sampleRate; ++i) {
+        double value = amplitude * sin(2.0 * M_PI * frequency * i / sampleRate);
+        samples->editItemAt(i * kChannelCount) = (int16_t)lrint(value * 32767.0);
+        samples->editItemAt(i * kChannelCount + 1) = (int16_t)lrint(-value * 32767.0);
+    }
+}
+
+static void Drain(
+        const sp<Resampler> &resampler, Vector<int16_t> *output, int64_t *firstTimeUs) {
+    const void *data;
+    int64_t timeUs;
+    size_t n;
+    while ((n = resampler->getOutput(&data, &timeUs)) > 0) {
+        if (*firstTimeUs < 0ll) {
+            *firstTimeUs = timeUs;
+        }
+        output->appendArray(static_cast<const int16_t *>(data), n * kChannelCount);
+        resampler->consumeOutput(n);
+    }
+}
+
+// Queues the input in chunks of chunkFrames and collects all output up to
+// the end of stream.
+static void Resample(
+        const sp<Resampler> &resampler, const Vector<int16_t> &input, size_t chunkFrames,
+        Vector<int16_t> *output, int64_t *firstTimeUs) {
+    size_t numFrames = input.size() / kChannelCount;
+    *firstTimeUs = -1ll;
+
+    for (size_t frame = 0; frame < numFrames; frame += chunkFrames) {
+        size_t n = numFrames - frame < chunkFrames ? numFrames - frame : chunkFrames;
+        resampler->queueInput(
+                input.array() + frame * kChannelCount, n,
+                frame * 1000000ll / resampler->inputRate());
+        Drain(resampler, output, firstTimeUs);
+    }
+
+    resampler->signalEndOfStream();
+    Drain(resampler, output, firstTimeUs);
+}
+
+// RMS of one channel relative to full scale, leaving out the filter
+// running in and out at both ends.
+static double Rms(const Vector<int16_t> &samples, int32_t channel, size_t skipFrames) {
+    size_t numFrames = samples.size() / kChannelCount;
+    double energy = 0.0;
+    for (size_t i = skipFrames; i + skipFrames < numFrames; ++i) {
+        double value = samples[i * kChannelCount + channel] / 32767.0;
+        energy += value * value;
+    }
+    return sqrt(energy / (numFrames - 2 * skipFrames));
+}
+
+TEST(ResamplerTest, OutputLengthMatchesTheRatio) {
+    static const struct {
+        uint32_t mInputRate;
+        uint32_t mOutputRate;
+    } kRates[] = {
+        { 44100, 48000 },
+        { 48000, 44100 },
+        { 22050, 48000 },
+        { 96000, 48000 },
+        { 8000, 44100 },
+    };
+
+    for (size_t i = 0; i < sizeof(kRates) / sizeof(kRates[0]); ++i) {
+        for (int q = 0; q < Resampler::NUM_QUALITIES; ++q) {
+            sp<Resampler> resampler = new Resampler(
+                    kRates[i].mInputRate, kRates[i].mOutputRate, kChannelCount,
+                    AUDIO_FORMAT_PCM_16_BIT, (Resampler::Quality)q);
+
+            Vector<int16_t> input;
+            MakeTone(&input, kRates[i].mInputRate, 440.0, 0.5);
+
+            // A chunk size that does not divide either rate.
+            Vector<int16_t> output;
+            int64_t firstTimeUs;
+            Resample(resampler, input, 1000, &output, &firstTimeUs);
+
+            EXPECT_EQ(kRates[i].mOutputRate * kChannelCount, output.size())
+                    << kRates[i].mInputRate << " to " << kRates[i].mOutputRate
+                    << ", " << Resampler::QualityName((Resampler::Quality)q);
+            EXPECT_EQ((int64_t)kRates[i].mOutputRate, resampler->numFramesProduced());
+            EXPECT_EQ(0ll, firstTimeUs);
+        }
+    }
+}
+
+TEST(ResamplerTest, PassesTonesInThePassband) {
+    // Well below the -6 dB point of each quality.
+    static const double kPassbandEdgeHz[Resampler::NUM_QUALITIES] = {
+        10000.0, 15000.0, 17000.0,
+    };
+
+    for (int q = 0; q < Resampler::NUM_QUALITIES; ++q) {
+        const double frequencies[] = { 100.0, 1000.0, kPassbandEdgeHz[q] };
+
+        for (size_t i = 0; i < sizeof(frequencies) / sizeof(frequencies[0]); ++i) {
+            sp<Resampler> resampler = new Resampler(
+                    44100, 48000, kChannelCount, AUDIO_FORMAT_PCM_16_BIT,
+                    (Resampler::Quality)q);
+
+            Vector<int16_t> input;
+            MakeTone(&input, 44100, frequencies[i], 0.5);
+
+            Vector<int16_t> output;
+            int64_t firstTimeUs;
+            Resample(resampler, input, 1024, &output, &firstTimeUs);
+
+            // Within 0.2 dB of the 0.5 / sqrt(2) the tone has.
+            double gainDb = 20.0 * log10(Rms(output, 0, 1000) / (0.5 * M_SQRT1_2));
+            EXPECT_NEAR(0.0, gainDb, 0.2)
+                    << frequencies[i] << " Hz, "
+                    << Resampler::QualityName((Resampler::Quality)q);
+            EXPECT_NEAR(Rms(output, 0, 1000), Rms(output, 1, 1000), 1E-4);
+        }
+    }
+}
+
+TEST(ResamplerTest, RejectsTonesAboveTheOutputNyquistFrequency) {
+    static const double kMinAttenuationDb[Resampler::NUM_QUALITIES] = { 40.0, 60.0, 80.0 };
+
+    for (int q = 0; q < Resampler::NUM_QUALITIES; ++q) {
+        sp<Resampler> resampler = new Resampler(
+                48000, 22050, kChannelCount, AUDIO_FORMAT_PCM_16_BIT, (Resampler::Quality)q);
+
+        // Would alias to 6 kHz.
+        Vector<int16_t> input;
+        MakeTone(&input, 48000, 16050.0, 0.5);
+
+        Vector<int16_t> output;
+        int64_t firstTimeUs;
+        Resample(resampler, input, 1024, &output, &firstTimeUs);
+
+        double gainDb = 20.0 * log10(Rms(output, 0, 1000) / (0.5 * M_SQRT1_2) + 1E-9);
+        EXPECT_LT(gainDb, -kMinAttenuationDb[q])
+                << Resampler::QualityName((Resampler::Quality)q);
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleBufferPool_test"
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+
+#include "SampleBufferPool.h"
+
+namespace android {
+
+TEST(SampleBufferPoolTest, ReusesReleasedBuffers) {
+    sp<SampleBufferPool> pool = new SampleBufferPool(1024, 4);
+
+    sp<ABuffer> buffer = pool->acquire(100);
+    EXPECT_EQ(100u, buffer->size());
+    EXPECT_EQ(1024u, buffer->capacity());
+    pool->release(buffer);
+
+    sp<ABuffer> again = pool->acquire(50);
+    EXPECT_EQ(buffer.get(), again.get());
+    EXPECT_EQ(50u, again->size());
+    EXPECT_EQ(1, pool->numHits());
+    EXPECT_EQ(1, pool->numMisses());
+}
+
+TEST(SampleBufferPoolTest, GrowsForLargerSamples) {
+    sp<SampleBufferPool> pool = new SampleBufferPool(1024, 4);
+
+    sp<ABuffer> small = pool->acquire(1024);
+    sp<ABuffer> large = pool->acquire(4096);
+    EXPECT_GE(large->capacity(), 4096u);
+
+    // Too small for what the track has shown it needs.
+    pool->release(small);
+    sp<ABuffer> next = pool->acquire(16);
+    EXPECT_NE(small.get(), next.get());
+    EXPECT_GE(next->capacity(), 4096u);
+    EXPECT_EQ(0, pool->numHits());
+
+    pool->release(large);
+    EXPECT_EQ(large.get(), pool->acquire(4096).get());
+    EXPECT_EQ(1, pool->numHits());
+}
+
+TEST(SampleBufferPoolTest, KeepsAtMostMaxBuffers) {
+    sp<SampleBufferPool> pool = new SampleBufferPool(256, 2);
+
+    sp<ABuffer> buffers[3];
+    for (size_t i = 0; i < 3; ++i) {
+        buffers[i] = pool->acquire(256);
+    }
+    for (size_t i = 0; i < 3; ++i) {
+        pool->release(buffers[i]);
+    }
+
+    for (size_t i = 0; i < 3; ++i) {
+        pool->acquire(256);
+    }
+    EXPECT_EQ(2, pool->numHits());
+    EXPECT_EQ(4, pool->numMisses());
+}
+
+TEST(SampleBufferPoolTest, ReusesViewsOfTheSameMemory) {
+    sp<SampleBufferPool> pool = new SampleBufferPool(256, 2);
+    uint8_t memory[2][64];
+
+    sp<ABuffer> view = pool->wrap(0, memory[0], sizeof(memory[0]));
+    EXPECT_EQ(memory[0], view->data());
+    view->setRange(0, 10);
+
+    sp<ABuffer> again = pool->wrap(0, memory[0], sizeof(memory[0]));
+    EXPECT_EQ(view.get(), again.get());
+    EXPECT_EQ(sizeof(memory[0]), again->size());
+
+    // The codec may hand out other memory under the same index.
+    sp<ABuffer> other = pool->wrap(0, memory[1], sizeof(memory[1]));
+    EXPECT_NE(view.get(), other.get());
+    EXPECT_EQ(memory[1], other->data());
+
+    EXPECT_NE(other.get(), pool->wrap(1, memory[1], sizeof(memory[1])).get());
+
+    EXPECT_EQ(1, pool->numWrapHits());
+    EXPECT_EQ(3, pool->numWrapMisses());
+    EXPECT_EQ(0, pool->numHits());
+}
+
+}  // namespace android
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleIndexFile_test"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MetaData.h>
+
+#include "SampleIndexFile.h"
+
+namespace android {
+
+// Where the fields the corruption cases change sit in the sidecar.
+static const off_t kSamplesOffsetPos = 32;
+static const off_t kNumSyncSamplesPos = 52;
+
+static const size_t kNumSamples = 6;
+static const size_t kSampleSize = 100;
+
+class SampleIndexFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mMediaPath.setTo(mDir.path);
+        mMediaPath.append("/media.bin");
+        mIndexPath = SampleIndexFile::SidecarPath(mMediaPath.c_str());
+
+        // Samples of kSampleSize bytes each holding its number, after a
+        // header of the same size.
+        int fd = open(mMediaPath.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+        ASSERT_GE(fd, 0);
+        for (size_t i = 0; i <= kNumSamples; ++i) {
+            memset(mSample, i, sizeof(mSample));
+            ASSERT_EQ((ssize_t)sizeof(mSample), write(fd, mSample, sizeof(mSample)));
+        }
+        close(fd);
+
+        ASSERT_EQ(0, stat(mMediaPath.c_str(), &mMediaStat));
+
+        mFormat = new AMessage;
+        mFormat->setString("mime", "audio/mp4a-latm");
+        mFormat->setInt32("sample-rate", 48000);
+        sp<ABuffer> csd = new ABuffer(2);
+        csd->data()[0] = 0x11;
+        csd->data()[1] = 0x90;
+        mFormat->setBuffer("csd-0", csd);
+    }
+
+    // Every sample read the way the extractor hands it out, every third
+    // one a sync sample.
+    sp<SampleIndexWriter> writeIndex(bool reportOffsets = true) {
+        sp<SampleIndexWriter> writer = new SampleIndexWriter(mMediaPath.c_str(), mMediaStat);
+        writer->addTrack(0, mFormat);
+
+        for (size_t i = 0; i < kNumSamples; ++i) {
+            sp<MetaData> meta = new MetaData;
+            if (reportOffsets) {
+                meta->setInt64(kKeySampleFileOffset, (i + 1) * kSampleSize);
+            }
+            meta->setInt64(kKeyTime, i * 20000ll);
+            meta->setInt32(kKeyIsSyncFrame, i % 3 == 0);
+
+            sp<ABuffer> data = new ABuffer(kSampleSize);
+            memset(data->data(), i + 1, kSampleSize);
+            writer->addSample(0, meta, data);
+        }
+
+        return writer;
+    }
+
+    void patchIndex(off_t pos, const void *data, size_t size) {
+        int fd = open(mIndexPath.c_str(), O_WRONLY | O_CLOEXEC);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ((ssize_t)size, pwrite(fd, data, size, pos));
+        close(fd);
+    }
+
+    TemporaryDir mDir;
+    AString mMediaPath;
+    AString mIndexPath;
+    struct stat mMediaStat;
+    sp<AMessage> mFormat;
+    uint8_t mSample[kSampleSize];
+};
+
+TEST_F(SampleIndexFileTest, RoundTrips) {
+    ASSERT_EQ((status_t)OK, writeIndex()->finish());
+
+    sp<SampleIndexFile> index = SampleIndexFile::Open(mIndexPath.c_str(), mMediaStat);
+    ASSERT_TRUE(index != NULL);
+
+    ASSERT_EQ(1u, index->countTracks());
+    EXPECT_EQ(0u, index->getTrackFlags(0));
+
+    sp<AMessage> format = index->getTrackFormat(0);
+    AString mime;
+    int32_t sampleRate;
+    sp<ABuffer> csd;
+    ASSERT_TRUE(format->findString("mime", &mime));
+    EXPECT_STREQ("audio/mp4a-latm", mime.c_str());
+    ASSERT_TRUE(format->findInt32("sample-rate", &sampleRate));
+    EXPECT_EQ(48000, sampleRate);
+    ASSERT_TRUE(format->findBuffer("csd-0", &csd));
+    ASSERT_EQ(2u, csd->size());
+    EXPECT_EQ(0x11, csd->data()[0]);
+    EXPECT_EQ(0x90, csd->data()[1]);
+
+    ASSERT_EQ(kNumSamples, index->countSamples());
+    for (size_t i = 0; i < kNumSamples; ++i) {
+        const SampleIndexFile::SampleEntry &entry = index->sampleAt(i);
+        EXPECT_EQ((int64_t)((i + 1) * kSampleSize), entry.mOffset);
+        EXPECT_EQ((int64_t)i * 20000ll, entry.mTimeUs);
+        EXPECT_EQ(kSampleSize, entry.mSize);
+        EXPECT_EQ(0u, entry.mTrack);
+        EXPECT_EQ(i % 3 == 0, (entry.mFlags & SampleIndexFile::kSampleFlagSync) != 0);
+    }
+
+    ASSERT_EQ(2u, index->countSyncSamples(0));
+    EXPECT_EQ(0u, index->syncSampleAt(0, 0));
+    EXPECT_EQ(3u, index->syncSampleAt(0, 1));
+}
+
+TEST_F(SampleIndexFileTest, IgnoresAChangedMediaFile) {
+    ASSERT_EQ((status_t)OK, writeIndex()->finish());
+
+    struct stat changed = mMediaStat;
+    changed.st_size += 1;
+    EXPECT_TRUE(SampleIndexFile::Open(mIndexPath.c_str(), changed) == NULL);
+
+    changed = mMediaStat;
+    changed.st_mtim.tv_nsec ^= 1;
+    EXPECT_TRUE(SampleIndexFile::Open(mIndexPath.c_str(), changed) == NULL);
+}
+
+TEST_F(SampleIndexFileTest, RejectsSamplesOffsetInsideTheHeader) {
+    ASSERT_EQ((status_t)OK, writeIndex()->finish());
+
+    uint64_t samplesOffset = 8;
+    patchIndex(kSamplesOffsetPos, &samplesOffset, sizeof(samplesOffset));
+    EXPECT_TRUE(SampleIndexFile::Open(mIndexPath.c_str(), mMediaStat) == NULL);
+}
+
+TEST_F(SampleIndexFileTest, RejectsSyncSamplesPastTheEnd) {
+    ASSERT_EQ((status_t)OK, writeIndex()->finish());
+
+    uint32_t numSyncSamples = 0x40000000;
+    patchIndex(kNumSyncSamplesPos, &numSyncSamples, sizeof(numSyncSamples));
+    EXPECT_TRUE(SampleIndexFile::Open(mIndexPath.c_str(), mMediaStat) == NULL);
+}
+
+TEST_F(SampleIndexFileTest, RejectsATruncatedIndex) {
+    ASSERT_EQ((status_t)OK, writeIndex()->finish());
+
+    struct stat st;
+    ASSERT_EQ(0, stat(mIndexPath.c_str(), &st));
+    ASSERT_EQ(0, truncate(mIndexPath.c_str(), st.st_size - 4));
+    EXPECT_TRUE(SampleIndexFile::Open(mIndexPath.c_str(), mMediaStat) == NULL);
+}
+
+TEST_F(SampleIndexFileTest, AbandonsWithoutSampleOffsets) {
+    EXPECT_EQ((status_t)OK, writeIndex(false /* reportOffsets */)->finish());
+    EXPECT_NE(0, access(mIndexPath.c_str(), F_OK));
+}
+
+TEST_F(SampleIndexFileTest, AbandonsWhenSamplesDifferFromTheFile) {
+    // The last sample is checked by finish() from the start it kept.
+    memset(mSample, 0x7f, sizeof(mSample));
+    int fd = open(mMediaPath.c_str(), O_WRONLY | O_CLOEXEC);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ((ssize_t)sizeof(mSample),
+              pwrite(fd, mSample, sizeof(mSample), kNumSamples * kSampleSize));
+    close(fd);
+
+    EXPECT_EQ((status_t)OK, writeIndex()->finish());
+    EXPECT_NE(0, access(mIndexPath.c_str(), F_OK));
+}
+
+}  // namespace android
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleQueue_test"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+
+#include "SampleQueue.h"
+
+namespace android {
+
+static sp<ABuffer> makeSample(uint32_t n) {
+    sp<ABuffer> buffer = new ABuffer(sizeof(n));
+    memcpy(buffer->data(), &n, sizeof(n));
+    return buffer;
+}
+
+static uint32_t sampleNumber(const sp<ABuffer> &buffer) {
+    uint32_t n;
+    memcpy(&n, buffer->data(), sizeof(n));
+    return n;
+}
+
+TEST(SampleQueueTest, RoundsCapacityUpToPowerOfTwo) {
+    static const struct {
+        size_t mRequested;
+        size_t mCapacity;
+    } kCases[] = {
+        { 1, 1 }, { 5, 8 }, { 256, 256 }, { 257, 512 },
+    };
+
+    for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); ++i) {
+        sp<SampleQueue> queue = new SampleQueue(kCases[i].mRequested);
+        EXPECT_EQ(kCases[i].mCapacity, queue->capacity());
+    }
+}
+
+TEST(SampleQueueTest, KeepsOrderAcrossWrapAround) {
+    sp<SampleQueue> queue = new SampleQueue(4);
+    sp<ABuffer> buffer;
+    EXPECT_TRUE(queue->empty());
+    EXPECT_FALSE(queue->pop(&buffer));
+
+    uint32_t pushed = 0, popped = 0;
+    for (size_t round = 0; round < 5; ++round) {
+        while (queue->push(makeSample(pushed))) {
+            ++pushed;
+        }
+        EXPECT_TRUE(queue->full());
+        EXPECT_EQ(4u, queue->size());
+
+        // Leave one behind so the next round starts mid-ring.
+        for (size_t i = 0; i < 3; ++i) {
+            ASSERT_TRUE(queue->pop(&buffer));
+            EXPECT_EQ(popped++, sampleNumber(buffer));
+        }
+        EXPECT_EQ(1u, queue->size());
+    }
+
+    ASSERT_TRUE(queue->pop(&buffer));
+    EXPECT_EQ(popped, sampleNumber(buffer));
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(SampleQueueTest, HandsOverEverySampleBetweenThreads) {
+    static const uint32_t kNumSamples = 100000;
+    sp<SampleQueue> queue = new SampleQueue(16);
+
+    std::thread producer([queue]() {
+        for (uint32_t n = 0; n < kNumSamples;) {
+            if (queue->push(makeSample(n))) {
+                ++n;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t next = 0;
+    while (next < kNumSamples) {
+        sp<ABuffer> buffer;
+        if (!queue->pop(&buffer)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(next, sampleNumber(buffer));
+        ++next;
+    }
+
+    producer.join();
+    EXPECT_TRUE(queue->empty());
+}
+
+}  // namespace android
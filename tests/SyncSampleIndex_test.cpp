@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SyncSampleIndex_test"
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/MetaData.h>
+
+#include "SampleSource.h"
+#include "SyncSampleIndex.h"
+
+namespace android {
+
+// Only reports the metadata of the sample it is set to.
+struct FakeSampleSource : public SampleSource {
+    FakeSampleSource() : mMeta(new MetaData) {}
+
+    void setSample(int64_t timeUs, bool isSync) {
+        mMeta->setInt64(kKeyTime, timeUs);
+        mMeta->setInt32(kKeyIsSyncFrame, isSync);
+    }
+
+    size_t countTracks() const override { return 1; }
+    status_t getTrackFormat(size_t, sp<AMessage> *) const override { return INVALID_OPERATION; }
+    status_t selectTrack(size_t) override { return OK; }
+    status_t seekTo(int64_t, MediaSource::ReadOptions::SeekMode) override {
+        return INVALID_OPERATION;
+    }
+    status_t advance() override { return INVALID_OPERATION; }
+    status_t readSampleData(const sp<ABuffer> &) override { return INVALID_OPERATION; }
+    status_t getSampleSize(size_t *) override { return INVALID_OPERATION; }
+    status_t getSampleTrackIndex(size_t *) override { return INVALID_OPERATION; }
+    status_t getSampleTime(int64_t *) override { return INVALID_OPERATION; }
+    status_t getSampleMeta(sp<MetaData> *sampleMeta) override {
+        *sampleMeta = mMeta;
+        return OK;
+    }
+
+private:
+    sp<MetaData> mMeta;
+};
+
+// 30 samples per second, a sync sample every second.
+static void addSamples(const sp<SyncSampleIndex> &index, int64_t fromUs, int64_t toUs) {
+    for (int64_t n = fromUs * 30 / 1000000ll; n < toUs * 30 / 1000000ll; ++n) {
+        index->addSample(n * 1000000ll / 30, n % 30 == 0);
+    }
+}
+
+TEST(SyncSampleIndexTest, FindsSyncSamplesAroundATime) {
+    sp<SyncSampleIndex> index = new SyncSampleIndex;
+    addSamples(index, 0ll, 3000000ll);
+    EXPECT_EQ(3u, index->size());
+
+    int64_t syncTimeUs;
+    ASSERT_TRUE(index->findPrevious(1500000ll, &syncTimeUs));
+    EXPECT_EQ(1000000ll, syncTimeUs);
+    ASSERT_TRUE(index->findPrevious(2000000ll, &syncTimeUs));
+    EXPECT_EQ(2000000ll, syncTimeUs);
+
+    ASSERT_TRUE(index->findNext(1500000ll, &syncTimeUs));
+    EXPECT_EQ(2000000ll, syncTimeUs);
+    ASSERT_TRUE(index->findNext(0ll, &syncTimeUs));
+    EXPECT_EQ(0ll, syncTimeUs);
+}
+
+TEST(SyncSampleIndexTest, OnlyAnswersForWhatWasRead) {
+    sp<SyncSampleIndex> index = new SyncSampleIndex;
+
+    int64_t syncTimeUs;
+    EXPECT_FALSE(index->findPrevious(0ll, &syncTimeUs));
+
+    addSamples(index, 0ll, 2500000ll);
+
+    // The next sync sample at 3 s has not been read, nor has anything
+    // past the last sample.
+    EXPECT_FALSE(index->findNext(2200000ll, &syncTimeUs));
+    EXPECT_FALSE(index->findNext(5000000ll, &syncTimeUs));
+    EXPECT_FALSE(index->findPrevious(5000000ll, &syncTimeUs));
+}
+
+TEST(SyncSampleIndexTest, StopsGrowingAcrossAHole) {
+    sp<SyncSampleIndex> index = new SyncSampleIndex;
+    addSamples(index, 0ll, 2500000ll);
+
+    // Seeked ahead, what lies in between was never read.
+    index->onSeek(6000000ll);
+    addSamples(index, 6000000ll, 7500000ll);
+    EXPECT_EQ(3u, index->size());
+
+    int64_t syncTimeUs;
+    EXPECT_FALSE(index->findPrevious(6500000ll, &syncTimeUs));
+
+    // Back inside the covered range, the index grows from there again.
+    index->onSeek(2000000ll);
+    addSamples(index, 2000000ll, 4500000ll);
+    EXPECT_EQ(5u, index->size());
+    ASSERT_TRUE(index->findNext(2200000ll, &syncTimeUs));
+    EXPECT_EQ(3000000ll, syncTimeUs);
+}
+
+TEST(SyncSampleIndexTest, RecordsTheCurrentSampleOnce) {
+    sp<SyncSampleIndex> index = new SyncSampleIndex;
+    sp<FakeSampleSource> source = new FakeSampleSource;
+
+    source->setSample(0ll, true /* isSync */);
+    EXPECT_TRUE(index->addCurrentSample(source));
+    source->setSample(33333ll, false /* isSync */);
+    EXPECT_FALSE(index->addCurrentSample(source));
+    source->setSample(1000000ll, true /* isSync */);
+    EXPECT_TRUE(index->addCurrentSample(source));
+
+    // Read again after seeking back.
+    index->onSeek(0ll);
+    source->setSample(0ll, true /* isSync */);
+    EXPECT_TRUE(index->addCurrentSample(source));
+    EXPECT_EQ(2u, index->size());
+}
+
+}  // namespace android
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "TimeStretcher_test"
+
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+#include <utils/Vector.h>
+
+#include "TimeStretcher.h"
+
+namespace android {
+
+static const uint32_t kSampleRate = 48000;
+static const int32_t kChannelCount = 2;
+
+// A second of a 440 Hz tone with a different level per channel.
+static void MakeTone(Vector<int16_t> *samples) {
+    samples->resize(kSampleRate * kChannelCount);
+    for (size_t i = 0; i < kSampleRate; ++i) {
+        float value = sinf(2.0f * M_PI * 440.0f * i / kSampleRate);
+        samples->editItemAt(i * kChannelCount) = (int16_t)(value * 16000.0f);
+        samples->editItemAt(i * kChannelCount + 1) = (int16_t)(value * 8000.0f);
+    }
+}
+
+static void Drain(
+        const sp<TimeStretcher> &stretcher, Vector<int16_t> *output, int64_t *firstTimeUs) {
+    const void *data;
+    int64_t timeUs;
+    size_t n;
+    while ((n = stretcher->getOutput(&data, &timeUs)) > 0) {
+        if (*firstTimeUs < 0ll) {
+            *firstTimeUs = timeUs;
+        }
+        output->appendArray(static_cast<const int16_t *>(data), n * kChannelCount);
+        stretcher->consumeOutput(n);
+    }
+}
+
+// Queues the input in chunks of chunkFrames and collects all output up to
+// the end of stream.
+static void Stretch(
+        const sp<TimeStretcher> &stretcher, const Vector<int16_t> &input,
+        size_t chunkFrames, Vector<int16_t> *output, int64_t *firstTimeUs) {
+    size_t numFrames = input.size() / kChannelCount;
+    *firstTimeUs = -1ll;
+
+    for (size_t frame = 0; frame < numFrames; frame += chunkFrames) {
+        size_t n = numFrames - frame < chunkFrames ? numFrames - frame : chunkFrames;
+        stretcher->queueInput(
+                input.array() + frame * kChannelCount, n, frame * 1000000ll / kSampleRate);
+        Drain(stretcher, output, firstTimeUs);
+    }
+
+    stretcher->signalEndOfStream();
+    Drain(stretcher, output, firstTimeUs);
+}
+
+TEST(TimeStretcherTest, PassesInputThroughAtUnityRate) {
+    Vector<int16_t> input;
+    MakeTone(&input);
+
+    sp<TimeStretcher> stretcher = new TimeStretcher(kSampleRate, kChannelCount);
+    Vector<int16_t> output;
+    int64_t firstTimeUs;
+    Stretch(stretcher, input, 1000, &output, &firstTimeUs);
+
+    EXPECT_EQ(0ll, firstTimeUs);
+    ASSERT_EQ(input.size(), output.size());
+    EXPECT_EQ(0, memcmp(input.array(), output.array(), input.size() * sizeof(int16_t)));
+}
+
+TEST(TimeStretcherTest, OutputLengthFollowsTheRate) {
+    static const float kRates[] = { 0.5f, 0.8f, 1.25f, 2.0f };
+
+    Vector<int16_t> input;
+    MakeTone(&input);
+    size_t numInputFrames = input.size() / kChannelCount;
+
+    for (size_t i = 0; i < sizeof(kRates) / sizeof(kRates[0]); ++i) {
+        sp<TimeStretcher> stretcher = new TimeStretcher(kSampleRate, kChannelCount);
+        stretcher->setRate(kRates[i]);
+
+        Vector<int16_t> output;
+        int64_t firstTimeUs;
+        Stretch(stretcher, input, 960, &output, &firstTimeUs);
+
+        // Hops start on whole frames, which adds up to well under a percent.
+        size_t numOutputFrames = output.size() / kChannelCount;
+        double expected = numInputFrames / kRates[i];
+        EXPECT_NEAR(expected, numOutputFrames, expected / 100.0) << "rate " << kRates[i];
+        EXPECT_EQ((int64_t)numOutputFrames, stretcher->numFramesProduced());
+        EXPECT_EQ(0ll, firstTimeUs);
+    }
+}
+
+TEST(TimeStretcherTest, KeepsTheToneLevel) {
+    Vector<int16_t> input;
+    MakeTone(&input);
+
+    sp<TimeStretcher> stretcher = new TimeStretcher(kSampleRate, kChannelCount);
+    stretcher->setRate(1.5f);
+
+    Vector<int16_t> output;
+    int64_t firstTimeUs;
+    Stretch(stretcher, input, 960, &output, &firstTimeUs);
+
+    // Segments of a steady tone line up, the cross-fades neither cancel
+    // nor add up. The end is faded into silence and left out.
+    size_t numFrames = output.size() / kChannelCount - kSampleRate / 20;
+    double energy = 0.0;
+    for (size_t i = 0; i < numFrames; ++i) {
+        double value = output[i * kChannelCount] / 16000.0;
+        energy += value * value;
+    }
+    EXPECT_NEAR(0.5, energy / numFrames, 0.02);
+}
+
+TEST(TimeStretcherTest, StartsOverAfterFlush) {
+    Vector<int16_t> input;
+    MakeTone(&input);
+
+    sp<TimeStretcher> stretcher = new TimeStretcher(kSampleRate, kChannelCount);
+    stretcher->setRate(2.0f);
+    stretcher->queueInput(input.array(), kSampleRate / 2, 0ll);
+
+    const void *data;
+    int64_t timeUs;
+    ASSERT_GT(stretcher->getOutput(&data, &timeUs), 0u);
+
+    stretcher->flush();
+    EXPECT_EQ(0u, stretcher->getOutput(&data, &timeUs));
+
+    stretcher->queueInput(input.array(), kSampleRate / 2, 5000000ll);
+    ASSERT_GT(stretcher->getOutput(&data, &timeUs), 0u);
+    EXPECT_EQ(5000000ll, timeUs);
+}
+
+}  // namespace android